@@ -0,0 +1,376 @@
+/**
+ * Functions to measure how fast the parser is. The page is read into
+ * memory first, so that neither the network nor the disk is measured,
+ * and is then parsed as many times as asked for, without anything
+ * being layouted or shown. How long it takes to delete the parts again,
+ * and to layout them, is measured as well.
+ *
+ * The user interface only has to be initialised, and not opened, for
+ * this. The parser asks it nothing but what it supports and the font
+ * sizes in its settings, which are both known after ui_init() and
+ * settings_read_interface(), and it never draws anything. The layouter
+ * also measures text with the interface, which the dump and psdump
+ * interfaces can do without being opened.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "protocol.h"
+#include "parse.h"
+#include "layout.h"
+#include "benchmark.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/**
+ * Read everything from a stream into memory.
+ *
+ * @param fd The file descriptor of the stream.
+ * @param length A pointer to where the number of bytes read is placed.
+ *
+ * @return a pointer to the allocated data, or NULL if an error occurred.
+ */
+static char *benchmark_read(int fd, size_t *length)
+{
+  char *data, *tmp;
+  size_t size;
+  int bytes;
+
+  size = BENCHMARK_READ_SIZE;
+  data = (char *)malloc(size);
+  if(data == NULL)
+    return NULL;
+
+  *length = 0;
+  while((bytes = read(fd, data + *length, size - *length)) > 0) {
+    *length += bytes;
+    if(*length == size) {
+      size *= 2;
+      tmp = (char *)realloc(data, size);
+      if(tmp == NULL) {
+	free(data);
+	return NULL;
+      }
+      data = tmp;
+    }
+  }
+
+  if(bytes < 0) {
+    free(data);
+    return NULL;
+  }
+
+  return data;
+}
+
+/**
+ * Read a whole page into memory.
+ *
+ * @param url The URL of the page.
+ * @param length A pointer to where the number of bytes read is placed.
+ * @param charset A pointer to where the charset of the page is placed,
+ * @param charset or NULL if the server did not tell it. It should be
+ * @param charset freed by the caller.
+ *
+ * @return a pointer to the allocated data, or NULL if an error occurred.
+ */
+char *benchmark_read_page(char *url, size_t *length, char **charset)
+{
+  struct protocol_http_headers *headers;
+  char *data;
+  int fd;
+
+  *charset = NULL;
+
+  fd = protocol_open(url, NULL, NULL);
+  if(fd < 0) {
+    fprintf(stderr, "Could not open %s\n", url);
+    return NULL;
+  }
+
+  headers = protocol_get_headers(fd);
+  if(headers != NULL && headers->charset != NULL) {
+    *charset = (char *)malloc(strlen(headers->charset) + 1);
+    if(*charset != NULL)
+      strcpy(*charset, headers->charset);
+  }
+
+  data = benchmark_read(fd, length);
+  protocol_close(fd);
+  if(data == NULL) {
+    fprintf(stderr, "Could not read %s\n", url);
+    if(*charset != NULL)
+      free(*charset);
+    *charset = NULL;
+  }
+
+  return data;
+}
+
+/**
+ * Count the parts in a linked list, and everything under them.
+ *
+ * @param parts A pointer to the first part in the list.
+ *
+ * @return the number of parts.
+ */
+static int benchmark_count_parts(struct layout_part *parts)
+{
+  struct layout_part *partp;
+  int count;
+
+  count = 0;
+  for(partp = parts ; partp ; partp = partp->next) {
+    count++;
+    if(partp->child != NULL)
+      count += benchmark_count_parts(partp->child);
+  }
+
+  return count;
+}
+
+/**
+ * Parse a page from memory once, into a page of its own.
+ *
+ * @param url The URL of the page.
+ * @param data The whole page.
+ * @param length The number of bytes in the page.
+ * @param charset The charset of the page, or NULL for ISO-8859-1.
+ * @param time A pointer to where the number of microseconds it took to
+ * @param time parse the page is placed.
+ * @param stats A pointer to where the counters of the parser are placed.
+ *
+ * @return a pointer to the page information part of the page, or NULL
+ * @return if an error occurred.
+ */
+struct layout_part *benchmark_parse(char *url, char *data, size_t length,
+				    char *charset, long *time,
+				    struct parse_statistics *stats)
+{
+  struct layout_part *page;
+  struct parse_context *context;
+  struct timeval start, end;
+  int ret;
+
+  page = layout_init_part(NULL, LAYOUT_PART_PAGE_INFORMATION);
+  if(page == NULL)
+    return NULL;
+  page->data.page_information.url = layout_alloc_string(page,
+							strlen(url) + 1);
+  if(page->data.page_information.url == NULL) {
+    layout_free_part(page);
+    return NULL;
+  }
+  strcpy(page->data.page_information.url, url);
+
+  context = parse_context_new(page);
+  if(context == NULL) {
+    layout_delete_all_parts(page);
+    return NULL;
+  }
+  parse_context_set_input(context, data, length);
+  if(charset != NULL)
+    parse_context_set_charset(context, charset);
+
+  gettimeofday(&start, NULL);
+  ret = parse_html(context, -1);
+  gettimeofday(&end, NULL);
+  parse_context_get_statistics(context, stats);
+  parse_context_free(context);
+
+  *time = (end.tv_sec - start.tv_sec) * 1000000L + 
+    (end.tv_usec - start.tv_usec);
+
+  if(ret != 0) {
+    layout_delete_all_parts(page);
+    return NULL;
+  }
+
+  return page;
+}
+
+/**
+ * Delete a page, and measure how long it takes.
+ *
+ * @param page A pointer to the page information part of the page.
+ *
+ * @return the number of microseconds it took.
+ */
+static long benchmark_delete(struct layout_part *page)
+{
+  struct timeval start, end;
+
+  gettimeofday(&start, NULL);
+  layout_delete_all_parts(page);
+  gettimeofday(&end, NULL);
+
+  return (end.tv_sec - start.tv_sec) * 1000000L +
+    (end.tv_usec - start.tv_usec);
+}
+
+/**
+ * Layout a page a number of times, and measure how long it takes at
+ * best. The first time, the widths of the contents of table cells are
+ * measured as well, which later times find already known, just as when
+ * a shown page is layouted again.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param rounds The number of times to layout the page.
+ *
+ * @return the number of microseconds it took at best, or a negative
+ * @return value if an error occurred.
+ */
+static long benchmark_layout(struct layout_part *page, int rounds)
+{
+  struct timeval start, end;
+  long time, best;
+  int i;
+
+  best = 0;
+  for(i = 0 ; i < rounds ; i++) {
+    gettimeofday(&start, NULL);
+    if(layout_relayout(page, BENCHMARK_LAYOUT_WIDTH) != 0)
+      return -1;
+    gettimeofday(&end, NULL);
+
+    time = (end.tv_sec - start.tv_sec) * 1000000L +
+      (end.tv_usec - start.tv_usec);
+    if(i == 0 || time < best)
+      best = time;
+  }
+
+  return best;
+}
+
+/**
+ * Parse a page a number of times from memory, and print how fast it
+ * went on stderr. The parts of the last time are then printed on stdout
+ * with debug_dump_parts(), which lets anyone see if a change to the 
+ * parser changed what it makes out of the page, in the same run. At
+ * last, the page is parsed once more and layouted the same number of
+ * times, to measure how fast the layouter is as well.
+ *
+ * @param url The URL of the page to parse.
+ * @param rounds The number of times to parse the page.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int benchmark_parser(char *url, int rounds)
+{
+  struct parse_statistics stats;
+  struct layout_part *page;
+  char *data, *charset;
+  size_t length;
+  long time, best, total, delete_time, delete_best, layout_best;
+  int i, parts;
+
+  data = benchmark_read_page(url, &length, &charset);
+  if(data == NULL)
+    return 1;
+
+  page = NULL;
+  best = total = 0;
+  delete_best = 0;
+  for(i = 0 ; i < rounds ; i++) {
+    if(page != NULL) {
+      delete_time = benchmark_delete(page);
+      if(i == 1 || delete_time < delete_best)
+	delete_best = delete_time;
+    }
+
+    page = benchmark_parse(url, data, length, charset, &time, &stats);
+    if(page == NULL) {
+      fprintf(stderr, "Could not parse %s\n", url);
+      break;
+    }
+
+    total += time;
+    if(i == 0 || time < best)
+      best = time;
+  }
+
+  if(page == NULL) {
+    free(data);
+    if(charset != NULL)
+      free(charset);
+    return 1;
+  }
+
+  /* Avoid dividing by zero for very small pages. */
+  if(best == 0)
+    best = 1;
+
+  parts = benchmark_count_parts(page);
+  debug_dump_parts(page, 0);
+
+  delete_time = benchmark_delete(page);
+  if(rounds == 1 || delete_time < delete_best)
+    delete_best = delete_time;
+
+  layout_best = -1;
+  page = benchmark_parse(url, data, length, charset, &time, &stats);
+  if(page != NULL) {
+    layout_best = benchmark_layout(page, rounds);
+    layout_delete_all_parts(page);
+  }
+
+  free(data);
+  if(charset != NULL)
+    free(charset);
+
+  fprintf(stderr, 
+	  "Parsed %lu bytes %d times in %ld ms, at best in %ld us.\n"
+	  "%.2f MB/s, %d parts, %.2f parts per KB.\n"
+	  "%lu arena allocations, %.2f per KB, %lu resizes, %lu resets, "
+	  "%lu blocks from malloc, %lu bytes at most.\n"
+	  "Other threads were let to run %lu times.\n"
+	  "Deleted the parts at best in %ld us.\n",
+	  (unsigned long)length, rounds, total / 1000, best,
+	  (double)length / best, parts, 
+	  length ? (double)parts * 1024 / length : 0.0,
+	  stats.allocations,
+	  length ? (double)stats.allocations * 1024 / length : 0.0,
+	  stats.resizes, stats.resets, stats.blocks,
+	  (unsigned long)stats.peak_bytes, stats.yields, delete_best);
+
+  if(layout_best < 0) {
+    fprintf(stderr, "Could not layout %s\n", url);
+    return 1;
+  }
+
+  fprintf(stderr, "Layouted it %d pixels wide at best in %ld us.\n",
+	  BENCHMARK_LAYOUT_WIDTH, layout_best);
+
+  return 0;
+}
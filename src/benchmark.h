@@ -0,0 +1,44 @@
+/** 
+ * Prototypes for the functions that measure how fast a page is parsed.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* The number of bytes read from the stream at a time, while the page is
+ * read into memory.
+ */
+#define BENCHMARK_READ_SIZE  16384
+
+/* The width the page is layouted at. */
+#define BENCHMARK_LAYOUT_WIDTH  640
+
+/* Function prototypes. */
+extern char *benchmark_read_page(char *url, size_t *length, char **charset);
+extern struct layout_part *benchmark_parse(char *url, char *data,
+					   size_t length, char *charset,
+					   long *time,
+					   struct parse_statistics *stats);
+extern int benchmark_parser(char *url, int rounds);
+
+#endif /* _BENCHMARK_H_ */
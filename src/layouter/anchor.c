@@ -0,0 +1,361 @@
+/**
+ * Functions which keep track of the named places on a page, so that a
+ * URL with a fragment can be shown at the right place, without looking
+ * through all the parts of the page to find it.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "layout.h"
+#include "protocol.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/* The number of buckets in a new index. The index is made twice as
+ * large whenever it holds twice as many places as it has buckets.
+ */
+#define LAYOUT_ANCHOR_BUCKETS  64
+
+/**
+ * Calculate the hash value of the name of a place.
+ *
+ * @param name The name of the place.
+ * @param size The number of buckets in the index.
+ *
+ * @return the bucket the place belongs in.
+ */
+static int layout_anchor_hash(char *name, int size)
+{
+  unsigned int hash;
+
+  hash = 0;
+  while(*name)
+    hash = hash * 31 + (unsigned char)*name++;
+
+  return hash % size;
+}
+
+/**
+ * Make the index twice as large, and move all places into the buckets
+ * where they now belong. If there is no memory for it, the index is
+ * just left as it is.
+ *
+ * @param index The index to make larger.
+ */
+static void layout_grow_anchors(struct layout_anchor_index *index)
+{
+  struct layout_anchor **buckets, *anchor, *next;
+  int i, hash, size;
+
+  size = index->size * 2;
+  buckets = (struct layout_anchor **)calloc(size,
+					    sizeof(struct layout_anchor *));
+  if(buckets == NULL)
+    return;
+
+  for(i = 0 ; i < index->size ; i++) {
+    for(anchor = index->buckets[i] ; anchor ; anchor = next) {
+      next = anchor->next;
+      hash = layout_anchor_hash(anchor->name, size);
+      anchor->next = buckets[hash];
+      buckets[hash] = anchor;
+    }
+  }
+
+  free(index->buckets);
+  index->buckets = buckets;
+  index->size = size;
+}
+
+/**
+ * Find a named place on a page.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param name The name of the place.
+ *
+ * @return a pointer to the place, or NULL if there is no such place.
+ */
+static struct layout_anchor *layout_get_anchor(struct layout_part *page,
+					       char *name)
+{
+  struct layout_anchor_index *index = page->data.page_information.anchors;
+  struct layout_anchor *anchor;
+
+  if(index == NULL)
+    return NULL;
+
+  anchor = index->buckets[layout_anchor_hash(name, index->size)];
+  while(anchor && strcmp(anchor->name, name))
+    anchor = anchor->next;
+
+  return anchor;
+}
+
+/**
+ * Add a named place to a page. It does not point at any part until
+ * the caller sets one. If there already is a place with the same name,
+ * the first one is kept, as the HTML specification says.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param name The name of the place. It is copied.
+ *
+ * @return a pointer to the new place, or NULL if it was not added.
+ */
+struct layout_anchor *layout_add_anchor(struct layout_part *page, char *name)
+{
+  struct layout_anchor_index *index = page->data.page_information.anchors;
+  struct layout_anchor *anchor;
+  int hash;
+
+  if(layout_get_anchor(page, name) != NULL)
+    return NULL;
+
+  if(index == NULL) {
+    index = (struct layout_anchor_index *)
+      malloc(sizeof(struct layout_anchor_index));
+    if(index == NULL)
+      return NULL;
+    index->buckets = (struct layout_anchor **)
+      calloc(LAYOUT_ANCHOR_BUCKETS, sizeof(struct layout_anchor *));
+    if(index->buckets == NULL) {
+      free(index);
+      return NULL;
+    }
+    index->size = LAYOUT_ANCHOR_BUCKETS;
+    index->count = 0;
+    page->data.page_information.anchors = index;
+  }
+
+  anchor = (struct layout_anchor *)malloc(sizeof(struct layout_anchor));
+  if(anchor == NULL)
+    return NULL;
+  anchor->name = (char *)malloc(strlen(name) + 1);
+  if(anchor->name == NULL) {
+    free(anchor);
+    return NULL;
+  }
+  strcpy(anchor->name, name);
+  anchor->part = NULL;
+
+  if(index->count >= index->size * 2)
+    layout_grow_anchors(index);
+
+  hash = layout_anchor_hash(name, index->size);
+  anchor->next = index->buckets[hash];
+  index->buckets[hash] = anchor;
+  index->count++;
+
+  return anchor;
+}
+
+/**
+ * Free all the named places on a page. This must be done before any of
+ * the parts they point at are freed, unless the whole page is freed.
+ *
+ * @param page A pointer to the page information part of the page.
+ */
+void layout_free_anchors(struct layout_part *page)
+{
+  struct layout_anchor_index *index = page->data.page_information.anchors;
+  struct layout_anchor *anchor, *next;
+  int i;
+
+  if(index == NULL)
+    return;
+
+  for(i = 0 ; i < index->size ; i++) {
+    for(anchor = index->buckets[i] ; anchor ; anchor = next) {
+      next = anchor->next;
+      free(anchor->name);
+      free(anchor);
+    }
+  }
+
+  free(index->buckets);
+  free(index);
+  page->data.page_information.anchors = NULL;
+}
+
+/**
+ * Check if a part directly on a page has been layouted by an unfinished
+ * relayouting. The parts which are layouted and those which are not
+ * still form one list, linked backwards from the first pending part,
+ * so it is searched in both directions from the part at once, until it
+ * is clear on which side of where they meet the part is.
+ *
+ * @param progress The unfinished relayouting of the page.
+ * @param partp A pointer to the part.
+ *
+ * @return non-zero value if the part is layouted.
+ */
+static int layout_anchor_layouted(struct layout_progress *progress,
+				  struct layout_part *partp)
+{
+  struct layout_part *forward, *backward;
+
+  if(progress->last_part == NULL)
+    return 0;
+
+  forward = partp;
+  backward = partp;
+  for(;;) {
+    if(forward == progress->last_part || backward == NULL)
+      return 1;
+    if(forward == NULL || backward == progress->pending->child)
+      return 0;
+
+    forward = forward->next;
+    backward = backward->previous;
+  }
+}
+
+/**
+ * Layout a page which is being layouted again a piece at a time, down
+ * to a given part, but no further.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param partp A pointer to the part.
+ */
+static void layout_anchor_relayout(struct layout_part *page,
+				   struct layout_part *partp)
+{
+  struct layout_progress *progress;
+  struct layout_part *piece;
+
+  progress = page->data.page_information.relayout;
+  if(progress == NULL)
+    return;
+
+  /* Only the parts directly on the page are moved over to it. */
+  while(partp->parent != NULL && partp->parent != page)
+    partp = partp->parent;
+  if(layout_anchor_layouted(progress, partp))
+    return;
+
+  /* The part is among the pieces layouted next. */
+  for(;;) {
+    piece = progress->pending->child;
+    if(layout_relayout_more(page, page->geometry.height + 1) <= 0)
+      return;
+
+    for( ; piece != NULL ; piece = piece->next)
+      if(piece == partp)
+	return;
+  }
+}
+
+/**
+ * Find the Y position of a named place on a layouted page. A place
+ * which no part was found after is at the end of the page, and one
+ * that does not exist at all is at the top, like the page itself.
+ * If the page is being layouted again a piece at a time, it is first
+ * layouted down to the place, but no further.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param name The name of the place.
+ *
+ * @return the Y position of the place.
+ */
+static int layout_anchor_position(struct layout_part *page, char *name)
+{
+  struct layout_anchor *anchor;
+  struct layout_part *partp;
+
+  anchor = layout_get_anchor(page, name);
+  if(anchor == NULL)
+    return 0;
+  if(anchor->part == NULL) {
+    layout_relayout_more(page, 0);
+    return page->geometry.height;
+  }
+
+  layout_anchor_relayout(page, anchor->part);
+
+  /* A text which was wrapped as a whole is continued in the next part. */
+  partp = anchor->part;
+  while(partp->type == LAYOUT_PART_DELETED && partp->next)
+    partp = partp->next;
+
+  return partp->geometry.y_position;
+}
+
+/**
+ * Find out where on a page a URL points, if it points at a place on the
+ * page itself. Such a URL can be shown by just scrolling the page, with
+ * no need to load or layout it again. The page must be completely
+ * loaded.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param url The URL to look for, absolute or relative to the page,
+ * @param url or NULL to look for the fragment the page was asked for with.
+ *
+ * @return the Y position of the place, or a negative value if the URL
+ * @return does not point at a place on this page.
+ */
+int layout_find_anchor(struct layout_part *page, char *url)
+{
+  char *new_url, *fragment;
+  int y_position;
+
+  if(url == NULL) {
+    if(page->data.page_information.fragment == NULL)
+      return -1;
+
+    return layout_anchor_position(page,
+				  page->data.page_information.fragment);
+  }
+
+  /* Without a fragment, the URL asks for the whole page again. */
+  if(strchr(url, '#') == NULL)
+    return -1;
+
+  new_url = protocol_resolve_url(url, page->data.page_information.url,
+				 NULL);
+  if(new_url == NULL)
+    return -1;
+
+  fragment = strchr(new_url, '#');
+  if(fragment == NULL) {
+    free(new_url);
+    return -1;
+  }
+  *fragment++ = '\0';
+
+  if(strcmp(new_url, page->data.page_information.url))
+    y_position = -1;
+  else
+    y_position = layout_anchor_position(page, fragment);
+
+  free(new_url);
+
+  return y_position;
+}
@@ -0,0 +1,356 @@
+/**
+ * The layout arena. Each page has one of its own, from which its parts
+ * and their strings are taken. Instead of allocating and freeing each
+ * of them separately, they are handed out from a few large blocks, and
+ * all of them are released at once when the page is deleted. The few
+ * parts which hold something outside the arena, like images, are kept
+ * on a list of their own, so that the page never has to be gone through
+ * to find them when it is deleted.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "layout.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/* Round a size up so that every allocation is suitably aligned. */
+#define LAYOUT_ARENA_ALIGN(size)  (((size) + 7) & ~((size_t)7))
+
+/* The memory of a block starts directly after the block header. */
+#define LAYOUT_ARENA_DATA(blockp) \
+  ((char *)(blockp) + LAYOUT_ARENA_ALIGN(sizeof(struct layout_arena_block)))
+
+/**
+ * One block of memory in the layout arena. The usable memory follows
+ * directly after the struct itself.
+ *
+ * @member size The number of usable bytes in the block.
+ * @member used The number of bytes handed out from the block.
+ * @member next A pointer to the next block in the arena.
+ */
+struct layout_arena_block {
+  size_t size;
+  size_t used;
+  struct layout_arena_block *next;
+};
+
+/**
+ * A layout arena. The cells of a table may be layouted by several
+ * threads at once, which all make parts for the rows of their texts,
+ * so the arena is locked while anything is taken from it.
+ *
+ * @member current_block The block allocations are currently made from.
+ * @member current_block The blocks filled before it follow after it.
+ * @member last_allocation The most recent allocation, which is the only
+ * @member last_allocation one that can grow in place.
+ * @member free_parts The parts that have been freed, linked by their
+ * @member free_parts next pointers, which are used again before any more
+ * @member free_parts memory is taken for parts.
+ * @member holders The parts which hold something outside the arena,
+ * @member holders linked by their next_holder pointers. A part stays on
+ * @member holders the list when it is freed and used again.
+ * @member lock Held while the arena is changed.
+ */
+struct layout_arena {
+  struct layout_arena_block *current_block;
+  char *last_allocation;
+  struct layout_part *free_parts;
+  struct layout_part *holders;
+  pthread_mutex_t lock;
+};
+
+/**
+ * Allocate a new block from the system, and put it in the arena. A
+ * block larger than usual is put after the current one, which is then
+ * still used for the smaller allocations.
+ *
+ * @param arena The arena the block is allocated for.
+ * @param size The minimum number of usable bytes in the block.
+ *
+ * @return a pointer to the new block, or NULL if an error occurred.
+ */
+static struct layout_arena_block *
+layout_arena_new_block(struct layout_arena *arena, size_t size)
+{
+  struct layout_arena_block *blockp;
+
+  if(size < LAYOUT_ARENA_BLOCK_SIZE)
+    size = LAYOUT_ARENA_BLOCK_SIZE;
+
+  blockp = (struct layout_arena_block *)
+    malloc(LAYOUT_ARENA_ALIGN(sizeof(struct layout_arena_block)) + size);
+  if(blockp == NULL)
+    return NULL;
+
+  blockp->size = size;
+  blockp->used = 0;
+
+  if(arena->current_block == NULL) {
+    blockp->next = NULL;
+    arena->current_block = blockp;
+  } else if(size > LAYOUT_ARENA_BLOCK_SIZE) {
+    blockp->next = arena->current_block->next;
+    arena->current_block->next = blockp;
+  } else {
+    blockp->next = arena->current_block;
+    arena->current_block = blockp;
+  }
+
+  return blockp;
+}
+
+/**
+ * Create a new, empty arena for a page.
+ *
+ * @return a pointer to the arena, or NULL if an error occurred.
+ */
+struct layout_arena *layout_arena_new(void)
+{
+  struct layout_arena *arena;
+
+  arena = (struct layout_arena *)malloc(sizeof(struct layout_arena));
+  if(arena == NULL)
+    return NULL;
+
+  arena->current_block = NULL;
+  arena->last_allocation = NULL;
+  arena->free_parts = NULL;
+  arena->holders = NULL;
+  pthread_mutex_init(&arena->lock, NULL);
+
+  return arena;
+}
+
+/**
+ * Release an arena, and all memory held by it. Every part and string
+ * handed out from it becomes invalid. Only the parts which have been
+ * put on the list of those holding something outside the arena are
+ * looked at first, so that they can let go of it.
+ *
+ * @param arena The arena to release.
+ * @param release The function which frees what a part holds outside
+ * @param release the arena. It is also given the parts on the list
+ * @param release which have been freed, which have nothing left to free.
+ */
+void layout_arena_delete(struct layout_arena *arena,
+			 void (*release)(struct layout_part *partp))
+{
+  struct layout_arena_block *blockp, *oldest;
+  struct layout_part *partp;
+
+  for(partp = arena->holders ; partp ; ) {
+    release(partp);
+    if(partp->next_holder == partp)
+      break;
+    partp = partp->next_holder;
+  }
+
+  /* Free the oldest block first. The blocks then merge into one free
+   * area, which is given back to the system once, instead of the top
+   * of the heap shrinking once for every block. */
+  oldest = NULL;
+  while(arena->current_block) {
+    blockp = arena->current_block->next;
+    arena->current_block->next = oldest;
+    oldest = arena->current_block;
+    arena->current_block = blockp;
+  }
+
+  while(oldest) {
+    blockp = oldest->next;
+    free(oldest);
+    oldest = blockp;
+  }
+
+  pthread_mutex_destroy(&arena->lock);
+  free(arena);
+}
+
+/**
+ * Allocate memory from the arena, without locking it.
+ *
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ *
+ * @return a pointer to the memory, or NULL if an error occurred.
+ */
+static void *layout_arena_take(struct layout_arena *arena, size_t size)
+{
+  struct layout_arena_block *blockp;
+  char *pointer;
+
+  size = LAYOUT_ARENA_ALIGN(size);
+
+  blockp = arena->current_block;
+  if(blockp == NULL || blockp->used + size > blockp->size) {
+    blockp = layout_arena_new_block(arena, size);
+    if(blockp == NULL)
+      return NULL;
+  }
+
+  pointer = LAYOUT_ARENA_DATA(blockp) + blockp->used;
+  blockp->used += size;
+  if(blockp == arena->current_block)
+    arena->last_allocation = pointer;
+
+  return pointer;
+}
+
+/**
+ * Allocate memory from the arena. The memory is valid until the arena
+ * is deleted, and should not be freed by the caller.
+ *
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ *
+ * @return a pointer to the memory, or NULL if an error occurred.
+ */
+void *layout_arena_alloc(struct layout_arena *arena, size_t size)
+{
+  void *pointer;
+
+  pthread_mutex_lock(&arena->lock);
+  pointer = layout_arena_take(arena, size);
+  pthread_mutex_unlock(&arena->lock);
+
+  return pointer;
+}
+
+/**
+ * Change the size of a piece of memory from the arena. If it was the
+ * latest allocation and there is room in the block, this is done in
+ * place. Otherwise the contents are copied to a new piece of memory,
+ * and the old one is left unused until the arena is deleted.
+ *
+ * @param arena The arena the memory was allocated from.
+ * @param pointer The memory to resize, or NULL to allocate new memory.
+ * @param old_size The size the memory was allocated with.
+ * @param new_size The wanted size of the memory.
+ *
+ * @return a pointer to the resized memory, or NULL if an error occurred.
+ */
+void *layout_arena_resize(struct layout_arena *arena, void *pointer,
+			  size_t old_size, size_t new_size)
+{
+  struct layout_arena_block *blockp;
+  char *new_pointer;
+  size_t start;
+
+  pthread_mutex_lock(&arena->lock);
+
+  blockp = arena->current_block;
+  if(pointer != NULL && pointer == arena->last_allocation) {
+    start = (char *)pointer - LAYOUT_ARENA_DATA(blockp);
+    if(start + LAYOUT_ARENA_ALIGN(new_size) <= blockp->size) {
+      blockp->used = start + LAYOUT_ARENA_ALIGN(new_size);
+      pthread_mutex_unlock(&arena->lock);
+      return pointer;
+    }
+  }
+
+  new_pointer = layout_arena_take(arena, new_size);
+  pthread_mutex_unlock(&arena->lock);
+  if(new_pointer == NULL)
+    return NULL;
+
+  if(pointer != NULL)
+    memcpy(new_pointer, pointer, old_size < new_size ? old_size : new_size);
+
+  return new_pointer;
+}
+
+/**
+ * Allocate a part from the arena, using one that has been freed if
+ * there is any. A part used again is still on the list of those which
+ * hold something outside the arena, if it ever was put there.
+ *
+ * @param arena The arena to allocate from.
+ *
+ * @return a pointer to the uninitialised part, or NULL if an error
+ * @return occurred.
+ */
+struct layout_part *layout_arena_alloc_part(struct layout_arena *arena)
+{
+  struct layout_part *partp;
+
+  pthread_mutex_lock(&arena->lock);
+  partp = arena->free_parts;
+  if(partp != NULL) {
+    arena->free_parts = partp->next;
+  } else {
+    partp = (struct layout_part *)
+      layout_arena_take(arena, sizeof(struct layout_part));
+    if(partp != NULL)
+      partp->next_holder = NULL;
+  }
+  pthread_mutex_unlock(&arena->lock);
+
+  return partp;
+}
+
+/**
+ * Give a part back to the arena it was allocated from, so that it can
+ * be used again. Anything the part points at must already be freed.
+ *
+ * @param arena The arena the part was allocated from.
+ * @param partp A pointer to the part.
+ */
+void layout_arena_free_part(struct layout_arena *arena,
+			    struct layout_part *partp)
+{
+  pthread_mutex_lock(&arena->lock);
+  partp->next = arena->free_parts;
+  arena->free_parts = partp;
+  pthread_mutex_unlock(&arena->lock);
+}
+
+/**
+ * Put a part on the list of those which hold something outside the
+ * arena, unless it is already there. What it holds is then freed when
+ * the arena is released, without going through all parts of the page.
+ *
+ * @param arena The arena the part was allocated from.
+ * @param partp A pointer to the part.
+ */
+void layout_arena_hold(struct layout_arena *arena, struct layout_part *partp)
+{
+  pthread_mutex_lock(&arena->lock);
+  if(partp->next_holder == NULL) {
+    if(arena->holders == NULL)
+      partp->next_holder = partp;
+    else
+      partp->next_holder = arena->holders;
+    arena->holders = partp;
+  }
+  pthread_mutex_unlock(&arena->lock);
+}
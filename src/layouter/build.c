@@ -30,18 +30,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
 
 #include "layout.h"
 #include "protocol.h"
 
-/* I really do not want this here. The layouter should not know anything
- * about the parser. The alternative would be to move the state handling
- * to the layouter, but it does not really belong there. For now, this
- * is how I will have it. Let us hope I can come up with something better
- * in the future.
- */
-#include "states.h"
-
 /* This is used when compiling with the libdmalloc debug library. */
 #ifdef HAVE_DMALLOC_H
 #include <dmalloc.h>
@@ -53,22 +50,66 @@
 struct layout_part *layout_internal_parts = NULL;
 
 /**
- * A pointer to the current base for the page being parsed or layouted.
+ * Find the arena that the parts and strings of a page are allocated from.
+ *
+ * @param relative A pointer to the page information part of the page, or
+ * @param relative to any part on the page, or NULL.
+ *
+ * @return a pointer to the arena, or NULL if they are allocated on their
+ * @return own.
  */
-struct layout_part *current_base = NULL;
+static struct layout_arena *layout_get_arena(struct layout_part *relative)
+{
+  if(relative == NULL)
+    return NULL;
+
+  if(relative->arena != NULL)
+    return relative->arena;
+
+  if(relative->type == LAYOUT_PART_PAGE_INFORMATION)
+    return relative->data.page_information.arena;
+
+  return NULL;
+}
 
 /** 
  * Create and initialize a layout part of a specified type. This function
  * sets default values, if there are any worth mentioning.
+ * A part made for a page is taken from the arena of the page, and is
+ * only really freed together with the page. A page information part
+ * made on its own gets a new arena, which the parts of the page are
+ * then taken from. A part of a type which holds something outside the
+ * arena is put on the list in the arena of such parts.
+ *
+ * @param relative A pointer to the page that the part is made for, or to
+ * @param relative any part on it, or NULL to allocate the part on its own.
+ * @param type The type of the part.
  *
  * @return a pointer to a basically empty layout_part struct or
  * @return NULL an error occurred.
  */
-struct layout_part *layout_init_part(enum layout_part_type type)
+struct layout_part *layout_init_part(struct layout_part *relative,
+				     enum layout_part_type type)
 {
+  struct layout_arena *arena, *page_arena;
   struct layout_part *new;
 
-  new = (struct layout_part *)malloc(sizeof(struct layout_part));
+  page_arena = NULL;
+  arena = layout_get_arena(relative);
+  if(arena != NULL) {
+    new = layout_arena_alloc_part(arena);
+  } else {
+    if(type == LAYOUT_PART_PAGE_INFORMATION) {
+      page_arena = layout_arena_new();
+      if(page_arena == NULL)
+	return NULL;
+    }
+    new = (struct layout_part *)malloc(sizeof(struct layout_part));
+    if(new == NULL && page_arena != NULL)
+      layout_arena_delete(page_arena, NULL);
+    if(new != NULL)
+      new->next_holder = NULL;
+  }
   if(new == NULL)
     return NULL;
 
@@ -83,13 +124,19 @@ struct layout_part *layout_init_part(enum layout_part_type type)
   new->next = NULL;
   new->previous = NULL;
   new->child = NULL;
+  new->last_child = NULL;
   new->parent = NULL;
+  new->arena = arena;
 
   switch(type) {
   case LAYOUT_PART_PAGE_INFORMATION:
     new->data.page_information.title = NULL;
     new->data.page_information.url = NULL;
     new->data.page_information.base_url = NULL;
+    new->data.page_information.fragment = NULL;
+    new->data.page_information.anchors = NULL;
+    new->data.page_information.relayout = NULL;
+    new->data.page_information.arena = page_arena;
     new->data.page_information.background_colour = 0xc0c0c0;
     new->data.page_information.text_colour = 0x000000;
     new->data.page_information.link_colour = 0x0000ee;
@@ -104,9 +151,29 @@ struct layout_part *layout_init_part(enum layout_part_type type)
 
   case LAYOUT_PART_TEXT:
     new->data.text.text = NULL;
+    new->data.text.length = 0;
+    new->data.text.buffer = NULL;
+    new->data.text.buffer_size = 0;
     /* The styles are defaulted in parse_state_init(). */
     break;
 
+  case LAYOUT_PART_PREFORMATTED:
+    new->data.preformatted.text = NULL;
+    new->data.preformatted.length = 0;
+    new->data.preformatted.lines = NULL;
+    new->data.preformatted.line_step = 1;
+    new->data.preformatted.number_of_lines = 0;
+    new->data.preformatted.longest_line = 0;
+    new->data.preformatted.line_height = 0;
+    new->data.preformatted.mapped = 0;
+    new->data.preformatted.line = NULL;
+    new->data.preformatted.line_size = 0;
+    new->data.preformatted.last_line = -1;
+    new->data.preformatted.last_end = 0;
+    if(arena != NULL)
+      layout_arena_hold(arena, new);
+    break;
+
   case LAYOUT_PART_LINK:
     new->data.link.href = NULL;
     break;
@@ -119,6 +186,9 @@ struct layout_part *layout_init_part(enum layout_part_type type)
     new->data.graphics.border = 0;
     new->data.graphics.border_colour = 0x80000000;
     new->data.graphics.type = LAYOUT_PART_GRAPHICS_UNKNOWN;
+    new->data.graphics.tried = 0;
+    if(arena != NULL)
+      layout_arena_hold(arena, new);
     break;
 
   case LAYOUT_PART_LINE:
@@ -141,7 +211,7 @@ struct layout_part *layout_init_part(enum layout_part_type type)
     break;
 
   case LAYOUT_PART_TABLE_ROW:
-    new->data.table_cell.background_colour = 0x80000000;
+    new->data.table_row.background_colour = 0x80000000;
     break;
 
   case LAYOUT_PART_TABLE_CELL:
@@ -154,6 +224,8 @@ struct layout_part *layout_init_part(enum layout_part_type type)
     new->data.table_cell.height = 0;
     new->data.table_cell.height_type = LAYOUT_SIZE_UNSPECIFIED;
     new->data.table_cell.background_colour = 0x80000000;
+    new->data.table_cell.min_width = -1;
+    new->data.table_cell.max_width = -1;
     break;
 
   case LAYOUT_PART_FORM:
@@ -192,52 +264,123 @@ struct layout_part *layout_init_part(enum layout_part_type type)
 
   default:
     new->data.generic = NULL;
+    if(arena != NULL)
+      layout_arena_hold(arena, new);
   }
 
   return new;
 }
 
 /**
- * It is time to free this part, and send its bytes into oblivion.
- * Malloc to free, bits to bits. Of bytes are thy come, and of bytes
- * shall thee again become.
+ * Free what a part holds outside the arena of its page: images, blocks
+ * of preformatted text, and the data of the user interface. What is
+ * freed is forgotten, so that doing this again to the same part, such
+ * as when its arena is released after the part was freed, does nothing.
  *
- * @member part A pointer to a layout part object to free.
+ * @param part A pointer to the part.
+ */
+static void layout_free_part_outside(struct layout_part *part)
+{
+  switch(part->type) {
+  case LAYOUT_PART_PREFORMATTED:
+    if(part->data.preformatted.text != NULL) {
+#ifdef HAVE_MMAP
+      if(part->data.preformatted.mapped)
+	munmap(part->data.preformatted.text, part->data.preformatted.length);
+      else
+#endif /* HAVE_MMAP */
+	free(part->data.preformatted.text);
+      part->data.preformatted.text = NULL;
+    }
+    if(part->data.preformatted.lines != NULL) {
+      free(part->data.preformatted.lines);
+      part->data.preformatted.lines = NULL;
+    }
+    if(part->data.preformatted.line != NULL) {
+      free(part->data.preformatted.line);
+      part->data.preformatted.line = NULL;
+    }
+    break;
+
+  case LAYOUT_PART_GRAPHICS:
+    if(part->data.graphics.data != NULL) {
+      free(part->data.graphics.data);
+      part->data.graphics.data = NULL;
+    }
+    break;
+
+  case LAYOUT_PART_FORM_TEXTAREA:
+    if(part->data.generic != NULL) {
+      free(part->data.generic);
+      part->data.generic = NULL;
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  /* Safely free possible interface specific data. If the interface
+   * has provided its own function for doing this, we oblige to its
+   * wishes and let it handle it all by itself.
+   */
+  if(part->interface_data != NULL) {
+    if(part->free_interface_data != NULL)
+      part->free_interface_data(part);
+    else
+      free(part->interface_data);
+    part->interface_data = NULL;
+  }
+}
+
+/**
+ * Free what a part holds, but not the part itself. The strings of a
+ * part in an arena are left to the arena, but images, blocks of
+ * preformatted text and the data of the user interface are always
+ * freed.
  *
- * @return non-zero value if an error occurred.
+ * @param part A pointer to the part.
  */
-int layout_free_part(struct layout_part *part)
+static void layout_free_part_data(struct layout_part *part)
 {
   switch(part->type) {
   case LAYOUT_PART_PAGE_INFORMATION:
     if(part->data.page_information.title != NULL)
-      free(part->data.page_information.title);
+      layout_free_string(part, part->data.page_information.title);
     if(part->data.page_information.url != NULL)
-      free(part->data.page_information.url);
+      layout_free_string(part, part->data.page_information.url);
     if(part->data.page_information.base_url != NULL)
-      free(part->data.page_information.base_url);
+      layout_free_string(part, part->data.page_information.base_url);
+    if(part->data.page_information.fragment != NULL)
+      layout_free_string(part, part->data.page_information.fragment);
+    layout_free_anchors(part);
     break;
 
   case LAYOUT_PART_PARAGRAPH:
     break;
 
+    /* Only a text part is ever marked as deleted, when it is wrapped
+     * away from a row, and it keeps its text.
+     */
+  case LAYOUT_PART_DELETED:
   case LAYOUT_PART_TEXT:
-    if(part->data.text.text != NULL)
-      free(part->data.text.text);
+    if(part->data.text.buffer != NULL)
+      layout_free_string(part, part->data.text.buffer);
+    break;
+
+  case LAYOUT_PART_PREFORMATTED:
     break;
 
   case LAYOUT_PART_LINK:
     if(part->data.link.href != NULL)
-      free(part->data.link.href);
+      layout_free_string(part, part->data.link.href);
     break;
 
   case LAYOUT_PART_GRAPHICS:
-    if(part->data.graphics.data != NULL)
-      free(part->data.graphics.data);
     if(part->data.graphics.alt_text != NULL)
-      free(part->data.graphics.alt_text);
+      layout_free_string(part, part->data.graphics.alt_text);
     if(part->data.graphics.src != NULL)
-      free(part->data.graphics.src);
+      layout_free_string(part, part->data.graphics.src);
     break;
 
   case LAYOUT_PART_LINE:
@@ -254,114 +397,425 @@ int layout_free_part(struct layout_part *part)
 
   case LAYOUT_PART_FORM:
     if(part->data.form.action != NULL)
-      free(part->data.form.action);
+      layout_free_string(part, part->data.form.action);
     break;
 
   case LAYOUT_PART_FORM_SUBMIT:
     if(part->data.form_submit.name != NULL)
-      free(part->data.form_submit.name);
+      layout_free_string(part, part->data.form_submit.name);
     if(part->data.form_submit.value != NULL)
-      free(part->data.form_submit.value);
+      layout_free_string(part, part->data.form_submit.value);
     break;
 
   case LAYOUT_PART_FORM_CHECKBOX:
     if(part->data.form_checkbox.name != NULL)
-      free(part->data.form_checkbox.name);
+      layout_free_string(part, part->data.form_checkbox.name);
     if(part->data.form_checkbox.value != NULL)
-      free(part->data.form_checkbox.value);
+      layout_free_string(part, part->data.form_checkbox.value);
     break;
 
   case LAYOUT_PART_FORM_RADIO:
     if(part->data.form_radio.name != NULL)
-      free(part->data.form_radio.name);
+      layout_free_string(part, part->data.form_radio.name);
     if(part->data.form_radio.value != NULL)
-      free(part->data.form_radio.value);
+      layout_free_string(part, part->data.form_radio.value);
     break;
 
   case LAYOUT_PART_FORM_TEXT:
     if(part->data.form_text.name != NULL)
-      free(part->data.form_text.name);
+      layout_free_string(part, part->data.form_text.name);
     if(part->data.form_text.value != NULL)
-      free(part->data.form_text.value);
+      layout_free_string(part, part->data.form_text.value);
     break;
 
   case LAYOUT_PART_FORM_HIDDEN:
     if(part->data.form_hidden.name != NULL)
-      free(part->data.form_hidden.name);
+      layout_free_string(part, part->data.form_hidden.name);
     if(part->data.form_hidden.value != NULL)
-      free(part->data.form_hidden.value);
+      layout_free_string(part, part->data.form_hidden.value);
     break;
 
   default:
-    if(part->data.generic != NULL)
-      free(part->data.generic);
+    break;
   }
-  
-  /* Safely free possible interface specific data. If the interface
-   * has provided its own function for doing this, we oblige to its
-   * wishes and let it handle it all by itself.
-   */
-  if(part->interface_data != NULL) {
-    if(part->free_interface_data != NULL)
-      part->free_interface_data(part);
+
+  layout_free_part_outside(part);
+}
+
+/**
+ * Free a layout part and everything it holds. A part which belongs to
+ * an arena is given back to it, to be used again. When the page
+ * information part of a page is freed, the arena of the page is
+ * released, with all the parts and strings that are still in it,
+ * without going through each of them, since the arena knows which of
+ * them hold anything outside it.
+ *
+ * @param part A pointer to a layout part object to free.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int layout_free_part(struct layout_part *part)
+{
+  struct layout_arena *page_arena;
+
+  page_arena = NULL;
+  if(part->type == LAYOUT_PART_PAGE_INFORMATION) {
+    page_arena = part->data.page_information.arena;
+
+    /* The parts which an unfinished relayouting had not come to yet. */
+    if(part->data.page_information.relayout != NULL) {
+      if(page_arena == NULL)
+	layout_delete_all_parts(part->data.page_information.relayout->pending);
+      free(part->data.page_information.relayout);
+    }
+  }
+
+  layout_free_part_data(part);
+
+  if(part->arena != NULL)
+    layout_arena_free_part(part->arena, part);
+  else
+    free(part);
+
+  if(page_arena != NULL)
+    layout_arena_delete(page_arena, layout_free_part_outside);
+
+  return 0;
+}
+
+/**
+ * Allocate memory for a string that belongs to a part, from the same
+ * place as the part itself.
+ *
+ * @param relative A pointer to the part that the string belongs to, or
+ * @param relative to its page, or to any part on it, just like what the
+ * @param relative part was made with.
+ * @param size The number of bytes to allocate.
+ *
+ * @return a pointer to the memory, or NULL if an error occurred.
+ */
+char *layout_alloc_string(struct layout_part *relative, size_t size)
+{
+  struct layout_arena *arena;
+
+  arena = layout_get_arena(relative);
+  if(arena != NULL)
+    return (char *)layout_arena_alloc(arena, size);
+
+  return (char *)malloc(size);
+}
+
+/**
+ * Free a string allocated by layout_alloc_string(). A string in an arena
+ * is left there until the page is freed.
+ *
+ * @param relative The part that the string was allocated with.
+ * @param string The string to free.
+ */
+void layout_free_string(struct layout_part *relative, char *string)
+{
+  if(layout_get_arena(relative) == NULL)
+    free(string);
+}
+
+/**
+ * Change the size of a string allocated by layout_alloc_string().
+ *
+ * @param relative The part that the string was allocated with.
+ * @param string The string to resize.
+ * @param old_size The size the string was allocated with.
+ * @param new_size The wanted size of the string.
+ *
+ * @return a pointer to the resized string, or NULL if an error occurred,
+ * @return in which case the string is left as it was.
+ */
+static char *layout_resize_string(struct layout_part *relative,
+				  char *string, size_t old_size,
+				  size_t new_size)
+{
+  struct layout_arena *arena;
+
+  arena = layout_get_arena(relative);
+  if(arena != NULL)
+    return (char *)layout_arena_resize(arena, string, old_size, new_size);
+
+  return (char *)realloc(string, new_size);
+}
+
+
+/**
+ * Check if two text parts look exactly the same, apart from the text
+ * itself, so that they may just as well be one.
+ *
+ * @param first A pointer to the first text part.
+ * @param second A pointer to the second text part.
+ *
+ * @return non-zero value if the texts have the same style and alignment.
+ */
+static int layout_same_text_style(struct layout_part *first,
+				  struct layout_part *second)
+{
+  struct layout_text_styles *a = &first->data.text.style;
+  struct layout_text_styles *b = &second->data.text.style;
+
+  return (a->size == b->size && a->colour == b->colour &&
+	  a->monospaced == b->monospaced && a->italic == b->italic &&
+	  a->bold == b->bold && a->underlined == b->underlined &&
+	  a->overlined == b->overlined && a->subscript == b->subscript &&
+	  a->superscript == b->superscript && 
+	  a->preformatted == b->preformatted &&
+	  a->directquote == b->directquote &&
+	  first->align.horizontal == second->align.horizontal &&
+	  first->align.vertical == second->align.vertical &&
+	  first->align.indent_offset == second->align.indent_offset);
+}
+
+/**
+ * Remove a part from the list it is in, and free it.
+ *
+ * @param part A pointer to the part to remove.
+ */
+static void layout_remove_part(struct layout_part *part)
+{
+  if(part->parent != NULL && part->parent->last_child == part) {
+    if(part->previous != NULL && part->previous->next == part)
+      part->parent->last_child = part->previous;
     else
-      free(part->interface_data);
+      part->parent->last_child = NULL;
   }
 
-  free(part);
+  if(part->previous != NULL && part->previous->next == part)
+    part->previous->next = part->next;
+  else if(part->parent != NULL && part->parent->child == part)
+    part->parent->child = part->next;
+  if(part->next != NULL)
+    part->next->previous = part->previous;
+
+  layout_free_part(part);
+}
+
+/**
+ * Merge a new paragraph into the last part in a list, if the paragraph
+ * would add nothing to it.
+ * If many paragraphs are placed after one another, html work in such 
+ * a way that they act as if there was only one. The paragraph tag has
+ * higher priority than the break row tag, which means if there is a
+ * break row already, and a paragraph is approaching, the stored part
+ * is saved as a paragraph.
+ * This is not true for plain texts, which should have all paragraphs
+ * left intact. Plain texts use permanent paragraphs. However, to get
+ * the correct line distances, two paragraphs in a row will always
+ * turn the second one into a paragraph, as opposed to a break line.
+ * We must also make sure that alignments are always taken from the
+ * last paragraph and not from the first. 
+ *
+ * @param last A pointer to the last part in the list.
+ * @param new A pointer to the paragraph about to be added after it.
+ *
+ * @return non-zero value if the paragraph was merged, and freed.
+ */
+static int layout_merge_paragraph(struct layout_part *last,
+				  struct layout_part *new)
+{
+  if(new->data.paragraph.permanent) {
+    if(last->type == LAYOUT_PART_PARAGRAPH)
+      new->data.paragraph.paragraph = 1;
+    
+    return 0;
+  }
+
+  if(last->type == LAYOUT_PART_PARAGRAPH) {
+    if(!last->data.paragraph.paragraph)
+      last->data.paragraph.paragraph = new->data.paragraph.paragraph;
+
+    /* If this is a paragraph, and not a break row, we should make
+     * sure its alignment is copied to the one we are going to keep.
+     */
+    if(new->data.paragraph.paragraph)
+      last->align = new->align;
+
+    layout_free_part(new);
+    return 1;
+  }
+
+  /* A single space between two paragraphs is removed as well. */
+  if(last->previous != NULL && last->previous->next == last &&
+     last->type == LAYOUT_PART_TEXT &&
+     last->previous->type == LAYOUT_PART_PARAGRAPH &&
+     (last->data.text.length == 0 ||
+      (last->data.text.length == 1 && last->data.text.text[0] == ' '))) {
+    if(!last->previous->data.paragraph.paragraph)
+      last->previous->data.paragraph.paragraph = 
+	new->data.paragraph.paragraph;
+
+    layout_remove_part(last);
+    layout_free_part(new);
+    return 1;
+  }
 
   return 0;
 }
 
 /**
- * Add a new element to the linked list `parts'. The new element is not
- * copied, only the pointer is stored in the list. The new part is placed
- * under the current base part.
+ * Merge a new text part into the last part in a list, if they have the
+ * same style. The last part is kept, since named places on the page may
+ * already point at it.
+ * Preformatted texts are left alone, since each of them is placed on
+ * a row of its own, and so are two whitespaces that meet, since only
+ * one of them would then be removed at the beginning of a row. Neither
+ * is a text which has been broken into rows, since other parts share
+ * its text.
+ * The text of the last part is given twice the room it needs when it
+ * has to grow, so that a long text merged from many pieces is not
+ * copied once for every piece.
  *
- * @param parts A pointer to the first element in a linked list of layout
- * @param parts parts. If `parts' is NULL, use the internal linked list.
+ * @param last A pointer to the last part in the list.
+ * @param new A pointer to the text part about to be added after it.
+ *
+ * @return non-zero value if the new part was merged, and freed.
+ */
+static int layout_merge_text(struct layout_part *last, struct layout_part *new)
+{
+  char *text;
+  int length, size;
+
+  if(last->type != LAYOUT_PART_TEXT || new->data.text.style.preformatted ||
+     last->data.text.text != last->data.text.buffer ||
+     last->data.text.text[last->data.text.length] != '\0' ||
+     !layout_same_text_style(last, new))
+    return 0;
+
+  length = last->data.text.length;
+  if(isspace((int)last->data.text.text[length - 1]) &&
+     isspace((int)new->data.text.text[0]))
+    return 0;
+
+  size = length + new->data.text.length + 1;
+  if(size > last->data.text.buffer_size) {
+    if(size < 2 * last->data.text.buffer_size)
+      size = 2 * last->data.text.buffer_size;
+    text = layout_resize_string(last, last->data.text.buffer,
+				last->data.text.buffer_size, size);
+    if(text == NULL)
+      return 0;
+    last->data.text.buffer = text;
+    last->data.text.buffer_size = size;
+  }
+
+  text = last->data.text.buffer;
+  memcpy(text + length, new->data.text.text, new->data.text.length);
+  text[length + new->data.text.length] = '\0';
+  last->data.text.text = text;
+  last->data.text.length += new->data.text.length;
+
+  layout_free_part(new);
+
+  return 1;
+}
+
+/**
+ * Give a text part a text of its own.
+ *
+ * @param partp A pointer to the text part.
+ * @param text The null terminated text, which must have been allocated
+ * @param text with layout_alloc_string() for the part. It belongs to the
+ * @param text part from now on.
+ */
+void layout_set_text(struct layout_part *partp, char *text)
+{
+  partp->data.text.text = text;
+  partp->data.text.length = strlen(text);
+  partp->data.text.buffer = text;
+  partp->data.text.buffer_size = partp->data.text.length + 1;
+}
+
+/**
+ * Give a part data of the user interface, and the function which frees
+ * it, or NULL to have it freed as it is. A part on a page is put on the
+ * list in the arena of the page of parts which hold something outside
+ * it, so that the data is freed when the page is.
+ *
+ * @param partp A pointer to the part.
+ * @param data The data of the user interface.
+ * @param free_data The function which frees the data, or NULL.
+ */
+void layout_set_interface_data(struct layout_part *partp, void *data,
+			       void (*free_data)(struct layout_part *partp))
+{
+  partp->interface_data = data;
+  partp->free_interface_data = free_data;
+  if(partp->arena != NULL)
+    layout_arena_hold(partp->arena, partp);
+}
+
+/**
+ * Add a new element last among the children of the part `base'. The new
+ * element is not copied, only the pointer is stored in the list.
+ * To keep the list short, an empty text is not added at all, a
+ * paragraph may be merged into the one before it, and a text is merged
+ * with the text before it, if they have the same style. 
+ * The widths measured for the table cells that the new part ends up
+ * inside are forgotten, since the contents of the cells have changed.
+ * The last part under `base' is kept in it, so that a page with many
+ * parts in a row is not gone through once for every part added.
+ *
+ * @param base A pointer to the part under which the new part is placed.
  * @param new A pointer to a layout part that should be added to the
- * @param new linked list provided by `parts'.
+ * @param new linked list. An empty text, or a paragraph or text which
+ * @param new is merged into the part before it, is freed, and must not
+ * @param new be used after this.
  *
  * @return non-zero value if an error occurred.
  */
-int layout_add_part(struct layout_part *new)
+int layout_add_part(struct layout_part *base, struct layout_part *new)
 {
-  struct layout_part *partp, *base_part;
-  struct layout_aligns align;
+  struct layout_part *partp, *last;
 
-  base_part = NULL;
-  parse_state_get_current(NULL, NULL, &base_part);
+  partp = base;
 
-  if(base_part == NULL)
-    partp = current_base;
-  else
-    partp = base_part;
+  if(new->type == LAYOUT_PART_TEXT && new->data.text.length == 0) {
+    layout_free_part(new);
+    return 0;
+  }
 
   new->parent = partp;
 
+  for( ; partp ; partp = partp->parent) {
+    if(partp->type == LAYOUT_PART_TABLE_CELL) {
+      partp->data.table_cell.min_width = -1;
+      partp->data.table_cell.max_width = -1;
+    }
+  }
+  partp = base;
+
   /* We start by selecting the child to the current partp. If it does not
    * exist, we put the new part at that position.
    */
   if(partp->child == NULL) {
     partp->child = new;
   } else {
-    partp = partp->child;
-
-    /* Find the last element in the list at the current level. */
-    while(partp->next) {
-      partp = partp->next;
+    /* The last element in the list at the current level is only
+     * searched for if it is not known.
+     */
+    last = partp->last_child;
+    if(last == NULL) {
+      last = partp->child;
+      while(last->next)
+	last = last->next;
+      partp->last_child = last;
     }
-    
-    new->previous = partp;
-    partp->next = new;
-  }
 
-  /* This gets the current alignment state and adds that to the
-   * new part which is about to be added to the linked list.
-   */
-  parse_state_get_current(NULL, &align, NULL);
-  new->align = align;
+    if(new->type == LAYOUT_PART_PARAGRAPH &&
+       layout_merge_paragraph(last, new))
+      return 0;
+
+    if(new->type == LAYOUT_PART_TEXT && layout_merge_text(last, new))
+      return 0;
+
+    new->previous = last;
+    last->next = new;
+  }
+  partp->last_child = new;
 
   return 0;
 }
@@ -369,6 +823,8 @@ int layout_add_part(struct layout_part *new)
 /**
  * Delete all parts from the linked list given in the parameter
  * `parts'. Free all memory areas allocated by layout_init_part().
+ * The parts of a page with an arena are not freed one by one, since
+ * the arena is released with the page.
  *
  * @param parts A pointer to the first element in a linked list of layout
  * @param parts parts. If `parts' is NULL, use the internal linked list.
@@ -389,7 +845,9 @@ int layout_delete_all_parts(struct layout_part *parts)
     /* Get rid of the child tree first. We do this by recursively call
      * this function again.
      */
-    if(partp->child != NULL)
+    if(partp->child != NULL &&
+       (partp->type != LAYOUT_PART_PAGE_INFORMATION ||
+	partp->data.page_information.arena == NULL))
       layout_delete_all_parts(partp->child);
 
     previous_part = partp;
@@ -407,18 +865,14 @@ int layout_delete_all_parts(struct layout_part *parts)
  * Retreive the first part on the linked list given by the parameter,
  * which contains information about the page.
  *
- * @param parts A pointer to the first part of a linked list of layout parts,
- * @param parts or NULL if the internal list is to be used.
+ * @param parts A pointer to the first part of a linked list of layout parts.
  *
  * @return a pointer to the page information part, or NULL if the part was
  * @return not available or if an error occurred.  
  */
 struct layout_part *layout_get_page_information(struct layout_part *parts)
 {
-  if(parts == NULL)
-    return current_base;
-  else
-    return parts;
+  return parts;
 }
 
 /**
@@ -439,8 +893,8 @@ struct layout_part *layout_get_internal_parts(void)
  * to this page will be placed under this, starting from the child link of
  * the page information part.
  * This must be called first, and if it is not, the programmer has made a 
- * major mistake. This will set the global current base pointer, which is
- * used by other layout functions as the default base.
+ * major mistake. The parts of the page are added under the part that
+ * this returns.
  *
  * @param url The URL for the page being initialized.
  * @param referer The URL we came from. This is used to place the new page
@@ -474,10 +928,11 @@ struct layout_part *layout_init_page(char *url, char *referer)
     }
   }
 
-  partp = layout_init_part(LAYOUT_PART_PAGE_INFORMATION);
+  partp = layout_init_part(NULL, LAYOUT_PART_PAGE_INFORMATION);
   if(partp == NULL)
     return NULL;
-  partp->data.page_information.url = (char *)malloc(strlen(url) + 1);
+  partp->data.page_information.url =
+    layout_alloc_string(partp, strlen(url) + 1);
   if(partp->data.page_information.url == NULL) {
     layout_free_part(partp);
     return NULL;
@@ -494,7 +949,230 @@ struct layout_part *layout_init_page(char *url, char *referer)
     previous_part->next = partp;
   }
 
-  current_base = partp;
-
   return partp;
 }
+
+/**
+ * Get one of the lines in a block of preformatted text. In a mapped file,
+ * the line is found from the closest line in the index, or right after
+ * the line taken last time, which makes it quick to go through the lines
+ * in order. It is then copied into the buffer of the block, without any
+ * carriage returns or nul characters, just like the parser would have
+ * stored it. The line is only valid until the next line is taken.
+ *
+ * @param partp A pointer to the preformatted part.
+ * @param index The number of the line, counting from zero.
+ *
+ * @return a pointer to the null terminated line, or NULL if there is no
+ * @return such line, or an error occurred.
+ */
+char *layout_get_line(struct layout_part *partp, int index)
+{
+  struct layout_part_preformatted_data *block;
+  char *start, *end, *tmp;
+  int i, size;
+
+  block = &partp->data.preformatted;
+  if(index < 0 || index >= block->number_of_lines)
+    return NULL;
+
+  if(!block->mapped)
+    return block->text + block->lines[index];
+
+  if(index == block->last_line)
+    return block->line;
+
+  if(block->last_line >= 0 && index == block->last_line + 1) {
+    start = block->text + block->last_end;
+  } else {
+    start = block->text + block->lines[index / block->line_step];
+    for(i = index - index % block->line_step ; i < index ; i++)
+      start = (char *)memchr(start, '\n', 
+			     block->text + block->length - start) + 1;
+  }
+
+  end = memchr(start, '\n', block->text + block->length - start);
+  if(end == NULL)
+    end = block->text + block->length;
+
+  if(end - start >= block->line_size) {
+    size = end - start + 1;
+    tmp = realloc(block->line, size);
+    if(tmp == NULL)
+      return NULL;
+    block->line = tmp;
+    block->line_size = size;
+  }
+
+  for(tmp = block->line ; start < end ; start++)
+    if(*start != '\r' && *start != '\0')
+      *tmp++ = *start;
+  *tmp = '\0';
+
+  block->last_line = index;
+  block->last_end = end + 1 - block->text;
+
+  return block->line;
+}
+
+/**
+ * Print a string within quotes, with the characters that could not be
+ * told apart on the terminal written as octal escapes instead.
+ *
+ * @param text The string to print, or NULL.
+ */
+static void debug_dump_text(char *text)
+{
+  if(text == NULL) {
+    printf("NULL");
+    return;
+  }
+
+  putchar('"');
+  for( ; *text ; text++) {
+    if((unsigned char)*text < ' ' || *text == '"' || *text == '\\')
+      printf("\\%03o", (unsigned char)*text);
+    else
+      putchar(*text);
+  }
+  putchar('"');
+}
+
+/**
+ * Prints the contents of a linked list of layout parts, and everything
+ * under them, with one part on each row, indented by its depth in the
+ * tree. Only what the parser has put into the parts is printed, and
+ * nothing of the geometry, so the output stays the same for a page no
+ * matter which user interface is used.
+ *
+ * @param parts A pointer to the first part in the list to print.
+ * @param depth The depth in the tree of the parts, which is zero for the
+ * @param depth page itself.
+ *
+ * @return the number of parts printed.
+ */
+int debug_dump_parts(struct layout_part *parts, int depth)
+{
+  struct layout_part *partp;
+  struct layout_text_styles *style;
+  int count;
+
+  count = 0;
+  for(partp = parts ; partp ; partp = partp->next) {
+    count++;
+    printf("%*s", depth * 2, "");
+
+    switch(partp->type) {
+    case LAYOUT_PART_PAGE_INFORMATION:
+      printf("Page ");
+      debug_dump_text(partp->data.page_information.title);
+      break;
+
+    case LAYOUT_PART_PARAGRAPH:
+      printf("%s%s", partp->data.paragraph.paragraph ? "Paragraph" : "Break",
+	     partp->data.paragraph.permanent ? " permanent" : "");
+      break;
+
+    case LAYOUT_PART_TEXT:
+      style = &partp->data.text.style;
+      printf("Text size=%d colour=%08lx %s%s%s%s%s%s%s%s ", style->size,
+	     (unsigned long)style->colour, style->monospaced ? "m" : "-",
+	     style->italic ? "i" : "-", style->bold ? "b" : "-",
+	     style->underlined ? "u" : "-", style->overlined ? "o" : "-",
+	     style->subscript ? "s" : "-", style->superscript ? "S" : "-",
+	     style->preformatted ? "p" : "-");
+      debug_dump_text(partp->data.text.text);
+      break;
+
+    case LAYOUT_PART_PREFORMATTED:
+      printf("Preformatted lines=%d length=%lu",
+	     partp->data.preformatted.number_of_lines,
+	     (unsigned long)partp->data.preformatted.length);
+      break;
+
+    case LAYOUT_PART_LINK:
+      printf("Link ");
+      debug_dump_text(partp->data.link.href);
+      break;
+
+    case LAYOUT_PART_GRAPHICS:
+      printf("Graphics ");
+      debug_dump_text(partp->data.graphics.src);
+      printf(" ");
+      debug_dump_text(partp->data.graphics.alt_text);
+      break;
+
+    case LAYOUT_PART_LINE:
+      printf("Line width=%d%s size=%d", partp->data.line.width,
+	     partp->data.line.absolute ? "" : "%", partp->data.line.size);
+      break;
+
+    case LAYOUT_PART_TABLE:
+      printf("Table rows=%d columns=%d border=%d",
+	     partp->data.table.number_of_rows,
+	     partp->data.table.number_of_columns,
+	     partp->data.table.border);
+      break;
+
+    case LAYOUT_PART_TABLE_ROW:
+      printf("Row");
+      break;
+
+    case LAYOUT_PART_TABLE_CELL:
+      printf("Cell row=%d column=%d rowspan=%d colspan=%d",
+	     partp->data.table_cell.rowstart,
+	     partp->data.table_cell.colstart,
+	     partp->data.table_cell.rowspan,
+	     partp->data.table_cell.colspan);
+      break;
+
+    case LAYOUT_PART_FORM:
+      printf("Form ");
+      debug_dump_text(partp->data.form.action);
+      break;
+
+    case LAYOUT_PART_FORM_SUBMIT:
+      printf("Submit ");
+      debug_dump_text(partp->data.form_submit.name);
+      break;
+
+    case LAYOUT_PART_FORM_CHECKBOX:
+      printf("Checkbox ");
+      debug_dump_text(partp->data.form_checkbox.name);
+      break;
+
+    case LAYOUT_PART_FORM_RADIO:
+      printf("Radio ");
+      debug_dump_text(partp->data.form_radio.name);
+      break;
+
+    case LAYOUT_PART_FORM_TEXT:
+      printf("Input ");
+      debug_dump_text(partp->data.form_text.name);
+      break;
+
+    case LAYOUT_PART_FORM_TEXTAREA:
+      printf("Textarea");
+      break;
+
+    case LAYOUT_PART_FORM_HIDDEN:
+      printf("Hidden ");
+      debug_dump_text(partp->data.form_hidden.name);
+      break;
+
+    default:
+      printf("Unknown type %d", partp->type);
+    }
+
+    /* The page itself is never aligned, so its aligns are never set. */
+    if(partp->type != LAYOUT_PART_PAGE_INFORMATION)
+      printf(" align=%d,%d indent=%d", partp->align.horizontal,
+	     partp->align.vertical, partp->align.indent_offset);
+    printf("\n");
+
+    if(partp->child != NULL)
+      count += debug_dump_parts(partp->child, depth + 1);
+  }
+
+  return count;
+}
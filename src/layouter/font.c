@@ -0,0 +1,410 @@
+/**
+ * Functions which measure text for the layouter. The user interface
+ * may give the metrics of the font used for a style of text, which are
+ * kept here, so that the width of a text can be found without asking
+ * the user interface about every single string.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#include "layout.h"
+#include "ui.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/**
+ * The metrics of the font for one combination of the styles that may
+ * change the font. The user interface is only asked once about each.
+ *
+ * @member size The size of the text.
+ * @member monospaced Non-zero value if the text is monospaced.
+ * @member italic Non-zero value if the text is italic.
+ * @member bold Non-zero value if the text is bold.
+ * @member available Non-zero value if the user interface gave metrics
+ * @member available for the font. Otherwise the text is measured by the
+ * @member available set_size operation.
+ * @member metrics The metrics of the font.
+ * @member next A pointer to the next font, or NULL.
+ */
+struct layout_font {
+  int size;
+  int monospaced;
+  int italic;
+  int bold;
+  int available;
+  struct zen_ui_font_metrics metrics;
+  struct layout_font *next;
+};
+
+/* The most fonts that are kept. Only a few sizes are normally used,
+ * but nested tags may make the size of a text grow without limit.
+ */
+#define LAYOUT_FONTS_MAX  64
+
+/* All fonts that have been used, the most recently used first. The
+ * list is shared by all pages being layouted, and is locked while it
+ * is searched. The fonts themselves never change once they are added,
+ * and are never removed, since other threads may be using them.
+ */
+static struct layout_font *layout_fonts = NULL;
+static int layout_fonts_count = 0;
+static pthread_mutex_t layout_fonts_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The user interface does not expect to be asked about sizes by more
+ * than one thread at a time.
+ */
+static pthread_mutex_t layout_size_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Let the user interface set the width and height of a part. This is
+ * done for all parts that the layouter cannot measure itself, and may
+ * be done by several threads at once, when the cells of a table are
+ * layouted in parallel.
+ *
+ * @param partp A pointer to the part.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int layout_ui_set_size(struct layout_part *partp)
+{
+  int ret;
+
+  pthread_mutex_lock(&layout_size_lock);
+  ret = user_interface.ui_operations->set_size(partp);
+  pthread_mutex_unlock(&layout_size_lock);
+
+  return ret;
+}
+
+/**
+ * Find the font of a style of text in the list of fonts, and move it
+ * first in the list. The list must be locked.
+ *
+ * @param style The style of the text.
+ *
+ * @return a pointer to the font, or NULL if it is not in the list.
+ */
+static struct layout_font *layout_find_font(struct layout_text_styles *style)
+{
+  struct layout_font *font, *previous;
+
+  previous = NULL;
+  for(font = layout_fonts ; font ; font = font->next) {
+    if(font->size == style->size &&
+       font->monospaced == style->monospaced &&
+       font->italic == style->italic &&
+       font->bold == style->bold)
+      break;
+    previous = font;
+  }
+
+  /* The same font is most often asked for many times in a row. */
+  if(font && previous) {
+    previous->next = font->next;
+    font->next = layout_fonts;
+    layout_fonts = font;
+  }
+
+  return font;
+}
+
+/**
+ * Get the metrics of the font used for a style of text. The user
+ * interface is asked without the list of fonts locked, since it may
+ * take locks of its own, which another thread may hold while it waits
+ * for the list.
+ *
+ * @param style The style of the text.
+ *
+ * @return a pointer to the metrics, or NULL if the user interface cannot
+ * @return give any for this style.
+ */
+static struct zen_ui_font_metrics *
+layout_get_font_metrics(struct layout_text_styles *style)
+{
+  struct layout_font *font, *found;
+  int known;
+
+  if(user_interface.ui_operations->get_font_metrics == NULL)
+    return NULL;
+
+  pthread_mutex_lock(&layout_fonts_lock);
+  font = layout_find_font(style);
+  known = (font != NULL || layout_fonts_count >= LAYOUT_FONTS_MAX);
+  pthread_mutex_unlock(&layout_fonts_lock);
+
+  /* Once the list is full, text in other fonts is measured by the user
+   * interface, one string at a time.
+   */
+  if(known) {
+    if(font == NULL || !font->available)
+      return NULL;
+    return &font->metrics;
+  }
+
+  font = (struct layout_font *)malloc(sizeof(struct layout_font));
+  if(font == NULL)
+    return NULL;
+  font->size = style->size;
+  font->monospaced = style->monospaced;
+  font->italic = style->italic;
+  font->bold = style->bold;
+
+  pthread_mutex_lock(&layout_size_lock);
+  font->available =
+    !user_interface.ui_operations->get_font_metrics(style, &font->metrics)
+    && font->metrics.scale > 0;
+  pthread_mutex_unlock(&layout_size_lock);
+
+  /* Another thread may have added the same font in the meantime. */
+  pthread_mutex_lock(&layout_fonts_lock);
+  found = layout_find_font(style);
+  if(found == NULL && layout_fonts_count < LAYOUT_FONTS_MAX) {
+    font->next = layout_fonts;
+    layout_fonts = font;
+    layout_fonts_count++;
+  } else {
+    free(font);
+    font = found;
+  }
+  pthread_mutex_unlock(&layout_fonts_lock);
+
+  if(font == NULL || !font->available)
+    return NULL;
+
+  return &font->metrics;
+}
+
+/**
+ * Set the width and height of a text part. This calculates as if the
+ * text was placed in one row.
+ *
+ * @param partp A pointer to the text part.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int layout_set_text_size(struct layout_part *partp)
+{
+  struct zen_ui_font_metrics *metrics;
+  unsigned char *text;
+  double width;
+  int i;
+
+  metrics = layout_get_font_metrics(&partp->data.text.style);
+  if(metrics == NULL)
+    return layout_ui_set_size(partp);
+
+  text = (unsigned char *)partp->data.text.text;
+  width = 0;
+  for(i = 0 ; i < partp->data.text.length ; i++)
+    width += metrics->width[text[i]];
+
+  partp->geometry.width = (int)(width / metrics->scale);
+  partp->geometry.height = metrics->ascent + metrics->descent;
+
+  return 0;
+}
+
+/**
+ * Find out how much of the beginning of a text that fits within a
+ * certain width. If all of it fits, the width and height of the part are
+ * set, as with layout_set_text_size(). With the metrics of the font, the
+ * widths of the characters are added up until they no longer fit.
+ * Otherwise, since a longer piece of a text is never narrower than a
+ * shorter one, the length is found by halving the interval of possible
+ * lengths, which only asks the user interface for the size of a few
+ * pieces, no matter how long the text is. The text itself is left as it
+ * was.
+ *
+ * @param partp A pointer to the text part.
+ * @param width The width the text should fit within.
+ *
+ * @return the number of characters that fit, or a negative value if not
+ * @return even an empty text fits.
+ */
+int layout_fit_text(struct layout_part *partp, int width)
+{
+  struct zen_ui_font_metrics *metrics;
+  char *text;
+  int length, low, high, middle;
+  long sum, limit;
+
+  if(width < 0)
+    return -1;
+
+  text = partp->data.text.text;
+  length = partp->data.text.length;
+  metrics = layout_get_font_metrics(&partp->data.text.style);
+  if(metrics != NULL) {
+    /* The text is wider than the width as soon as this is reached. */
+    limit = (long)(width + 1) * metrics->scale;
+    sum = 0;
+    for(low = 0 ; low < length ; low++) {
+      sum += metrics->width[(unsigned char)text[low]];
+      if(sum >= limit)
+	return low;
+    }
+
+    partp->geometry.width = sum / metrics->scale;
+    partp->geometry.height = metrics->ascent + metrics->descent;
+
+    return low;
+  }
+
+  layout_ui_set_size(partp);
+  if(partp->geometry.width <= width)
+    return length;
+
+  low = 0;
+  high = length;
+  while(high - low > 1) {
+    middle = (low + high) / 2;
+    partp->data.text.length = middle;
+    layout_ui_set_size(partp);
+    partp->data.text.length = length;
+
+    if(partp->geometry.width <= width)
+      low = middle;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+/**
+ * Find how far below the top of a text part the baseline of the text is.
+ * Without the metrics of the font, the text is taken to stand on the
+ * bottom of the part.
+ *
+ * @param partp A pointer to the text part, which must already have its
+ * @param partp height set.
+ *
+ * @return the distance from the top of the part to the baseline.
+ */
+int layout_text_ascent(struct layout_part *partp)
+{
+  struct zen_ui_font_metrics *metrics;
+
+  metrics = layout_get_font_metrics(&partp->data.text.style);
+  if(metrics == NULL)
+    return partp->geometry.height;
+
+  return metrics->ascent;
+}
+
+/**
+ * Find the width of a text part, both as if it was placed in one row,
+ * and as its widest word, which is the narrowest it can be without
+ * cutting a word. The text is only broken at whitespace. The width and
+ * height of the part are set as with layout_set_text_size().
+ *
+ * @param partp A pointer to the text part.
+ * @param min_width A pointer to where the width of the widest word is
+ * @param min_width stored.
+ * @param max_width A pointer to where the width of the whole text is
+ * @param max_width stored.
+ */
+void layout_measure_text(struct layout_part *partp, int *min_width,
+			 int *max_width)
+{
+  struct zen_ui_font_metrics *metrics;
+  char *text;
+  int length, start, i;
+  long sum, word;
+
+  text = partp->data.text.text;
+  length = partp->data.text.length;
+  *min_width = 0;
+
+  metrics = layout_get_font_metrics(&partp->data.text.style);
+  if(metrics != NULL) {
+    sum = 0;
+    word = 0;
+    for(i = 0 ; i < length ; i++) {
+      sum += metrics->width[(unsigned char)text[i]];
+      if(isspace((int)text[i])) {
+	word = 0;
+      } else {
+	word += metrics->width[(unsigned char)text[i]];
+	if(word / metrics->scale > *min_width)
+	  *min_width = word / metrics->scale;
+      }
+    }
+
+    partp->geometry.width = sum / metrics->scale;
+    partp->geometry.height = metrics->ascent + metrics->descent;
+    *max_width = partp->geometry.width;
+
+    return;
+  }
+
+  /* Without the metrics, each word is measured as a text of its own. */
+  for(i = 0 ; i < length ; i = start) {
+    while(i < length && isspace((int)text[i]))
+      i++;
+    start = i;
+    while(start < length && !isspace((int)text[start]))
+      start++;
+    if(start == i)
+      break;
+
+    partp->data.text.text = text + i;
+    partp->data.text.length = start - i;
+    layout_ui_set_size(partp);
+    if(partp->geometry.width > *min_width)
+      *min_width = partp->geometry.width;
+  }
+
+  partp->data.text.text = text;
+  partp->data.text.length = length;
+  layout_ui_set_size(partp);
+  *max_width = partp->geometry.width;
+}
+
+/**
+ * Free the metrics of all fonts. This is done when the program ends.
+ */
+void layout_free_fonts(void)
+{
+  struct layout_font *font, *next;
+
+  for(font = layout_fonts ; font ; font = next) {
+    next = font->next;
+    free(font);
+  }
+
+  layout_fonts = NULL;
+  layout_fonts_count = 0;
+}
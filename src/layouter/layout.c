@@ -8,7 +8,7 @@
  * - Set sizes, sets the size of those parts which do not yet have
  *   a width and height set.
  * - Layouting, performs the actual layouting of the parts.
- * - Alignment, aligns the parts when they have been layouted.
+ * - Alignment, aligns the parts on a row when the row is finished.
  *
  * @author Tomas Berndtsson <tomas@nocrew.org>
  */
@@ -52,100 +52,39 @@
 #include <dmalloc.h>
 #endif /* HAVE_DMALLOC_H */
 
-/* External declaration of internal linked list for layout parts. 
- * The real variable is placed in build.c.
+/* Images are loaded by one thread at a time, even when the cells of a
+ * table are layouted by several.
  */
-extern struct layout_part *layout_internal_parts;
-
-/* A pointer to the current page information for the active page. */
-static struct layout_part *current_basep = NULL;
+static pthread_mutex_t layout_images_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
  * This function prepares some parts before the actual layouting can 
- * take place. It compresses multiple paragraphs, removed some unwanted
- * text, loads images and layouts tables. 
+ * take place. It loads images and layouts tables. Multiple paragraphs
+ * have already been compressed by layout_add_part(). 
+ * When the parts are only to be measured, the tables are left alone,
+ * since their cells are prepared as they are measured.
  *
+ * @param context The context of the layouting.
+ * @param budget How many parts may be prepared before other threads are
+ * @param budget let to run.
  * @param partp A pointer to the first element in a linked list of layout
  * @param partp parts. This is never NULL now, since we only call this
  * @param partp from layout_do(). At least so far. 
+ * @param stop The first part in the list which is not to be prepared,
+ * @param stop or NULL to prepare the rest of the list.
+ * @param total_width The total possible width to work with.
+ * @param tables Non-zero value if the tables are to be layouted.
  *
  * @return non-zero value if an error occurred.
  */
-static int layout_prepare_parts(struct layout_part *partp, int total_width)
+static int layout_prepare_parts(struct layout_context *context,
+				struct thread_budget *budget,
+				struct layout_part *partp, 
+				struct layout_part *stop, int total_width,
+				int tables)
 {
-  struct layout_part *tmp;
-
-  while(partp) {
+  while(partp && partp != stop) {
     switch(partp->type) {
-      /* If many paragraphs are placed after one another, html work in such 
-       * a way that they act as if there was only one. The paragraph tag has
-       * higher priority than the break row tag, which means if there is a
-       * break row already, and a paragraph is approaching, the stored part
-       * is saved as a paragraph.
-       * This is not true for plain texts, which should have all paragraphs
-       * left intact. Plain texts use permanent paragraphs. However, to get
-       * the correct line distances, two paragraphs in a row will always
-       * turn the second one into a paragraph, as opposed to a break line.
-       * We must also make sure that alignments are always taken from the
-       * last paragraph and not from the first. 
-       */
-    case LAYOUT_PART_PARAGRAPH:
-      if(partp->data.paragraph.permanent) {
-	if(partp->previous)
-	  if(partp->previous->type == LAYOUT_PART_PARAGRAPH)
-	    partp->data.paragraph.paragraph = 1;
-	
-	break;
-      }
-
-      if(partp->previous) {
-	if(partp->previous->type == LAYOUT_PART_PARAGRAPH) {
-	  if(!partp->previous->data.paragraph.paragraph) {
-	    partp->previous->data.paragraph.paragraph = 
-	      partp->data.paragraph.paragraph;
-	  }
-	  /* If this is a paragraph, and not a break row, we should make
-	   * sure its alignment is copied to the one we are going to keep.
-	   */
-	  if(partp->data.paragraph.paragraph) {
-#ifdef DEBUG
-	    fprintf(stderr, "copying alignment... %d => %d\n",
-		    partp->previous->align.indent_offset,
-		    partp->align.indent_offset);
-#endif
-	    partp->previous->align = partp->align;
-	  }
-	  /* Remove the current part from the list, as it is now obsolete. */
-	  if(partp->next != NULL)
-	    partp->next->previous = partp->previous;
-	  partp->previous->next = partp->next;
-	  tmp = partp->previous;
-	  layout_free_part(partp);
-	  partp = tmp;
-	} else if(partp->previous->previous && 
-		  partp->previous->type == LAYOUT_PART_TEXT && 
-		  partp->previous->previous->type == LAYOUT_PART_PARAGRAPH && 
-		  (!strcmp(partp->previous->data.text.text, " ") || 
-		   strlen(partp->previous->data.text.text) == 0)) {
-	  if(!partp->previous->previous->data.paragraph.paragraph) {
-	    partp->previous->previous->data.paragraph.paragraph = 
-	      partp->data.paragraph.paragraph;
-	  }
-
-	  /* Remove both the almost empty text as well as the current 
-	   * paragraph. 
-	   */
-	  if(partp->next != NULL)
-	    partp->next->previous = partp->previous->previous;
-	  partp->previous->previous->next = partp->next;
-	  tmp = partp->previous->previous;
-	  layout_free_part(partp->previous);
-	  layout_free_part(partp);
-	  partp = tmp;
-	} 
-      }
-      break;
-
       /* This converts a graphics part to a text part if the user
        * interface has reported that it does not support images. 
        * I am not yet sure that this is the best place to do this. 
@@ -160,25 +99,32 @@ static int layout_prepare_parts(struct layout_part *partp, int total_width)
 	  struct layout_part *new_part;
 	  char *new_text;
 	  
-	  new_part = layout_init_part(LAYOUT_PART_TEXT);
+	  new_part = layout_init_part(partp, LAYOUT_PART_TEXT);
 	  if(new_part == NULL) {
 	    break;
 	  }
 	  new_part->align = partp->align;
 
-	  new_text = (char *)malloc(strlen(partp->data.graphics.alt_text) + 1);
-	  if(new_part == NULL) {
+	  new_text =
+	    layout_alloc_string(new_part,
+				strlen(partp->data.graphics.alt_text) + 1);
+	  if(new_text == NULL) {
 	    layout_free_part(new_part);
+	    break;
 	  }
 	  strcpy(new_text, partp->data.graphics.alt_text);
-	  new_part->data.text.text = new_text;
+	  layout_set_text(new_part, new_text);
 	  if(partp->previous != NULL)
 	    partp->previous->next = new_part;
 	  if(partp->next != NULL)
 	    partp->next->previous = new_part;
 	  new_part->next = partp->next;
 	  new_part->previous = partp->previous;
+	  new_part->parent = partp->parent;
+	  if(partp->parent != NULL && partp->parent->last_child == partp)
+	    partp->parent->last_child = new_part;
 	  layout_free_part(partp);
+	  partp = new_part;
 	} else {
 	  /* In this case the user interface does not support images, and 
 	   * there is no alternative text. Then we simply remove the image
@@ -192,10 +138,19 @@ static int layout_prepare_parts(struct layout_part *partp, int total_width)
 	   * if we really want to. 
 	   */
 	  if(partp->previous != NULL) {
-	    if(partp->next != NULL)
-	      partp->next->previous = partp->previous;
-	    partp->previous->next = partp->next;
+	    struct layout_part *next;
+
+	    next = partp->next;
+	    if(next != NULL)
+	      next->previous = partp->previous;
+	    partp->previous->next = next;
+	    if(partp->parent != NULL && partp->parent->last_child == partp)
+	      partp->parent->last_child = NULL;
 	    layout_free_part(partp);
+
+	    /* The part is gone, so go on with the one after it. */
+	    partp = next;
+	    continue;
 	  }
 	}
       } else {
@@ -206,22 +161,26 @@ static int layout_prepare_parts(struct layout_part *partp, int total_width)
 	struct image_data *picture;
 
 	/* If the image is already loaded for some reason, do not try to load 
-	 * it again, or we will have problems.
+	 * it again, or we will have problems. Neither is an image which
+	 * could not be loaded the first time the page was layouted.
 	 */
-	if(partp->data.graphics.data)
+	if(partp->data.graphics.data || partp->data.graphics.tried)
 	  break;
+	partp->data.graphics.tried = 1;
 
-	if(current_basep == NULL)
+	pthread_mutex_lock(&layout_images_lock);
+	if(context->page == NULL)
 	  img_fd = protocol_open(partp->data.graphics.src, NULL, NULL);
 	else
 	  img_fd = protocol_open(partp->data.graphics.src, 
-				 current_basep->data.page_information.url,
-				 current_basep->data.page_information.base_url);
+				 context->page->data.page_information.url,
+				 context->page->data.page_information.base_url);
 
 	/* If we are unable to open the image, we might want to convert the
 	 * image part into a text part containing the alternative text.
 	 */
 	if(img_fd < 0) {
+	  pthread_mutex_unlock(&layout_images_lock);
 	  break;
 	}
 	
@@ -233,6 +192,7 @@ static int layout_prepare_parts(struct layout_part *partp, int total_width)
 	picture = image_open(img_fd, partp->geometry.width, partp->geometry.height);
 	if(picture == NULL) {
 	  protocol_close(img_fd);
+	  pthread_mutex_unlock(&layout_images_lock);
 	  if(partp->geometry.width == -1)
 	    partp->geometry.width = 0;
 	  if(partp->geometry.height == -1)
@@ -248,24 +208,27 @@ static int layout_prepare_parts(struct layout_part *partp, int total_width)
 	free(picture);
 
 	protocol_close(img_fd);
+	pthread_mutex_unlock(&layout_images_lock);
       }
       break;
 
       /* The table has its own layouting function. */
     case LAYOUT_PART_TABLE:
-      layout_table(partp, total_width);
+      if(tables)
+	layout_table(context, partp, total_width);
       break;
 
     default:
       break;
     }
 
-    /* Yield after each layout part. Maybe that's overkill? */
-    thread_yield();
+    /* Let other threads run, if enough parts have been prepared. */
+    thread_budget_spend(budget, 1);
 
     /* Recurse over child parts, if there are any. */
     if(partp->child != NULL && partp->type != LAYOUT_PART_TABLE)
-      layout_prepare_parts(partp->child, total_width);
+      layout_prepare_parts(context, budget, partp->child, NULL, total_width,
+			   tables);
 
     partp = partp->next;
   }
@@ -281,11 +244,15 @@ static int layout_prepare_parts(struct layout_part *partp, int total_width)
  * @param partp A pointer to the first element in a linked list of layout
  * @param partp parts. This is never NULL now, since we only call this
  * @param partp from layout_do(). At least so far. 
+ * @param stop The first part in the list which is not to be sized,
+ * @param stop or NULL to size the rest of the list.
+ * @param total_width The total possible width to work with.
  *
  * @return the single maximum width of a part, not counting a text as one
  * @return wide part, since that can be divided later.
  */
-static int layout_set_sizes(struct layout_part *partp, int total_width)
+static int layout_set_sizes(struct layout_part *partp, 
+			    struct layout_part *stop, int total_width)
 {
   int max_width, part_max;
 
@@ -294,7 +261,7 @@ static int layout_set_sizes(struct layout_part *partp, int total_width)
 
   max_width = 0;
   part_max = 0;
-  while(partp) {
+  while(partp && partp != stop) {
     switch(partp->type) {
     case LAYOUT_PART_PARAGRAPH:
       partp->geometry.width = 0;
@@ -310,9 +277,10 @@ static int layout_set_sizes(struct layout_part *partp, int total_width)
       break;
 
     case LAYOUT_PART_LINE:
-      if(!partp->data.line.absolute)
-	partp->data.line.width = (partp->data.line.width * total_width) / 100;
-      partp->geometry.width = partp->data.line.width;
+      if(partp->data.line.absolute)
+	partp->geometry.width = partp->data.line.width;
+      else
+	partp->geometry.width = (partp->data.line.width * total_width) / 100;
       partp->geometry.height = 2 * 7 + partp->data.line.size;
       break;
 
@@ -336,7 +304,7 @@ static int layout_set_sizes(struct layout_part *partp, int total_width)
     case LAYOUT_PART_FORM_CHECKBOX:
     case LAYOUT_PART_FORM_RADIO:
     case LAYOUT_PART_FORM_TEXT:
-      user_interface.ui_operations->set_size(partp);
+      layout_ui_set_size(partp);
       break;
 
     default:
@@ -346,7 +314,7 @@ static int layout_set_sizes(struct layout_part *partp, int total_width)
 
     /* Recurse over the child parts, if there are any. */
     if(partp->child != NULL && partp->type != LAYOUT_PART_TABLE)
-      part_max = layout_set_sizes(partp->child, total_width);
+      part_max = layout_set_sizes(partp->child, NULL, total_width);
 
     if(part_max == 0) {
       if(partp->geometry.width > max_width)
@@ -363,225 +331,232 @@ static int layout_set_sizes(struct layout_part *partp, int total_width)
 }
 
 /**
- * This puts the correct alignment on previously layouted parts. That
- * means that it travels backwards in the linked list, and possibly moves
- * each part that are on the same row to a more correct position in 
- * the known universe. 
+ * Add a part to the row which is being layouted. The part must already
+ * have been placed and got its size.
  *
- * @param partp A pointer to the last element in the linked list to be
- * @param partp aligned. If this is NULL, we exit gracefully, but also
- * @param partp returns a fabulous error code.
- * @param max_width The total width of the whole screen as we know it.
- * @param max_part_height The height of the highest part in this row.
+ * @param context The context of the layouting.
+ * @param partp A pointer to the part.
  *
  * @return non-zero value if an error occurred.
  */
-int layout_align_parts(struct layout_part *partp, int max_width, 
-		       int max_part_height)
+static int layout_line_add(struct layout_context *context,
+			   struct layout_part *partp)
 {
-  int current_y_position, found;
-  int row_width, row_x_offset;
-
-  /* Find the first valid part to align. */
-  found = 0;
-  while(!found) {
-    while(partp && partp->type == LAYOUT_PART_DELETED)
-      partp = partp->previous;
-    
-    if(partp == NULL)
+  struct layout_line *line = &context->line;
+  struct layout_line_member *members;
+  int size, baseline;
+
+  if(line->count == line->size) {
+    size = (line->size > 0 ? line->size * 2 : 16);
+    members = (struct layout_line_member *)
+      realloc(line->members, sizeof(struct layout_line_member) * size);
+    if(members == NULL)
       return 1;
-    
-    if(partp->type == LAYOUT_PART_PARAGRAPH)
-      return 0;
-    
-    found = 1;
-    while(partp && partp->type == LAYOUT_PART_LINK) {
-      found = 0;
-      partp = partp->child;
-    }
+    line->members = members;
+    line->size = size;
   }
 
-  /* We read the Y position from the pointed part, and store that. This
-   * is then used to see that we keep our alignment within the same row
-   * of parts. We stop aligning as soon as we hit the previous row, since
-   * that is already aligned.
-   */
-  current_y_position = partp->geometry.y_position;
+  if(partp->type == LAYOUT_PART_TEXT)
+    baseline = layout_text_ascent(partp);
+  else
+    baseline = partp->geometry.height;
 
-  /* The row width is used to know how much we should move the parts
-   * horizontally, if we align to the right or to the center.
-   */
-  row_width = partp->geometry.x_position + partp->geometry.width;
-
-  switch(partp->align.horizontal) {
-  case LAYOUT_PART_ALIGN_LEFT:
-  case LAYOUT_PART_ALIGN_JUSTIFY:
-    row_x_offset = 0;
-    break;
-
-  case LAYOUT_PART_ALIGN_CENTER:
-  case LAYOUT_PART_ALIGN_FORCED_CENTER:
-    row_x_offset = (max_width - row_width) / 2;
-    break;
-    
-  case LAYOUT_PART_ALIGN_RIGHT:
-    row_x_offset = max_width - row_width;
-    break;
+  line->members[line->count].part = partp;
+  line->members[line->count].baseline = baseline;
+  line->count++;
 
-  default:
-    row_x_offset = 0;
-  }
+  line->width = partp->geometry.x_position + partp->geometry.width;
+  if(partp->geometry.height > line->height)
+    line->height = partp->geometry.height;
 
-  /* Step backwards through the list and align, until we bump into
-   * the start of the list, or until the row comes to a beginning.
-   * Also break if we get to a title or a paragraph.
-   */
-  while(partp) {
-    if(partp->geometry.y_position < current_y_position ||
-       partp->type == LAYOUT_PART_PAGE_INFORMATION ||
-       partp->type == LAYOUT_PART_PARAGRAPH)
-      break;
+  if(partp->align.vertical == LAYOUT_PART_ALIGN_BOTTOM) {
+    if(baseline > line->baseline)
+      line->baseline = baseline;
+    if(partp->geometry.height - baseline > line->depth)
+      line->depth = partp->geometry.height - baseline;
+  }
 
-#ifdef DEBUG
-    fprintf(stderr, "%s: partp=%p, type=%d, x_offset=%d, max_height=%d\n", 
-	    __FUNCTION__, partp, partp->type, row_x_offset, max_part_height);
-#endif /* DEBUG */
+  return 0;
+}
 
-    partp->geometry.x_position += row_x_offset;
+/**
+ * Finish the row which is being layouted, by aligning the parts on it.
+ * The whole row is moved sideways according to the horizontal alignment
+ * of its last part, while each part is moved down according to its own
+ * vertical alignment. A part aligned to the bottom is put on the
+ * baseline of the row, so that texts of different sizes, and images
+ * next to them, stand on the same line. A table on the row gets the
+ * positions of its cells set, now that it will not be moved any more.
+ *
+ * Afterwards, the row has no parts, but the height of the whole row is
+ * left in the line.
+ *
+ * @param context The context of the layouting.
+ */
+static void layout_line_end(struct layout_context *context)
+{
+  struct layout_line *line = &context->line;
+  struct layout_part *partp;
+  int x_offset, y_offset, i;
 
-    /* Vertical alignment does not yet work properly. */
-#if 0
-    fprintf(stderr, "valign=%d\n", partp->align.vertical);
-    /* Align this particular part vertically. */
-    switch(partp->align.vertical) {
-    case LAYOUT_PART_ALIGN_TOP:
-      /* We do not need to do any alignment here. */
-      break;
+  if(line->baseline + line->depth > line->height)
+    line->height = line->baseline + line->depth;
 
-    case LAYOUT_PART_ALIGN_MIDDLE:
-      partp->geometry.y_position += (max_part_height - 
-				     partp->geometry.height) / 2;
+  x_offset = 0;
+  if(line->count > 0) {
+    switch(line->members[line->count - 1].part->align.horizontal) {
+    case LAYOUT_PART_ALIGN_CENTER:
+    case LAYOUT_PART_ALIGN_FORCED_CENTER:
+      x_offset = (context->max_width - line->width) / 2;
       break;
-
-    case LAYOUT_PART_ALIGN_BOTTOM:
-      partp->geometry.y_position += max_part_height - partp->geometry.height;
+    
+    case LAYOUT_PART_ALIGN_RIGHT:
+      x_offset = context->max_width - line->width;
       break;
 
     default:
       break;
     }
-#endif
+  }
 
-    /* After aligning the whole table, we call this to set the cell
-     * positions.
-     */
-    if(partp->type == LAYOUT_PART_TABLE) {
-      layout_table_set_positions(partp, NULL, 0);
-      break;
-    }
+  for(i = 0 ; i < line->count ; i++) {
+    partp = line->members[i].part;
 
-    if(partp->previous != NULL || 
-       partp->parent->type == LAYOUT_PART_TABLE_CELL)
-      partp = partp->previous;
-    else
-      partp = partp->parent->previous;
+    switch(partp->align.vertical) {
+    case LAYOUT_PART_ALIGN_MIDDLE:
+      y_offset = (line->height - partp->geometry.height) / 2;
+      break;
 
-    if(partp && partp->type == LAYOUT_PART_TABLE)
+    case LAYOUT_PART_ALIGN_BOTTOM:
+      y_offset = line->baseline - line->members[i].baseline;
       break;
 
-    /* Align the child parts of a link group, starting at the last part. */
-    if(partp && partp->type == LAYOUT_PART_LINK && partp->child) {
-      partp = partp->child;
-      while(partp->next)
-	partp = partp->next;
+    default:
+      y_offset = 0;
     }
+
+    partp->geometry.x_position += x_offset;
+    partp->geometry.y_position += y_offset;
+
+    if(partp->type == LAYOUT_PART_TABLE)
+      layout_table_set_positions(partp, NULL, 0);
   }
 
-  return 0;
+  line->count = 0;
+  line->width = 0;
+  line->baseline = 0;
+  line->depth = 0;
 }
 
 /**
- * Perform the layouting of all the wonderful parts that the parser
- * has picked up from the fantastic stream provided by earlier parts
- * of the procedure. This will go through the linked list of layout
- * parts, and decide how they are to be spread over the screen that
- * the interface presents us with. This is done using extensive
- * mathematical calculations, optimised to their maximum.
- *
- * @param parts A pointer to the first element in a linked list of layout
- * @param parts parts. If `parts' is NULL, use the internal linked list.
- * @param keep_position A non-zero value means that the X and Y position
- * @param keep_position we are currently working at, is not changed from 
- * @param keep_position the previous call. This is used for layouting child
- * @param keep_position part trees. A value of zero will reset them to 0;0.
- * @param total_width The total possible width to work with. A value of zero
- * @param total_width will use the width of the user interface display.
- * @param total_width Note that this is not necessarily the actual width of
- * @param total_width the finished parts, but more of a guide line.
- * @param result_height
+ * Finish the row which is being layouted, and start a new one below it.
  *
- * @return the maximum width of the layouted parts, or a negative value
- * @return if an error occurred.
+ * @param context The context of the layouting.
+ * @param indent The X position where the new row starts.
  */
-int layout_do(struct layout_part *parts, int keep_position, int total_width,
-	      int *result_height)
+static void layout_line_break(struct layout_context *context, int indent)
 {
-  struct layout_part *partp;
-  static int max_width = 0, max_row_height = 0;
-  static int x_position = 0, y_position = 0;
-  int saved_x_position = 0, saved_y_position = 0;
-  int saved_max_width = 0, saved_max_row_height = 0;
-  int previous_y_position, tmp;
+  layout_line_end(context);
 
-  if(parts == NULL)
-    partp = layout_get_page_information(NULL);
-  else
-    partp = parts;
+  context->x_position = indent;
+  context->y_position += context->line.height;
+  context->line.height = 0;
+}
 
-  /* If the internal list is completely empty, there is not much good we
-   * can do, else than consider it an error and bring these devestating
-   * news back to the unfortunate caller of this function.
-   */
-  if(partp == NULL)
-    return -1;
+/**
+ * Forget the parts on the row which was layouted last, when a list of
+ * parts has been layouted, and free the room they were kept in.
+ *
+ * @param context The context of the layouting.
+ */
+static void layout_line_free(struct layout_context *context)
+{
+  if(context->line.members != NULL)
+    free(context->line.members);
 
-  if(partp->type == LAYOUT_PART_PAGE_INFORMATION) {
-    current_basep = partp;
-  }
+  context->line.members = NULL;
+  context->line.count = 0;
+  context->line.size = 0;
+}
 
-  if(!keep_position) {
-    saved_x_position = x_position;
-    saved_y_position = y_position;
-    saved_max_width = max_width;
-    saved_max_row_height = max_row_height;
+/**
+ * Set the width and height of a block of preformatted lines. Each line
+ * is measured as if it were a text part of its own. The widest line
+ * gives the width of the block, and the highest line the height of
+ * every row in it. A mapped file may be far too large to look at every
+ * line, so there only the longest line is measured, which is enough
+ * since the text is monospaced.
+ *
+ * @param partp A pointer to the preformatted part.
+ */
+static void layout_set_preformatted_size(struct layout_part *partp)
+{
+  struct layout_part_preformatted_data *block;
+  struct layout_part line;
+  int index, last, width, height;
+
+  block = &partp->data.preformatted;
+
+  memset(&line, 0, sizeof(struct layout_part));
+  line.type = LAYOUT_PART_TEXT;
+  line.align = partp->align;
+  line.parent = partp->parent;
+  line.data.text.style = block->style;
+
+  if(block->mapped) {
+    index = block->longest_line;
+    last = index + 1;
+  } else {
+    index = 0;
+    last = block->number_of_lines;
+  }
 
-    x_position = 0;
-    y_position = 0;
-    max_row_height = 0;
-    
-    /* Get rid of excess fat. Once. */
-    layout_prepare_parts(partp, total_width);
-    
-    /* Set width and height of all parts. This also find the maximum width 
-     * among all parts. 
-     */
-    max_width = layout_set_sizes(partp, total_width);
-    
-    /* We want to use max_width as reference when layouting the parts. */
-    if(total_width <= 0) {
-      if(max_width < user_interface.ui_display.width)
-	max_width = user_interface.ui_display.width;
-    } else {
-      if(max_width < total_width)
-	max_width = total_width;
-    }
+  width = 0;
+  height = 0;
+  for( ; index < last ; index++) {
+    line.data.text.text = layout_get_line(partp, index);
+    if(line.data.text.text == NULL)
+      continue;
+    line.data.text.length = strlen(line.data.text.text);
+    layout_set_text_size(&line);
+
+    if(line.geometry.width > width)
+      width = line.geometry.width;
+    if(line.geometry.height > height)
+      height = line.geometry.height;
   }
 
+  block->line_height = height;
+  partp->geometry.width = width;
+  partp->geometry.height = height * block->number_of_lines;
+}
+
+/**
+ * Layout the parts in a linked list, starting at the position where the
+ * previous parts ended. This is the real work horse of layout_do(), and
+ * expects the parts to have been prepared and sized already.
+ *
+ * @param context The context of the layouting, which tells where the
+ * @param context parts are placed.
+ * @param partp A pointer to the first part in the list to layout.
+ * @param stop The first part in the list which is not to be layouted,
+ * @param stop or NULL to layout the rest of the list.
+ * @param result_height A pointer to where the height of the layouted
+ * @param result_height parts is stored, or NULL.
+ *
+ * @return the maximum width of the layouted parts, or a negative value
+ * @return if an error occurred.
+ */
+static int layout_do_parts(struct layout_context *context,
+			   struct layout_part *partp, 
+			   struct layout_part *stop, int *result_height)
+{
+  struct layout_part *parent;
 
   /* Here is an attempt to explain what this is all about.
    * We go through the linked list from beginning to end, working with one
    * part at a time, until that it completely finished.
-   * The variables x_position and y_position are set to the coordinates
+   * The positions in the context are set to the coordinates
    * where the next part will end up. An exception to this rule is when we
    * stumble across a paragraph part, which instead sets those variables
    * to where the next part will be placed. Another exception is if we are
@@ -589,13 +564,14 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
    * row, and set the position variables accordingly. In the case that the
    * part is a text, we might have to split that text up into several parts
    * if it is too long to fit on one row.
-   * The variable max_row_height is used to keep track of the highest height
-   * during one row. It is used when we go down to a new row, to know how much
-   * to increase y_position with.
+   * The line in the context keeps track of the parts placed on the current
+   * row, and of the highest height during it. It is used when we go down to
+   * a new row, to know how much to increase y_position with.
    * 
    * Alignments are handled in such a way that a row is first layouted as if
    * there was no alignment, or rather, as if the alignment was always to the
-   * left and top, and parts are then moved accordingly to the real alignment.
+   * left and top, and the parts on it are then moved accordingly to the real
+   * alignment, when the row is finished.
    *
    * The contents of tables have already been layouted at this point, 
    * and here, only the whole table is moved around in the rest of the page.
@@ -603,10 +579,10 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
    * I hope this is all clear now.
    */
 
-  /* Traverse the tree and lay out to the future. */
-  while(partp) {
+  parent = (partp ? partp->parent : NULL);
 
-    previous_y_position = y_position;
+  /* Traverse the tree and lay out to the future. */
+  while(partp && partp != stop) {
 
     /*
     fprintf(stderr, 
@@ -619,45 +595,41 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
 
     switch(partp->type) {
     case LAYOUT_PART_PARAGRAPH:
-      x_position = partp->align.indent_offset;
-      y_position += max_row_height;
-      max_row_height = 0;
-      partp->geometry.x_position = x_position;
-      partp->geometry.y_position = y_position;
-      y_position += partp->geometry.height;
+      layout_line_break(context, partp->align.indent_offset);
+      partp->geometry.x_position = context->x_position;
+      partp->geometry.y_position = context->y_position;
+      context->y_position += partp->geometry.height;
       break;
 
+      /* A line is a row of its own. */
     case LAYOUT_PART_LINE:
-      x_position = partp->align.indent_offset;
-      y_position += max_row_height;
-      max_row_height = 0;
-      partp->geometry.x_position = x_position;
-      partp->geometry.y_position = y_position;
-      y_position += partp->geometry.height;
+      layout_line_break(context, partp->align.indent_offset);
+      partp->geometry.x_position = context->x_position;
+      partp->geometry.y_position = context->y_position;
+      layout_line_add(context, partp);
+      layout_line_break(context, partp->align.indent_offset);
       break;
 
     case LAYOUT_PART_TEXT:
       {
+	int width_left, fit_length;
+
 	/* Preformatted text demands special attention. I want to give it
 	 * the best treatment it can possible get.
 	 */
 	if(partp->data.text.style.preformatted) {
-	  /* Let the user interface set the width and height for this piece 
-	   * of text. This calculates as if the text was placed in one row.
+	  /* Set the width and height for this piece of text. This
+	   * calculates as if the text was placed in one row.
 	   */
-	  user_interface.ui_operations->set_size(partp);
-
-	  if(max_width < partp->geometry.width)
-	    max_width = partp->geometry.width;
+	  layout_set_text_size(partp);
 
-	  if(partp->geometry.height > max_row_height)
-	    max_row_height = partp->geometry.height;
+	  if(context->max_width < partp->geometry.width)
+	    context->max_width = partp->geometry.width;
 
-	  partp->geometry.x_position = x_position;
-	  partp->geometry.y_position = y_position;
-	  x_position = 0;
-	  y_position += max_row_height;
-	  max_row_height = 0;
+	  partp->geometry.x_position = context->x_position;
+	  partp->geometry.y_position = context->y_position;
+	  layout_line_add(context, partp);
+	  layout_line_break(context, 0);
 
 	  break;
 	}
@@ -665,28 +637,29 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
 	/* We do not want any excess whitespace at the beginning of a row. 
 	 * We also know that there can be only one whitespace at this point.
 	 */
-	if(x_position == partp->align.indent_offset && 
+	if(context->x_position == partp->align.indent_offset && 
+	   partp->data.text.length > 0 &&
 	   isspace((int)partp->data.text.text[0])) {
-	  memmove(partp->data.text.text, partp->data.text.text + 1,
-		  strlen(partp->data.text.text));
+	  partp->data.text.text++;
+	  partp->data.text.length--;
 	}
 
-	/* Let the user interface set the width and height for this piece 
-	 * of text. This calculates as if the text was placed in one row.
+	/* Find out how much of this piece of text that fits in the room
+	 * that is left of the row. If all of it does, its width and height
+	 * are set, as if the text was placed in one row.
 	 */
-	user_interface.ui_operations->set_size(partp);
+	width_left = context->max_width - context->x_position;
+	fit_length = layout_fit_text(partp, width_left);
 
-	if(partp->geometry.height > max_row_height)
-	  max_row_height = partp->geometry.height;
-      
-	if(x_position + partp->geometry.width <= max_width) {
+	if(fit_length == partp->data.text.length) {
 	  /* If we manage to drag the program counter here, it means that all
 	   * text in this part actually fits within the room that is left of
 	   * the user interface. Despite the long comment, it is a good thing.
 	   */
-	  partp->geometry.x_position = x_position;
-	  partp->geometry.y_position = y_position;
-	  x_position += partp->geometry.width;
+	  partp->geometry.x_position = context->x_position;
+	  partp->geometry.y_position = context->y_position;
+	  layout_line_add(context, partp);
+	  context->x_position += partp->geometry.width;
 	} else {
 	  /* If we reach this point, we need to break the text up into two
 	   * parts. The first part will of course fit in this row, or we would
@@ -695,42 +668,49 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
 	   * right after the current, and will therefore become the next part
 	   * to be processed by this very same loop. Bejoyed.
 	   *
+	   * Neither part gets a copy of the text. Both point into the text
+	   * of the original part, which is only freed with that part.
+	   *
 	   * Word wrapping is performed, unless a word takes up the whole line,
 	   * then that word is cut off at the end of the line.
 	   */
-	  int first_text_length, second_text_length, width_left;
+	  int first_text_length, full_length;
 	  struct layout_part *second_part;
-	  char *first_text, *second_text, *full_text;
+	  char *text;
 
 	  /* Place this part in the correct position. */
-	  partp->geometry.x_position = x_position;
-	  partp->geometry.y_position = y_position;
+	  partp->geometry.x_position = context->x_position;
+	  partp->geometry.y_position = context->y_position;
 	  
-	  /* Put the rest of the string into a new part. */
+	  text = partp->data.text.text;
+	  full_length = partp->data.text.length;
 
-	  width_left = max_width - x_position;
-	  
-	  /* Save the full, original text for future reference, since the 
-	   * following code will change the text which is placed in the
-	   * part. 
+	  /* Word wrap and find the best place to cut the text off. That is
+	   * the last whitespace within the part of the text which fits,
+	   * since the text before it then fits as well.
 	   */
-	  full_text = (char *)malloc(strlen(partp->data.text.text) + 1);
-	  if(full_text == NULL)
-	    return -1;
-	  strcpy(full_text, partp->data.text.text);
-
-	  /* Word wrap and find the best place to cut the text off. */
-	  first_text = partp->data.text.text;
-	  first_text_length = strlen(first_text);
-	  do {
-	    while(first_text_length > 0 && 
-		  !isspace((int)first_text[first_text_length - 1]))
-	      first_text_length--;
-	    if(first_text_length > 0)
-	      first_text[first_text_length - 1] = '\0';
-	    
-	    user_interface.ui_operations->set_size(partp);
-	  } while(first_text_length > 0 && width_left < partp->geometry.width);
+	  first_text_length = fit_length;
+	  while(first_text_length >= 0 &&
+		!isspace((int)text[first_text_length]))
+	    first_text_length--;
+
+	  if(first_text_length >= 0) {
+	    partp->data.text.length = first_text_length;
+	    first_text_length++;
+	  } else {
+	    /* Not even the first word fits. Only that word is left in
+	     * the part, which still gives the height of this row.
+	     */
+	    partp->data.text.length = 0;
+	    while(partp->data.text.length < full_length &&
+		  !isspace((int)text[partp->data.text.length]))
+	      partp->data.text.length++;
+	    first_text_length = 0;
+	  }
+	  layout_set_text_size(partp);
+
+	  if(partp->geometry.height > context->line.height)
+	    context->line.height = partp->geometry.height;
 
     	  /* If the whole text was wrapped, we mark this part as deleted, and
 	   * it the text will be taken care of on the next row. However, if 
@@ -738,19 +718,15 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
 	   * the next row, because then we might end up in an infinite loop.
 	   * Instead, we cut the word off.
 	   *
-	   * Marking the part as deleted is a bad idea, because it will create
-	   * a memory leak. This will have to be made in a different way later.
+	   * A part marked as deleted still owns its text, which the parts
+	   * after it may point into, so it is kept until the page is freed.
 	   */
 	  if(first_text_length == 0) {
-	    if(x_position == partp->align.indent_offset) {
-	      width_left = max_width - x_position;
-	      strcpy(first_text, full_text);
-	      first_text_length = strlen(first_text);
-	      do {
-		first_text_length--;
-		first_text[first_text_length] = '\0';
-		user_interface.ui_operations->set_size(partp);
-	      } while(first_text_length > 0 && width_left < partp->geometry.width);
+	    if(context->x_position == partp->align.indent_offset) {
+	      /* How much of the word that fits was found above. */
+	      first_text_length = (fit_length > 0 ? fit_length : 0);
+	      partp->data.text.length = first_text_length;
+	      layout_set_text_size(partp);
 
 	      /* If we do not even have room for one character, we are in 
 	       * trouble. Let us quietly mark the text part as deleted, and 
@@ -758,7 +734,6 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
 	       */
 	      if(first_text_length == 0) {
 		partp->type = LAYOUT_PART_DELETED;	    
-		free(full_text);
 		break;
 	      }
 	    } else {
@@ -766,29 +741,21 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
 	    }
 	  }
 
-	  /* Set the position variables with new values. */
-	  x_position = partp->align.indent_offset;
-	  y_position += max_row_height;
-	  max_row_height = partp->geometry.height;
-
-	  second_text_length = strlen(full_text) - first_text_length;
-
-	  second_text = (char *)malloc(second_text_length + 1);
-	  if(second_text == NULL) {
-	    /* Flee the field, before it is too late not to. */
-	    free(full_text);
-	    break;
-	  }
-	  strcpy(second_text, full_text + first_text_length);
-	  free(full_text);
+	  /* The row ends after what is left of this part. A wrapped word
+	   * still gives the height of this row, as well as of the next.
+	   */
+	  if(partp->type != LAYOUT_PART_DELETED)
+	    layout_line_add(context, partp);
+	  layout_line_break(context, partp->align.indent_offset);
+	  context->line.height = partp->geometry.height;
 
-	  second_part = layout_init_part(LAYOUT_PART_TEXT);
+	  second_part = layout_init_part(partp, LAYOUT_PART_TEXT);
 	  if(second_part == NULL) {
 	    /* Oops, that was not supposed to happen. Let us bail out. */
-	    free(second_text);
 	    break; 
 	  }
-	  second_part->data.text.text = second_text;
+	  second_part->data.text.text = text + first_text_length;
+	  second_part->data.text.length = full_length - first_text_length;
 	  second_part->data.text.style = partp->data.text.style;
 	  second_part->align = partp->align;	  
 
@@ -799,23 +766,37 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
 	    partp->next->previous = second_part;
 	  second_part->previous = partp;
 	  partp->next = second_part;
+	  if(partp->parent != NULL && partp->parent->last_child == partp)
+	    partp->parent->last_child = second_part;
 	}
 
 	break;
       }
 
+      /* A block of preformatted lines is placed just like a preformatted
+       * text, only several rows high.
+       */
+    case LAYOUT_PART_PREFORMATTED:
+      layout_set_preformatted_size(partp);
+
+      if(context->max_width < partp->geometry.width)
+	context->max_width = partp->geometry.width;
+
+      partp->geometry.x_position = context->x_position;
+      partp->geometry.y_position = context->y_position;
+      layout_line_add(context, partp);
+      layout_line_break(context, 0);
+      break;
+
     case LAYOUT_PART_GRAPHICS:
-      if(x_position + partp->geometry.width > max_width) {
+      if(context->x_position + partp->geometry.width > context->max_width) {
 	/* Change row. */
-	x_position = partp->align.indent_offset;
-	y_position += max_row_height;
-	max_row_height = 0;
+	layout_line_break(context, partp->align.indent_offset);
       }
-      partp->geometry.x_position = x_position;
-      partp->geometry.y_position = y_position;
-      x_position += partp->geometry.width;
-      if(partp->geometry.height > max_row_height)
-	max_row_height = partp->geometry.height;
+      partp->geometry.x_position = context->x_position;
+      partp->geometry.y_position = context->y_position;
+      layout_line_add(context, partp);
+      context->x_position += partp->geometry.width;
       break;
 
       /* Only layout the whole table, since the parts are already layouted. */
@@ -826,34 +807,28 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
        * tables can be placed next to each other on one line. This is however
        * not yet supported.
        */
-      x_position = partp->align.indent_offset;
-      y_position += max_row_height;
-      max_row_height = 0;
+      layout_line_break(context, partp->align.indent_offset);
 
-      partp->geometry.x_position = x_position;
-      partp->geometry.y_position = y_position;
+      partp->geometry.x_position = context->x_position;
+      partp->geometry.y_position = context->y_position;
 
-      layout_align_parts(partp, max_width, partp->geometry.height);
-      y_position += partp->geometry.height;
-      previous_y_position = y_position;
+      layout_line_add(context, partp);
+      layout_line_break(context, partp->align.indent_offset);
       break;
 
     case LAYOUT_PART_FORM_SUBMIT:
     case LAYOUT_PART_FORM_CHECKBOX:
     case LAYOUT_PART_FORM_RADIO:
     case LAYOUT_PART_FORM_TEXT:
-      if(x_position + partp->geometry.width > max_width) {
+      if(context->x_position + partp->geometry.width > context->max_width) {
 	/* Change row. */
-	x_position = partp->align.indent_offset;
-	y_position += max_row_height;
-	max_row_height = 0;
+	layout_line_break(context, partp->align.indent_offset);
       }
-      partp->geometry.x_position = x_position;
-      partp->geometry.y_position = y_position;
+      partp->geometry.x_position = context->x_position;
+      partp->geometry.y_position = context->y_position;
+      layout_line_add(context, partp);
 
-      x_position += partp->geometry.width;
-      if(partp->geometry.height > max_row_height)
-	max_row_height = partp->geometry.height;
+      context->x_position += partp->geometry.width;
       break;
 
     default:
@@ -864,7 +839,7 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
     if(partp->child != NULL && partp->type != LAYOUT_PART_TABLE) {
       int total_height;
 
-      layout_do(partp->child, 1, max_width, &total_height);
+      layout_do_parts(context, partp->child, NULL, &total_height);
 
       if(result_height != NULL)
 	*result_height = total_height;
@@ -873,61 +848,817 @@ int layout_do(struct layout_part *parts, int keep_position, int total_width,
        * the complete page at this point.
        */
       if(partp->type == LAYOUT_PART_PAGE_INFORMATION) {
-	partp->geometry.width = max_width;
+	partp->geometry.width = context->max_width;
 	partp->geometry.height = total_height;
 
-	tmp = max_width;
-	
-	if(!keep_position) {
-	  x_position = saved_x_position;
-	  y_position = saved_y_position;
-	  max_width = saved_max_width;
-	  max_row_height = saved_max_row_height;
-	}
-	
-	return tmp;
+	return context->max_width;
       }
     }
 
-    if(partp->type == LAYOUT_PART_LINE) {
-      layout_align_parts(partp, max_width, max_row_height);
-    }
-    if(y_position != previous_y_position) {
-      if(partp->previous) {
-	if(partp->previous->type != LAYOUT_PART_LINE &&
-	   partp->previous->type != LAYOUT_PART_TABLE &&
-	   partp->previous->type != LAYOUT_PART_FORM)
-	  layout_align_parts(partp->previous, max_width, max_row_height);
-      } else {
-	if(partp->type != LAYOUT_PART_TABLE &&
-	   partp->type != LAYOUT_PART_FORM)
-	  layout_align_parts(partp, max_width, max_row_height);
+    partp = partp->next;
+  }
+
+  /* Do not forget to align the very last row of a page or a table cell,
+   * please. A link is only part of a row.
+   */
+  if(parent != NULL && (parent->type == LAYOUT_PART_PAGE_INFORMATION ||
+			parent->type == LAYOUT_PART_TABLE_CELL))
+    layout_line_end(context);
+
+  if(result_height != NULL)
+    *result_height = context->y_position + context->line.height;
+
+  return context->max_width;
+}
+
+/**
+ * Prepare a context for layouting the parts of a page, or a part of a
+ * page that is layouted by itself, like the contents of a table cell.
+ *
+ * @param context The context to initialise.
+ * @param page A pointer to the page information part of the page that
+ * @param page the parts are on, or NULL if it is not known.
+ */
+void layout_init_context(struct layout_context *context,
+			 struct layout_part *page)
+{
+  memset(context, 0, sizeof(struct layout_context));
+  context->page = page;
+}
+
+/**
+ * Perform the layouting of all the wonderful parts that the parser
+ * has picked up from the fantastic stream provided by earlier parts
+ * of the procedure. This will go through the linked list of layout
+ * parts, and decide how they are to be spread over the screen that
+ * the interface presents us with. This is done using extensive
+ * mathematical calculations, optimised to their maximum.
+ *
+ * Everything that is needed while doing this is kept in the context,
+ * so different trees of parts may be layouted at the same time, as
+ * long as each has a context of its own.
+ *
+ * @param context The context of the layouting. The parts are placed
+ * @param context from position 0;0, and the position after the last
+ * @param context part is left in the context.
+ * @param parts A pointer to the first element in a linked list of layout
+ * @param parts parts.
+ * @param total_width The total possible width to work with. A value of zero
+ * @param total_width will use the width of the user interface display.
+ * @param total_width Note that this is not necessarily the actual width of
+ * @param total_width the finished parts, but more of a guide line.
+ * @param result_height A pointer to where the height of the layouted
+ * @param result_height parts is stored, or NULL.
+ *
+ * @return the maximum width of the layouted parts, or a negative value
+ * @return if an error occurred.
+ */
+int layout_do(struct layout_context *context, struct layout_part *parts,
+	      int total_width, int *result_height)
+{
+  struct layout_part *stop;
+  struct thread_budget budget;
+  int width;
+
+  /* If the list is completely empty, there is not much good we can do,
+   * else than consider it an error and bring these devestating news
+   * back to the unfortunate caller of this function.
+   */
+  if(parts == NULL)
+    return -1;
+
+  /* A page is followed by the later pages in the history, which are
+   * none of our business.
+   */
+  stop = NULL;
+  if(parts->type == LAYOUT_PART_PAGE_INFORMATION) {
+    context->page = parts;
+    stop = parts->next;
+  }
+
+  context->x_position = 0;
+  context->y_position = 0;
+  context->line.count = 0;
+  context->line.height = 0;
+    
+  /* Get rid of excess fat. Once. */
+  thread_budget_init(&budget);
+  layout_prepare_parts(context, &budget, parts, stop, total_width, 1);
+    
+  /* Set width and height of all parts. This also find the maximum width 
+   * among all parts. 
+   */
+  context->max_width = layout_set_sizes(parts, stop, total_width);
+    
+  /* We want to use max_width as reference when layouting the parts. */
+  if(total_width <= 0) {
+    if(context->max_width < user_interface.ui_display.width)
+      context->max_width = user_interface.ui_display.width;
+  } else {
+    if(context->max_width < total_width)
+      context->max_width = total_width;
+  }
+
+  width = layout_do_parts(context, parts, stop, result_height);
+  layout_line_free(context);
+
+  return width;
+}
+
+/**
+ * Keeps track of the widths found while measuring a list of parts.
+ *
+ * @member min_width The widest that a part which cannot be broken has
+ * @member min_width been so far, counting from the left edge.
+ * @member max_width The widest that a row has been so far.
+ * @member row_width The width of the current row.
+ */
+struct layout_measure {
+  int min_width;
+  int max_width;
+  int row_width;
+};
+
+/**
+ * End the current row of the measured parts, and start a new one.
+ *
+ * @param measure The widths found so far.
+ * @param indent The indentation of the new row.
+ */
+static void layout_measure_row(struct layout_measure *measure, int indent)
+{
+  if(measure->row_width > measure->max_width)
+    measure->max_width = measure->row_width;
+  measure->row_width = indent;
+}
+
+/**
+ * Add a part to the current row of the measured parts. If the part must
+ * be broken, it starts a row of its own, at the indentation of the part.
+ *
+ * @param measure The widths found so far.
+ * @param partp A pointer to the part.
+ * @param min_width The narrowest the part can be.
+ * @param max_width The width of the part, if it is not broken.
+ */
+static void layout_measure_add(struct layout_measure *measure,
+			       struct layout_part *partp,
+			       int min_width, int max_width)
+{
+  measure->row_width += max_width;
+  if(partp->align.indent_offset + min_width > measure->min_width)
+    measure->min_width = partp->align.indent_offset + min_width;
+}
+
+/**
+ * Measure the parts in a linked list, following the same rules for when
+ * a row is broken as layout_do_parts(). The parts must have been
+ * prepared already.
+ *
+ * @param context The context of the layouting.
+ * @param measure The widths found so far.
+ * @param partp A pointer to the first part in the list to measure.
+ */
+static void layout_measure_parts(struct layout_context *context,
+				 struct layout_measure *measure,
+				 struct layout_part *partp)
+{
+  int min_width, max_width;
+
+  while(partp) {
+    switch(partp->type) {
+    case LAYOUT_PART_PARAGRAPH:
+      layout_measure_row(measure, partp->align.indent_offset);
+      break;
+
+      /* A line given in per cent gets as wide as there is room for. */
+    case LAYOUT_PART_LINE:
+      layout_measure_row(measure, partp->align.indent_offset);
+      if(partp->data.line.absolute) {
+	layout_measure_add(measure, partp, partp->data.line.width,
+			   partp->data.line.width);
+	layout_measure_row(measure, partp->align.indent_offset);
+      }
+      break;
+
+      /* Preformatted text is never broken, not even where the row it
+       * continues began.
+       */
+    case LAYOUT_PART_TEXT:
+      layout_measure_text(partp, &min_width, &max_width);
+      if(!partp->data.text.style.preformatted) {
+	layout_measure_add(measure, partp, min_width, max_width);
+	break;
       }
+      measure->row_width += max_width;
+      if(measure->row_width > measure->min_width)
+	measure->min_width = measure->row_width;
+      layout_measure_row(measure, 0);
+      break;
+
+    case LAYOUT_PART_PREFORMATTED:
+      layout_set_preformatted_size(partp);
+      measure->row_width += partp->geometry.width;
+      if(measure->row_width > measure->min_width)
+	measure->min_width = measure->row_width;
+      layout_measure_row(measure, 0);
+      break;
+
+      /* An image which could not be loaded gets the size given to it by
+       * layout_set_sizes().
+       */
+    case LAYOUT_PART_GRAPHICS:
+      max_width = partp->geometry.width;
+      if(max_width == 0)
+	max_width = 16;
+      layout_measure_add(measure, partp, max_width, max_width);
+      break;
+
+    case LAYOUT_PART_TABLE:
+      layout_measure_row(measure, partp->align.indent_offset);
+      layout_table_measure(context, partp, &min_width, &max_width);
+      layout_measure_add(measure, partp, min_width, max_width);
+      layout_measure_row(measure, partp->align.indent_offset);
+      break;
+
+    case LAYOUT_PART_FORM_SUBMIT:
+    case LAYOUT_PART_FORM_CHECKBOX:
+    case LAYOUT_PART_FORM_RADIO:
+    case LAYOUT_PART_FORM_TEXT:
+      layout_ui_set_size(partp);
+      layout_measure_add(measure, partp, partp->geometry.width,
+			 partp->geometry.width);
+      break;
+
+    default:
+      break;
     }
 
-    /* Do not forget to align the very last parts, please. */
-    if(partp->next == NULL && 
-       partp->type != LAYOUT_PART_TABLE && 
-       partp->type != LAYOUT_PART_FORM && 
-       (partp->parent->type == LAYOUT_PART_PAGE_INFORMATION ||
-	partp->parent->type == LAYOUT_PART_TABLE_CELL)) {
-      layout_align_parts(partp, max_width, max_row_height);
+    if(partp->child != NULL && partp->type != LAYOUT_PART_TABLE)
+      layout_measure_parts(context, measure, partp->child);
+
+    partp = partp->next;
+  }
+}
+
+/**
+ * Measure a list of parts, to find the narrowest they can be layouted
+ * without cutting a word or an image, and how wide they get if no row is
+ * broken. The images are loaded first, just as before layouting, but
+ * nothing is placed. The contents of a table inside the parts are
+ * measured by layout_table_measure().
+ *
+ * @param context The context of the layouting. Only the page is used,
+ * @param context to load images relative to.
+ * @param parts A pointer to the first element in a linked list of layout
+ * @param parts parts.
+ * @param min_width A pointer to where the narrowest width is stored.
+ * @param max_width A pointer to where the widest width is stored.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int layout_measure(struct layout_context *context, struct layout_part *parts,
+		   int *min_width, int *max_width)
+{
+  struct layout_measure measure;
+  struct thread_budget budget;
+
+  *min_width = 0;
+  *max_width = 0;
+  if(parts == NULL)
+    return 1;
+
+  thread_budget_init(&budget);
+  layout_prepare_parts(context, &budget, parts, NULL, 0, 0);
+
+  measure.min_width = 0;
+  measure.max_width = 0;
+  measure.row_width = 0;
+  layout_measure_parts(context, &measure, parts);
+  layout_measure_row(&measure, 0);
+
+  *min_width = measure.min_width;
+  *max_width = measure.max_width;
+  if(*max_width < *min_width)
+    *max_width = *min_width;
+
+  return 0;
+}
+
+/**
+ * Undo what an earlier layouting did to a list of parts, so that they
+ * can be layouted again. A text which was broken into rows is put back
+ * together, by letting the part which owns the text hold all of it
+ * again, and freeing the parts that held the rows after the first.
+ * All parts are moved back to position 0;0, where they were before the
+ * first layouting. Not every part gets a position of its own, like a
+ * link, but the positions inside a table cell are moved along with it.
+ *
+ * @param partp A pointer to the first part in the list.
+ * @param stop The first part in the list which is not to be reset, or
+ * @param stop NULL to reset the rest of the list. This must not be one
+ * @param stop of the parts holding the later rows of a text.
+ */
+static void layout_reset_parts(struct layout_part *partp,
+			       struct layout_part *stop)
+{
+  struct layout_part *nextp;
+
+  while(partp && partp != stop) {
+    partp->geometry.x_position = 0;
+    partp->geometry.y_position = 0;
+
+    if((partp->type == LAYOUT_PART_TEXT ||
+	partp->type == LAYOUT_PART_DELETED) &&
+       partp->data.text.buffer != NULL) {
+      partp->type = LAYOUT_PART_TEXT;
+      partp->data.text.text = partp->data.text.buffer;
+      partp->data.text.length = strlen(partp->data.text.buffer);
+
+      /* The parts of the later rows have no text of their own. */
+      nextp = partp->next;
+      while(nextp && 
+	    (nextp->type == LAYOUT_PART_TEXT ||
+	     nextp->type == LAYOUT_PART_DELETED) &&
+	    nextp->data.text.buffer == NULL) {
+	partp->next = nextp->next;
+	if(nextp->next)
+	  nextp->next->previous = partp;
+	if(nextp->parent != NULL && nextp->parent->last_child == nextp)
+	  nextp->parent->last_child = partp;
+	layout_free_part(nextp);
+	nextp = partp->next;
+      }
     }
 
+    if(partp->child != NULL)
+      layout_reset_parts(partp->child, NULL);
+
     partp = partp->next;
   }
+}
 
-  if(result_height != NULL)
-    *result_height = y_position + max_row_height;
+/**
+ * Put the parts of a page that an unfinished relayouting has not come
+ * to yet back on the page, after the parts which it has layouted, so
+ * that the page holds all its parts again.
+ *
+ * @param page A pointer to the page information part of the page.
+ */
+static void layout_relayout_gather(struct layout_part *page)
+{
+  struct layout_progress *progress;
+  struct layout_part *partp;
+
+  progress = page->data.page_information.relayout;
+  if(progress == NULL)
+    return;
+
+  /* The first pending part still points back at the last part on the
+   * page, and all pending parts still have the page as their parent.
+   */
+  partp = progress->pending->child;
+  if(partp != NULL) {
+    if(progress->last_part == NULL)
+      page->child = partp;
+    else
+      progress->last_part->next = partp;
+    page->last_child = NULL;
+  }
+
+  progress->pending->child = NULL;
+  layout_free_part(progress->pending);
+  free(progress);
+  page->data.page_information.relayout = NULL;
+}
+
+/**
+ * Layout a completely loaded page again, for example when the display
+ * it is shown on has changed its size. Nothing is loaded or parsed
+ * again, since the page keeps all the parts that the parser made. Only
+ * the positions and sizes of the parts, and the rows that the texts are
+ * broken into, are made anew.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param width The width to layout the page within. A value of zero
+ * @param width will use the width of the user interface display.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int layout_relayout(struct layout_part *page, int width)
+{
+  struct layout_context context;
+  int height;
+
+  if(page == NULL || page->type != LAYOUT_PART_PAGE_INFORMATION)
+    return 1;
+
+  layout_relayout_gather(page);
+  layout_reset_parts(page->child, NULL);
+
+  layout_init_context(&context, page);
+  if(layout_do(&context, page, width, &height) < 0)
+    return 1;
+
+  return 0;
+}
+
+/**
+ * Check if a part is a text with nothing but a single space in it. Such
+ * a text between two paragraphs is removed by layout_add_part(), which
+ * merges the paragraphs.
+ *
+ * @param partp A pointer to the part to check.
+ *
+ * @return non-zero value if the part is an empty text.
+ */
+static int layout_is_empty_text(struct layout_part *partp)
+{
+  if(partp->type != LAYOUT_PART_TEXT)
+    return 0;
+
+  return (partp->data.text.text == NULL ||
+	  partp->data.text.length == 0 ||
+	  (partp->data.text.length == 1 && partp->data.text.text[0] == ' '));
+}
+
+/**
+ * Check if the layouting of a page can be paused right after a part,
+ * without anything before it having to be changed by what comes after.
+ * That is right after a paragraph, which ends the row it is on, and
+ * which will not have any later paragraph merged into it by
+ * layout_add_part().
+ *
+ * @param partp A pointer to the part.
+ *
+ * @return non-zero value if the layouting can be paused after the part.
+ */
+static int layout_is_pause(struct layout_part *partp)
+{
+  struct layout_part *nextp;
+
+  nextp = partp->next;
+
+  return (partp->type == LAYOUT_PART_PARAGRAPH && nextp != NULL &&
+	  nextp->type != LAYOUT_PART_PARAGRAPH &&
+	  (!layout_is_empty_text(nextp) ||
+	   (nextp->next != NULL && 
+	    nextp->next->type != LAYOUT_PART_PARAGRAPH)));
+}
+
+/**
+ * Find the last place where the layouting of a page can be paused, as
+ * told by layout_is_pause().
+ *
+ * @param parts A pointer to the first part not yet layouted.
+ * @param open_part The first part that the parser may still add parts
+ * @param open_part under, or NULL if all parts are finished. Nothing 
+ * @param open_part from here on may be layouted.
+ *
+ * @return a pointer to the first part after the pause, or NULL if there
+ * @return is no place to pause at yet.
+ */
+static struct layout_part *layout_find_pause(struct layout_part *parts,
+					     struct layout_part *open_part)
+{
+  struct layout_part *partp;
+
+  if(parts == NULL || parts == open_part)
+    return NULL;
+
+  /* Search backwards from the last finished part. */
+  if(open_part == NULL) {
+    partp = parts;
+    while(partp->next)
+      partp = partp->next;
+  } else {
+    partp = open_part->previous;
+  }
+
+  while(partp && partp != parts->previous) {
+    if(layout_is_pause(partp))
+      return partp->next;
+
+    partp = partp->previous;
+  }
+
+  return NULL;
+}
+
+/**
+ * Find the first place where the layouting of a page can be paused, as
+ * told by layout_is_pause().
+ *
+ * @param parts A pointer to the first part not yet layouted.
+ *
+ * @return a pointer to the first part after the pause, or NULL if there
+ * @return is no place to pause at before the end of the list.
+ */
+static struct layout_part *layout_find_next_pause(struct layout_part *parts)
+{
+  struct layout_part *partp;
+
+  for(partp = parts ; partp ; partp = partp->next)
+    if(layout_is_pause(partp))
+      return partp->next;
+
+  return NULL;
+}
+
+/**
+ * Layout the pending parts of a page up to a given part, and move them
+ * over to the page. The position is taken from where the previous call
+ * left it, so the page is extended and never layouted again.
+ *
+ * @param progress The layout progress of the page.
+ * @param stop The first pending part not to layout, or NULL to layout
+ * @param stop all pending parts.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int layout_do_pending(struct layout_progress *progress, 
+			     struct layout_part *stop)
+{
+  struct layout_context *context = &progress->context;
+  struct layout_part *first, *last;
+  struct thread_budget budget;
+  int width, height, ret;
+
+  first = progress->pending->child;
+  if(first == NULL || first == stop)
+    return 1;
+
+  thread_budget_init(&budget);
+  layout_prepare_parts(context, &budget, first, stop, progress->width, 1);
+
+  /* The width can only grow, since what is already on the page stays
+   * the way it is.
+   */
+  width = layout_set_sizes(first, stop, progress->width);
+  if(progress->width > 0) {
+    if(width < progress->width)
+      width = progress->width;
+  } else {
+    if(width < user_interface.ui_display.width)
+      width = user_interface.ui_display.width;
+  }
+  if(context->max_width < width)
+    context->max_width = width;
+
+  height = 0;
+  ret = layout_do_parts(context, first, stop, &height);
+  layout_line_free(context);
+
+  progress->page->geometry.width = context->max_width;
+  progress->page->geometry.height = height;
+
+  if(ret < 0)
+    return 1;
+
+  /* Move the layouted parts over to the page. The first pending part
+   * still points back at the last part on the page, since the paragraph
+   * there tells where its row starts.
+   */
+  last = first;
+  last->parent = progress->page;
+  while(last->next != stop) {
+    last = last->next;
+    last->parent = progress->page;
+  }
+
+  progress->pending->child = stop;
+  if(stop == NULL)
+    progress->pending->last_child = NULL;
+  last->next = NULL;
+
+  if(progress->last_part == NULL)
+    progress->page->child = first;
+  else
+    progress->last_part->next = first;
+  progress->page->last_child = last;
+  progress->last_part = last;
+
+  return 0;
+}
+
+/**
+ * Prepare a page to be layouted a piece at a time, while it is still
+ * being parsed. The parser should add new parts under the pending part
+ * in the progress, and not directly under the page.
+ *
+ * @param progress The layout progress to initialise.
+ * @param page A pointer to the page information part of the page.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int layout_init_progress(struct layout_progress *progress,
+			 struct layout_part *page)
+{
+  memset(progress, 0, sizeof(struct layout_progress));
+  progress->page = page;
+  layout_init_context(&progress->context, page);
+
+  /* The pending part acts as the page while the parts are layouted, so
+   * it is made the same type.
+   */
+  progress->pending = layout_init_part(page, LAYOUT_PART_PAGE_INFORMATION);
+  if(progress->pending == NULL)
+    return 1;
+
+  return 0;
+}
+
+/**
+ * Layout as much as possible of a page which is still being parsed. The
+ * layouted parts are moved over to the page, where they are left alone
+ * by later calls, so they can be shown while the rest is loaded.
+ *
+ * @param progress The layout progress of the page.
+ * @param open_part The first pending part that the parser may still add
+ * @param open_part parts under, or NULL if all pending parts are finished.
+ *
+ * @return zero if the page was extended, or a non-zero value if nothing
+ * @return could be layouted yet or if an error occurred.
+ */
+int layout_do_partial(struct layout_progress *progress,
+		      struct layout_part *open_part)
+{
+  struct layout_part *stop;
+
+  stop = layout_find_pause(progress->pending->child, open_part);
+  if(stop == NULL)
+    return 1;
+
+  return layout_do_pending(progress, stop);
+}
+
+/**
+ * Layout the rest of a page when it has been completely parsed. If the
+ * page was never extended by layout_do_partial(), the result is the 
+ * same as from layout_do().
+ *
+ * @param progress The layout progress of the page.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int layout_do_finish(struct layout_progress *progress)
+{
+  int ret = 0;
+
+  if(progress->pending->child != NULL)
+    ret = layout_do_pending(progress, NULL);
+
+  layout_free_part(progress->pending);
+  progress->pending = NULL;
+
+  return ret;
+}
+
+/**
+ * Finish a page which has been completely parsed like layout_do_finish(),
+ * but only layout it down to a given height. The rest is left just as
+ * if the page was being layouted again by layout_relayout_start(), so
+ * that a user interface which shows the page at once does not have to
+ * wait for all of a long page, and can layout more of it with
+ * layout_relayout_more() as it is scrolled down.
+ *
+ * @param progress The layout progress of the page.
+ * @param height The height that the page should reach. The layouting is
+ * @param height only paused right after a paragraph, so the page often
+ * @param height gets a bit longer. A value of zero layouts all of it.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int layout_do_later(struct layout_progress *progress, int height)
+{
+  struct layout_progress *later;
+  struct layout_part *page, *partp;
+
+  page = progress->page;
+  if(height <= 0 || progress->pending->child == NULL)
+    return layout_do_finish(progress);
+
+  later = (struct layout_progress *)malloc(sizeof(struct layout_progress));
+  if(later == NULL)
+    return layout_do_finish(progress);
+
+  /* The parts not yet layouted get the page as their parent, like those
+   * of a page which is layouted again, so that the anchors in them are
+   * found to be directly on the page.
+   */
+  for(partp = progress->pending->child ; partp ; partp = partp->next)
+    partp->parent = page;
+  progress->pending->last_child = NULL;
 
-  tmp = max_width;
+  *later = *progress;
+  progress->pending = NULL;
+  page->data.page_information.relayout = later;
 
-  if(!keep_position) {
-    x_position = saved_x_position;
-    y_position = saved_y_position;
-    max_width = saved_max_width;
-    max_row_height = saved_max_row_height;
+  if(layout_relayout_more(page, height) < 0)
+    return 1;
+
+  return 0;
+}
+
+/**
+ * Start to layout a completely loaded page again, just like
+ * layout_relayout(), but only down to a given height. The rest of the
+ * page is left for layout_relayout_more(), so that the top of a long
+ * page can be shown without waiting for all of it. Each piece is only
+ * undone from the earlier layouting when it is about to be layouted.
+ * What is already layouted is never changed by what comes later, so a
+ * part further down which is wider than the display does not widen the
+ * rows above it, like when a page is layouted while it is loaded.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param width The width to layout the page within. A value of zero
+ * @param width will use the width of the user interface display.
+ * @param height The height that the page should reach. The layouting is
+ * @param height only paused right after a paragraph, so the page often
+ * @param height gets a bit longer. A value of zero layouts all of it.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int layout_relayout_start(struct layout_part *page, int width, int height)
+{
+  struct layout_progress *progress;
+
+  if(page == NULL || page->type != LAYOUT_PART_PAGE_INFORMATION)
+    return 1;
+
+  layout_relayout_gather(page);
+
+  progress = (struct layout_progress *)malloc(sizeof(struct 
+						      layout_progress));
+  if(progress == NULL)
+    return 1;
+  if(layout_init_progress(progress, page) != 0) {
+    free(progress);
+    return 1;
   }
+  progress->width = width;
+
+  /* All parts of the page are pending, and are moved back to the page
+   * a piece at a time as they are layouted. They keep the page as their
+   * parent, so that nothing has to be done to the parts not yet reached.
+   * Which of them is last is therefore not kept track of.
+   */
+  progress->pending->child = page->child;
+  page->child = NULL;
+  page->last_child = NULL;
+  page->geometry.width = 0;
+  page->geometry.height = 0;
+  page->data.page_information.relayout = progress;
+
+  if(layout_relayout_more(page, height) < 0)
+    return 1;
 
-  return tmp;
+  return 0;
+}
+
+/**
+ * Layout more of a page that layout_relayout_start() has started on,
+ * until the page reaches a given height. Only what is missing down to
+ * that height is layouted, so a user interface which is scrolled past
+ * the end of what is layouted only has to wait for that piece.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param height The height that the page should reach, or zero to 
+ * @param height layout all that is left of it.
+ *
+ * @return zero if all of the page is layouted, a positive value if there
+ * @return is more of it left, or a negative value if an error occurred.
+ */
+int layout_relayout_more(struct layout_part *page, int height)
+{
+  struct layout_progress *progress;
+  struct layout_part *stop;
+
+  progress = page->data.page_information.relayout;
+  if(progress == NULL)
+    return 0;
+
+  while(progress->pending->child != NULL &&
+	(height <= 0 || page->geometry.height < height)) {
+    if(height <= 0)
+      stop = NULL;
+    else
+      stop = layout_find_next_pause(progress->pending->child);
+
+    /* A part right after a paragraph never holds a later row of a text. */
+    layout_reset_parts(progress->pending->child, stop);
+    if(layout_do_pending(progress, stop) != 0) {
+      layout_relayout_gather(page);
+      return -1;
+    }
+  }
+
+  if(progress->pending->child != NULL)
+    return 1;
+
+  layout_do_finish(progress);
+  free(progress);
+  page->data.page_information.relayout = NULL;
+
+  return 0;
 }
@@ -36,6 +36,14 @@
 
 #include <sys/types.h>
 
+/* The size of each block of memory in the arena of a page. */
+#define LAYOUT_ARENA_BLOCK_SIZE  65536
+
+/* The arena that the parts of a page and their strings are taken from.
+ * What it holds is only known to the functions in arena.c.
+ */
+struct layout_arena;
+
 /**
  * A generically used rectangle definition for generical use.
  *
@@ -71,7 +79,8 @@ enum layout_part_type {
   LAYOUT_PART_FORM_RADIO,
   LAYOUT_PART_FORM_TEXT,
   LAYOUT_PART_FORM_TEXTAREA,
-  LAYOUT_PART_FORM_HIDDEN
+  LAYOUT_PART_FORM_HIDDEN,
+  LAYOUT_PART_PREFORMATTED
 };
 
 /**
@@ -110,6 +119,35 @@ enum layout_part_graphics_type {
   LAYOUT_PART_GRAPHICS_TIFF
 };
 
+/**
+ * A named place on a page, which a URL may point at with a fragment.
+ *
+ * @member name The name of the place, taken from the name of an anchor
+ * @member name or the id of any tag.
+ * @member part The first part found after the name, or NULL if there has
+ * @member part been no such part, in which case it is the end of the page.
+ * @member next The next place in the same bucket of the index.
+ */
+struct layout_anchor {
+  char *name;
+  struct layout_part *part;
+  struct layout_anchor *next;
+};
+
+/**
+ * The named places on a page, hashed on their names, so that finding
+ * one does not mean looking through all the parts of the page.
+ *
+ * @member buckets The lists of places, one for each hash value.
+ * @member size The number of buckets.
+ * @member count The number of places in the index.
+ */
+struct layout_anchor_index {
+  struct layout_anchor **buckets;
+  int size;
+  int count;
+};
+
 /**
  * Contains the title text for the page. There can be only one.
  *
@@ -117,6 +155,15 @@ enum layout_part_graphics_type {
  * @member url The URL for the page represented by this page information.
  * @member base_url The base URL used as reference for all other objects
  * @member base_url which uses a relative URL, or NULL to use `url' as base.
+ * @member fragment The name of the place on the page that the page was
+ * @member fragment asked for with, or NULL if it was asked for as a whole.
+ * @member anchors The index of the named places on the page, or NULL if
+ * @member anchors there are none.
+ * @member relayout The layouting of the page which was started again by
+ * @member relayout layout_relayout_start() and is not yet finished, or
+ * @member relayout NULL if all of the page is layouted.
+ * @member arena The arena that the parts of the page are allocated from.
+ * @member arena It is released when the page is freed.
  * @member background_colour The background colour of the page.
  * @member text_colour The text colour of the page.
  * @member link_colour The link colour of the page.
@@ -127,6 +174,10 @@ struct layout_part_page_information_data {
   char *title;
   char *url;
   char *base_url;
+  char *fragment;
+  struct layout_anchor_index *anchors;
+  struct layout_progress *relayout;
+  struct layout_arena *arena;
   uint32_t background_colour;
   uint32_t text_colour;
   uint32_t link_colour;
@@ -187,12 +238,69 @@ struct layout_text_styles {
 /**
  * Contains the information needed in order to store a text, which is
  * the text itself accompanied by all its possible attributes.
+ * When a text is broken into rows, each row is a part of its own, but
+ * they all share the text of the first part, which is never changed.
+ * The text of a part is therefore not null terminated, and must always
+ * be taken together with its length.
  *
- * @member text A null terminated char array of the text.
+ * @member text The text of this part, a piece of a longer text.
+ * @member length The number of characters in text.
+ * @member buffer The null terminated text that text is a piece of, if it
+ * @member buffer belongs to this part, or NULL if it belongs to the part
+ * @member buffer the text was broken off from.
+ * @member buffer_size The number of bytes allocated for buffer, which may
+ * @member buffer_size leave room for texts merged into it.
  * @member style The style to describe this particular piece of text.
  */
 struct layout_part_text_data {
   char *text;
+  int length;
+  char *buffer;
+  int buffer_size;
+  struct layout_text_styles style;
+};
+
+/* The number of lines between each line whose start is kept in the index
+ * of a preformatted block made from a mapped file.
+ */
+#define LAYOUT_PREFORMATTED_INDEX_STEP  1024
+
+/**
+ * Contains a block of preformatted text, made up of many lines which all
+ * have the same style. All the lines are kept in one buffer, instead of
+ * one text part each, and are placed one right below the other.
+ * A plain text file may be mapped into memory as it is, in which case
+ * only some of the lines are indexed, and the rest are found when they
+ * are needed. The lines should always be taken with layout_get_line().
+ *
+ * @member text All the lines after each other, each one null terminated,
+ * @member text or for a mapped file, ended by newlines as in the file.
+ * @member length The number of characters in text.
+ * @member lines The index in text where every line_step:th line starts.
+ * @member line_step The number of lines between each line in the index.
+ * @member number_of_lines The number of lines in the block.
+ * @member longest_line The number of the longest line in a mapped file.
+ * @member line_height The height of every line, as set by the layouter.
+ * @member mapped Non-zero value if text is a file mapped into memory.
+ * @member line A buffer with the line last taken from a mapped file.
+ * @member line_size The number of bytes allocated for line.
+ * @member last_line The number of the line in line, or -1 if none.
+ * @member last_end The index in text right after the last line taken.
+ * @member style The style of all the text in the block.
+ */
+struct layout_part_preformatted_data {
+  char *text;
+  size_t length;
+  size_t *lines;
+  int line_step;
+  int number_of_lines;
+  int longest_line;
+  int line_height;
+  int mapped;
+  char *line;
+  int line_size;
+  int last_line;
+  size_t last_end;
   struct layout_text_styles style;
 };
 
@@ -220,6 +328,8 @@ struct layout_part_link_data {
  * @member border_colour A 24-bit value describing the colour of the border.
  * @member border_colour This is used when the image is a link.
  * @member type The type of the data stored in `data'.
+ * @member tried Non-zero value if the layouter has tried to load the image,
+ * @member tried so that it is not tried again if the page is layouted again.
  */
 struct layout_part_graphics_data {
   unsigned char *data;
@@ -229,6 +339,7 @@ struct layout_part_graphics_data {
   int border;
   uint32_t border_colour;
   enum layout_part_graphics_type type;
+  int tried;
 };
 
 /**
@@ -306,6 +417,12 @@ struct layout_part_table_row_data {
  * @member width_type
  * @member height_type
  * @member background_colour
+ * @member min_width The narrowest the contents can be layouted, without
+ * @member min_width cutting a word or an image, or -1 if not yet known.
+ * @member max_width The width the contents get if no row is broken, or
+ * @member max_width -1 if not yet known. Both are measured when the
+ * @member max_width table is first layouted, and are kept until a part is
+ * @member max_width added somewhere inside the cell.
  */
 struct layout_part_table_cell_data {
   int rowstart;
@@ -317,6 +434,8 @@ struct layout_part_table_cell_data {
   enum layout_size_type width_type;
   enum layout_size_type height_type;
   uint32_t background_colour;
+  int min_width;
+  int max_width;
 };
 
 /**
@@ -408,6 +527,7 @@ struct layout_part_form_hidden_data {
  * @member generic Raw data used when no extra information is needed.
  * @member paragraph Used by paragraph breaks.
  * @member text Used by text parts.
+ * @member preformatted Used by blocks of preformatted text.
  * @member graphics Used by graphical parts.
  */
 union layout_part_data {
@@ -415,6 +535,7 @@ union layout_part_data {
   struct layout_part_page_information_data page_information;
   struct layout_part_paragraph_data paragraph;
   struct layout_part_text_data text;
+  struct layout_part_preformatted_data preformatted;
   struct layout_part_link_data link;
   struct layout_part_graphics_data graphics;
   struct layout_part_line_data line;
@@ -457,11 +578,20 @@ struct layout_aligns {
  * @member free_interface_data user interface free its own data. If
  * @member free_interface_data this function pointer is NULL and the
  * @member free_interface_data interface_data is not NULL, it will just
- * @member free_interface_data be freed as it is.
+ * @member free_interface_data be freed as it is. It should be set
+ * @member free_interface_data with layout_set_interface_data().
  * @member next Pointer to the next part placed next to this.
  * @member previous Pointer to the previous part placed before this.
  * @member child Pointer to the first part within this.
+ * @member last_child Pointer to the last part within this, so that a
+ * @member last_child part can be added after it without going through all
+ * @member last_child the others, or NULL if it is not known.
  * @member parent Pointer to the parent part, if this is a child.
+ * @member arena The arena the part is allocated from, together with its
+ * @member arena strings, or NULL if they are allocated on their own.
+ * @member next_holder The next part in the arena which holds something
+ * @member next_holder outside it, such as an image, or NULL if the part
+ * @member next_holder is not among those. The last one points at itself.
  */
 struct layout_part {
   enum layout_part_type type;
@@ -473,21 +603,160 @@ struct layout_part {
   struct layout_part *next;
   struct layout_part *previous;
   struct layout_part *child;
+  struct layout_part *last_child;
   struct layout_part *parent;
+  struct layout_arena *arena;
+  struct layout_part *next_holder;
+};
+
+/**
+ * A part placed on the row which is being layouted.
+ *
+ * @member part A pointer to the part.
+ * @member baseline How far below the top of the part the baseline of its
+ * @member baseline text is. A part without any text stands on its bottom.
+ */
+struct layout_line_member {
+  struct layout_part *part;
+  int baseline;
+};
+
+/**
+ * The parts placed on the row which is being layouted. They are kept
+ * here, so that they can all be aligned once the row is finished,
+ * without having to be searched for among the parts.
+ *
+ * @member members The parts on the row, in the order they were placed.
+ * @member count The number of parts on the row.
+ * @member size The number of parts there is room for in members.
+ * @member width The X position where the last part on the row ends.
+ * @member height The height of the highest part on the row. When the
+ * @member height row is finished, this is the height of the whole row.
+ * @member baseline How far below the top of the row the baseline is.
+ * @member baseline The parts aligned to the bottom stand on it.
+ * @member depth How far below the baseline the parts standing on it
+ * @member depth reach.
+ */
+struct layout_line {
+  struct layout_line_member *members;
+  int count;
+  int size;
+  int width;
+  int height;
+  int baseline;
+  int depth;
+};
+
+/**
+ * Holds where the layouting of a list of parts has come, and everything
+ * else that is shared by all calls made while layouting it. Each tree
+ * of parts that is layouted has a context of its own, so several pages
+ * can be layouted at the same time.
+ *
+ * @member page The page information part of the page that the parts
+ * @member page are on, or NULL. Images are loaded relative to its URL.
+ * @member x_position The X position where the next part is placed.
+ * @member y_position The Y position where the next part is placed.
+ * @member max_width The width the parts are fitted into.
+ * @member line The parts on the current row.
+ */
+struct layout_context {
+  struct layout_part *page;
+  int x_position;
+  int y_position;
+  int max_width;
+  struct layout_line line;
+};
+
+/**
+ * Keeps track of a page which is layouted a piece at a time, while the
+ * rest of it is still being parsed. New parts are collected under a
+ * pending part, and are moved over to the page once they are layouted,
+ * so that everything found under the page itself is ready to be shown.
+ *
+ * @member page The page information part of the page.
+ * @member pending The part under which the parts not yet layouted are
+ * @member pending kept. This is where the parser should add new parts.
+ * @member last_part The last part moved over to the page, or NULL if
+ * @member last_part nothing has been layouted yet.
+ * @member context Where the layouting of the page has come, which is
+ * @member context where the next piece continues.
+ * @member width The width to layout the page within, or zero to use the
+ * @member width width of the user interface display.
+ */
+struct layout_progress {
+  struct layout_part *page;
+  struct layout_part *pending;
+  struct layout_part *last_part;
+  struct layout_context context;
+  int width;
 };
 
 /* Prototypes of layout build functions. */
-extern struct layout_part *layout_init_part(enum layout_part_type type);
+extern struct layout_part *layout_init_part(struct layout_part *relative,
+					    enum layout_part_type type);
 extern int layout_free_part(struct layout_part *part);
-extern int layout_add_part(struct layout_part *new);
+extern char *layout_alloc_string(struct layout_part *relative, size_t size);
+extern void layout_free_string(struct layout_part *relative, char *string);
+extern int layout_add_part(struct layout_part *base, struct layout_part *new);
+extern void layout_set_text(struct layout_part *partp, char *text);
+extern void layout_set_interface_data(struct layout_part *partp, void *data,
+				      void (*free_data)(struct layout_part
+							*partp));
 extern int layout_delete_all_parts(struct layout_part *parts);
 extern struct layout_part *layout_get_page_information(struct 
 						       layout_part *parts);
 extern struct layout_part *layout_get_internal_parts(void);
 extern struct layout_part *layout_init_page(char *url, char *referer);
+extern char *layout_get_line(struct layout_part *partp, int index);
+extern int debug_dump_parts(struct layout_part *parts, int depth);
+
+/* Prototypes of layout arena functions. */
+extern struct layout_arena *layout_arena_new(void);
+extern void layout_arena_delete(struct layout_arena *arena,
+				void (*release)(struct layout_part *partp));
+extern void *layout_arena_alloc(struct layout_arena *arena, size_t size);
+extern void *layout_arena_resize(struct layout_arena *arena, void *pointer,
+				 size_t old_size, size_t new_size);
+extern struct layout_part *layout_arena_alloc_part(struct layout_arena *arena);
+extern void layout_arena_free_part(struct layout_arena *arena,
+				   struct layout_part *partp);
+extern void layout_arena_hold(struct layout_arena *arena,
+			      struct layout_part *partp);
+
+/* Prototypes of layout anchor functions. */
+extern struct layout_anchor *layout_add_anchor(struct layout_part *page,
+					       char *name);
+extern void layout_free_anchors(struct layout_part *page);
+extern int layout_find_anchor(struct layout_part *page, char *url);
+
+/* Prototypes of layout measuring functions. */
+extern int layout_ui_set_size(struct layout_part *partp);
+extern int layout_set_text_size(struct layout_part *partp);
+extern int layout_fit_text(struct layout_part *partp, int width);
+extern int layout_text_ascent(struct layout_part *partp);
+extern void layout_measure_text(struct layout_part *partp, int *min_width,
+				int *max_width);
+extern void layout_free_fonts(void);
 
 /* Prototypes of layout layouting functions. */
-extern int layout_do(struct layout_part *parts, int keep_position,
-		     int total_width, int *result_height);
+extern void layout_init_context(struct layout_context *context,
+				struct layout_part *page);
+extern int layout_do(struct layout_context *context,
+		     struct layout_part *parts, int total_width,
+		     int *result_height);
+extern int layout_measure(struct layout_context *context,
+			  struct layout_part *parts, int *min_width,
+			  int *max_width);
+extern int layout_init_progress(struct layout_progress *progress,
+				struct layout_part *page);
+extern int layout_do_partial(struct layout_progress *progress,
+			     struct layout_part *open_part);
+extern int layout_do_finish(struct layout_progress *progress);
+extern int layout_do_later(struct layout_progress *progress, int height);
+extern int layout_relayout(struct layout_part *page, int width);
+extern int layout_relayout_start(struct layout_part *page, int width,
+				 int height);
+extern int layout_relayout_more(struct layout_part *page, int height);
 
 #endif /* _LAYOUTER_LAYOUT_H_ */
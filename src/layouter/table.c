@@ -30,7 +30,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
+#include "threads.h"
+#include "settings.h"
 #include "layout.h"
 #include "ui.h"
 #include "table.h"
@@ -42,6 +45,16 @@
 
 #undef DEBUG
 
+/* A table needs at least this many cells before other threads help with
+ * them, or it takes longer to hand the cells over than to layout them.
+ */
+#define LAYOUT_TABLE_SHARED_CELLS  64
+
+/* The most threads used for tables when the setting "layout_threads" is
+ * zero, and one is used for each processor.
+ */
+#define LAYOUT_TABLE_MAX_THREADS  8
+
 /**
  * This is only used internally in this file, to work with the
  * table, and keep track of columns and rows. 
@@ -50,11 +63,495 @@ struct layout_table_structure {
   int width;
   int part_width;
   enum layout_size_type width_type;
+  int min_width;
   int max_width;
   int rowspan;
   int colspan;
 };
 
+/**
+ * The contents of one table cell, to be layouted.
+ *
+ * @member cell A pointer to the table cell part.
+ * @member width The width to layout the contents within. When they have
+ * @member width been layouted, this is the width they got, or a negative
+ * @member width value if an error occurred.
+ * @member height The height the contents got when they were layouted.
+ */
+struct layout_table_job {
+  struct layout_part *cell;
+  int width;
+  int height;
+};
+
+/**
+ * The contents of all the cells in a table, shared by the threads which
+ * layout them. The cells do not depend on each other, so they may be
+ * layouted in any order, by any thread.
+ *
+ * @member page The page the table is on.
+ * @member jobs The cells to layout.
+ * @member count The number of cells.
+ * @member next The first cell which no thread has started with yet.
+ * @member done The number of cells which have been layouted.
+ * @member next_batch The next table in the queue of tables with cells
+ * @member next_batch which no thread has started with yet.
+ */
+struct layout_table_batch {
+  struct layout_part *page;
+  struct layout_table_job *jobs;
+  int count;
+  int next;
+  int done;
+  struct layout_table_batch *next_batch;
+};
+
+/* Protects the queue of tables, and which of their cells are taken and
+ * which are done.
+ */
+static pthread_mutex_t layout_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Signalled when a table is put in the queue. */
+static pthread_cond_t layout_table_queued = PTHREAD_COND_INITIALIZER;
+
+/* Signalled when a helping thread has layouted a cell. */
+static pthread_cond_t layout_table_done = PTHREAD_COND_INITIALIZER;
+
+/* The tables with cells which no thread has started with yet, in the
+ * order they were put there.
+ */
+static struct layout_table_batch *layout_table_queue = NULL;
+
+/* The threads which help with the cells of tables. They are started
+ * when the first large table is layouted, and then wait for more tables
+ * for as long as the program runs. A table inside a cell is put in the
+ * same queue, so no thread is ever started for it.
+ */
+static int layout_table_helpers = 0;
+
+/**
+ * Take a cell, which no thread has started with, from a table. When it
+ * is the last one, the table is taken out of the queue. The lock must
+ * be held.
+ *
+ * @param batch The cells of the table.
+ *
+ * @return a pointer to the cell, or NULL if all are taken.
+ */
+static struct layout_table_job *
+layout_table_take(struct layout_table_batch *batch)
+{
+  struct layout_table_batch **batchp;
+
+  if(batch->next >= batch->count)
+    return NULL;
+
+  if(batch->next == batch->count - 1) {
+    for(batchp = &layout_table_queue ; *batchp ;
+	batchp = &(*batchp)->next_batch) {
+      if(*batchp == batch) {
+	*batchp = batch->next_batch;
+	break;
+      }
+    }
+  }
+
+  return &batch->jobs[batch->next++];
+}
+
+/**
+ * Layout the contents of one cell of a table.
+ *
+ * @param batch The cells of the table.
+ * @param job The cell to layout.
+ */
+static void layout_table_work(struct layout_table_batch *batch,
+			      struct layout_table_job *job)
+{
+  struct layout_context cell_context;
+
+  job->height = 0;
+  if(job->cell->child != NULL) {
+    layout_init_context(&cell_context, batch->page);
+    job->width = layout_do(&cell_context, job->cell->child, job->width,
+			   &job->height);
+  }
+}
+
+/**
+ * The thread function of the threads which help with the cells of
+ * tables. It waits for a table to be put in the queue, and takes cells
+ * from the first one there, one at a time.
+ *
+ * @param argument Not used.
+ *
+ * @return nothing, since it never returns.
+ */
+static void *layout_table_helper(void *argument)
+{
+  struct layout_table_batch *batch;
+  struct layout_table_job *job;
+
+  argument = argument;
+
+  pthread_mutex_lock(&layout_table_lock);
+  while(1) {
+    while(layout_table_queue == NULL)
+      pthread_cond_wait(&layout_table_queued, &layout_table_lock);
+
+    batch = layout_table_queue;
+    job = layout_table_take(batch);
+    pthread_mutex_unlock(&layout_table_lock);
+
+    layout_table_work(batch, job);
+
+    /* The table may be gone as soon as the lock is let go. */
+    pthread_mutex_lock(&layout_table_lock);
+    batch->done++;
+    pthread_cond_broadcast(&layout_table_done);
+  }
+
+  return NULL;
+}
+
+/**
+ * Find how many threads may layout the cells of tables at the same
+ * time, counting the thread which layouts the page, as given by the
+ * setting "layout_threads". Zero means one for each processor.
+ *
+ * @return the number of threads.
+ */
+static int layout_table_threads(void)
+{
+  void *value;
+  long threads;
+
+  threads = THREAD_LAYOUT_THREADS;
+  if(settings_get("layout_threads", &value) == SETTING_NUMBER &&
+     (long)value >= 0)
+    threads = (long)value;
+
+  if(threads == 0) {
+#ifdef _SC_NPROCESSORS_ONLN
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif /* _SC_NPROCESSORS_ONLN */
+    if(threads > LAYOUT_TABLE_MAX_THREADS)
+      threads = LAYOUT_TABLE_MAX_THREADS;
+    if(threads < 1)
+      threads = 1;
+  }
+
+  return (int)threads;
+}
+
+/**
+ * Layout the contents of the cells of a table. When there are many
+ * cells, the table is put in a queue, where the threads that help with
+ * tables take cells from it while this thread does the same. Each cell
+ * gets its own result, so the table looks the same no matter which
+ * thread layouted which cell.
+ *
+ * @param page The page the table is on.
+ * @param jobs The cells to layout.
+ * @param count The number of cells.
+ */
+static void layout_table_cells(struct layout_part *page,
+			       struct layout_table_job *jobs, int count)
+{
+  struct layout_table_batch batch, **batchp;
+  struct layout_table_job *job;
+  pthread_t thread;
+  int helpers, cancel_state, i;
+
+  batch.page = page;
+  batch.jobs = jobs;
+  batch.count = count;
+  batch.next = 0;
+  batch.done = 0;
+  batch.next_batch = NULL;
+
+  helpers = 0;
+  if(count >= LAYOUT_TABLE_SHARED_CELLS)
+    helpers = layout_table_threads() - 1;
+
+  if(helpers > 0) {
+    pthread_mutex_lock(&layout_table_lock);
+    while(layout_table_helpers < helpers &&
+	  pthread_create(&thread, NULL, layout_table_helper, NULL) == 0) {
+      pthread_detach(thread);
+      layout_table_helpers++;
+    }
+    helpers = layout_table_helpers;
+    pthread_mutex_unlock(&layout_table_lock);
+  }
+
+  if(helpers == 0) {
+    for(i = 0 ; i < count ; i++)
+      layout_table_work(&batch, &jobs[i]);
+    return;
+  }
+
+  /* The thread that loads a page is cancelled when another page is
+   * requested. That must wait until the other threads are done with the
+   * cells, which are on the stack of this thread.
+   */
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancel_state);
+
+  pthread_mutex_lock(&layout_table_lock);
+  for(batchp = &layout_table_queue ; *batchp ;
+      batchp = &(*batchp)->next_batch)
+    ;
+  *batchp = &batch;
+  pthread_cond_broadcast(&layout_table_queued);
+
+  /* This thread does its part too, and finishes the cells alone if the
+   * helping threads are busy with other tables.
+   */
+  while((job = layout_table_take(&batch)) != NULL) {
+    pthread_mutex_unlock(&layout_table_lock);
+    layout_table_work(&batch, job);
+    pthread_mutex_lock(&layout_table_lock);
+    batch.done++;
+  }
+
+  while(batch.done < batch.count)
+    pthread_cond_wait(&layout_table_done, &layout_table_lock);
+  pthread_mutex_unlock(&layout_table_lock);
+
+  pthread_setcancelstate(cancel_state, NULL);
+}
+
+/**
+ * Find the narrowest and the widest the contents of a table cell can be.
+ * They are only measured if they are not already known from when the
+ * table was layouted before, and the cell has not changed since.
+ *
+ * @param context The context of the layouting of the table.
+ * @param cellp A pointer to the table cell part.
+ */
+static void layout_table_cell_widths(struct layout_context *context,
+				     struct layout_part *cellp)
+{
+  struct layout_part_table_cell_data *cell;
+
+  cell = &cellp->data.table_cell;
+  if(cell->min_width >= 0 && cell->max_width >= 0)
+    return;
+
+  layout_measure(context, cellp->child, &cell->min_width, &cell->max_width);
+}
+
+/**
+ * Find the narrowest and the widest a table can be, for when it is
+ * inside another table. The cells of each row are added up, which is
+ * close enough for a table inside a cell, without finding out which
+ * columns the cells end up in. A table with a width in pixels is never
+ * narrower than that width, nor any wider, if its contents fit.
+ *
+ * @param context The context of the layouting around the table.
+ * @param table A pointer to the table part.
+ * @param min_width A pointer to where the narrowest width is stored.
+ * @param max_width A pointer to where the widest width is stored.
+ */
+void layout_table_measure(struct layout_context *context,
+			  struct layout_part *table, int *min_width,
+			  int *max_width)
+{
+  struct layout_part *rowp, *cellp;
+  int overhead, row_min, row_max;
+
+  overhead = table->data.table.cellpadding * 2 +
+    table->data.table.cellspacing + 2;
+
+  *min_width = 0;
+  *max_width = 0;
+  for(rowp = table->child ; rowp ; rowp = rowp->next) {
+    if(rowp->type != LAYOUT_PART_TABLE_ROW)
+      continue;
+
+    row_min = table->data.table.cellspacing + 1;
+    row_max = table->data.table.cellspacing + 1;
+    for(cellp = rowp->child ; cellp ; cellp = cellp->next) {
+      if(cellp->type != LAYOUT_PART_TABLE_CELL)
+	continue;
+
+      layout_table_cell_widths(context, cellp);
+      row_min += cellp->data.table_cell.min_width + overhead;
+      row_max += cellp->data.table_cell.max_width + overhead;
+    }
+
+    if(row_min > *min_width)
+      *min_width = row_min;
+    if(row_max > *max_width)
+      *max_width = row_max;
+  }
+
+  if(table->data.table.width_type == LAYOUT_SIZE_ABSOLUTE) {
+    if(*min_width < table->data.table.width)
+      *min_width = table->data.table.width;
+    *max_width = *min_width;
+  }
+}
+
+/**
+ * Find how wide the contents of a column want to be, without the space
+ * taken by the padding and spacing around the cells.
+ *
+ * @param table A pointer to the table part.
+ * @param virtual_cells The columns of the table.
+ * @param nr_of_cols The number of columns.
+ * @param column The number of the column.
+ *
+ * @return the width of the contents, which is never negative.
+ */
+static int layout_table_contents(struct layout_part *table,
+				 struct layout_table_structure *virtual_cells,
+				 int nr_of_cols, int column)
+{
+  int width;
+
+  width = virtual_cells[column].max_width -
+    (table->data.table.cellpadding * 2 + table->data.table.cellspacing + 2);
+  if(column == nr_of_cols - 1)
+    width -= table->data.table.cellspacing + 1;
+
+  return (width > 0 ? width : 0);
+}
+
+/**
+ * Spread a width over the columns of a table which have no width of
+ * their own, according to the contents of their cells. If there is room
+ * for all of them to get as wide as their contents, without breaking a
+ * row, the rest is shared in proportion to the width of the contents,
+ * or evenly if they are all empty. If not, they all get
+ * at least the narrowest their contents can be, and the rest goes to the
+ * columns that would need the most of it to get as wide as they want.
+ * If there is not even room for that, the width is shared in proportion
+ * to the narrowest they can be.
+ *
+ * A cell spanning several columns, which does not fit in what the
+ * columns need for the other cells, spreads the difference evenly over
+ * them.
+ *
+ * @param context The context of the layouting of the table.
+ * @param table A pointer to the table part.
+ * @param virtual_cells The columns of the table. The rowstart and
+ * @param virtual_cells colstart of each cell must already be set.
+ * @param nr_of_cols The number of columns.
+ * @param width The width to spread.
+ */
+static void layout_table_spread(struct layout_context *context,
+				struct layout_part *table,
+				struct layout_table_structure *virtual_cells,
+				int nr_of_cols, int width)
+{
+  struct layout_part *rowp, *cellp;
+  struct layout_part_table_cell_data *cell;
+  int overhead, min_width, max_width, span_min, span_max;
+  int pass, unset, last, count, i;
+  long sum_min, sum_max, sum_contents, left, contents;
+
+  overhead = table->data.table.cellpadding * 2 +
+    table->data.table.cellspacing + 2;
+
+  /* The cells spanning a single column are done in the first pass, and
+   * those spanning several in the second.
+   */
+  for(pass = 0 ; pass < 2 ; pass++) {
+    for(rowp = table->child ; rowp ; rowp = rowp->next) {
+      if(rowp->type != LAYOUT_PART_TABLE_ROW)
+	continue;
+
+      for(cellp = rowp->child ; cellp ; cellp = cellp->next) {
+	if(cellp->type != LAYOUT_PART_TABLE_CELL)
+	  continue;
+
+	cell = &cellp->data.table_cell;
+	if(cell->colstart < 0 || cell->colstart + cell->colspan > nr_of_cols ||
+	   (cell->colspan > 1) != pass)
+	  continue;
+
+	/* Only measure the cells that decide the width of some column. */
+	unset = 0;
+	for(i = cell->colstart ; i < cell->colstart + cell->colspan ; i++) {
+	  if(virtual_cells[i].width_type == LAYOUT_SIZE_UNSPECIFIED)
+	    unset = 1;
+	}
+	if(!unset)
+	  continue;
+
+	layout_table_cell_widths(context, cellp);
+	min_width = cell->min_width + overhead;
+	max_width = cell->max_width + overhead;
+	if(cell->colstart + cell->colspan == nr_of_cols) {
+	  min_width += table->data.table.cellspacing + 1;
+	  max_width += table->data.table.cellspacing + 1;
+	}
+
+	span_min = 0;
+	span_max = 0;
+	for(i = cell->colstart ; i < cell->colstart + cell->colspan ; i++) {
+	  span_min += virtual_cells[i].min_width;
+	  span_max += virtual_cells[i].max_width;
+	}
+
+	for(i = cell->colstart ; i < cell->colstart + cell->colspan ; i++) {
+	  if(min_width > span_min)
+	    virtual_cells[i].min_width += (min_width - span_min) / cell->colspan;
+	  if(max_width > span_max)
+	    virtual_cells[i].max_width += (max_width - span_max) / cell->colspan;
+	}
+      }
+    }
+  }
+
+  sum_min = 0;
+  sum_max = 0;
+  sum_contents = 0;
+  count = 0;
+  last = -1;
+  for(i = 0 ; i < nr_of_cols ; i++) {
+    if(virtual_cells[i].width_type != LAYOUT_SIZE_UNSPECIFIED)
+      continue;
+
+    sum_min += virtual_cells[i].min_width;
+    sum_max += virtual_cells[i].max_width;
+    sum_contents += layout_table_contents(table, virtual_cells, nr_of_cols,
+					  i);
+    count++;
+    last = i;
+  }
+  if(count == 0)
+    return;
+
+  left = width;
+  for(i = 0 ; i < nr_of_cols ; i++) {
+    if(virtual_cells[i].width_type != LAYOUT_SIZE_UNSPECIFIED)
+      continue;
+
+    min_width = virtual_cells[i].min_width;
+    max_width = virtual_cells[i].max_width;
+    contents = layout_table_contents(table, virtual_cells, nr_of_cols, i);
+    if(sum_max <= 0 || sum_min <= 0)
+      virtual_cells[i].width = width / count;
+    else if(sum_max <= width && sum_contents <= 0)
+      virtual_cells[i].width = max_width + (width - sum_max) / count;
+    else if(sum_max <= width)
+      virtual_cells[i].width = max_width + 
+	((width - sum_max) * contents) / sum_contents;
+    else if(sum_min <= width)
+      virtual_cells[i].width = min_width + 
+	((width - sum_min) * (max_width - min_width)) / (sum_max - sum_min);
+    else
+      virtual_cells[i].width = ((long)width * min_width) / sum_min;
+
+    left -= virtual_cells[i].width;
+  }
+
+  /* What is lost when rounding goes to the last column. */
+  virtual_cells[last].width += left;
+}
+
 /**
  * Layout a table, arranging the table cells and rows as either
  * specified in the tags, or as Zen seems fit. It does not always
@@ -64,6 +561,9 @@ struct layout_table_structure {
  * This might be the longest single function in this whole program.
  * Only layout_do() is close.
  *
+ * @param context The context of the layouting of the parts around the
+ * @param context table. The contents of each table cell are layouted
+ * @param context in a context of their own.
  * @param table A pointer to the layout part making out the 
  * @param table complete and utter table.
  * @param total_width The width that this function has got to
@@ -71,15 +571,18 @@ struct layout_table_structure {
  *
  * @return non-zero value if an error occurred.
  */
-int layout_table(struct layout_part *table, int total_width)
+int layout_table(struct layout_context *context, struct layout_part *table,
+		 int total_width)
 {
   int nr_of_rows, nr_of_cols, rownr, colnr, unset_cols, sum_absolute;
   int max_cols, cell_width, width_left, width_type;
   int x_position, y_position, max_row_height, i;
+  int nr_of_cells, nr_of_jobs;
   struct layout_part *rowp, *cellp;
   struct layout_part **rowspan_cells;
   int *rowspans;
   struct layout_table_structure *virtual_cells;
+  struct layout_table_job *jobs, *job;
 
   if(total_width <= 0)
     total_width = user_interface.ui_display.width;
@@ -89,6 +592,7 @@ int layout_table(struct layout_part *table, int total_width)
    */
 
   nr_of_rows = 0;
+  nr_of_cells = 0;
   max_cols = 0;
   rowp = table->child;
   while(rowp) {
@@ -99,6 +603,12 @@ int layout_table(struct layout_part *table, int total_width)
       while(cellp) {
 	if(cellp->type == LAYOUT_PART_TABLE_CELL) {
 	  nr_of_cols += cellp->data.table_cell.colspan;
+	  nr_of_cells++;
+
+	  /* A cell which is pushed out of the table by the cells above,
+	   * that span over its row, gets no column.
+	   */
+	  cellp->data.table_cell.colstart = -1;
 	}
 
 	cellp = cellp->next;
@@ -141,6 +651,8 @@ int layout_table(struct layout_part *table, int total_width)
     virtual_cells[i].width = 0;
     virtual_cells[i].part_width = 1;
     virtual_cells[i].width_type = LAYOUT_SIZE_UNSPECIFIED;
+    virtual_cells[i].min_width = 0;
+    virtual_cells[i].max_width = 0;
     virtual_cells[i].rowspan = 1;
     virtual_cells[i].colspan = 1;
   }
@@ -314,12 +826,21 @@ int layout_table(struct layout_part *table, int total_width)
 #endif
 
   if(unset_cols > 0) {
+    cell_width = 0;
     for(i = 0 ; i < nr_of_cols ; i++) {
       if(virtual_cells[i].width == 0) {
 	virtual_cells[i].width = (width_left * 
 				  virtual_cells[i].part_width) / unset_cols;
+	if(virtual_cells[i].width_type == LAYOUT_SIZE_UNSPECIFIED)
+	  cell_width += virtual_cells[i].width;
       }
     }
+
+    /* The columns without any width at all share what they got
+     * according to their contents, instead of in equal parts.
+     */
+    layout_table_spread(context, table, virtual_cells, nr_of_cols,
+			cell_width);
   }
 
   /* If all the columns have a set width, we can set the total table width
@@ -351,47 +872,44 @@ int layout_table(struct layout_part *table, int total_width)
     free(rowspan_cells);
     return 1;
   }
+  jobs = (struct layout_table_job *)
+    malloc(sizeof(struct layout_table_job) * nr_of_cells);
+  if(jobs == NULL) {
+    free(rowspans);
+    free(rowspan_cells);
+    return 1;
+  }
   for(i = 0 ; i < nr_of_cols ; i++) {
     rowspan_cells[i] = NULL;
     rowspans[i] = 1;
   }
 
-  /* Layout the interior of the table. */
-  y_position = 1;
+  /* Find the width of each cell, going through the rows just like when
+   * the cells are placed below. Now that the widths of the columns are
+   * known, the contents of the cells do not depend on each other, and
+   * are all layouted before any cell is placed.
+   */
+  nr_of_jobs = 0;
   rowp = table->child;
   while(rowp) {
-    /* If there happen to be anything between table cells, we just skip it.
-     * It is an error from the HTML writer, do not blame us.
-     */
     if(rowp->type != LAYOUT_PART_TABLE_ROW) {
       rowp = rowp->next;
       continue;
     }
 
     colnr = 0;
-    max_row_height = 0;
-    x_position = 1;
     cellp = rowp->child;
     while(colnr < nr_of_cols) {
-      int tmp_width, tmp_height;
+      int tmp_width;
 
       if(cellp && cellp->type != LAYOUT_PART_TABLE_CELL) {
 	cellp = cellp->next;
 	continue;
       }
 
-#ifdef DEBUG
-      fprintf(stderr, "%s: width_left=%d, colnr=%d, cellp=%p\n", 
-	      __FUNCTION__, width_left, colnr, cellp);
-#endif
-
       if(rowspans[colnr] == 1) {
-	/* If some cell is missing, we just skip over the area it was 
-	 * supposed to be in.
-	 */
-	if(cellp == NULL) {
+	if(cellp == NULL)
 	  break;
-	}
 
 	rowspans[colnr] = cellp->data.table_cell.rowspan;
 	rowspan_cells[colnr] = cellp;
@@ -404,7 +922,6 @@ int layout_table(struct layout_part *table, int total_width)
 	  table->data.table.cellspacing + 2;
 	if(nr_of_cols - colnr == cellp->data.table_cell.colspan)
 	  tmp_width -= table->data.table.cellspacing + 1;
-	tmp_height = 0;
 
 	if(tmp_width < 0) {
 	  fprintf(stderr, "Warning! Table cell width became negative!\n");
@@ -416,9 +933,74 @@ int layout_table(struct layout_part *table, int total_width)
 		__FUNCTION__, __LINE__, tmp_width);	
 #endif
 
-	if(cellp->child != NULL)
-	  tmp_width = layout_do(cellp->child, 0, tmp_width, &tmp_height);
-	
+	jobs[nr_of_jobs].cell = cellp;
+	jobs[nr_of_jobs].width = tmp_width;
+	nr_of_jobs++;
+
+	colnr += cellp->data.table_cell.colspan;
+	cellp = cellp->next;
+      } else {
+	rowspans[colnr]--;
+	colnr += rowspan_cells[colnr]->data.table_cell.colspan;
+      }
+    }
+
+    rowp = rowp->next;
+  }
+
+  layout_table_cells(context->page, jobs, nr_of_jobs);
+
+  for(i = 0 ; i < nr_of_cols ; i++) {
+    rowspan_cells[i] = NULL;
+    rowspans[i] = 1;
+  }
+
+  /* Place the cells of the table, row by row. */
+  job = jobs;
+  y_position = 1;
+  rowp = table->child;
+  while(rowp) {
+    /* If there happen to be anything between table cells, we just skip it.
+     * It is an error from the HTML writer, do not blame us.
+     */
+    if(rowp->type != LAYOUT_PART_TABLE_ROW) {
+      rowp = rowp->next;
+      continue;
+    }
+
+    colnr = 0;
+    max_row_height = 0;
+    x_position = 1;
+    cellp = rowp->child;
+    while(colnr < nr_of_cols) {
+      int tmp_width, tmp_height;
+
+      if(cellp && cellp->type != LAYOUT_PART_TABLE_CELL) {
+	cellp = cellp->next;
+	continue;
+      }
+
+#ifdef DEBUG
+      fprintf(stderr, "%s: width_left=%d, colnr=%d, cellp=%p\n", 
+	      __FUNCTION__, width_left, colnr, cellp);
+#endif
+
+      if(rowspans[colnr] == 1) {
+	/* If some cell is missing, we just skip over the area it was 
+	 * supposed to be in.
+	 */
+	if(cellp == NULL) {
+	  break;
+	}
+
+	rowspans[colnr] = cellp->data.table_cell.rowspan;
+	rowspan_cells[colnr] = cellp;
+
+	/* The cells come in the same order as they were layouted. */
+	tmp_width = job->width;
+	tmp_height = job->height;
+	job++;
+
 	if(tmp_width >= 0) {
 #ifdef DEBUG
 	    fprintf(stderr, "%s (%d): tmp_width=%d, tmp_height=%d\n", 
@@ -511,6 +1093,7 @@ int layout_table(struct layout_part *table, int total_width)
 
   table->geometry.height = y_position + table->data.table.cellspacing + 1;
 
+  free(jobs);
   free(rowspans);
   free(rowspan_cells);
   free(virtual_cells);
@@ -592,9 +1175,9 @@ void layout_table_set_positions(struct layout_part *table,
 	cellp->geometry.x_position += relative->geometry.x_position;
 	cellp->geometry.y_position += relative->geometry.y_position;
 	
+	/* The padding is that of the table the relative part is in. */
 	relative_table = relative->parent;
-	while(relative->type != LAYOUT_PART_TABLE_CELL && 
-	      relative_table->parent)
+	while(relative_table && relative_table->type != LAYOUT_PART_TABLE)
 	  relative_table = relative_table->parent;
 	if(relative_table) {
 	  cellp->geometry.x_position += relative_table->data.table.cellpadding;
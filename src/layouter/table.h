@@ -25,7 +25,11 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
-extern int layout_table(struct layout_part *table, int total_width);
+extern int layout_table(struct layout_context *context,
+			struct layout_part *table, int total_width);
+extern void layout_table_measure(struct layout_context *context,
+				 struct layout_part *table, int *min_width,
+				 int *max_width);
 extern void layout_table_set_positions(struct layout_part *table,
 				       struct layout_part *relative,
 				       int force_parts);
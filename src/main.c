@@ -37,6 +37,8 @@
 #include "ui.h"
 #include "layout.h"
 #include "protocol.h"
+#include "benchmark.h"
+#include "stress.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
 #ifdef HAVE_DMALLOC_H
@@ -130,6 +132,19 @@ int main(int argc, char *argv[])
     return 0;
   }
 
+  /* A benchmark only parses the page, and never shows it, so the user
+   * interface does not need to be opened for it. What the parser needs
+   * to know about the interface is known already.
+   */
+  settings_get("benchmark", &value);
+  if((int)value > 0)
+    return benchmark_parser(url, (int)value);
+
+  /* The stress test does not show the page either. */
+  settings_get("stress", &value);
+  if((int)value > 0)
+    return stress_parser(url, (int)value);
+
   /* Give over control to the user interface. */
   ret = ui_open(url);
 
@@ -150,6 +165,7 @@ int main(int argc, char *argv[])
 
   /* Clean up after ourselves. */
   layout_delete_all_parts(NULL);
+  layout_free_fonts();
 
   return ret;
 }
@@ -0,0 +1,248 @@
+/**
+ * The parse arena. Tags, parameters and words read from the stream only
+ * live until the tag has been handled, so instead of allocating and
+ * freeing each of them separately, they are handed out from a few large
+ * blocks that are simply rewound when the next tag starts.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/* Round a size up so that every allocation is suitably aligned. */
+#define PARSE_ARENA_ALIGN(size)  (((size) + 7) & ~((size_t)7))
+
+/* The memory of a block starts directly after the block header. */
+#define PARSE_ARENA_DATA(blockp) \
+  ((char *)(blockp) + PARSE_ARENA_ALIGN(sizeof(struct parse_arena_block)))
+
+/**
+ * Allocate a new block from the system.
+ *
+ * @param arena The arena the block is allocated for.
+ * @param size The minimum number of usable bytes in the block.
+ *
+ * @return a pointer to the new block, or NULL if an error occurred.
+ */
+static struct parse_arena_block *
+parse_arena_new_block(struct parse_arena *arena, size_t size)
+{
+  struct parse_arena_block *blockp;
+
+  if(size < PARSE_ARENA_BLOCK_SIZE)
+    size = PARSE_ARENA_BLOCK_SIZE;
+
+  blockp = (struct parse_arena_block *)
+    malloc(PARSE_ARENA_ALIGN(sizeof(struct parse_arena_block)) + size);
+  if(blockp == NULL)
+    return NULL;
+
+  blockp->size = size;
+  blockp->used = 0;
+  blockp->next = NULL;
+
+  arena->statistics.blocks++;
+
+  return blockp;
+}
+
+/**
+ * Initialise the arena for a new document. Any memory kept from a
+ * previous document is released first, so the arena must either be
+ * zeroed or have been initialised before.
+ *
+ * @param arena The arena to initialise.
+ *
+ * @return a non-zero value if an error occurred.
+ */
+int parse_arena_init(struct parse_arena *arena)
+{
+  parse_arena_delete(arena);
+
+  memset(&arena->statistics, 0, sizeof(struct parse_arena_statistics));
+
+  arena->first_block = parse_arena_new_block(arena, PARSE_ARENA_BLOCK_SIZE);
+  if(arena->first_block == NULL)
+    return 1;
+  arena->current_block = arena->first_block;
+
+  return 0;
+}
+
+/**
+ * Release all memory held by the arena. Everything handed out from it
+ * becomes invalid.
+ *
+ * @param arena The arena to release.
+ */
+void parse_arena_delete(struct parse_arena *arena)
+{
+  struct parse_arena_block *blockp;
+
+  while(arena->first_block) {
+    blockp = arena->first_block->next;
+    free(arena->first_block);
+    arena->first_block = blockp;
+  }
+
+  arena->current_block = NULL;
+  arena->last_allocation = NULL;
+  arena->bytes_before_current = 0;
+}
+
+/**
+ * Allocate memory from the arena. The memory is valid until the next
+ * call to parse_arena_reset() or parse_arena_delete(), and should not
+ * be freed by the caller.
+ *
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ *
+ * @return a pointer to the memory, or NULL if an error occurred.
+ */
+void *parse_arena_alloc(struct parse_arena *arena, size_t size)
+{
+  struct parse_arena_block *blockp;
+  size_t in_use;
+  char *pointer;
+
+  size = PARSE_ARENA_ALIGN(size);
+
+  if(arena->current_block == NULL && parse_arena_init(arena) != 0)
+    return NULL;
+
+  if(arena->current_block->used + size > arena->current_block->size) {
+    /* Move on to the next block, reusing it if it is large enough. */
+    blockp = arena->current_block->next;
+    if(blockp == NULL || blockp->size < size) {
+      blockp = parse_arena_new_block(arena, size);
+      if(blockp == NULL)
+	return NULL;
+      blockp->next = arena->current_block->next;
+      arena->current_block->next = blockp;
+    }
+
+    arena->bytes_before_current += arena->current_block->used;
+    blockp->used = 0;
+    arena->current_block = blockp;
+  }
+
+  blockp = arena->current_block;
+  pointer = PARSE_ARENA_DATA(blockp) + blockp->used;
+  blockp->used += size;
+  arena->last_allocation = pointer;
+
+  arena->statistics.allocations++;
+  in_use = arena->bytes_before_current + arena->current_block->used;
+  if(in_use > arena->statistics.peak_bytes)
+    arena->statistics.peak_bytes = in_use;
+
+  return pointer;
+}
+
+/**
+ * Change the size of a piece of memory from the arena. If it was the
+ * latest allocation and there is room in the block, this is done in
+ * place. Otherwise the contents are copied to a new piece of memory.
+ *
+ * @param arena The arena the memory was allocated from.
+ * @param pointer The memory to resize, or NULL to allocate new memory.
+ * @param old_size The size the memory was allocated with.
+ * @param new_size The wanted size of the memory.
+ *
+ * @return a pointer to the resized memory, or NULL if an error occurred.
+ */
+void *parse_arena_resize(struct parse_arena *arena, void *pointer,
+			 size_t old_size, size_t new_size)
+{
+  struct parse_arena_block *blockp;
+  char *new_pointer;
+  size_t start, in_use;
+
+  if(pointer == NULL)
+    return parse_arena_alloc(arena, new_size);
+
+  arena->statistics.resizes++;
+
+  blockp = arena->current_block;
+  if(pointer == arena->last_allocation) {
+    start = (char *)pointer - PARSE_ARENA_DATA(blockp);
+    if(start + PARSE_ARENA_ALIGN(new_size) <= blockp->size) {
+      blockp->used = start + PARSE_ARENA_ALIGN(new_size);
+      in_use = arena->bytes_before_current + blockp->used;
+      if(in_use > arena->statistics.peak_bytes)
+	arena->statistics.peak_bytes = in_use;
+      return pointer;
+    }
+  }
+
+  new_pointer = parse_arena_alloc(arena, new_size);
+  if(new_pointer == NULL)
+    return NULL;
+  memcpy(new_pointer, pointer, old_size < new_size ? old_size : new_size);
+
+  return new_pointer;
+}
+
+/**
+ * Rewind the arena, so that all memory handed out since the last reset
+ * is reused. This is done once for every tag, since nothing allocated
+ * while reading a tag is needed after it has been handled.
+ *
+ * @param arena The arena to rewind.
+ */
+void parse_arena_reset(struct parse_arena *arena)
+{
+  if(arena->first_block == NULL)
+    return;
+
+  arena->first_block->used = 0;
+  arena->current_block = arena->first_block;
+  arena->last_allocation = NULL;
+  arena->bytes_before_current = 0;
+
+  arena->statistics.resets++;
+}
+
+/**
+ * Get the counters describing how the arena has been used since the
+ * last call to parse_arena_init().
+ *
+ * @param arena The arena to get the counters of.
+ * @param stats A pointer to where the counters are copied.
+ */
+void parse_arena_get_statistics(struct parse_arena *arena,
+				struct parse_arena_statistics *stats)
+{
+  memcpy(stats, &arena->statistics, sizeof(struct parse_arena_statistics));
+}
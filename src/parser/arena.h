@@ -0,0 +1,94 @@
+/**
+ * Structs and prototypes for the parse arena, which hands out the
+ * short lived memory used while tokenizing a document.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+#ifndef _PARSER_ARENA_H_
+#define _PARSER_ARENA_H_
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <sys/types.h>
+
+/* The default size of each block of memory in the arena. */
+#define PARSE_ARENA_BLOCK_SIZE  16384
+
+/**
+ * One block of memory in the parse arena. The usable memory follows
+ * directly after the struct itself.
+ *
+ * @member size The number of usable bytes in the block.
+ * @member used The number of bytes handed out from the block.
+ * @member next A pointer to the next block in the arena.
+ */
+struct parse_arena_block {
+  size_t size;
+  size_t used;
+  struct parse_arena_block *next;
+};
+
+/**
+ * Counters describing how the parse arena has been used for a document.
+ *
+ * @member allocations The number of allocations served by the arena.
+ * @member resizes The number of resize requests served by the arena.
+ * @member resets The number of times the scratch region was reset.
+ * @member blocks The number of blocks allocated from the system.
+ * @member peak_bytes The largest number of bytes in use at one time.
+ */
+struct parse_arena_statistics {
+  unsigned long allocations;
+  unsigned long resizes;
+  unsigned long resets;
+  unsigned long blocks;
+  size_t peak_bytes;
+};
+
+/**
+ * A parse arena. Each document being parsed has one of its own.
+ *
+ * @member first_block The first block in the arena.
+ * @member current_block The block allocations are currently made from.
+ * @member last_allocation The most recent allocation, which is the only 
+ * @member last_allocation one that can grow in place.
+ * @member bytes_before_current Bytes in use in the blocks before the
+ * @member bytes_before_current current one.
+ * @member statistics Counters describing how the arena has been used.
+ */
+struct parse_arena {
+  struct parse_arena_block *first_block;
+  struct parse_arena_block *current_block;
+  char *last_allocation;
+  size_t bytes_before_current;
+  struct parse_arena_statistics statistics;
+};
+
+/* Arena function prototypes. */
+extern int parse_arena_init(struct parse_arena *arena);
+extern void parse_arena_delete(struct parse_arena *arena);
+extern void *parse_arena_alloc(struct parse_arena *arena, size_t size);
+extern void *parse_arena_resize(struct parse_arena *arena, void *pointer,
+				size_t old_size, size_t new_size);
+extern void parse_arena_reset(struct parse_arena *arena);
+extern void parse_arena_get_statistics(struct parse_arena *arena,
+				       struct parse_arena_statistics *stats);
+
+#endif /* _PARSER_ARENA_H_ */
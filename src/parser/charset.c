@@ -0,0 +1,388 @@
+/**
+ * The charset decoder. Everything in Zen is ISO-8859-1, so documents
+ * written in another charset are converted into that as soon as they
+ * are read from the stream, before the parser gets to them. Characters
+ * that do not exist in ISO-8859-1 are replaced with something that looks
+ * about the same, or a question mark. Since none of the supported
+ * charsets ever need more than one byte where ISO-8859-1 needs one, the
+ * conversion is done in the buffer the data was read into, and pure
+ * ASCII text is not even moved.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_STRINGS_H
+#include <strings.h>
+#endif /* HAVE_STRINGS_H */
+
+#include "charset.h"
+#include "scan.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/**
+ * A byte of a single byte charset which is not the same character as in
+ * ISO-8859-1.
+ *
+ * @member byte The byte in the charset.
+ * @member code The Unicode value of the character, or zero if the byte
+ * @member code is not used in the charset.
+ */
+struct parse_charset_byte {
+  unsigned char byte;
+  unsigned short code;
+};
+
+/* Windows-1252 puts printable characters where ISO-8859-1 has control
+ * characters. Otherwise they are the same.
+ */
+static struct parse_charset_byte parse_charset_windows_1252[] = {
+  { 0x80, 0x20ac }, { 0x81, 0 }, { 0x82, 0x201a }, { 0x83, 0x0192 },
+  { 0x84, 0x201e }, { 0x85, 0x2026 }, { 0x86, 0x2020 }, { 0x87, 0x2021 },
+  { 0x88, 0x02c6 }, { 0x89, 0x2030 }, { 0x8a, 0x0160 }, { 0x8b, 0x2039 },
+  { 0x8c, 0x0152 }, { 0x8d, 0 }, { 0x8e, 0x017d }, { 0x8f, 0 },
+  { 0x90, 0 }, { 0x91, 0x2018 }, { 0x92, 0x2019 }, { 0x93, 0x201c },
+  { 0x94, 0x201d }, { 0x95, 0x2022 }, { 0x96, 0x2013 }, { 0x97, 0x2014 },
+  { 0x98, 0x02dc }, { 0x99, 0x2122 }, { 0x9a, 0x0161 }, { 0x9b, 0x203a },
+  { 0x9c, 0x0153 }, { 0x9d, 0 }, { 0x9e, 0x017e }, { 0x9f, 0x0178 },
+  { 0, 0 }
+};
+
+/* ISO-8859-15 is ISO-8859-1 with the euro sign and a few letters. */
+static struct parse_charset_byte parse_charset_iso_8859_15[] = {
+  { 0xa4, 0x20ac }, { 0xa6, 0x0160 }, { 0xa8, 0x0161 }, { 0xb4, 0x017d },
+  { 0xb8, 0x017e }, { 0xbc, 0x0152 }, { 0xbd, 0x0153 }, { 0xbe, 0x0178 },
+  { 0, 0 }
+};
+
+/**
+ * A name of a charset the decoder knows.
+ *
+ * @member name The name, as given in the Content-Type header.
+ * @member kind The kind of charset.
+ * @member bytes For single byte charsets, the bytes that differ from
+ * @member bytes ISO-8859-1.
+ */
+struct parse_charset_name {
+  char *name;
+  enum parse_charset_kind kind;
+  struct parse_charset_byte *bytes;
+};
+
+/* The known charsets. The names are compared without caring about case. */
+static struct parse_charset_name parse_charset_names[] = {
+  { "iso-8859-1", PARSE_CHARSET_LATIN1, NULL },
+  { "iso8859-1", PARSE_CHARSET_LATIN1, NULL },
+  { "iso_8859-1", PARSE_CHARSET_LATIN1, NULL },
+  { "latin1", PARSE_CHARSET_LATIN1, NULL },
+  { "l1", PARSE_CHARSET_LATIN1, NULL },
+  { "us-ascii", PARSE_CHARSET_LATIN1, NULL },
+  { "ascii", PARSE_CHARSET_LATIN1, NULL },
+  { "utf-8", PARSE_CHARSET_UTF8, NULL },
+  { "utf8", PARSE_CHARSET_UTF8, NULL },
+  { "windows-1252", PARSE_CHARSET_SINGLE_BYTE, parse_charset_windows_1252 },
+  { "cp1252", PARSE_CHARSET_SINGLE_BYTE, parse_charset_windows_1252 },
+  { "x-cp1252", PARSE_CHARSET_SINGLE_BYTE, parse_charset_windows_1252 },
+  { "iso-8859-15", PARSE_CHARSET_SINGLE_BYTE, parse_charset_iso_8859_15 },
+  { "iso8859-15", PARSE_CHARSET_SINGLE_BYTE, parse_charset_iso_8859_15 },
+  { "iso_8859-15", PARSE_CHARSET_SINGLE_BYTE, parse_charset_iso_8859_15 },
+  { "latin9", PARSE_CHARSET_SINGLE_BYTE, parse_charset_iso_8859_15 },
+  { "latin-9", PARSE_CHARSET_SINGLE_BYTE, parse_charset_iso_8859_15 },
+  { NULL, PARSE_CHARSET_LATIN1, NULL }
+};
+
+/**
+ * A range of Unicode characters outside ISO-8859-1, and what to show
+ * instead of them.
+ *
+ * @member first The first character in the range.
+ * @member last The last character in the range.
+ * @member character The ISO-8859-1 character to use instead, or zero if
+ * @member character the characters are just left out.
+ */
+struct parse_charset_fallback {
+  unsigned long first;
+  unsigned long last;
+  unsigned char character;
+};
+
+/* Some characters that are common enough on web pages to deserve better
+ * than a question mark. Letters with marks not found in ISO-8859-1 are
+ * shown without the mark.
+ */
+static struct parse_charset_fallback parse_charset_fallbacks[] = {
+  { 0x0152, 0x0152, 'O' }, { 0x0153, 0x0153, 'o' },
+  { 0x0160, 0x0160, 'S' }, { 0x0161, 0x0161, 's' },
+  { 0x0178, 0x0178, 'Y' }, { 0x017d, 0x017d, 'Z' },
+  { 0x017e, 0x017e, 'z' }, { 0x0192, 0x0192, 'f' },
+  { 0x02c6, 0x02c6, '^' }, { 0x02dc, 0x02dc, '~' },
+  { 0x2000, 0x200a, ' ' }, { 0x200b, 0x200f, 0 },
+  { 0x2010, 0x2015, '-' }, { 0x2018, 0x201b, '\'' },
+  { 0x201c, 0x201f, '"' }, { 0x2020, 0x2021, '+' },
+  { 0x2022, 0x2022, 0xb7 }, { 0x2026, 0x2026, '.' },
+  { 0x2030, 0x2030, '%' }, { 0x2032, 0x2032, '\'' },
+  { 0x2033, 0x2033, '"' }, { 0x2039, 0x2039, '<' },
+  { 0x203a, 0x203a, '>' }, { 0x20ac, 0x20ac, 'E' },
+  { 0xfeff, 0xfeff, 0 },
+  { 0, 0, 0 }
+};
+
+/**
+ * Find the ISO-8859-1 character to use for a Unicode character.
+ *
+ * @param code The Unicode value of the character.
+ *
+ * @return the character to use, or zero if nothing should be shown.
+ */
+static unsigned char parse_charset_to_latin1(unsigned long code)
+{
+  int index;
+
+  if(code < 256)
+    return (unsigned char)code;
+
+  for(index = 0 ; parse_charset_fallbacks[index].last ; index++)
+    if(code >= parse_charset_fallbacks[index].first &&
+       code <= parse_charset_fallbacks[index].last)
+      return parse_charset_fallbacks[index].character;
+
+  return '?';
+}
+
+/**
+ * Choose the charset the document is written in. Until this is called,
+ * or if the charset is not known, ISO-8859-1 is assumed.
+ *
+ * @param charset The charset decoder of the document.
+ * @param name The name of the charset, as given in the Content-Type header.
+ *
+ * @return non-zero value if the charset is not known.
+ */
+int parse_charset_set(struct parse_charset *charset, char *name)
+{
+  struct parse_charset_byte *bytes;
+  int index, byte;
+
+  for(index = 0 ; parse_charset_names[index].name ; index++)
+    if(!strcasecmp(name, parse_charset_names[index].name))
+      break;
+
+  charset->pending_length = 0;
+  charset->kind = parse_charset_names[index].kind;
+  if(parse_charset_names[index].name == NULL) {
+#ifdef DEBUG
+    fprintf(stderr, "%s: Unknown charset %s, using ISO-8859-1.\n",
+	    __FUNCTION__, name);
+#endif /* DEBUG */
+    return 1;
+  }
+
+  if(charset->kind == PARSE_CHARSET_SINGLE_BYTE) {
+    for(byte = 0 ; byte < 256 ; byte++)
+      charset->map[byte] = byte;
+    for(bytes = parse_charset_names[index].bytes ; bytes->byte ; bytes++) {
+      if(bytes->code)
+	charset->map[bytes->byte] = parse_charset_to_latin1(bytes->code);
+      else
+	charset->map[bytes->byte] = '?';
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Put the start of a character that was cut off at the end of the last
+ * buffer at the start of the next, so that the rest can be read after it.
+ *
+ * @param charset The charset decoder of the document.
+ * @param buffer The buffer the next data will be read into.
+ *
+ * @return the number of bytes put in the buffer.
+ */
+int parse_charset_restore(struct parse_charset *charset, char *buffer)
+{
+  int length;
+
+  length = charset->pending_length;
+  if(length > 0)
+    memcpy(buffer, charset->pending, length);
+  charset->pending_length = 0;
+
+  return length;
+}
+
+/**
+ * Find out how many bytes at the end of a buffer are the start of a
+ * UTF-8 character that continues in the next buffer.
+ *
+ * @param text The buffer.
+ * @param length The number of bytes in the buffer.
+ *
+ * @return the number of bytes to keep for the next buffer.
+ */
+static int parse_charset_utf8_cut(unsigned char *text, int length)
+{
+  unsigned char c;
+  int back, needed;
+
+  for(back = 1 ; back < PARSE_CHARSET_PENDING_SIZE && back <= length ;
+      back++) {
+    c = text[length - back];
+    if((c & 0xc0) == 0x80)
+      continue;
+    if(c < 0xc0)
+      return 0;
+
+    if(c >= 0xf0)
+      needed = 4;
+    else if(c >= 0xe0)
+      needed = 3;
+    else
+      needed = 2;
+    if(needed > back)
+      return back;
+    return 0;
+  }
+
+  return 0;
+}
+
+/**
+ * Convert a buffer of UTF-8 into ISO-8859-1.
+ *
+ * @param charset The charset decoder of the document.
+ * @param buffer The buffer to convert.
+ * @param length The number of bytes in the buffer.
+ *
+ * @return the number of bytes in the buffer after the conversion.
+ */
+static int parse_charset_decode_utf8(struct parse_charset *charset,
+				     char *buffer, int length)
+{
+  unsigned char *text = (unsigned char *)buffer;
+  unsigned long code;
+  unsigned char c;
+  int in, out, end, run, needed;
+
+  end = length - parse_charset_utf8_cut(text, length);
+  charset->pending_length = length - end;
+  memcpy(charset->pending, buffer + end, charset->pending_length);
+
+  in = out = 0;
+  while(in < end) {
+    /* Copy ASCII as it is, which means not at all until something
+     * before it has become shorter.
+     */
+    run = parse_scan_ascii(buffer + in, end - in);
+    if(run > 0) {
+      if(out != in)
+	memmove(buffer + out, buffer + in, run);
+      in += run;
+      out += run;
+      continue;
+    }
+
+    c = text[in++];
+    if(c >= 0xf8 || c < 0xc0) {
+      /* Not the start of a character. */
+      text[out++] = '?';
+      continue;
+    } else if(c >= 0xf0) {
+      needed = 3;
+      code = c & 0x07;
+    } else if(c >= 0xe0) {
+      needed = 2;
+      code = c & 0x0f;
+    } else {
+      needed = 1;
+      code = c & 0x1f;
+    }
+
+    while(needed > 0 && in < end && (text[in] & 0xc0) == 0x80) {
+      code = (code << 6) | (text[in++] & 0x3f);
+      needed--;
+    }
+
+    /* A character cut short is shown as such, and whatever interrupted
+     * it is taken care of next.
+     */
+    if(needed > 0)
+      c = '?';
+    else
+      c = parse_charset_to_latin1(code);
+    if(c)
+      text[out++] = c;
+  }
+
+  return out;
+}
+
+/**
+ * Convert a buffer of the document into ISO-8859-1. The result is never
+ * longer than the original, so it is placed in the same buffer. If the
+ * buffer ends in the middle of a character, the start of it is kept and
+ * should be put back with parse_charset_restore() before the next data
+ * is read.
+ *
+ * @param charset The charset decoder of the document.
+ * @param buffer The buffer to convert.
+ * @param length The number of bytes in the buffer.
+ *
+ * @return the number of bytes in the buffer after the conversion.
+ */
+int parse_charset_decode(struct parse_charset *charset,
+			 char *buffer, int length)
+{
+  unsigned char *text = (unsigned char *)buffer;
+  int index;
+
+  switch(charset->kind) {
+  case PARSE_CHARSET_LATIN1:
+    return length;
+
+  case PARSE_CHARSET_UTF8:
+    return parse_charset_decode_utf8(charset, buffer, length);
+
+  case PARSE_CHARSET_SINGLE_BYTE:
+    index = 0;
+    while(index < length) {
+      index += parse_scan_ascii(buffer + index, length - index);
+      if(index < length) {
+	text[index] = charset->map[text[index]];
+	index++;
+      }
+    }
+    return length;
+  }
+
+  return length;
+}
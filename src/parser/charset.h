@@ -0,0 +1,68 @@
+/**
+ * Structs and prototypes for the charset decoder, which converts the
+ * document into ISO-8859-1 as it is read from the stream.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+#ifndef _PARSER_CHARSET_H_
+#define _PARSER_CHARSET_H_
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* The most bytes of a UTF-8 character that can be cut off at the end
+ * of one buffer and kept for the next.
+ */
+#define PARSE_CHARSET_PENDING_SIZE  4
+
+/**
+ * The kinds of charsets the decoder knows how to convert.
+ */
+enum parse_charset_kind {
+  PARSE_CHARSET_LATIN1,
+  PARSE_CHARSET_SINGLE_BYTE,
+  PARSE_CHARSET_UTF8
+};
+
+/**
+ * The charset decoder of a document.
+ *
+ * @member kind The kind of charset the document is written in. Documents
+ * @member kind in ISO-8859-1, or plain ASCII, are not touched at all.
+ * @member map The ISO-8859-1 character for every byte of a single byte
+ * @member map charset.
+ * @member pending The start of a character that was cut off at the end
+ * @member pending of the last buffer.
+ * @member pending_length The number of bytes in pending.
+ */
+struct parse_charset {
+  enum parse_charset_kind kind;
+  unsigned char map[256];
+  char pending[PARSE_CHARSET_PENDING_SIZE];
+  int pending_length;
+};
+
+/* Charset decoder function prototypes. */
+extern int parse_charset_set(struct parse_charset *charset, char *name);
+extern int parse_charset_restore(struct parse_charset *charset,
+				 char *buffer);
+extern int parse_charset_decode(struct parse_charset *charset,
+				char *buffer, int length);
+
+#endif /* _PARSER_CHARSET_H_ */
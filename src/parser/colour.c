@@ -0,0 +1,172 @@
+/**
+ * Functions which convert the colours given to tags, either as
+ * hexadecimal numbers or by name, into colour values. The named
+ * colours are the full set which HTML and CSS know, mostly taken
+ * from the X11 rgb.txt.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <ctype.h>
+#include <string.h>
+
+#include "helpers.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/* The same as tolower() in the C locale, which the names are in. */
+#define PARSE_COLOUR_LOWER(c) \
+  ((c) >= 'A' && (c) <= 'Z' ? (c) - 'A' + 'a' : (c))
+
+/**
+ * A named colour.
+ *
+ * @member name The name of the colour, in lower case.
+ * @member colour The colour value.
+ */
+struct parse_colour {
+  const char *name;
+  uint32_t colour;
+};
+
+/* The named colours are found with a minimal perfect hash. The first
+ * hash of a name, with seed zero, selects one of the buckets in
+ * parse_colour_seeds. The second hash, with the seed of that bucket, is
+ * then the index in parse_colours of the only colour the name can be.
+ * The seeds and the table are generated by mkcolours from the list in
+ * colours.txt. Run `make colours' after changing the list.
+ */
+#include "colours.h"
+
+/**
+ * Calculate the hash value of a colour name, in upper or lower case.
+ * This is the FNV-1a hash, with a seed mixed into its start value.
+ *
+ * @param name The name of the colour.
+ * @param seed The seed to hash with.
+ *
+ * @return the hash value.
+ */
+static uint32_t parse_colour_hash(const char *name, uint32_t seed)
+{
+  uint32_t hash;
+
+  hash = 2166136261U ^ seed;
+  for( ; *name ; name++)
+    hash = (hash ^ (unsigned char)PARSE_COLOUR_LOWER(*name)) * 16777619U;
+
+  return hash;
+}
+
+/**
+ * Look up a named colour, in upper or lower case.
+ *
+ * @param name The name of the colour.
+ * @param colour Where the colour value is stored, if it is found.
+ *
+ * @return non-zero value if there is no colour with that name.
+ */
+static int parse_colour_by_name(const char *name, uint32_t *colour)
+{
+  const struct parse_colour *entry;
+  uint32_t seed;
+
+  seed = parse_colour_seeds[parse_colour_hash(name, 0) % 
+			    PARSE_COLOUR_BUCKETS];
+  entry = &parse_colours[parse_colour_hash(name, seed) % PARSE_COLOURS];
+  if(strcasecmp(name, entry->name))
+    return 1;
+
+  *colour = entry->colour;
+
+  return 0;
+}
+
+/**
+ * Convert a hexadecimal digit into its corresponding decimal value.
+ *
+ * @param hex The hexadecimal digit, in upper or lower case.
+ *
+ * @return the decimal value, or zero if it is not a hexadecimal digit.
+ */
+static int parse_convert_hex(char hex)
+{
+  if(hex >= '0' && hex <= '9')
+    return hex - '0';
+  if(hex >= 'a' && hex <= 'f')
+    return hex - 'a' + 10;
+  if(hex >= 'A' && hex <= 'F')
+    return hex - 'A' + 10;
+
+  return 0;
+}
+
+/**
+ * Converts a colour, given by name or in the form #rrggbb, into a 24-bit
+ * colour value. The hash mark is often left out, and the short form
+ * #rgb is understood as well.
+ *
+ * @param colour A string containing the colour code.
+ *
+ * @return a 24-bit colour value, or white if the colour is unknown.
+ */
+uint32_t parse_convert_colour(char *colour)
+{
+  uint32_t real_colour;
+  int digits, i;
+
+  if(colour[0] == '#') {
+    colour++;
+  } else {
+    if(!parse_colour_by_name(colour, &real_colour))
+      return real_colour;
+
+    for(digits = 0 ; digits < 6 ; digits++)
+      if(!isxdigit((int)colour[digits]))
+	return 0xffffff;
+  }
+
+  digits = strlen(colour);
+  if(digits == 3) {
+    real_colour = 0;
+    for(i = 0 ; i < 3 ; i++)
+      real_colour = (real_colour << 8) | (parse_convert_hex(colour[i]) * 17);
+
+    return real_colour;
+  }
+
+  /* Missing digits are taken as zeroes. */
+  real_colour = 0;
+  for(i = 0 ; i < 6 ; i++) {
+    real_colour <<= 4;
+    if(i < digits)
+      real_colour |= parse_convert_hex(colour[i]);
+  }
+
+  return real_colour;
+}
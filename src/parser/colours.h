@@ -0,0 +1,167 @@
+/* Do not edit.  Generated by mkcolours from colours.txt. */
+
+/* The number of named colours, and the number of buckets they are
+ * spread over by the first hash.
+ */
+#define PARSE_COLOURS  148
+#define PARSE_COLOUR_BUCKETS  64
+
+static const unsigned char parse_colour_seeds[PARSE_COLOUR_BUCKETS] = {
+    0,   0,   0,   0,   2,  18,  47,   0,   3,   3,   0,   0,
+    0,   1,   4,  50,  17,  32,  36,   0,   1,   4,  39,   2,
+   13,   8,   1,   0,   4,   3,  38,   0,   7,   0,  22,   0,
+   12,   0,   3,   0,   0,   8,  19,   1,   3,  40,  80,  23,
+    2,  37,   4,  19,  15,  15,  30,   0,   0,  18,   0,  24,
+    0,  19, 172, 122
+};
+
+static const struct parse_colour parse_colours[PARSE_COLOURS] = {
+  { "cadetblue", 0x5f9ea0 },
+  { "lightgrey", 0xd3d3d3 },
+  { "bisque", 0xffe4c4 },
+  { "khaki", 0xf0e68c },
+  { "lime", 0x00ff00 },
+  { "honeydew", 0xf0fff0 },
+  { "cyan", 0x00ffff },
+  { "lightslategray", 0x778899 },
+  { "palegreen", 0x98fb98 },
+  { "slategray", 0x708090 },
+  { "violet", 0xee82ee },
+  { "lightblue", 0xadd8e6 },
+  { "red", 0xff0000 },
+  { "royalblue", 0x4169e1 },
+  { "brown", 0xa52a2a },
+  { "forestgreen", 0x228b22 },
+  { "blue", 0x0000ff },
+  { "mediumseagreen", 0x3cb371 },
+  { "paleturquoise", 0xafeeee },
+  { "wheat", 0xf5deb3 },
+  { "linen", 0xfaf0e6 },
+  { "palevioletred", 0xdb7093 },
+  { "oldlace", 0xfdf5e6 },
+  { "darkseagreen", 0x8fbc8f },
+  { "magenta", 0xff00ff },
+  { "chocolate", 0xd2691e },
+  { "lightsteelblue", 0xb0c4de },
+  { "limegreen", 0x32cd32 },
+  { "darkred", 0x8b0000 },
+  { "purple", 0x800080 },
+  { "indigo", 0x4b0082 },
+  { "darkkhaki", 0xbdb76b },
+  { "greenyellow", 0xadff2f },
+  { "lightgoldenrodyellow", 0xfafad2 },
+  { "orchid", 0xda70d6 },
+  { "darksalmon", 0xe9967a },
+  { "slateblue", 0x6a5acd },
+  { "pink", 0xffc0cb },
+  { "plum", 0xdda0dd },
+  { "mediumturquoise", 0x48d1cc },
+  { "seashell", 0xfff5ee },
+  { "midnightblue", 0x191970 },
+  { "darkcyan", 0x008b8b },
+  { "whitesmoke", 0xf5f5f5 },
+  { "olive", 0x808000 },
+  { "navy", 0x000080 },
+  { "lightseagreen", 0x20b2aa },
+  { "darkolivegreen", 0x556b2f },
+  { "olivedrab", 0x6b8e23 },
+  { "dimgrey", 0x696969 },
+  { "orange", 0xffa500 },
+  { "deeppink", 0xff1493 },
+  { "mistyrose", 0xffe4e1 },
+  { "palegoldenrod", 0xeee8aa },
+  { "chartreuse", 0x7fff00 },
+  { "silver", 0xc0c0c0 },
+  { "lightgray", 0xd3d3d3 },
+  { "cornsilk", 0xfff8dc },
+  { "yellow", 0xffff00 },
+  { "aliceblue", 0xf0f8ff },
+  { "lightyellow", 0xffffe0 },
+  { "slategrey", 0x708090 },
+  { "ghostwhite", 0xf8f8ff },
+  { "lawngreen", 0x7cfc00 },
+  { "peachpuff", 0xffdab9 },
+  { "sandybrown", 0xf4a460 },
+  { "maroon", 0x800000 },
+  { "gray", 0x808080 },
+  { "mediumpurple", 0x9370db },
+  { "springgreen", 0x00ff7f },
+  { "fuchsia", 0xff00ff },
+  { "hotpink", 0xff69b4 },
+  { "darkmagenta", 0x8b008b },
+  { "aqua", 0x00ffff },
+  { "beige", 0xf5f5dc },
+  { "lightpink", 0xffb6c1 },
+  { "lightcoral", 0xf08080 },
+  { "azure", 0xf0ffff },
+  { "mediumvioletred", 0xc71585 },
+  { "gold", 0xffd700 },
+  { "black", 0x000000 },
+  { "darkslategray", 0x2f4f4f },
+  { "darkorchid", 0x9932cc },
+  { "gainsboro", 0xdcdcdc },
+  { "green", 0x008000 },
+  { "floralwhite", 0xfffaf0 },
+  { "darkorange", 0xff8c00 },
+  { "tan", 0xd2b48c },
+  { "darkblue", 0x00008b },
+  { "grey", 0x808080 },
+  { "blueviolet", 0x8a2be2 },
+  { "mediumslateblue", 0x7b68ee },
+  { "burlywood", 0xdeb887 },
+  { "turquoise", 0x40e0d0 },
+  { "indianred", 0xcd5c5c },
+  { "lightsalmon", 0xffa07a },
+  { "lightslategrey", 0x778899 },
+  { "aquamarine", 0x7fffd4 },
+  { "dodgerblue", 0x1e90ff },
+  { "teal", 0x008080 },
+  { "mediumaquamarine", 0x66cdaa },
+  { "steelblue", 0x4682b4 },
+  { "snow", 0xfffafa },
+  { "seagreen", 0x2e8b57 },
+  { "goldenrod", 0xdaa520 },
+  { "darkgrey", 0xa9a9a9 },
+  { "sienna", 0xa0522d },
+  { "lemonchiffon", 0xfffacd },
+  { "ivory", 0xfffff0 },
+  { "papayawhip", 0xffefd5 },
+  { "mediumblue", 0x0000cd },
+  { "peru", 0xcd853f },
+  { "firebrick", 0xb22222 },
+  { "darkslategrey", 0x2f4f4f },
+  { "lightskyblue", 0x87cefa },
+  { "lightcyan", 0xe0ffff },
+  { "powderblue", 0xb0e0e6 },
+  { "darkturquoise", 0x00ced1 },
+  { "darkviolet", 0x9400d3 },
+  { "white", 0xffffff },
+  { "darkgreen", 0x006400 },
+  { "orangered", 0xff4500 },
+  { "deepskyblue", 0x00bfff },
+  { "darkgray", 0xa9a9a9 },
+  { "mediumspringgreen", 0x00fa9a },
+  { "yellowgreen", 0x9acd32 },
+  { "mintcream", 0xf5fffa },
+  { "tomato", 0xff6347 },
+  { "darkgoldenrod", 0xb8860b },
+  { "mediumorchid", 0xba55d3 },
+  { "coral", 0xff7f50 },
+  { "rosybrown", 0xbc8f8f },
+  { "darkslateblue", 0x483d8b },
+  { "lightgreen", 0x90ee90 },
+  { "moccasin", 0xffe4b5 },
+  { "salmon", 0xfa8072 },
+  { "lavenderblush", 0xfff0f5 },
+  { "navajowhite", 0xffdead },
+  { "crimson", 0xdc143c },
+  { "dimgray", 0x696969 },
+  { "blanchedalmond", 0xffebcd },
+  { "saddlebrown", 0x8b4513 },
+  { "skyblue", 0x87ceeb },
+  { "cornflowerblue", 0x6495ed },
+  { "rebeccapurple", 0x663399 },
+  { "antiquewhite", 0xfaebd7 },
+  { "lavender", 0xe6e6fa },
+  { "thistle", 0xd8bfd8 }
+};
@@ -0,0 +1,252 @@
+/** 
+ * Functions to create and destroy parser contexts.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "context.h"
+#include "helpers.h"
+#include "states.h"
+#include "tags.h"
+#include "parse.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/**
+ * Create a new parser context, used to parse one document into the
+ * given page.
+ *
+ * @param page The page information part returned by layout_init_page(),
+ * @param page under which all parts of the document are placed. This may
+ * @param page be NULL if the events are all taken care of by the caller.
+ *
+ * @return a pointer to the new context, or NULL if an error occurred.
+ */
+struct parse_context *parse_context_new(struct layout_part *page)
+{
+  struct parse_context *context;
+
+  context = (struct parse_context *)malloc(sizeof(struct parse_context));
+  if(context == NULL)
+    return NULL;
+
+  memset(context, 0, sizeof(struct parse_context));
+  context->page = page;
+  context->base = page;
+  context->events = &parse_tag_events;
+  context->events_data = context;
+
+  /* Leading whitespace of the first text on the page is not kept. */
+  context->string.last_was_space = 1;
+
+  return context;
+}
+
+/**
+ * Free a parser context and everything it holds. The layout parts 
+ * created while parsing are not touched.
+ *
+ * @param context The parser context to free.
+ */
+void parse_context_free(struct parse_context *context)
+{
+  if(context == NULL)
+    return;
+
+  parse_arena_delete(&context->arena);
+  parse_state_free(context);
+  parse_string_discard(context);
+  parse_preload_free(&context->preload);
+  if(context->anchors.anchors != NULL)
+    free(context->anchors.anchors);
+
+  free(context);
+}
+
+/**
+ * Ask for a function to be called now and then while the document is
+ * parsed, so that the page can be layouted and shown before it has been
+ * completely loaded. New parts which are not placed inside another part
+ * are then added under a separate base part instead of the page, where
+ * the checkpoint function can pick them up from.
+ *
+ * @param context The parser context of the document.
+ * @param base The part to add new parts under instead of the page.
+ * @param function The function to call at each checkpoint.
+ * @param data Data given to the checkpoint function.
+ */
+void parse_context_set_checkpoint(struct parse_context *context,
+				  struct layout_part *base,
+				  parse_checkpoint_function *function,
+				  void *data)
+{
+  context->base = base;
+  context->checkpoint.function = function;
+  context->checkpoint.data = data;
+  context->checkpoint.bytes = 0;
+  context->checkpoint.count = 0;
+  gettimeofday(&context->checkpoint.time, NULL);
+}
+
+/**
+ * Ask for a function to be called for every image found in the document,
+ * as soon as it has been read from the stream. This lets the caller start
+ * fetching the images long before the parser gets to them.
+ *
+ * @param context The parser context of the document.
+ * @param function The function to call for each image.
+ * @param data Data given to the preload function.
+ */
+void parse_context_set_preload(struct parse_context *context,
+			       parse_preload_function *function,
+			       void *data)
+{
+  context->preload.function = function;
+  context->preload.data = data;
+  context->preload.state = PARSE_PRELOAD_TEXT;
+  context->preload.count = 0;
+}
+
+/**
+ * Tell the parser which charset the document is written in, so that it
+ * can be converted into ISO-8859-1 while it is read. Without this, the
+ * document is assumed to be ISO-8859-1 already.
+ *
+ * @param context The parser context of the document.
+ * @param name The name of the charset, as given in the Content-Type header.
+ *
+ * @return non-zero value if the charset is not known, in which case
+ * @return ISO-8859-1 is assumed.
+ */
+int parse_context_set_charset(struct parse_context *context, char *name)
+{
+  return parse_charset_set(&context->charset, name);
+}
+
+/**
+ * Ask for other functions than the usual ones to be called for the tags,
+ * text and comments found in the document. Those normally build the
+ * layout parts of the page, which is not done at all with other events.
+ *
+ * @param context The parser context of the document.
+ * @param events The functions to call, or NULL to build the page again.
+ * @param data Data given to the event functions.
+ */
+void parse_context_set_events(struct parse_context *context,
+			      struct parse_events *events, void *data)
+{
+  if(events == NULL) {
+    context->events = &parse_tag_events;
+    context->events_data = context;
+  } else {
+    context->events = events;
+    context->events_data = data;
+  }
+}
+
+/**
+ * Let the parser read the document from memory, instead of from the
+ * stream given to the parsing function, which is then never read from.
+ * The text is not copied, and must be kept until the parsing is done.
+ *
+ * @param context The parser context of the document.
+ * @param text The whole document.
+ * @param length The number of bytes in the document.
+ */
+void parse_context_set_input(struct parse_context *context,
+			     char *text, size_t length)
+{
+  context->input.memory = text;
+  context->input.memory_left = length;
+}
+
+/**
+ * Get the counters describing how the last document was parsed with the
+ * context, such as how many allocations were made from its arena.
+ *
+ * @param context The parser context of the document.
+ * @param stats A pointer to where the counters are placed.
+ */
+void parse_context_get_statistics(struct parse_context *context,
+				  struct parse_statistics *stats)
+{
+  struct parse_arena_statistics arena_stats;
+
+  parse_arena_get_statistics(&context->arena, &arena_stats);
+  stats->allocations = arena_stats.allocations;
+  stats->resizes = arena_stats.resizes;
+  stats->resets = arena_stats.resets;
+  stats->blocks = arena_stats.blocks;
+  stats->peak_bytes = arena_stats.peak_bytes;
+  stats->yields = context->budget.yields;
+}
+
+/**
+ * Call the checkpoint function, if enough has been parsed or enough time
+ * has passed since the last time. This is called between the tags, and
+ * before waiting for more data from the stream.
+ *
+ * @param context The parser context of the document.
+ */
+void parse_context_checkpoint(struct parse_context *context)
+{
+  struct parse_checkpoint *checkpoint = &context->checkpoint;
+  struct timeval now;
+  size_t parsed, wanted;
+  long elapsed;
+
+  if(checkpoint->function == NULL)
+    return;
+
+  parsed = context->input.total - context->input.left;
+  if(parsed <= checkpoint->bytes)
+    return;
+
+  if(checkpoint->count == 0)
+    wanted = PARSE_CHECKPOINT_FIRST_BYTES;
+  else
+    wanted = PARSE_CHECKPOINT_BYTES;
+
+  gettimeofday(&now, NULL);
+  elapsed = (now.tv_sec - checkpoint->time.tv_sec) * 1000 +
+    (now.tv_usec - checkpoint->time.tv_usec) / 1000;
+
+  if(parsed - checkpoint->bytes < wanted && 
+     elapsed < PARSE_CHECKPOINT_INTERVAL)
+    return;
+
+  checkpoint->bytes = parsed;
+  checkpoint->time = now;
+  checkpoint->count++;
+
+  checkpoint->function(parse_state_open_part(context), checkpoint->data);
+}
@@ -0,0 +1,162 @@
+/** 
+ * The parser context, which holds everything the parser needs to know
+ * about the document it is parsing. Since nothing is kept in global
+ * variables, several documents can be parsed at the same time.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+#ifndef _PARSER_CONTEXT_H_
+#define _PARSER_CONTEXT_H_
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include "threads.h"
+#include "layout.h"
+#include "parse.h"
+#include "arena.h"
+#include "states.h"
+#include "preload.h"
+#include "charset.h"
+
+/* The number of bytes read from the stream at a time. */
+#define PARSE_INPUT_BUFFER_SIZE  16384
+
+/* The number of bytes parsed before the first checkpoint, and between
+ * the following ones. 
+ */
+#define PARSE_CHECKPOINT_FIRST_BYTES  4096
+#define PARSE_CHECKPOINT_BYTES  32768
+
+/* The number of milliseconds after which a checkpoint is made anyway,
+ * if anything has been parsed since the last one.
+ */
+#define PARSE_CHECKPOINT_INTERVAL  250
+
+/**
+ * The buffered input stream of a document.
+ *
+ * @member buffer The data read from the stream.
+ * @member index The position of the next byte in the buffer.
+ * @member left The number of bytes left in the buffer.
+ * @member total The total number of bytes read from the stream.
+ * @member memory The rest of a document that is read from memory instead
+ * @member memory of from the stream, or NULL if it is read from the stream.
+ * @member memory_left The number of bytes left in memory.
+ */
+struct parse_input {
+  char buffer[PARSE_INPUT_BUFFER_SIZE];
+  int index;
+  int left;
+  size_t total;
+  char *memory;
+  size_t memory_left;
+};
+
+/**
+ * The text that is collected between the tags.
+ *
+ * @member text The text collected so far, or NULL if there is none.
+ * @member length The length of the text.
+ * @member allocation The number of bytes allocated for the text.
+ * @member preformatted Non-zero value if the text is preformatted.
+ * @member last_was_space Non-zero value if the last stored text ended
+ * @member last_was_space with a whitespace character.
+ */
+struct parse_string {
+  char *text;
+  int length;
+  int allocation;
+  int preformatted;
+  int last_was_space;
+};
+
+/**
+ * Keeps track of when to let the caller see what has been parsed.
+ *
+ * @member function The function to call at a checkpoint, or NULL if
+ * @member function no checkpoints should be made.
+ * @member data The data given to the checkpoint function.
+ * @member bytes The number of bytes parsed at the last checkpoint.
+ * @member time The time of the last checkpoint.
+ * @member count The number of checkpoints made so far.
+ */
+struct parse_checkpoint {
+  parse_checkpoint_function *function;
+  void *data;
+  size_t bytes;
+  struct timeval time;
+  int count;
+};
+
+/**
+ * The named places found in the document, which are still waiting for
+ * a part to point at.
+ * @member anchors The places waiting, or NULL if none have been found.
+ * @member count The number of places waiting.
+ * @member allocation The number of places there is room for.
+ */
+struct parse_anchors {
+  struct layout_anchor **anchors;
+  int count;
+  int allocation;
+};
+
+/**
+ * Everything the parser keeps while parsing one document.
+ *
+ * @member page The page information part the document is parsed into.
+ * @member base The part that new parts are added under, when there is
+ * @member base no open tag saying otherwise. This is normally the page.
+ * @member input The buffered input stream.
+ * @member charset The decoder converting the input into ISO-8859-1.
+ * @member arena The arena that tags and their parameters are read into.
+ * @member states The stack of styles, alignments and base parts.
+ * @member string The text collected since the last tag.
+ * @member checkpoint When to let the caller see what has been parsed.
+ * @member budget How much may be parsed before other threads are let to
+ * @member budget run.
+ * @member preload The scanner looking for resources to preload.
+ * @member anchors The named places waiting for a part.
+ * @member events The functions called for what is found in the document.
+ * @member events_data The data given to the event functions.
+ */
+struct parse_context {
+  struct layout_part *page;
+  struct layout_part *base;
+  struct parse_input input;
+  struct parse_charset charset;
+  struct parse_arena arena;
+  struct parse_state_stack states;
+  struct parse_string string;
+  struct parse_checkpoint checkpoint;
+  struct thread_budget budget;
+  struct parse_preload preload;
+  struct parse_anchors anchors;
+  struct parse_events *events;
+  void *events_data;
+};
+
+/* Prototypes of internal parser context functions. */
+extern void parse_context_checkpoint(struct parse_context *context);
+
+#endif /* _PARSER_CONTEXT_H_ */
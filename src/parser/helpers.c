@@ -36,7 +36,9 @@
 #include "threads.h"
 
 #include "tags.h"
+#include "context.h"
 #include "helpers.h"
+#include "scan.h"
 #include "ui.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
@@ -44,6 +46,35 @@
 #include <dmalloc.h>
 #endif /* HAVE_DMALLOC_H */
 
+/**
+ * Read more of the document into the buffer, from memory if it was
+ * given with parse_context_set_input(), or else from the stream.
+ *
+ * @param context The parser context, which holds the input.
+ * @param fd The file descriptor from where to read data.
+ * @param buffer Where the data is placed.
+ * @param size The most number of bytes to read.
+ *
+ * @return the number of bytes read, zero at the end of the document, or
+ * @return a negative value if an error occurred.
+ */
+static int parse_read_input(struct parse_context *context, int fd,
+			    char *buffer, int size)
+{
+  struct parse_input *input = &context->input;
+
+  if(input->memory == NULL)
+    return read(fd, buffer, size);
+
+  if((size_t)size > input->memory_left)
+    size = input->memory_left;
+  memcpy(buffer, input->memory, size);
+  input->memory += size;
+  input->memory_left -= size;
+
+  return size;
+}
+
 /**
  * As the name suggests, this function will get one byte from the stream.
  * It does this in a bit more efficient way than just doing a read(), since
@@ -52,6 +83,7 @@
  * Comments: Right now, the number of bytes read each time is fixed. If need
  *           be, I will put this as a config file option in the future.
  *
+ * @param context The parser context, which holds the buffer.
  * @param fd The file descriptor from where to read data. 
  * @param c A pointer to a character where the byte is placed.
  *
@@ -59,67 +91,120 @@
  * @return was read successfully, a 0 if the stream ended before we could read
  * @return the character, or a negative value if an error occurred. 
  */
-int parse_get_byte(int fd, char *c)
+int parse_get_byte(struct parse_context *context, int fd, char *c)
 {
-  static char buffer[16384];
-  static int index = 0, left = 0;
-  static size_t total = 0;
+  struct parse_input *input = &context->input;
   char *status;
+  int amount_read, kept;
+
+  /* A buffer may turn out to hold nothing but the start of a character,
+   * in which case there is nothing to return until more has been read.
+   */
+  while(input->left == 0) {
+    /* Show what we have before possibly waiting for more. */
+    parse_context_checkpoint(context);
 
-  if(left == 0) {
-    left = read(fd, buffer, 16384);
-    total += left;
+    kept = parse_charset_restore(&context->charset, input->buffer);
+    amount_read = parse_read_input(context, fd, input->buffer + kept,
+				   PARSE_INPUT_BUFFER_SIZE - kept);
+    input->total += amount_read;
 
     status = (char *)malloc(256);
     if(status == NULL)
       return -1;
-    sprintf(status, "Read %d bytes...", (int)total); 
+    sprintf(status, "Read %d bytes...", (int)input->total); 
     ui_functions_set_status(status);
     free(status);
 
-    if(left <= 0) {
-      total = 0;
+    if(amount_read <= 0) {
+      input->total = 0;
       ui_functions_set_status("Done reading page.");
-      return left;
+      return amount_read;
     }
-    index = 0;
+    input->index = 0;
+
+    /* Everything after this sees the document as ISO-8859-1. */
+    input->left = parse_charset_decode(&context->charset, input->buffer,
+				       kept + amount_read);
+
+    /* Look for images to fetch before parsing what was just read. */
+    parse_preload_scan(&context->preload, input->buffer, input->left);
   }
 
-  *c = buffer[index++];
-  left--;
+  *c = input->buffer[input->index++];
+  input->left--;
 
   return 1;
 }
 
+/**
+ * Take the bytes that are already in the buffer, up to but not including
+ * the next stop character. Unlike parse_get_byte(), this never reads from
+ * the stream, so there may be more of the same after what is returned.
+ *
+ * @param context The parser context, which holds the buffer.
+ * @param stop The character to stop at.
+ * @param text A pointer to where a pointer to the bytes is placed. They
+ * @param text are only valid until the next byte is read.
+ *
+ * @return the number of bytes taken, which is zero if the buffer is 
+ * @return empty or the next byte is the stop character.
+ */
+int parse_get_run(struct parse_context *context, char stop, char **text)
+{
+  struct parse_input *input = &context->input;
+  char *start, *found;
+  int length;
+
+  if(input->left == 0)
+    return 0;
+
+  start = input->buffer + input->index;
+  found = memchr(start, stop, input->left);
+  if(found)
+    length = found - start;
+  else
+    length = input->left;
+
+  input->index += length;
+  input->left -= length;
+  *text = start;
+
+  return length;
+}
+
 /**
  * Allocates a parse_param struct and initialises its name and value.
+ * The memory is taken from the parse arena, and is only valid until
+ * the tag it belongs to has been freed.
  *
+ * @param context The parser context, which holds the arena.
  * @param name The name of the parameter.
  * @param value The value of the parameter.
  *
  * @return an allocated parse_param struct or NULL if an error occurred.
  */
-struct parse_param *parse_alloc_param(char *name, char *value)
+struct parse_param *parse_alloc_param(struct parse_context *context,
+				      char *name, char *value)
 {
   struct parse_param *paramp;
   char *used_value;
-  int index;
+  size_t name_length;
 
-  paramp = (struct parse_param *)malloc(sizeof(struct parse_param));
+  paramp = (struct parse_param *)parse_arena_alloc(&context->arena,
+						  sizeof(struct parse_param));
   if(paramp == NULL)
     return NULL;
 
   /* Initialise name */
-  paramp->name = (char *)malloc(strlen(name) + 1);
-  if(paramp->name == NULL) {
-    free(paramp);
+  name_length = strlen(name);
+  paramp->name = (char *)parse_arena_alloc(&context->arena, name_length + 1);
+  if(paramp->name == NULL)
     return NULL;
-  }
 
   /* Copy parameter name and convert it to lower case. */
-  for(index = 0 ; index < strlen(name) ; index++)
-    paramp->name[index] = tolower(name[index]);
-  paramp->name[strlen(name)] = '\0';
+  parse_scan_lower(paramp->name, name, name_length);
+  paramp->name[name_length] = '\0';
 
   /* If this was a parameter without a value. In the style of XML (I think),
    * we then use the name of the parameter as the value as well.
@@ -130,12 +215,10 @@ struct parse_param *parse_alloc_param(char *name, char *value)
     used_value = value;
 
   /* Initiate the value. */
-  paramp->value = (char *)malloc(strlen(used_value) + 1);
-  if(paramp->value == NULL) {
-    free(paramp->name);
-    free(paramp);
+  paramp->value = (char *)parse_arena_alloc(&context->arena,
+					    strlen(used_value) + 1);
+  if(paramp->value == NULL)
     return NULL;
-  }
   strcpy(paramp->value, used_value);
 
   paramp->next = NULL;
@@ -143,28 +226,6 @@ struct parse_param *parse_alloc_param(char *name, char *value)
   return paramp;
 }
 
-/**
- * Free the complete memory of a parse_param struct.
- * It only frees the given object, and does not follow the
- * link to the next parameter.
- *
- * @param paramp A pointer to the parse_param object to be freed.
- *
- * @return a non-zero value if an error occurred.
- */
-int parse_free_param(struct parse_param *paramp)
-{
- if(paramp->name != NULL)
-    free(paramp->name);
-
- if(paramp->value != NULL)
-    free(paramp->value);
-
- free(paramp);
-
-  return 0;
-}
-
 /**
  * Look very carefully for a parameter that matches the given parameter
  * name, and come up with the suitable value for that parameter.
@@ -187,34 +248,66 @@ char *parse_get_param_value(struct parse_param *paramp, char *name)
   return NULL;
 }
 
+/**
+ * Look for several parameters at once, going through the list of
+ * parameters only one time. Like parse_get_param_value(), the first
+ * parameter with a name is the one that counts.
+ *
+ * @member paramp A pointer to the first parse_param object in a linked list.
+ * @member names The names of the parameters to look for, ending with NULL.
+ * @member values Where the value of each parameter is stored, or NULL if
+ * @member values that parameter name could not be found.
+ */
+void parse_get_param_values(struct parse_param *paramp, char **names,
+			    char **values)
+{
+  int i;
+
+  for(i = 0 ; names[i] ; i++)
+    values[i] = NULL;
+
+  while(paramp) {
+    for(i = 0 ; names[i] ; i++) {
+      if(values[i] == NULL && !strcmp(paramp->name, names[i])) {
+	values[i] = paramp->value;
+	break;
+      }
+    }
+
+    paramp = paramp->next;
+  }
+}
+
 /**
  * Allocates the a parse_tag struct and initialises its name and type. 
+ * The memory is taken from the parse arena.
  *
+ * @param context The parser context, which holds the arena.
  * @param name The name of the parameter.
  * @param type The type of the parameter.
  *
  * @return an allocated parse_tag struct or NULL if an error occurred.
  */
-struct parse_tag *parse_alloc_tag(const char *name, enum parse_tag_type type)
+struct parse_tag *parse_alloc_tag(struct parse_context *context,
+				  const char *name, enum parse_tag_type type)
 {
   struct parse_tag *tagp;
-  int index;
+  size_t name_length;
 
-  tagp = (struct parse_tag *)malloc(sizeof(struct parse_tag));
+  tagp = (struct parse_tag *)parse_arena_alloc(&context->arena,
+					      sizeof(struct parse_tag));
   if(tagp == NULL)
     return NULL;
 
   /* Initialise name */
-  tagp->name = (char *)malloc(strlen(name) + 1);
-  if(tagp->name == NULL) {
-    free(tagp);
+  name_length = strlen(name);
+  tagp->name = (char *)parse_arena_alloc(&context->arena, name_length + 1);
+  if(tagp->name == NULL)
     return NULL;
-  }
 
   /* Copy tag name and convert it to lower case. */
-  for(index = 0 ; index < strlen(name) ; index++)
-    tagp->name[index] = tolower(name[index]);
-  tagp->name[strlen(name)] = '\0';
+  parse_scan_lower(tagp->name, name, name_length);
+  tagp->name[name_length] = '\0';
 
   /* Initialise type */
   tagp->type = type;
@@ -226,34 +319,19 @@ struct parse_tag *parse_alloc_tag(const char *name, enum parse_tag_type type)
 }
 
 /**
- * Free the complete memory of a parse_tag struct. 
- * Automatically frees the parameter list as well.
+ * Free the complete memory of a parse_tag struct, including the 
+ * parameter list. Since all of it lives in the parse arena, this 
+ * rewinds the arena's scratch region, and thereby also releases any 
+ * words read since the tag started.
  *
+ * @param context The parser context, which holds the arena.
  * @param tagp A pointer to the parse_tag object to be freed.
  *
  * @return a non-zero value if an error occurred.
  */
-int parse_free_tag(struct parse_tag *tagp)
+int parse_free_tag(struct parse_context *context, struct parse_tag *tagp)
 {
-  struct parse_param *paramp;
-
-  if(tagp->name != NULL)
-    free(tagp->name);
-
-  /* Free all allocated parameters from the list. */
-  paramp = tagp->first;
-  while(paramp != NULL) {
-    struct parse_param *next_paramp = paramp->next;
-    int retval;
-
-    retval = parse_free_param(paramp);
-    if(retval != 0)
-      return retval;
-
-    paramp = next_paramp;
-  }
-
-  free(tagp);
+  parse_arena_reset(&context->arena);
 
   return 0;
 }
@@ -261,8 +339,10 @@ int parse_free_tag(struct parse_tag *tagp)
 /**
  * Read one word from the input stream, up to a delimiter character.
  * Delimiter characters are defined in the string given by the
- * parameter `delimeters'.
+ * parameter `delimeters'. The word is stored in the parse arena, and
+ * must not be freed by the caller.
  *
+ * @param context The parser context of the document.
  * @param fd File descriptor of input stream.
  * @param word Pointer to a string variable where the word is stored.
  * @param first Put this character in as first character in the word.
@@ -273,7 +353,8 @@ int parse_free_tag(struct parse_tag *tagp)
  * @return a positive number containing the delimiter character which 
  * @return ended the word.
  */
-int parse_read_word(int fd, char **word, int first, char *delimiters)
+int parse_read_word(struct parse_context *context, int fd,
+		    char **word, int first, char *delimiters)
 {
   char *tmp=NULL;
   unsigned char c;
@@ -281,22 +362,21 @@ int parse_read_word(int fd, char **word, int first, char *delimiters)
   int amount_read;
 
   while(!done) {
-    /* Current buffer has come to an end, please allocate a new. */
+    /* Current buffer has come to an end, please make it larger. As
+     * long as nothing else is allocated meanwhile, this grows in place.
+     */
     if(index == current) {
       char *newtmp;
-      current += 1024;
-      newtmp = realloc(tmp, current);
-      if(newtmp == NULL) {
-	if(tmp != NULL)
-	  free(tmp);
+      newtmp = parse_arena_resize(&context->arena, tmp, current, current + 256);
+      if(newtmp == NULL)
 	return -1;
-      }
+      current += 256;
       tmp = newtmp;
     }
  
     if(first == 0) {
       /* Read one character from the stream. */
-      amount_read = parse_get_byte(fd, &c);
+      amount_read = parse_get_byte(context, fd, &c);
     } else {
       /* Use the input character instead, and simulate a read. */
       c = first;
@@ -308,15 +388,13 @@ int parse_read_word(int fd, char **word, int first, char *delimiters)
       /* If amount_read is zero, the stream ended. Interpret this as 
        * an error, just as if read returned -1.
        */
-      free(tmp);
       return -1;
     } else if(strchr(delimiters, c) != NULL) {
       tmp[index++] = '\0';
-      *word = (char *)realloc(tmp, index);
-      if(*word == NULL) {
-	free(tmp);
+      /* Give back what was not used of the buffer. */
+      *word = parse_arena_resize(&context->arena, tmp, current, index);
+      if(*word == NULL)
 	return -1;
-      }
       done = 1;
     } else {
       /* A character which is not a delimiter was read. */
@@ -335,6 +413,7 @@ int parse_read_word(int fd, char **word, int first, char *delimiters)
  * back into the stream. This function instead returns the first
  * character which was not skipped.
  *
+ * @param context The parser context of the document.
  * @param fd File descriptor of input stream.
  * @param skippers A string of characters which are to be smoked.
  *
@@ -342,7 +421,7 @@ int parse_read_word(int fd, char **word, int first, char *delimiters)
  * @return a positive number containing the first character which 
  * @return was not a skipper.
  */
-int parse_skip_leading(int fd, char *skippers)
+int parse_skip_leading(struct parse_context *context, int fd, char *skippers)
 {
   unsigned char c;
   int done=0;
@@ -350,7 +429,7 @@ int parse_skip_leading(int fd, char *skippers)
 
   while(!done) {
     /* Read one character from the stream. */
-    amount_read = parse_get_byte(fd, &c);
+    amount_read = parse_get_byte(context, fd, &c);
 
     if(amount_read == -1) {
       /* An error occurred while reading. */
@@ -371,17 +450,36 @@ int parse_skip_leading(int fd, char *skippers)
  * This marks the end of a comment tag. Feature leap: It now also
  * works for "->" only, due to major fuck ups in Netscape's stupid
  * parser. Argh. *calming down* *deep breath*
+ * If the text of the comment is wanted, it is kept in the parse arena.
  *
+ * @param context The parser context of the document.
  * @param fd File descriptor of input stream.
+ * @param comment Where the nul terminated text of the comment is placed,
+ * @param comment or NULL if it is not wanted.
+ *
+ * @return non-zero value if an error occurred.
  */
-void parse_skip_comment(int fd)
+int parse_skip_comment(struct parse_context *context, int fd, char **comment)
 {
-  int nr_of_hyphens;
+  int nr_of_hyphens, index, size;
   unsigned char c;
+  char *text, *tmp;
 
+  text = NULL;
+  index = 0;
+  size = 0;
   nr_of_hyphens = 0;
   while(1) {
-    if(parse_get_byte(fd, &c) <= 0)
+    /* Make room for one more character, and the ending nul character. */
+    if(comment != NULL && index + 1 >= size) {
+      tmp = parse_arena_resize(&context->arena, text, size, size + 256);
+      if(tmp == NULL)
+	return 1;
+      text = tmp;
+      size += 256;
+    }
+
+    if(parse_get_byte(context, fd, &c) <= 0)
       break;
 
     if(nr_of_hyphens < 1) {
@@ -395,43 +493,78 @@ void parse_skip_comment(int fd)
       else if(c != '-')
 	nr_of_hyphens = 0;      
     }
+
+    if(comment != NULL)
+      text[index++] = c;
   }
+
+  if(comment != NULL) {
+    /* Neither the hyphen starting the text, nor those ending it, are
+     * part of the comment.
+     */
+    while(index > 0 && text[index - 1] == '-')
+      index--;
+    text[index] = '\0';
+    if(text[0] == '-')
+      text++;
+    *comment = text;
+  }
+
+  return 0;
 }
 
 /**
  * Extract the tag and its parameters from the input stream.
+ * The tag is allocated in the parse arena, and stays valid until
+ * it is freed or the next tag is read.
  *
+ * @param context The parser context of the document.
  * @param fd File descriptor of input stream.
  *
  * @return pointer to a parse_tag struct where the result is stored
  * @return or NULL if no tag could be retrieved.
  */
-struct parse_tag *parse_get_tag(int fd)
+struct parse_tag *parse_get_tag(struct parse_context *context, int fd)
 {
   struct parse_tag *tagp;
   char *name, ch;
   int c, ending;
   enum parse_tag_type type;
 
-  c = parse_skip_leading(fd, " \t\n\r");
+  /* Nothing from the previous tag is needed any more. */
+  parse_arena_reset(&context->arena);
+
+  c = parse_skip_leading(context, fd, " \t\n\r");
   if(c <= 0) {
     return NULL;
   }
 
   if(c == '/') { /* End tag. */
-    ending = parse_read_word(fd, &name, 0, "> \t\n\r");
+    ending = parse_read_word(context, fd, &name, 0, "> \t\n\r");
     type = PARSE_TAG_END;
   } else if(c == '!') { /* Commentary tag. */
-    if(parse_get_byte(fd, &ch) <= 0)
+    if(parse_get_byte(context, fd, &ch) <= 0)
       return NULL;
-    if(ch == '-')
-      parse_skip_comment(fd);
-    else
-      parse_read_word(fd, &name, c, ">");
-      
-    return NULL;
+    if(ch != '-') {
+      parse_read_word(context, fd, &name, c, ">");
+      return NULL;
+    }
+
+    /* The comment is only kept if someone wants to see it. */
+    if(context->events->comment == NULL) {
+      parse_skip_comment(context, fd, NULL);
+      return NULL;
+    }
+
+    if(parse_skip_comment(context, fd, &name) != 0)
+      return NULL;
+    tagp = parse_alloc_tag(context, "", PARSE_TAG_COMMENT);
+    if(tagp != NULL)
+      tagp->name = name;
+
+    return tagp;
   } else { /* Start tag. */
-    ending = parse_read_word(fd, &name, c, "> \t\n\r");
+    ending = parse_read_word(context, fd, &name, c, "> \t\n\r");
     type = PARSE_TAG_START;
   }
   /* If we bumped into the end of the stream, we cannot consider this 
@@ -441,8 +574,7 @@ struct parse_tag *parse_get_tag(int fd)
     return NULL;
   }
 
-  tagp = parse_alloc_tag(name, type);
-  free(name);
+  tagp = parse_alloc_tag(context, name, type);
   if(tagp == NULL) {
     return NULL;
   }
@@ -452,9 +584,9 @@ struct parse_tag *parse_get_tag(int fd)
     return tagp;
 
   /* Here we know a space character is the last one read. */
-  ending = parse_skip_leading(fd, " \t\n\r");
+  ending = parse_skip_leading(context, fd, " \t\n\r");
   if(ending <= 0) {
-    parse_free_tag(tagp);
+    parse_free_tag(context, tagp);
     return NULL;
   }
 
@@ -465,36 +597,33 @@ struct parse_tag *parse_get_tag(int fd)
     tmpparamp = NULL;
 
     /* Here we have the start of the parameters to the tag. */
-    ending = parse_read_word(fd, &param_name, ending, "=> \t\n\r");
+    ending = parse_read_word(context, fd, &param_name, ending, "=> \t\n\r");
     if(ending <= 0) {
-      parse_free_tag(tagp);
+      parse_free_tag(context, tagp);
       return NULL;
     }
 
     if(ending != '>' && ending != '=') {
-      ending = parse_skip_leading(fd, " \t\n\r");
+      ending = parse_skip_leading(context, fd, " \t\n\r");
       if(ending <= 0) {
-	free(param_name);
-	parse_free_tag(tagp);
+	parse_free_tag(context, tagp);
 	return NULL;
       }
     }
 
     if(ending != '=') {
       /* This parameter did not have a value. */
-      tmpparamp = parse_alloc_param(param_name, NULL);
-      free(param_name);
+      tmpparamp = parse_alloc_param(context, param_name, NULL);
       if(tmpparamp == NULL) {
-	parse_free_tag(tagp);
+	parse_free_tag(context, tagp);
 	return NULL;
       }
 
     } else if(ending == '=') {
       /* There is definitely a value to this parameter, or should be. */
-      ending = parse_skip_leading(fd, " \t\n\r");
+      ending = parse_skip_leading(context, fd, " \t\n\r");
       if(ending <= 0) {
-	free(param_name);
-	parse_free_tag(tagp);
+	parse_free_tag(context, tagp);
 	return NULL;
       }
 
@@ -502,34 +631,29 @@ struct parse_tag *parse_get_tag(int fd)
        * only be terminated by a second quote.
        */ 
       if(ending == '"') {
-	ending = parse_read_word(fd, &param_value, 0, "\"");
+	ending = parse_read_word(context, fd, &param_value, 0, "\"");
       } else if(ending == '\'') {
-	ending = parse_read_word(fd, &param_value, 0, "'");
+	ending = parse_read_word(context, fd, &param_value, 0, "'");
       } else {
-	ending = parse_read_word(fd, &param_value, ending, "> \t\n\r");
+	ending = parse_read_word(context, fd, &param_value, ending, "> \t\n\r");
       }
       if(ending <= 0) {
-	free(param_name);
-	parse_free_tag(tagp);
+	parse_free_tag(context, tagp);
 	return NULL;
       }
 
       if(ending != '>') {
-	ending = parse_skip_leading(fd, " \t\n\r");
+	ending = parse_skip_leading(context, fd, " \t\n\r");
 	if(ending <= 0) {
-	  free(param_name);
-	  free(param_value);
-	  parse_free_tag(tagp);
+	  parse_free_tag(context, tagp);
 	  return NULL;
 	}
       }
       
       /* Allocate the parameter struct. */
-      tmpparamp = parse_alloc_param(param_name, param_value);
-      free(param_name);
-      free(param_value);
+      tmpparamp = parse_alloc_param(context, param_name, param_value);
       if(tmpparamp == NULL) {
-	parse_free_tag(tagp);
+	parse_free_tag(context, tagp);
 	return NULL;
       }
     }
@@ -578,6 +702,8 @@ void debug_dump_tag(struct parse_tag *tagp)
     fprintf(stderr, "Start\n");
   else if(tagp->type == PARSE_TAG_END)
     fprintf(stderr, "End\n");
+  else if(tagp->type == PARSE_TAG_COMMENT)
+    fprintf(stderr, "Comment\n");
   else
     fprintf(stderr, "Unknown (This should not happen!)\n");
 
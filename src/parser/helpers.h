@@ -30,30 +30,47 @@
 #include "tags.h"
 #include "layout.h"
 
+struct parse_context;
+
 /* Parse helpers */
-extern int parse_get_byte(int fd, char *c);
-extern struct parse_param *parse_alloc_param(char *name, char *value);
-extern int parse_free_param(struct parse_param *paramp);
+extern int parse_get_byte(struct parse_context *context, int fd, char *c);
+extern int parse_get_run(struct parse_context *context, char stop, 
+			 char **text);
+extern struct parse_param *parse_alloc_param(struct parse_context *context,
+					     char *name, char *value);
 extern char *parse_get_param_value(struct parse_param *paramp, char *name);
-extern struct parse_tag *parse_alloc_tag(const char *name, enum parse_tag_type type);
-extern int parse_free_tag(struct parse_tag *tagp);
-extern int parse_read_word(int fd, char **word, int first, char *delimiters);
-extern int parse_skip_leading(int fd, char *skippers);
-extern struct parse_tag *parse_get_tag(int fd);
+extern void parse_get_param_values(struct parse_param *paramp, char **names,
+				   char **values);
+extern struct parse_tag *parse_alloc_tag(struct parse_context *context,
+					 const char *name,
+					 enum parse_tag_type type);
+extern int parse_free_tag(struct parse_context *context,
+			  struct parse_tag *tagp);
+extern int parse_read_word(struct parse_context *context, int fd,
+			   char **word, int first, char *delimiters);
+extern int parse_skip_leading(struct parse_context *context, int fd,
+			      char *skippers);
+extern struct parse_tag *parse_get_tag(struct parse_context *context, int fd);
 extern uint32_t parse_convert_colour(char *colour);
 
 /* String helpers */
-extern int parse_string_store_character(char c);
-extern void parse_string_set_preformatted(int value);
-extern int parse_string_get_stored(char *buf, int size);
-extern int parse_string_set_stored(char *buf);
-extern int parse_string_get_length(void);
-extern void parse_string_discard(void);
-extern struct layout_part *parse_string_store_current(void);
-extern int parse_string_store_title(void);
+extern int parse_string_store_character(struct parse_context *context,
+					char c);
+extern int parse_string_store_text(struct parse_context *context,
+				   const char *text, int length);
+extern void parse_string_set_preformatted(struct parse_context *context,
+					  int value);
+extern int parse_string_get_stored(struct parse_context *context,
+				   char *buf, int size);
+extern int parse_string_set_stored(struct parse_context *context, char *buf);
+extern int parse_string_get_length(struct parse_context *context);
+extern void parse_string_discard(struct parse_context *context);
+extern struct layout_part *
+parse_string_store_current(struct parse_context *context);
+extern int parse_string_store_title(struct parse_context *context);
 
 /* Debug helpers */
-extern void debug_dump_string(void);
+extern void debug_dump_string(struct parse_context *context);
 extern void debug_dump_param(struct parse_param *paramp);
 extern void debug_dump_tag(struct parse_tag *tagp);
 
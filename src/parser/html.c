@@ -29,13 +29,16 @@
 #endif /* HAVE_CONFIG_H */
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "threads.h"
 #include "states.h"
 #include "tags.h"
+#include "context.h"
 #include "helpers.h"
 #include "layout.h"
+#include "parse.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
 #ifdef HAVE_DMALLOC_H
@@ -43,52 +46,113 @@
 #endif /* HAVE_DMALLOC_H */
 
 /**
- * Treat the incoming stream as HTML with equal rights.
+ * Give a tag to the event function for its type.
+ *
+ * @param events The event functions of the document.
+ * @param tagp The tag to give away.
+ * @param data The data given to the event functions.
+ *
+ * @return the return value of the event function, or zero if there is
+ * @return no such function.
+ */
+static int parse_html_tag_event(struct parse_events *events,
+				struct parse_tag *tagp, void *data)
+{
+  switch(tagp->type) {
+  case PARSE_TAG_START:
+    if(events->start_tag != NULL)
+      return events->start_tag(tagp, data);
+    break;
+
+  case PARSE_TAG_END:
+    if(events->end_tag != NULL)
+      return events->end_tag(tagp, data);
+    break;
+
+  case PARSE_TAG_COMMENT:
+    if(events->comment != NULL)
+      return events->comment(tagp->name, strlen(tagp->name), data);
+    break;
+  }
+
+  return 0;
+}
+
+/**
+ * Treat the incoming stream as HTML with equal rights. Everything found
+ * in it is given to the event functions of the context, which normally
+ * build the layout parts of the page.
  * 
+ * @param context The parser context of the document.
  * @param fd File descriptor of input stream.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_html(int fd)
+int parse_html(struct parse_context *context, int fd)
 {
-  char c;
-  int ret, amount_read;
+  struct parse_events *events = context->events;
+  void *data = context->events_data;
+  char c, *text;
+  int ret, amount_read, length, stop;
   struct parse_tag *tmptagp;
 
   ret = 0;
+  thread_budget_init(&context->budget);
 
   /* Initialize the state struct used throughout the whole parsing. */
-  parse_state_delete_all();
-  parse_state_init();
+  parse_state_delete_all(context);
+  parse_state_init(context);
+
+  /* Tags are read into the arena, which is kept for the whole document. */
+  if(parse_arena_init(&context->arena) != 0)
+    return -1;
 
-  while(1) {
-    amount_read = parse_get_byte(fd, &c);
+  stop = 0;
+  while(!stop) {
+    /* Give away the text up to the next tag in one go, as far as it has
+     * been read so far.
+     */
+    length = parse_get_run(context, '<', &text);
+    if(length > 0 && events->text != NULL)
+      stop = events->text(text, length, data);
+    if(stop)
+      break;
+
+    amount_read = parse_get_byte(context, fd, &c);
     if(amount_read <= 0) { /* Either error or end of stream. */
       ret = amount_read;
       break;
     }
     
     if(c == '<') { /* There is a tag approaching. */
-      tmptagp = parse_get_tag(fd);
+      tmptagp = parse_get_tag(context, fd);
       if(tmptagp != NULL) {
-	parse_call_tag_binding(tmptagp);
+	stop = parse_html_tag_event(events, tmptagp, data);
       
 	/* Delete the tag when we are done with it. */
-	parse_free_tag(tmptagp);
+	parse_free_tag(context, tmptagp);
 
-	/* Yield after each tag. Maybe that's overkill? */
-	thread_yield();
+	/* Let the caller see what has been parsed so far, if it is time. */
+	parse_context_checkpoint(context);
+
+	/* Let other threads run, if enough tags have been parsed. */
+	thread_budget_spend(&context->budget, 1);
       }
-    } else { /* Normal, simple, boring character */
-      parse_string_store_character(c);
+    } else if(events->text != NULL) { /* Normal, simple, boring character */
+      stop = events->text(&c, 1, data);
     }
   }
 
   /* The file is at an end, please place the last read string in the list. */
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   /* Delete the states when we are done with them. */
-  parse_state_delete_all();
+  parse_state_delete_all(context);
+
+  /* The counters of the arena are kept, and can still be read with
+   * parse_context_get_statistics().
+   */
+  parse_arena_delete(&context->arena);
 
   return ret;
 }
@@ -33,6 +33,7 @@
 #include <unistd.h>
 
 #include "states.h"
+#include "context.h"
 #include "image.h"
 #include "layout.h"
 #include "ui.h"
@@ -46,11 +47,12 @@
  * Take the input stream as an image and create a layout part containing
  * an image, as if it was taken from an img-tag in an HTML page.
  * 
+ * @param context The parser context of the document.
  * @param fd File descriptor of input stream.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_image(int fd)
+int parse_image(struct parse_context *context, int fd)
 {
   struct layout_part *partp;
   struct image_data *picture;
@@ -59,10 +61,10 @@ int parse_image(int fd)
     return 1;
 
   /* Initialize the state struct used throughout the whole parsing. */
-  parse_state_delete_all();
-  parse_state_init();
+  parse_state_delete_all(context);
+  parse_state_init(context);
 
-  partp = layout_init_part(LAYOUT_PART_GRAPHICS);
+  partp = layout_init_part(context->page, LAYOUT_PART_GRAPHICS);
   if(partp == NULL) {
     return 1;
   }
@@ -84,10 +86,10 @@ int parse_image(int fd)
   partp->geometry.width = picture->width;
   partp->geometry.height = picture->height;
   free(picture);
-  layout_add_part(partp);
+  parse_state_add_part(context, partp);
 
   /* Delete the states when we are done with them. */
-  parse_state_delete_all();
+  parse_state_delete_all(context);
 
   return 0;
 }
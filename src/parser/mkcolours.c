@@ -0,0 +1,281 @@
+/**
+ * Generates the table of named colours for colour.c, from the list of
+ * names and values in colours.txt. The names are placed in the table
+ * with a minimal perfect hash, and the seeds that the hash needs are
+ * written along with the table. This is not a part of Zen itself, but
+ * is run with `make colours' whenever colours.txt has been changed.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The most names that can be read. */
+#define MKCOLOURS_MAX_COLOURS  1024
+
+/* The number of buckets the names are spread over by the first hash. */
+#define MKCOLOURS_BUCKETS  64
+
+/* The highest seed that is tried, which must fit in an unsigned char. */
+#define MKCOLOURS_MAX_SEED  255
+
+/**
+ * A named colour, as read from the list.
+ *
+ * @member name The name of the colour, in lower case.
+ * @member colour The colour value.
+ * @member bucket The bucket the first hash puts the name in.
+ */
+struct mkcolours_colour {
+  char name[64];
+  unsigned long colour;
+  int bucket;
+};
+
+static struct mkcolours_colour colours[MKCOLOURS_MAX_COLOURS];
+static int number_of_colours;
+
+/* The colour placed at each index of the table, or -1. */
+static int table[MKCOLOURS_MAX_COLOURS];
+
+/* The seed chosen for each bucket, and the number of names in it. */
+static int seeds[MKCOLOURS_BUCKETS];
+static int bucket_sizes[MKCOLOURS_BUCKETS];
+
+/**
+ * Calculate the hash value of a colour name. This must be exactly the
+ * same as parse_colour_hash() in colour.c, apart from the case of the
+ * name, which is already lower case here.
+ *
+ * @param name The name of the colour.
+ * @param seed The seed to hash with.
+ *
+ * @return the hash value.
+ */
+static unsigned long mkcolours_hash(const char *name, unsigned long seed)
+{
+  unsigned long hash;
+
+  hash = (2166136261UL ^ seed) & 0xffffffffUL;
+  for( ; *name ; name++)
+    hash = ((hash ^ (unsigned char)*name) * 16777619UL) & 0xffffffffUL;
+
+  return hash;
+}
+
+/**
+ * Read the names and values of the colours. Each line holds a name and
+ * a value as rrggbb, separated by white space. Empty lines, and lines
+ * starting with a hash mark, are skipped.
+ *
+ * @param file The file to read from.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int mkcolours_read(FILE *file)
+{
+  char line[256], name[64];
+  unsigned long colour;
+  int i, lineno;
+
+  lineno = 0;
+  while(fgets(line, sizeof(line), file) != NULL) {
+    lineno++;
+    if(line[0] == '#' || line[0] == '\n')
+      continue;
+
+    if(sscanf(line, "%63s %lx", name, &colour) != 2) {
+      fprintf(stderr, "mkcolours: line %d is not a name and a colour\n",
+	      lineno);
+      return 1;
+    }
+
+    if(number_of_colours == MKCOLOURS_MAX_COLOURS) {
+      fprintf(stderr, "mkcolours: too many colours\n");
+      return 1;
+    }
+
+    for(i = 0 ; name[i] ; i++)
+      if(name[i] >= 'A' && name[i] <= 'Z')
+	name[i] = name[i] - 'A' + 'a';
+
+    for(i = 0 ; i < number_of_colours ; i++) {
+      if(!strcmp(colours[i].name, name)) {
+	fprintf(stderr, "mkcolours: %s is given twice\n", name);
+	return 1;
+      }
+    }
+
+    strcpy(colours[number_of_colours].name, name);
+    colours[number_of_colours].colour = colour & 0xffffff;
+    number_of_colours++;
+  }
+
+  return 0;
+}
+
+/**
+ * Find a seed for a bucket, which places all its names in free places
+ * in the table, and place them there.
+ *
+ * @param bucket The bucket to place.
+ *
+ * @return non-zero value if no seed could be found.
+ */
+static int mkcolours_place_bucket(int bucket)
+{
+  int places[MKCOLOURS_MAX_COLOURS];
+  int seed, count, i, j, index;
+
+  for(seed = 0 ; seed <= MKCOLOURS_MAX_SEED ; seed++) {
+    count = 0;
+    for(i = 0 ; i < number_of_colours ; i++) {
+      if(colours[i].bucket != bucket)
+	continue;
+
+      index = mkcolours_hash(colours[i].name, seed) % number_of_colours;
+      if(table[index] != -1)
+	break;
+      for(j = 0 ; j < count ; j++)
+	if(places[j] == index)
+	  break;
+      if(j < count)
+	break;
+      places[count++] = index;
+    }
+
+    /* All names of the bucket got a place of their own. */
+    if(i == number_of_colours) {
+      count = 0;
+      for(i = 0 ; i < number_of_colours ; i++)
+	if(colours[i].bucket == bucket)
+	  table[places[count++]] = i;
+      seeds[bucket] = seed;
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/**
+ * Place all names in the table. The buckets are placed from the one
+ * with the most names, which are the hardest to find room for, to the
+ * ones with the fewest. Each gets the lowest seed that works.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int mkcolours_place(void)
+{
+  int bucket, largest, i;
+
+  for(i = 0 ; i < number_of_colours ; i++) {
+    table[i] = -1;
+    colours[i].bucket = mkcolours_hash(colours[i].name, 0) %
+      MKCOLOURS_BUCKETS;
+    bucket_sizes[colours[i].bucket]++;
+  }
+
+  for(;;) {
+    largest = -1;
+    for(bucket = 0 ; bucket < MKCOLOURS_BUCKETS ; bucket++)
+      if(bucket_sizes[bucket] > 0 &&
+	 (largest == -1 || bucket_sizes[bucket] > bucket_sizes[largest]))
+	largest = bucket;
+    if(largest == -1)
+      break;
+
+    if(mkcolours_place_bucket(largest) != 0) {
+      fprintf(stderr, "mkcolours: no seed places bucket %d, "
+	      "try more buckets\n", largest);
+      return 1;
+    }
+    bucket_sizes[largest] = 0;
+  }
+
+  return 0;
+}
+
+/**
+ * Write the seeds and the table, as C source.
+ */
+static void mkcolours_write(void)
+{
+  int i;
+
+  printf("/* Do not edit.  Generated by mkcolours from colours.txt. */\n"
+	 "\n"
+	 "/* The number of named colours, and the number of buckets they "
+	 "are\n"
+	 " * spread over by the first hash.\n"
+	 " */\n"
+	 "#define PARSE_COLOURS  %d\n"
+	 "#define PARSE_COLOUR_BUCKETS  %d\n"
+	 "\n"
+	 "static const unsigned char "
+	 "parse_colour_seeds[PARSE_COLOUR_BUCKETS] = {\n",
+	 number_of_colours, MKCOLOURS_BUCKETS);
+
+  for(i = 0 ; i < MKCOLOURS_BUCKETS ; i++) {
+    if(i % 12 == 0)
+      printf(" ");
+    printf(" %3d%s", seeds[i], i == MKCOLOURS_BUCKETS - 1 ? "" : ",");
+    if(i % 12 == 11 || i == MKCOLOURS_BUCKETS - 1)
+      printf("\n");
+  }
+
+  printf("};\n"
+	 "\n"
+	 "static const struct parse_colour parse_colours[PARSE_COLOURS] = "
+	 "{\n");
+
+  for(i = 0 ; i < number_of_colours ; i++)
+    printf("  { \"%s\", 0x%06lx }%s\n", colours[table[i]].name,
+	   colours[table[i]].colour, i == number_of_colours - 1 ? "" : ",");
+
+  printf("};\n");
+}
+
+/**
+ * Read the colours from the standard input, and write the table to the
+ * standard output.
+ *
+ * @return the program exit code, 0 if it exited normally.
+ */
+int main(void)
+{
+  if(mkcolours_read(stdin) != 0)
+    return 1;
+
+  if(number_of_colours == 0) {
+    fprintf(stderr, "mkcolours: no colours\n");
+    return 1;
+  }
+
+  if(mkcolours_place() != 0)
+    return 1;
+
+  mkcolours_write();
+
+  return 0;
+}
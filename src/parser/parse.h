@@ -25,9 +25,108 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include "layout.h"
+
+/* The parser context is only known to the parser itself. */
+struct parse_context;
+struct parse_tag;
+
+/**
+ * A function called now and then while a document is parsed, so that
+ * what has been parsed so far can be layouted and shown.
+ *
+ * @param open_part The first part under the base of the context that new
+ * @param open_part parts may still be added under, or NULL if none.
+ * @param data The data given to parse_context_set_checkpoint().
+ *
+ * @return non-zero value if an error occurred.
+ */
+typedef int parse_checkpoint_function(struct layout_part *open_part, 
+				      void *data);
+
+/**
+ * A function called for every resource the preload scanner finds in a
+ * document, as soon as the data has been read and before it is parsed.
+ *
+ * @param url The URL of the resource, just as written in the document.
+ * @param base_url The base URL given in the document, or NULL if none
+ * @param base_url has been given so far.
+ * @param data The data given to parse_context_set_preload().
+ *
+ * @return non-zero value if an error occurred.
+ */
+typedef int parse_preload_function(char *url, char *base_url, void *data);
+
+/**
+ * The functions parse_html() calls for what it finds in the document, in
+ * the order it is found. Normally these build the layout parts of the
+ * page, but someone who only wants the tags or the text can use functions
+ * of their own, and no layout work is done at all. Any of the functions
+ * may be NULL, and that kind of event is then ignored. Each function is
+ * given the data given to parse_context_set_events(), and returns a
+ * non-zero value to stop parsing the rest of the document.
+ *
+ * @member start_tag Called for each start tag. The tag, its parameters
+ * @member start_tag and their values are only valid during the call.
+ * @member end_tag Called for each end tag.
+ * @member text Called for the text between the tags, just as it is
+ * @member text written in the document. The text of one run may be given
+ * @member text in several pieces, and is not nul terminated.
+ * @member comment Called for each comment, with the nul terminated text
+ * @member comment between "<!--" and "-->".
+ */
+struct parse_events {
+  int (*start_tag)(struct parse_tag *tagp, void *data);
+  int (*end_tag)(struct parse_tag *tagp, void *data);
+  int (*text)(char *text, int length, void *data);
+  int (*comment)(char *text, int length, void *data);
+};
+
+/**
+ * Counters describing how a document was parsed.
+ *
+ * @member allocations The number of allocations served by the arena that
+ * @member allocations tags, parameters and words are read into. Each of
+ * @member allocations these would otherwise be a call to malloc().
+ * @member resizes The number of times something in the arena was resized.
+ * @member resets The number of times the arena was rewound after a tag.
+ * @member blocks The number of blocks the arena took from malloc().
+ * @member peak_bytes The largest number of bytes in use in the arena.
+ * @member yields The number of times other threads were let to run. This
+ * @member yields is only done with GNU pth, and is otherwise always zero.
+ */
+struct parse_statistics {
+  unsigned long allocations;
+  unsigned long resizes;
+  unsigned long resets;
+  unsigned long blocks;
+  size_t peak_bytes;
+  unsigned long yields;
+};
+
+/* Prototypes of parser context functions. */
+extern struct parse_context *parse_context_new(struct layout_part *page);
+extern void parse_context_free(struct parse_context *context);
+extern void parse_context_set_checkpoint(struct parse_context *context,
+					 struct layout_part *base,
+					 parse_checkpoint_function *function,
+					 void *data);
+extern void parse_context_set_preload(struct parse_context *context,
+				      parse_preload_function *function,
+				      void *data);
+extern int parse_context_set_charset(struct parse_context *context,
+				     char *name);
+extern void parse_context_set_events(struct parse_context *context,
+				     struct parse_events *events,
+				     void *data);
+extern void parse_context_set_input(struct parse_context *context,
+				    char *text, size_t length);
+extern void parse_context_get_statistics(struct parse_context *context,
+					 struct parse_statistics *stats);
+
 /* Prototypes of parsing functions. */
-extern int parse_html(int fd);
-extern int parse_text(int fd);
-extern int parse_image(int fd);
+extern int parse_html(struct parse_context *context, int fd);
+extern int parse_text(struct parse_context *context, int fd);
+extern int parse_image(struct parse_context *context, int fd);
 
 #endif /* _PARSER_PARSE_H_ */
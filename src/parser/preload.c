@@ -0,0 +1,307 @@
+/**
+ * The preload scanner. Every buffer read from the stream is quickly
+ * scanned for images, before the parser itself gets to it, so that the
+ * images can be fetched while the rest of the document is still being
+ * read and parsed. The scanner only understands enough of HTML to find
+ * the tags it wants, and does not care about getting anything else right.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "preload.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/**
+ * A tag and parameter pair that the scanner looks for.
+ *
+ * @member tag The name of the tag.
+ * @member param The name of the parameter holding the URL.
+ * @member is_base Non-zero value if the URL is the base for the following
+ * @member is_base ones, rather than a resource to preload.
+ */
+struct parse_preload_tag {
+  char *tag;
+  char *param;
+  int is_base;
+};
+
+/* The tags the scanner looks for. When the body tag supports background
+ * images, its background parameter should be added here.
+ */
+static struct parse_preload_tag parse_preload_tags[] = {
+  { "img", "src", 0 },
+  { "base", "href", 1 },
+  { NULL, NULL, 0 }
+};
+
+/**
+ * Look for the current name among the wanted tags.
+ *
+ * @param preload The preload scanner.
+ *
+ * @return the index of the tag, or a negative value if it is not wanted.
+ */
+static int parse_preload_find_tag(struct parse_preload *preload)
+{
+  int index;
+
+  if(preload->name_length >= PARSE_PRELOAD_NAME_SIZE)
+    return -1;
+  preload->name[preload->name_length] = '\0';
+
+  for(index = 0 ; parse_preload_tags[index].tag ; index++)
+    if(!strcmp(preload->name, parse_preload_tags[index].tag))
+      return index;
+
+  return -1;
+}
+
+/**
+ * Check if the current name is the parameter wanted in the current tag.
+ *
+ * @param preload The preload scanner.
+ *
+ * @return non-zero value if it is wanted.
+ */
+static int parse_preload_wanted_param(struct parse_preload *preload)
+{
+  if(preload->tag < 0 || preload->name_length >= PARSE_PRELOAD_NAME_SIZE)
+    return 0;
+  preload->name[preload->name_length] = '\0';
+
+  return !strcmp(preload->name, parse_preload_tags[preload->tag].param);
+}
+
+/**
+ * Add a character to the current name. Names that are too long are
+ * remembered as such, since they cannot be anything we want.
+ *
+ * @param preload The preload scanner.
+ * @param c The character to add.
+ */
+static inline void parse_preload_add_name(struct parse_preload *preload,
+					  char c)
+{
+  if(preload->name_length < PARSE_PRELOAD_NAME_SIZE)
+    preload->name[preload->name_length++] = tolower((int)c);
+}
+
+/**
+ * Called when a value is complete. If it was wanted, the URL is either
+ * given to the preload function or stored as the new base URL.
+ *
+ * @param preload The preload scanner.
+ */
+static void parse_preload_end_value(struct parse_preload *preload)
+{
+  char *base_url;
+
+  if(!preload->wanted || preload->value_length == 0 ||
+     preload->value_length >= PARSE_PRELOAD_VALUE_SIZE)
+    return;
+  preload->value[preload->value_length] = '\0';
+  preload->wanted = 0;
+
+  if(parse_preload_tags[preload->tag].is_base) {
+    base_url = (char *)malloc(preload->value_length + 1);
+    if(base_url == NULL)
+      return;
+    strcpy(base_url, preload->value);
+    if(preload->base_url)
+      free(preload->base_url);
+    preload->base_url = base_url;
+  } else {
+    preload->function(preload->value, preload->base_url, preload->data);
+    preload->count++;
+  }
+}
+
+/**
+ * Scan a buffer of the document for resources to preload. The buffer
+ * does not have to end at a tag, the scanner continues where it was
+ * when the next buffer is given to it.
+ *
+ * @param preload The preload scanner.
+ * @param buffer The data read from the stream.
+ * @param length The number of bytes in the buffer.
+ */
+void parse_preload_scan(struct parse_preload *preload,
+			char *buffer, int length)
+{
+  char c;
+  int index;
+
+  if(preload->function == NULL)
+    return;
+
+  for(index = 0 ; index < length ; index++) {
+    c = buffer[index];
+
+    switch(preload->state) {
+    case PARSE_PRELOAD_TEXT:
+      if(c == '<')
+	preload->state = PARSE_PRELOAD_TAG_START;
+      break;
+
+    case PARSE_PRELOAD_TAG_START:
+      if(isalpha((int)c)) {
+	preload->name_length = 0;
+	parse_preload_add_name(preload, c);
+	preload->state = PARSE_PRELOAD_TAG_NAME;
+      } else if(c == '!') {
+	preload->dashes = 0;
+	preload->state = PARSE_PRELOAD_MARKUP;
+      } else if(c == '<') {
+	/* Still at the start of a tag. */
+      } else if(c == '>') {
+	preload->state = PARSE_PRELOAD_TEXT;
+      } else {
+	preload->state = PARSE_PRELOAD_SKIP_TAG;
+      }
+      break;
+
+    case PARSE_PRELOAD_TAG_NAME:
+      if(isalnum((int)c)) {
+	parse_preload_add_name(preload, c);
+	break;
+      }
+      preload->tag = parse_preload_find_tag(preload);
+      preload->wanted = 0;
+      if(c == '>')
+	preload->state = PARSE_PRELOAD_TEXT;
+      else if(preload->tag < 0)
+	preload->state = PARSE_PRELOAD_SKIP_TAG;
+      else
+	preload->state = PARSE_PRELOAD_PARAMS;
+      break;
+
+    case PARSE_PRELOAD_MARKUP:
+      /* Either a comment, or something like a document type. */
+      if(c == '-') {
+	if(++preload->dashes == 2) {
+	  preload->dashes = 0;
+	  preload->state = PARSE_PRELOAD_COMMENT;
+	}
+      } else if(c == '>') {
+	preload->state = PARSE_PRELOAD_TEXT;
+      } else {
+	preload->state = PARSE_PRELOAD_SKIP_TAG;
+      }
+      break;
+
+    case PARSE_PRELOAD_COMMENT:
+      if(c == '-')
+	preload->dashes++;
+      else if(c == '>' && preload->dashes >= 2)
+	preload->state = PARSE_PRELOAD_TEXT;
+      else
+	preload->dashes = 0;
+      break;
+
+    case PARSE_PRELOAD_SKIP_TAG:
+      if(c == '>')
+	preload->state = PARSE_PRELOAD_TEXT;
+      break;
+
+    case PARSE_PRELOAD_PARAMS:
+      if(c == '>') {
+	preload->state = PARSE_PRELOAD_TEXT;
+      } else if(!isspace((int)c) && c != '/') {
+	preload->name_length = 0;
+	parse_preload_add_name(preload, c);
+	preload->state = PARSE_PRELOAD_PARAM_NAME;
+      }
+      break;
+
+    case PARSE_PRELOAD_PARAM_NAME:
+    case PARSE_PRELOAD_AFTER_NAME:
+      if(c == '=') {
+	preload->wanted = parse_preload_wanted_param(preload);
+	preload->state = PARSE_PRELOAD_BEFORE_VALUE;
+      } else if(c == '>') {
+	preload->state = PARSE_PRELOAD_TEXT;
+      } else if(isspace((int)c)) {
+	preload->state = PARSE_PRELOAD_AFTER_NAME;
+      } else if(preload->state == PARSE_PRELOAD_PARAM_NAME) {
+	parse_preload_add_name(preload, c);
+      } else {
+	/* The last parameter had no value, and this is a new one. */
+	preload->name_length = 0;
+	parse_preload_add_name(preload, c);
+	preload->state = PARSE_PRELOAD_PARAM_NAME;
+      }
+      break;
+
+    case PARSE_PRELOAD_BEFORE_VALUE:
+      if(isspace((int)c))
+	break;
+      preload->value_length = 0;
+      if(c == '>') {
+	preload->state = PARSE_PRELOAD_TEXT;
+      } else if(c == '"' || c == '\'') {
+	preload->quote = c;
+	preload->state = PARSE_PRELOAD_VALUE;
+      } else {
+	preload->quote = '\0';
+	preload->value[preload->value_length++] = c;
+	preload->state = PARSE_PRELOAD_VALUE;
+      }
+      break;
+
+    case PARSE_PRELOAD_VALUE:
+      if(preload->quote ? c == preload->quote :
+	 (isspace((int)c) || c == '>')) {
+	parse_preload_end_value(preload);
+	if(c == '>')
+	  preload->state = PARSE_PRELOAD_TEXT;
+	else
+	  preload->state = PARSE_PRELOAD_PARAMS;
+      } else if(preload->value_length < PARSE_PRELOAD_VALUE_SIZE) {
+	preload->value[preload->value_length++] = c;
+      }
+      break;
+    }
+  }
+}
+
+/**
+ * Free what the preload scanner has allocated.
+ *
+ * @param preload The preload scanner.
+ */
+void parse_preload_free(struct parse_preload *preload)
+{
+  if(preload->base_url)
+    free(preload->base_url);
+  preload->base_url = NULL;
+}
@@ -0,0 +1,95 @@
+/**
+ * Structs and prototypes for the preload scanner, which looks for
+ * resources in the raw document before the parser gets to them.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+#ifndef _PARSER_PRELOAD_H_
+#define _PARSER_PRELOAD_H_
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "parse.h"
+
+/* The longest tag or parameter name the scanner cares about. */
+#define PARSE_PRELOAD_NAME_SIZE  16
+
+/* The longest URL the scanner cares about. */
+#define PARSE_PRELOAD_VALUE_SIZE  1024
+
+/**
+ * Where in the document the preload scanner is.
+ */
+enum parse_preload_state {
+  PARSE_PRELOAD_TEXT,
+  PARSE_PRELOAD_TAG_START,
+  PARSE_PRELOAD_TAG_NAME,
+  PARSE_PRELOAD_MARKUP,
+  PARSE_PRELOAD_COMMENT,
+  PARSE_PRELOAD_SKIP_TAG,
+  PARSE_PRELOAD_PARAMS,
+  PARSE_PRELOAD_PARAM_NAME,
+  PARSE_PRELOAD_AFTER_NAME,
+  PARSE_PRELOAD_BEFORE_VALUE,
+  PARSE_PRELOAD_VALUE
+};
+
+/**
+ * The preload scanner of a document. Since the document is given to the
+ * scanner one buffer at a time, it has to remember where it was.
+ *
+ * @member function The function to call for each resource found, or
+ * @member function NULL if the document should not be scanned.
+ * @member data The data given to the preload function.
+ * @member state Where in the document the scanner is.
+ * @member tag The index of the current tag in the table of wanted tags,
+ * @member tag or a negative value if it is not wanted.
+ * @member wanted Non-zero value if the current parameter is wanted.
+ * @member dashes The number of dashes in a row, to find comments.
+ * @member quote The quote character around the current value, or zero.
+ * @member name The name of the current tag or parameter, in lower case.
+ * @member name_length The length of the name.
+ * @member value The value of the current parameter.
+ * @member value_length The length of the value.
+ * @member base_url The base URL given in the document, or NULL.
+ * @member count The number of resources found.
+ */
+struct parse_preload {
+  parse_preload_function *function;
+  void *data;
+  enum parse_preload_state state;
+  int tag;
+  int wanted;
+  int dashes;
+  char quote;
+  char name[PARSE_PRELOAD_NAME_SIZE];
+  int name_length;
+  char value[PARSE_PRELOAD_VALUE_SIZE];
+  int value_length;
+  char *base_url;
+  int count;
+};
+
+/* Preload scanner function prototypes. */
+extern void parse_preload_scan(struct parse_preload *preload,
+			       char *buffer, int length);
+extern void parse_preload_free(struct parse_preload *preload);
+
+#endif /* _PARSER_PRELOAD_H_ */
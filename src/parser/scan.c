@@ -0,0 +1,164 @@
+/**
+ * Scanning functions for the hot loops of the parser. Instead of looking
+ * at one character at a time, these look at a whole unsigned long at a
+ * time, and only fall back to single characters around a match. This
+ * needs nothing but plain C, so it works the same on every machine.
+ * Searching for a single character is left to memchr() and strchr(),
+ * which most C libraries already do as fast as the machine allows.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <string.h>
+
+#include "scan.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/* The number of characters looked at in one go. */
+#define PARSE_SCAN_WORD  sizeof(unsigned long)
+
+/* A word with every byte set to one, and one with only the high bit
+ * of every byte set.
+ */
+#define PARSE_SCAN_ONES  (~0UL / 255)
+#define PARSE_SCAN_HIGHS  (PARSE_SCAN_ONES * 128)
+
+/* Non-zero value if any byte in the word is less than n, which must
+ * not be larger than 128. Bytes with the high bit set never match.
+ */
+#define PARSE_SCAN_HAS_LESS(word, n) \
+  (((word) - PARSE_SCAN_ONES * (n)) & ~(word) & PARSE_SCAN_HIGHS)
+
+/**
+ * Find the first character in a piece of text that is whitespace or the
+ * nul character. Since all of those are less than or equal to a space,
+ * words without any such bytes are skipped without looking closer.
+ *
+ * @param text The text to look through.
+ * @param length The number of characters in the text.
+ *
+ * @return the index of the first such character, or the length of the
+ * @return text if there is none.
+ */
+size_t parse_scan_special(const char *text, size_t length)
+{
+  unsigned long word;
+  size_t index, end;
+
+  index = 0;
+  while(index < length) {
+    if(length - index >= PARSE_SCAN_WORD) {
+      memcpy(&word, text + index, PARSE_SCAN_WORD);
+      if(!PARSE_SCAN_HAS_LESS(word, ' ' + 1)) {
+	index += PARSE_SCAN_WORD;
+	continue;
+      }
+      end = index + PARSE_SCAN_WORD;
+    } else {
+      end = length;
+    }
+
+    /* Something in here might be it, or just a control character. */
+    for( ; index < end ; index++)
+      if(PARSE_SCAN_IS_SPECIAL(text[index]))
+	return index;
+  }
+
+  return length;
+}
+
+/**
+ * Find the first character in a piece of text that is not ASCII, that
+ * is, has the high bit set.
+ *
+ * @param text The text to look through.
+ * @param length The number of characters in the text.
+ *
+ * @return the index of the first such character, or the length of the
+ * @return text if there is none.
+ */
+size_t parse_scan_ascii(const char *text, size_t length)
+{
+  unsigned long word;
+  size_t index;
+
+  index = 0;
+  while(length - index >= PARSE_SCAN_WORD) {
+    memcpy(&word, text + index, PARSE_SCAN_WORD);
+    if(word & PARSE_SCAN_HIGHS)
+      break;
+    index += PARSE_SCAN_WORD;
+  }
+
+  for( ; index < length ; index++)
+    if(text[index] & 0x80)
+      return index;
+
+  return length;
+}
+
+/**
+ * Copy a piece of text, converting the letters A to Z into lower case.
+ * Other characters are left as they are, just like tolower() does in
+ * the C locale. The source and destination may be the same.
+ *
+ * @param destination Where the converted text is placed.
+ * @param source The text to convert.
+ * @param length The number of characters to convert.
+ */
+void parse_scan_lower(char *destination, const char *source, size_t length)
+{
+  unsigned long word, low, above_z, from_a, upper;
+  size_t index;
+
+  index = 0;
+  while(length - index >= PARSE_SCAN_WORD) {
+    memcpy(&word, source + index, PARSE_SCAN_WORD);
+
+    /* Adding to the low seven bits of each byte sets its high bit if the
+     * byte is at least 'A', or more than 'Z'. Neither carries into the
+     * next byte. Bytes with the high bit already set are not letters.
+     */
+    low = word & ~PARSE_SCAN_HIGHS;
+    from_a = low + PARSE_SCAN_ONES * (128 - 'A');
+    above_z = low + PARSE_SCAN_ONES * (128 - 'Z' - 1);
+    upper = (from_a ^ above_z) & ~word & PARSE_SCAN_HIGHS;
+    word |= upper >> 2;
+
+    memcpy(destination + index, &word, PARSE_SCAN_WORD);
+    index += PARSE_SCAN_WORD;
+  }
+
+  for( ; index < length ; index++) {
+    if(source[index] >= 'A' && source[index] <= 'Z')
+      destination[index] = source[index] + 'a' - 'A';
+    else
+      destination[index] = source[index];
+  }
+}
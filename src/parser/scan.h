@@ -0,0 +1,44 @@
+/**
+ * Prototypes for the scanning functions, which look through text a
+ * whole machine word at a time.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+#ifndef _PARSER_SCAN_H_
+#define _PARSER_SCAN_H_
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <sys/types.h>
+
+/* Non-zero value for the bytes that the text collector cannot just copy:
+ * whitespace, which may be collapsed or start a new line, and the nul
+ * character, which is never stored.
+ */
+#define PARSE_SCAN_IS_SPECIAL(c) \
+  ((c) == ' ' || ((c) >= '\t' && (c) <= '\r') || (c) == '\0')
+
+/* Scanning function prototypes. */
+extern size_t parse_scan_special(const char *text, size_t length);
+extern size_t parse_scan_ascii(const char *text, size_t length);
+extern void parse_scan_lower(char *destination, const char *source,
+			     size_t length);
+
+#endif /* _PARSER_SCAN_H_ */
@@ -35,6 +35,7 @@
 #include "ui.h"
 #include "layout.h"
 #include "states.h"
+#include "context.h"
 #include "helpers.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
@@ -42,31 +43,291 @@
 #include <dmalloc.h>
 #endif /* HAVE_DMALLOC_H */
 
-/* A pointer to the current state. */
-static struct parse_state *current_state = NULL;
+/* The number of states the stack is first allocated with. */
+#define PARSE_STATE_STACK_SIZE  32
 
-static void parse_state_delete(struct parse_state *state)
+/* The number of slots the hash tables are first allocated with. */
+#define PARSE_STATE_HASH_SIZE  64
+
+/**
+ * Calculate a hash value for a tag name.
+ *
+ * @param tagname The tag name to hash.
+ *
+ * @return the hash value.
+ */
+static unsigned int parse_state_hash_name(const char *tagname)
+{
+  unsigned int hash = 0;
+
+  while(*tagname)
+    hash = hash * 31 + (unsigned char)*tagname++;
+
+  return hash;
+}
+
+/**
+ * Calculate a hash value for a text style.
+ *
+ * @param style The text style to hash.
+ *
+ * @return the hash value.
+ */
+static unsigned int parse_state_hash_style(struct layout_text_styles *style)
+{
+  unsigned int hash;
+
+  hash = (unsigned int)style->size * 31 + style->colour;
+  hash = hash * 31 + ((style->monospaced != 0) |
+		      ((style->italic != 0) << 1) |
+		      ((style->bold != 0) << 2) |
+		      ((style->underlined != 0) << 3) |
+		      ((style->overlined != 0) << 4) |
+		      ((style->subscript != 0) << 5) |
+		      ((style->superscript != 0) << 6) |
+		      ((style->preformatted != 0) << 7) |
+		      ((style->directquote != 0) << 8));
+
+  return hash;
+}
+
+/**
+ * Compare two text styles.
+ *
+ * @param style1 The first text style.
+ * @param style2 The second text style.
+ *
+ * @return non-zero value if the styles are equal.
+ */
+static int parse_state_equal_style(struct layout_text_styles *style1,
+				   struct layout_text_styles *style2)
+{
+  return (style1->size == style2->size &&
+	  style1->colour == style2->colour &&
+	  style1->monospaced == style2->monospaced &&
+	  style1->italic == style2->italic &&
+	  style1->bold == style2->bold &&
+	  style1->underlined == style2->underlined &&
+	  style1->overlined == style2->overlined &&
+	  style1->subscript == style2->subscript &&
+	  style1->superscript == style2->superscript &&
+	  style1->preformatted == style2->preformatted &&
+	  style1->directquote == style2->directquote);
+}
+
+/**
+ * Make sure an array has room for at least one more element, by
+ * doubling its size when it is full.
+ *
+ * @param array A pointer to the array to grow.
+ * @param allocated A pointer to the number of allocated elements.
+ * @param used The number of elements in use.
+ * @param element_size The size of each element.
+ * @param initial The number of elements to allocate the first time.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int parse_state_grow(void **array, int *allocated, int used,
+			    size_t element_size, int initial)
+{
+  void *new_array;
+  int new_allocated;
+
+  if(used < *allocated)
+    return 0;
+
+  new_allocated = *allocated ? *allocated * 2 : initial;
+  new_array = realloc(*array, new_allocated * element_size);
+  if(new_array == NULL)
+    return 1;
+
+  *array = new_array;
+  *allocated = new_allocated;
+
+  return 0;
+}
+
+/**
+ * Rebuild a hash table of interned entries with twice the number of 
+ * slots. Each slot holds the index of an entry plus one, or zero if
+ * the slot is empty.
+ *
+ * @param stack The state stack the interned entries belong to.
+ * @param for_style Non-zero value if the style hash table is to be
+ * @param for_style rebuilt, and zero for the atom hash table.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int parse_state_rehash(struct parse_state_stack *stack, int for_style)
+{
+  int *new_hash, new_size, count, index;
+  unsigned int slot;
+
+  if(for_style) {
+    new_size = stack->style_hash_size;
+    count = stack->style_count;
+  } else {
+    new_size = stack->atom_hash_size;
+    count = stack->atom_count;
+  }
+  new_size = new_size ? new_size * 2 : PARSE_STATE_HASH_SIZE;
+
+  new_hash = (int *)calloc(new_size, sizeof(int));
+  if(new_hash == NULL)
+    return 1;
+
+  for(index = 0 ; index < count ; index++) {
+    if(for_style)
+      slot = parse_state_hash_style(&stack->style_entries[index]);
+    else
+      slot = parse_state_hash_name(stack->atom_names[index]);
+    slot &= new_size - 1;
+    while(new_hash[slot])
+      slot = (slot + 1) & (new_size - 1);
+    new_hash[slot] = index + 1;
+  }
+
+  if(for_style) {
+    free(stack->style_hash);
+    stack->style_hash = new_hash;
+    stack->style_hash_size = new_size;
+  } else {
+    free(stack->atom_hash);
+    stack->atom_hash = new_hash;
+    stack->atom_hash_size = new_size;
+  }
+
+  return 0;
+}
+
+/**
+ * Find the atom of a tag name that has already been interned.
+ *
+ * @param stack The state stack the atom belongs to.
+ * @param tagname The tag name to look for.
+ *
+ * @return the atom of the tag name, or -1 if it has never been seen.
+ */
+static int parse_state_find_atom(struct parse_state_stack *stack,
+				 const char *tagname)
 {
-  struct parse_state *prev, *statep;
+  unsigned int slot, mask;
+
+  if(stack->atom_hash_size == 0)
+    return -1;
 
-  prev = NULL;
-  statep = current_state;
-  while(statep && statep != state) {
-    prev = statep;
-    statep = statep->previous;
+  mask = stack->atom_hash_size - 1;
+  slot = parse_state_hash_name(tagname) & mask;
+  while(stack->atom_hash[slot]) {
+    if(!strcmp(stack->atom_names[stack->atom_hash[slot] - 1], tagname))
+      return stack->atom_hash[slot] - 1;
+    slot = (slot + 1) & mask;
   }
 
-  /* Return directly if the state could not be found. */
-  if(statep == NULL)
-    return;
+  return -1;
+}
 
-  if(prev == NULL)
-    current_state = statep->previous;
-  else
-    prev->previous = statep->previous;
+/**
+ * Find the atom of a tag name, interning the name if it has not been
+ * seen before. Tag names are never forgotten, so an atom stays valid
+ * as long as the state stack.
+ *
+ * @param stack The state stack the atom belongs to.
+ * @param tagname The tag name to look for.
+ *
+ * @return the atom of the tag name, or -1 if an error occurred.
+ */
+static int parse_state_get_atom(struct parse_state_stack *stack,
+				const char *tagname)
+{
+  unsigned int slot, mask;
+  char *name;
+  int atom;
+
+  atom = parse_state_find_atom(stack, tagname);
+  if(atom >= 0)
+    return atom;
+
+  if(stack->atom_count * 2 >= stack->atom_hash_size &&
+     parse_state_rehash(stack, 0))
+    return -1;
+
+  mask = stack->atom_hash_size - 1;
+  slot = parse_state_hash_name(tagname) & mask;
+  while(stack->atom_hash[slot])
+    slot = (slot + 1) & mask;
+
+  if(parse_state_grow((void **)&stack->atom_names, &stack->atom_allocated,
+		      stack->atom_count, sizeof(char *),
+		      PARSE_STATE_HASH_SIZE / 2))
+    return -1;
+
+  name = (char *)malloc(strlen(tagname) + 1);
+  if(name == NULL)
+    return -1;
+  strcpy(name, tagname);
+
+  stack->atom_names[stack->atom_count] = name;
+  stack->atom_hash[slot] = stack->atom_count + 1;
+
+  return stack->atom_count++;
+}
+
+/**
+ * Find the index of an interned text style equal to the given one, 
+ * interning a copy of it if there is none.
+ *
+ * @param stack The state stack the style belongs to.
+ * @param style The text style to look for.
+ *
+ * @return the index of the interned style, or -1 if an error occurred.
+ */
+static int parse_state_get_style(struct parse_state_stack *stack,
+				 struct layout_text_styles *style)
+{
+  unsigned int slot, mask;
+  int index;
+
+  if(stack->style_count * 2 >= stack->style_hash_size &&
+     parse_state_rehash(stack, 1))
+    return -1;
+
+  mask = stack->style_hash_size - 1;
+  slot = parse_state_hash_style(style) & mask;
+  while(stack->style_hash[slot]) {
+    index = stack->style_hash[slot] - 1;
+    if(parse_state_equal_style(&stack->style_entries[index], style))
+      return index;
+    slot = (slot + 1) & mask;
+  }
+
+  if(parse_state_grow((void **)&stack->style_entries, &stack->style_allocated,
+		      stack->style_count, sizeof(struct layout_text_styles),
+		      PARSE_STATE_HASH_SIZE / 2))
+    return -1;
+
+  stack->style_entries[stack->style_count] = *style;
+  stack->style_hash[slot] = stack->style_count + 1;
 
-  free(statep->tagname);
-  free(statep);
+  return stack->style_count++;
+}
+
+/**
+ * Remove a state from the stack. The states above it are moved down
+ * to fill its place.
+ *
+ * @param stack The state stack to remove the state from.
+ * @param index The position in the stack of the state to remove.
+ */
+static void parse_state_delete(struct parse_state_stack *stack, int index)
+{
+  if(index < 0 || index >= stack->depth)
+    return;
+
+  stack->depth--;
+  if(index < stack->depth)
+    memmove(&stack->states[index], &stack->states[index + 1],
+	    (stack->depth - index) * sizeof(struct parse_state));
 }
 
 /**
@@ -114,47 +375,85 @@ void parse_state_reset(struct layout_text_styles *style,
 /**
  * Initialize the state stack with the default values.
  *
+ * @param context The parser context of the document.
+ *
  * @return non-zero value if an error occurred.
  */
-int parse_state_init(void)
+int parse_state_init(struct parse_context *context)
 {
-  if(current_state == NULL) {
-    current_state = (struct parse_state *)malloc(sizeof(struct parse_state));
-    if(current_state == NULL)
+  struct parse_state_stack *stack = &context->states;
+  struct layout_text_styles style;
+  struct parse_state *statep;
+
+  if(stack->depth == 0) {
+    /* No state refers to any style, so start over with a fresh set. */
+    stack->style_count = 0;
+    if(stack->style_hash != NULL)
+      memset(stack->style_hash, 0, stack->style_hash_size * sizeof(int));
+
+    if(parse_state_grow((void **)&stack->states, &stack->allocated, 0,
+			sizeof(struct parse_state), PARSE_STATE_STACK_SIZE))
       return 1;
-    current_state->tagname = (char *)malloc(16);
-    if(current_state->tagname == NULL) {
-      free(current_state);
+    stack->states[0].tag = parse_state_get_atom(stack, "initiated");
+    if(stack->states[0].tag < 0)
       return 1;
-    }
-    strcpy(current_state->tagname, "initiated");
-    current_state->previous = NULL;
+    stack->depth = 1;
   }
 
-  parse_state_reset(&current_state->style, NULL, NULL);
-  parse_state_reset(NULL, &current_state->align, NULL);
-  parse_state_reset(NULL, NULL, &current_state->base);
+  statep = &stack->states[stack->depth - 1];
+
+  parse_state_reset(&style, NULL, NULL);
+  statep->style = parse_state_get_style(stack, &style);
+  if(statep->style < 0)
+    return 1;
+  parse_state_reset(NULL, &statep->align, NULL);
+  parse_state_reset(NULL, NULL, &statep->base);
 
   return 0;
 }
 
 /**
- * Delete all previous states.
+ * Delete all previous states. The memory of the stack is kept, to
+ * be reused by the next page.
+ *
+ * @param context The parser context of the document.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_state_delete_all(void)
+int parse_state_delete_all(struct parse_context *context)
 {
-  while(current_state) {
-    parse_state_delete(current_state);
-  }
+  context->states.depth = 0;
 
   return 0;
 }
 
+/**
+ * Release all memory used by the state stack, including the interned
+ * tag names and styles.
+ *
+ * @param context The parser context of the document.
+ */
+void parse_state_free(struct parse_context *context)
+{
+  struct parse_state_stack *stack = &context->states;
+  int index;
+
+  for(index = 0 ; index < stack->atom_count ; index++)
+    free(stack->atom_names[index]);
+
+  free(stack->atom_names);
+  free(stack->atom_hash);
+  free(stack->style_entries);
+  free(stack->style_hash);
+  free(stack->states);
+
+  memset(stack, 0, sizeof(struct parse_state_stack));
+}
+
 /**
  * Copy the state values from the current state to the given structs.
  *
+ * @param context The parser context of the document.
  * @param style A pointer to where to store text style information. A NULL
  * @param style value means the style will not be retreived.
  * @param align A pointer to where to store part align information. A NULL
@@ -166,18 +465,27 @@ int parse_state_delete_all(void)
  *
  * @return non-zero value if an error occurred.
  */
-int parse_state_get_current(struct layout_text_styles *style,
+int parse_state_get_current(struct parse_context *context,
+			    struct layout_text_styles *style,
 			    struct layout_aligns *align,
 			    struct layout_part **base)
 {
+  struct parse_state_stack *stack = &context->states;
+  struct parse_state *statep;
+
+  if(stack->depth == 0)
+    return 1;
+
+  statep = &stack->states[stack->depth - 1];
+
   if(style)
-    *style = current_state->style;
+    *style = stack->style_entries[statep->style];
   
   if(align)
-    *align = current_state->align;
+    *align = statep->align;
 
   if(base)
-    *base = current_state->base;
+    *base = statep->base;
 
   return 0;
 }
@@ -186,6 +494,7 @@ int parse_state_get_current(struct layout_text_styles *style,
  * Copy the style and align values into a new state and place that first 
  * on the stack. Also sets the new mother of layout parts, if given.
  *
+ * @param context The parser context of the document.
  * @param tagname A string containing the name of the tag that sets this
  * @param tagname tag. Used when popping the state back.
  * @param style A pointer to the style to store in the state. A NULL value
@@ -197,47 +506,53 @@ int parse_state_get_current(struct layout_text_styles *style,
  *
  * @return non-zero value if an error occurred.
  */
-int parse_state_push(char *tagname,
+int parse_state_push(struct parse_context *context, char *tagname,
 		     struct layout_text_styles *style,
 		     struct layout_aligns *align,
 		     struct layout_part **base)
 {
-  struct parse_state *new_state = NULL;
+  struct parse_state_stack *stack = &context->states;
+  struct parse_state *new_state, *previous_state;
 
-  new_state = (struct parse_state *)malloc(sizeof(struct parse_state));
-  if(new_state == NULL)
+  if(stack->depth == 0)
     return 1;
 
-  new_state->tagname = (char *)malloc(strlen(tagname) + 1);
-  if(new_state->tagname == NULL) {
-    free(new_state);
+  if(parse_state_grow((void **)&stack->states, &stack->allocated,
+		      stack->depth, sizeof(struct parse_state),
+		      PARSE_STATE_STACK_SIZE))
     return 1;
-  }
 
-  strcpy(new_state->tagname, tagname);
+  previous_state = &stack->states[stack->depth - 1];
+  new_state = &stack->states[stack->depth];
 
-  if(style)
-    new_state->style = *style;
-  else
-    parse_state_get_current(&new_state->style, NULL, NULL);
+  new_state->tag = parse_state_get_atom(stack, tagname);
+  if(new_state->tag < 0)
+    return 1;
+
+  if(style) {
+    new_state->style = parse_state_get_style(stack, style);
+    if(new_state->style < 0)
+      return 1;
+  } else
+    new_state->style = previous_state->style;
 
   if(align)
     new_state->align = *align;
   else
-    parse_state_get_current(NULL, &new_state->align, NULL);
+    new_state->align = previous_state->align;
 
   if(base)
     new_state->base = *base;
   else
-    parse_state_get_current(NULL, NULL, &new_state->base);
+    new_state->base = previous_state->base;
 
-  new_state->previous = current_state;
-  current_state = new_state;
+  stack->depth++;
 
   /* We need special treatment of the preformatted style, because this
    * inflicts on the parsing.
    */
-  parse_string_set_preformatted(current_state->style.preformatted);
+  style = &stack->style_entries[new_state->style];
+  parse_string_set_preformatted(context, style->preformatted);
 
   return 0;
 }
@@ -246,62 +561,71 @@ int parse_state_push(char *tagname,
  * Remove the first state from the stack, no matter what there is inside it.
  * Only do this if we do not pop over a set state mark.
  *
+ * @param context The parser context of the document.
  * @member pop_style Non-zero value if popping the current style.
  * @member pop_align Non-zero value if popping the current align.
  * @member pop_base Non-zero value if popping the current base.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_state_pop(char *tagname, int delete_nested)
+int parse_state_pop(struct parse_context *context, char *tagname,
+		    int delete_nested)
 {
-  struct parse_state *statep, *old_statep;
+  struct parse_state_stack *stack = &context->states;
+  int tag, index;
 
-  if(current_state == NULL) {
+  if(stack->depth == 0) {
     fprintf(stderr, "%s(%d): Trying to pop from empty stack.\n",
 	    __FUNCTION__, __LINE__);
     return 1;
   }
 
+  /* A tag name that has never been pushed cannot be on the stack, and
+   * is not interned just to find that out.
+   */
+  tag = parse_state_find_atom(stack, tagname);
+
   /* Search backwards for the given tagname. If it cannot be found, 
    * There is definitely something wrong with the page. If another
    * tagname is found before the one we search for, there is a nested
    * error in the page. In either case, we print some messages to let
    * the nice user know this. 
    */
-  if(!strcmp(current_state->tagname, tagname)) {
-    parse_state_delete(current_state);
+  if(stack->states[stack->depth - 1].tag == tag) {
+    parse_state_delete(stack, stack->depth - 1);
   } else {
-    statep = current_state;
-    while(statep && strcmp(statep->tagname, tagname) != 0) {
+    index = stack->depth - 1;
+    while(index >= 0 && stack->states[index].tag != tag) {
       fprintf(stderr, "Warning! Nested tags! Popping '%s' right past '%s'.\n",
-	      tagname, statep->tagname);
-      old_statep = statep;
-      statep = statep->previous;
+	      tagname, stack->atom_names[stack->states[index].tag]);
       if(delete_nested) {
 	fprintf(stderr, "And deleting it.\n");      
-	parse_state_delete(old_statep);
+	parse_state_delete(stack, index);
       }
+      index--;
     }
-    if(statep == NULL) {
+    if(index < 0) {
       fprintf(stderr, "Warning! Cannot find tagname '%s' to pop.\n", tagname);
     } else {
-      parse_state_delete(statep);
+      parse_state_delete(stack, index);
     }
   }
 
   /* If we happen to pop more than we push, we will come to a position
-   * where current_state is NULL again. This cannot be allowed, and to
+   * where the stack is empty again. This cannot be allowed, and to
    * easily recover from this problem, we simply reinitialize it.
    */
-  if(current_state == NULL) {
+  if(stack->depth == 0) {
     fprintf(stderr, "Warning! Initialized the state more than once!\n");
-    parse_state_init();
+    parse_state_init(context);
   }
 
   /* We need special treatment of the preformatted style, because this
    * inflicts on the parsing.
    */
-  parse_string_set_preformatted(current_state->style.preformatted);
+  index = stack->states[stack->depth - 1].style;
+  parse_string_set_preformatted(context,
+				stack->style_entries[index].preformatted);
 
   return 0;
 }
@@ -309,14 +633,166 @@ int parse_state_pop(char *tagname, int delete_nested)
 /**
  * Return the name of the top state.
  *
+ * @param context The parser context of the document.
+ *
  * @return the name of the top state. This string is not copied, so
  * @return it should never ever be written to.
  */
-char *parse_state_peek(void)
+char *parse_state_peek(struct parse_context *context)
 {
-  return current_state->tagname;
+  struct parse_state_stack *stack = &context->states;
+
+  return stack->atom_names[stack->states[stack->depth - 1].tag];
 }
 
+/**
+ * Check if a part has a place of its own on the page, so that a named
+ * place found before it may point at it. Images are left out, since
+ * they may be replaced by their alternative texts, and so are texts
+ * which are only whitespace, since they may be removed.
+ *
+ * @param partp A pointer to the layout part.
+ *
+ * @return non-zero value if the part may be pointed at.
+ */
+static int parse_state_is_anchorable(struct layout_part *partp)
+{
+  switch(partp->type) {
+  case LAYOUT_PART_TEXT:
+    return (partp->data.text.text != NULL &&
+	    partp->data.text.text[strspn(partp->data.text.text, " ")] != '\0');
+
+  case LAYOUT_PART_PARAGRAPH:
+  case LAYOUT_PART_LINE:
+  case LAYOUT_PART_PREFORMATTED:
+  case LAYOUT_PART_TABLE:
+  case LAYOUT_PART_FORM_SUBMIT:
+  case LAYOUT_PART_FORM_CHECKBOX:
+  case LAYOUT_PART_FORM_RADIO:
+  case LAYOUT_PART_FORM_TEXT:
+  case LAYOUT_PART_FORM_TEXTAREA:
+    return 1;
 
+  default:
+    return 0;
+  }
+}
+
+/**
+ * Add a named place to the page being parsed. It will point at the
+ * next part added to the page, which has a place of its own.
+ *
+ * @param context The parser context of the document.
+ * @param name The name of the place. It is copied.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int parse_state_add_anchor(struct parse_context *context, char *name)
+{
+  struct parse_anchors *anchors = &context->anchors;
+  struct layout_anchor *anchor;
+
+  if(context->page == NULL || name[0] == '\0')
+    return 0;
+
+  if(parse_state_grow((void **)&anchors->anchors, &anchors->allocation,
+		      anchors->count, sizeof(struct layout_anchor *), 4))
+    return 1;
+
+  /* Only the first place with a name is kept. */
+  anchor = layout_add_anchor(context->page, name);
+  if(anchor != NULL)
+    anchors->anchors[anchors->count++] = anchor;
+
+  return 0;
+}
+
+/**
+ * Add a new part to the page being parsed. The part is placed under
+ * the base part of the current state, or under the base of the context
+ * if there is none, and gets the alignment of the current state.
+ * Named places waiting for a part are pointed at the new part, or at
+ * the part it was merged into.
+ *
+ * @param context The parser context of the document.
+ * @param partp A pointer to the layout part to add.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int parse_state_add_part(struct parse_context *context,
+			 struct layout_part *partp)
+{
+  struct parse_anchors *anchors = &context->anchors;
+  struct layout_part *base_part;
+  int anchorable, i;
 
+  base_part = NULL;
+  parse_state_get_current(context, NULL, &partp->align, &base_part);
 
+  if(base_part == NULL)
+    base_part = context->base;
+
+  anchorable = anchors->count > 0 && parse_state_is_anchorable(partp);
+
+  if(layout_add_part(base_part, partp))
+    return 1;
+
+  /* The part last under the base is the new part, or the part it was
+   * merged into.
+   */
+  if(anchorable && base_part->last_child != NULL) {
+    for(i = 0 ; i < anchors->count ; i++)
+      anchors->anchors[i]->part = base_part->last_child;
+    anchors->count = 0;
+  }
+
+  return 0;
+}
+
+/**
+ * Find the first of the parts directly under the base of the context,
+ * which new parts may still be added under. That is a part which is,
+ * or contains, the base part of one of the states on the stack.
+ *
+ * @param context The parser context of the document.
+ *
+ * @return a pointer to the first open part, or NULL if no part under
+ * @return the base of the context is open.
+ */
+struct layout_part *parse_state_open_part(struct parse_context *context)
+{
+  struct parse_state_stack *stack = &context->states;
+  struct layout_part *partp, *basep, *first;
+  int i, several;
+
+  /* Usually all open parts are nested inside the same one. */
+  first = NULL;
+  several = 0;
+  for(i = 0 ; i < stack->depth ; i++) {
+    basep = stack->states[i].base;
+    while(basep && basep->parent != context->base)
+      basep = basep->parent;
+    if(basep == NULL)
+      continue;
+    if(first == NULL)
+      first = basep;
+    else if(basep != first)
+      several = 1;
+  }
+
+  if(!several)
+    return first;
+
+  /* Otherwise, find the one that comes first. */
+  for(partp = context->base->child ; partp ; partp = partp->next) {
+    for(i = 0 ; i < stack->depth ; i++) {
+      basep = stack->states[i].base;
+      while(basep && basep->parent != context->base)
+	basep = basep->parent;
+      if(basep == partp)
+	return partp;
+    }
+  }
+
+  return NULL;
+}
@@ -31,20 +31,21 @@
 
 /**
  * Contains information about the style, align and base state of
- * the page. 
+ * the page. The states are kept in an array used as a stack, and
+ * neither the tag name nor the style is stored in the state itself.
  * 
+ * @member tag The atom of the tag name that pushed this state.
+ * @member style The index of the interned style of this particular
+ * @member style state of the parsing.
  * @member align The alignment used for the current state.
- * @member style The style to describe this particular state of the parsing.
  * @member base A pointer to the layout part which is to be the base part
  * @member base of new parts added.
- * @member previous A pointer to the previous state in the pushed stack.
 */
 struct parse_state {
-  char *tagname;
-  struct layout_text_styles style;
+  int tag;
+  int style;
   struct layout_aligns align;
   struct layout_part *base;
-  struct parse_state *previous;
 };
 
 /**
@@ -62,20 +63,65 @@ struct parse_state_mark {
   struct parse_state_mark *previous;
 };
 
+/**
+ * The stack of states of one document, together with the tag names and
+ * text styles the states refer to.
+ *
+ * @member states The states, with the current state at the top.
+ * @member depth The number of states on the stack.
+ * @member allocated The number of states the stack has room for.
+ * @member atom_names The interned tag names, indexed by atom.
+ * @member atom_count The number of interned tag names.
+ * @member atom_allocated The number of tag names there is room for.
+ * @member atom_hash A hash table of atoms plus one, zero meaning empty.
+ * @member atom_hash_size The number of slots in the atom hash table.
+ * @member style_entries The interned text styles.
+ * @member style_count The number of interned text styles.
+ * @member style_allocated The number of text styles there is room for.
+ * @member style_hash A hash table of style indexes plus one.
+ * @member style_hash_size The number of slots in the style hash table.
+ */
+struct parse_state_stack {
+  struct parse_state *states;
+  int depth;
+  int allocated;
+  char **atom_names;
+  int atom_count;
+  int atom_allocated;
+  int *atom_hash;
+  int atom_hash_size;
+  struct layout_text_styles *style_entries;
+  int style_count;
+  int style_allocated;
+  int *style_hash;
+  int style_hash_size;
+};
+
+struct parse_context;
+
 /* State function prototypes. */
-extern int parse_state_init(void);
-extern int parse_state_delete_all(void);
+extern int parse_state_init(struct parse_context *context);
+extern int parse_state_delete_all(struct parse_context *context);
+extern void parse_state_free(struct parse_context *context);
 extern void parse_state_reset(struct layout_text_styles *style,
 			      struct layout_aligns *align,
 			      struct layout_part **base);
-extern int parse_state_get_current(struct layout_text_styles *style,
+extern int parse_state_get_current(struct parse_context *context,
+				   struct layout_text_styles *style,
 				   struct layout_aligns *align,
 				   struct layout_part **base);
-extern int parse_state_push(char *tagname,
+extern int parse_state_push(struct parse_context *context, char *tagname,
 			    struct layout_text_styles *style,
 			    struct layout_aligns *align,
 			    struct layout_part **base);
-extern int parse_state_pop(char *tagname, int delete_nested);
-extern char *parse_state_peek(void);
+extern int parse_state_pop(struct parse_context *context, char *tagname,
+			   int delete_nested);
+extern char *parse_state_peek(struct parse_context *context);
+extern int parse_state_add_anchor(struct parse_context *context,
+				  char *name);
+extern int parse_state_add_part(struct parse_context *context,
+				struct layout_part *partp);
+extern struct layout_part *parse_state_open_part(struct parse_context 
+						 *context);
 
 #endif /* _PARSER_STATES_H_ */
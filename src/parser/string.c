@@ -34,16 +34,20 @@
 
 #include "layout.h"
 #include "states.h"
+#include "context.h"
 #include "helpers.h"
+#include "scan.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
 #ifdef HAVE_DMALLOC_H
 #include <dmalloc.h>
 #endif /* HAVE_DMALLOC_H */
 
-static char *internal_string = NULL;
-static int internal_allocation = 0;
-static int is_preformatted = 0;
+/* When the text collected in preformatted mode grows to this size, it is
+ * stored at the end of the next line, so that the page can be shown while
+ * it loads, without every line becoming a part of its own.
+ */
+#define PARSE_STRING_BLOCK_SIZE  32768
 
 /* HTML character entities, starting at ISO-8859-1 index 160. */
 static char *entities[] = { 
@@ -62,77 +66,37 @@ static char *entities[] = {
 };
 
 /**
- * Convert a hexadecimal digit into its corresponding decimal value.
+ * Make sure there is room for more characters in the internal string,
+ * plus the terminating nul character.
  *
- * @param hex The hexadecimal digit.
+ * @param string The internal string.
+ * @param extra The number of characters that are about to be added.
  *
- * @return the decimal value.
+ * @return non-zero value if an error occurred.
  */
-static int parse_convert_hex(char hex)
+static int parse_string_reserve(struct parse_string *string, int extra)
 {
-  if(hex >= '0' && hex <= '9')
-    return hex - '0';
-  if(hex >= 'a' && hex <= 'f')
-    return hex - 'a' + 10;
+  char *tmp;
+  int allocation;
 
-  return 0;
-}
+  if(string->text != NULL && string->length + extra < string->allocation)
+    return 0;
 
-/**
- * Converts a string in the form #rrggbb into a 24-bit colour value.
- * Later, this will also handle named colours.
- *
- * @param colour A string containing the colour code.
- *
- * @return a 24-bit colour value.
- */
-uint32_t parse_convert_colour(char *colour)
-{
-  uint32_t real_colour;
-  int red, green, blue;
+  allocation = string->text ? string->allocation * 2 : 1024;
+  while(string->length + extra >= allocation)
+    allocation *= 2;
 
-  /* Convert some well known named colours. An idea here is to check
-   * for rgb.txt that comes with X, and use that for conversion.
-   */
-  if(colour[0] != '#' && 
-     !(isxdigit((int)colour[0]) &&
-       isxdigit((int)colour[1]) &&
-       isxdigit((int)colour[2]) &&
-       isxdigit((int)colour[3]) &&
-       isxdigit((int)colour[4]) &&
-       isxdigit((int)colour[5]))) {
-    if(!strcasecmp(colour, "black"))
-      return 0x000000;
-    else if(!strcasecmp(colour, "white"))
-      return 0xffffff;
-    else if(!strcasecmp(colour, "red"))
-      return 0xff0000;
-    else if(!strcasecmp(colour, "green"))
-      return 0x00ff00;
-    else if(!strcasecmp(colour, "blue"))
-      return 0x0000ff;
-    else if(!strcasecmp(colour, "yellow"))
-      return 0xffff00;
-    else if(!strcasecmp(colour, "cyan"))
-      return 0x00ffff;
-    else if(!strcasecmp(colour, "magenta"))
-      return 0xff00ff;
-    else
-      return 0xffffff;
+  tmp = realloc(string->text, allocation);
+  if(tmp == NULL)
+    return 1;
+  if(string->text == NULL) {
+    tmp[0] = '\0';
+    string->length = 0;
   }
+  string->text = tmp;
+  string->allocation = allocation;
 
-  red = parse_convert_hex(tolower((int)colour[1])) * 16 +
-    parse_convert_hex(tolower((int)colour[2]));
-  green = parse_convert_hex(tolower((int)colour[3])) * 16 +
-    parse_convert_hex(tolower((int)colour[4]));
-  blue = parse_convert_hex(tolower((int)colour[5])) * 16 +
-    parse_convert_hex(tolower((int)colour[6]));
-
-  real_colour = ((red   << 16) |
-		 (green <<  8) |
-		 (blue  <<  0));
-
-  return real_colour;
+  return 0;
 }
 
 /**
@@ -141,79 +105,107 @@ uint32_t parse_convert_colour(char *colour)
  * whitespace characters are converted into space characters, unless
  * the current string is preformatted.
  *
+ * @param context The parser context of the document.
  * @param c The character to be stored.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_string_store_character(char c)
+int parse_string_store_character(struct parse_context *context, char c)
 {
-  int size;
+  struct parse_string *string = &context->string;
 
   /* Convert all whitespace characters into spaces,
    * unless we are in preformating mode. 
    */
-  if(!is_preformatted && isspace((int)c))
+  if(!string->preformatted && isspace((int)c))
     c = ' ';
 
-  /* If we are preformating, newline characters should create what is
-   * equivalent to a br-tag.
+  /* If we are preformating, newline characters are kept in the string,
+   * and become what is equivalent to br-tags when the string is stored.
    */
-  if(is_preformatted && c == '\n') {
-    struct layout_part *partp;
-
-    parse_string_store_current();
-    partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
-    if(partp == NULL) {
+  if(string->preformatted && c == '\n') {
+    if(parse_string_reserve(string, 1) != 0)
       return 1;
-    }
-    partp->data.paragraph.permanent = 1;
-    layout_add_part(partp);
+    string->text[string->length++] = c;
+    string->text[string->length] = '\0';
+
+    if(string->length >= PARSE_STRING_BLOCK_SIZE || context->input.left == 0)
+      parse_string_store_current(context);
 
-    /* Exit here, to avoid having to store the evil newline character. */
     return 0;
   }
 
-  if(internal_string == NULL) {
-    internal_string = malloc(1024);
-    internal_string[0] = '\0';
-    internal_allocation = 1024;
-  } else if(strlen(internal_string) == internal_allocation - 1) {
-    char *tmp;
-
-    tmp = realloc(internal_string, internal_allocation + 1024);
-    if(tmp == NULL)
-      return 1;
-    internal_string = tmp;
-    internal_allocation += 1024;
-  }
-  
-  size = strlen(internal_string);
+  if(parse_string_reserve(string, 1) != 0)
+    return 1;
 
   /* Skip several whitespaces, unless preformatted text. */
-  if(!is_preformatted && 
-     size > 0 && internal_string[size - 1] == ' ' && c == ' ')
+  if(!string->preformatted && string->length > 0 && 
+     string->text[string->length - 1] == ' ' && c == ' ')
     return 0;
 
-  /* Store character, but never store a newline. */
-  if(c == '\n' || c == '\r') {
-    internal_string[size] = '\0';
-  } else {
-    internal_string[size] = c;
-    internal_string[size + 1] = '\0';
+  /* Store character, but never store a newline, or a nul character. */
+  if(c != '\n' && c != '\r' && c != '\0') {
+    string->text[string->length++] = c;
+    string->text[string->length] = '\0';
   }
 
   return 0;
 }
 
 /**
- * Sets the static variable is_preformatted, simply because I do
- * not want to make it global. Modularity, my friend.
+ * Store a piece of text at the end of the temporary internal string,
+ * exactly as if each of its characters had been given to 
+ * parse_string_store_character(). Runs of ordinary characters are
+ * copied in one go, and only whitespace is looked at more closely.
+ *
+ * @param context The parser context of the document.
+ * @param text The text to store. It does not have to be nul terminated.
+ * @param length The number of characters in the text.
  *
- * @param value The new value of is_preformatted.
+ * @return non-zero value if an error occurred.
  */
-void parse_string_set_preformatted(int value)
+int parse_string_store_text(struct parse_context *context, 
+			    const char *text, int length)
 {
-  is_preformatted = value;
+  struct parse_string *string = &context->string;
+  int run;
+
+  while(length > 0) {
+    run = parse_scan_special(text, length);
+    if(run > 0) {
+      if(parse_string_reserve(string, run) != 0)
+	return 1;
+      memcpy(string->text + string->length, text, run);
+      string->length += run;
+      string->text[string->length] = '\0';
+      text += run;
+      length -= run;
+      if(length == 0)
+	break;
+    }
+
+    /* The newline in preformatted text ends the current text part, and
+     * the rest of the special characters are simple enough.
+     */
+    if(parse_string_store_character(context, *text) != 0)
+      return 1;
+    text++;
+    length--;
+  }
+
+  return 0;
+}
+
+/**
+ * Sets whether the text being collected is preformatted, simply because
+ * I do not want the states to know about the string. Modularity, my friend.
+ *
+ * @param context The parser context of the document.
+ * @param value The new value of the preformatted flag.
+ */
+void parse_string_set_preformatted(struct parse_context *context, int value)
+{
+  context->string.preformatted = value;
 }
 
 /**
@@ -222,20 +214,24 @@ void parse_string_set_preformatted(int value)
  * the string will not be nul terminated.
  * After the string is copied, the internal string is cleared.
  *
+ * @param context The parser context of the document.
  * @param buf A buffer into which the string goes.
  * @param size Maximum number of characters that are copied.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_string_get_stored(char *buf, int size)
+int parse_string_get_stored(struct parse_context *context, char *buf, int size)
 {
-  if(internal_string == NULL || buf == NULL)
+  struct parse_string *string = &context->string;
+
+  if(string->text == NULL || buf == NULL)
     return 1;
 
-  strncpy(buf, internal_string, size);
+  strncpy(buf, string->text, size);
 
-  free(internal_string);
-  internal_string = NULL;
+  free(string->text);
+  string->text = NULL;
+  string->length = 0;
 
   return 0;
 }
@@ -245,23 +241,19 @@ int parse_string_get_stored(char *buf, int size)
  * do that safely, first discard the old string, as if it were not
  * worth anything at all. 
  *
+ * @param context The parser context of the document.
  * @param buf A buffer containing the string to store.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_string_set_stored(char *buf)
+int parse_string_set_stored(struct parse_context *context, char *buf)
 {
-  int i;
-
   if(buf == NULL)
     return 1;
 
-  parse_string_discard();
+  parse_string_discard(context);
   
-  for(i = 0 ; i < strlen(buf) ; i++)
-    parse_string_store_character(buf[i]);
-
-  return 0;
+  return parse_string_store_text(context, buf, strlen(buf));
 }
 
 /**
@@ -270,34 +262,35 @@ int parse_string_set_stored(char *buf)
  * front, we keep one of them and trim the rest off. The same thing goes
  * for the whitespace characters at the back.
  *
+ * @param context The parser context of the document.
  * @param skip_front_space If non-zero, do not keep any leading space.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_string_trim(int skip_front_space)
+int parse_string_trim(struct parse_context *context, int skip_front_space)
 {
+  struct parse_string *string = &context->string;
   char *stringp_front, *stringp_back;
   int front_space = 0, back_space = 0;
 
-  if(internal_string == NULL || (!skip_front_space &&
-				 strlen(internal_string) == 1))
+  if(string->text == NULL || (!skip_front_space && string->length == 1))
     return 0;
 
-  if(!skip_front_space && isspace((int)internal_string[0]))
+  if(!skip_front_space && isspace((int)string->text[0]))
     front_space = 1;
-  if(isspace((int)internal_string[strlen(internal_string) - 1]))
+  if(string->length > 0 && isspace((int)string->text[string->length - 1]))
     back_space = 1;
 
   /* Find the front. */
-  stringp_front = internal_string;
+  stringp_front = string->text;
   while(*stringp_front && isspace((int)*stringp_front))
     stringp_front++;
   if(front_space)
     stringp_front--;
 
   /* Cut the back, but only if there is something left to cut. */
-  if(strlen(stringp_front) > 0) {
-    stringp_back = internal_string + strlen(internal_string) - 1;
+  if(*stringp_front != '\0') {
+    stringp_back = string->text + string->length - 1;
     while(isspace((int)*stringp_back))
       stringp_back--;
     if(back_space)
@@ -306,9 +299,11 @@ int parse_string_trim(int skip_front_space)
     stringp_back[1] = '\0';
 
     /* Move the trimmed string to the first position in the internal string. */
-    memmove(internal_string, stringp_front, strlen(stringp_front) + 1);
+    string->length = stringp_back + 1 - stringp_front;
+    memmove(string->text, stringp_front, string->length + 1);
   } else {
-    internal_string[0] = '\0';
+    string->text[0] = '\0';
+    string->length = 0;
   }
 
   return 0;
@@ -317,25 +312,34 @@ int parse_string_trim(int skip_front_space)
 /**
  * Return the length of the internal string. 
  *
+ * @param context The parser context of the document.
+ *
  * @return the length of the string.
  */
-int parse_string_get_length(void)
+int parse_string_get_length(struct parse_context *context)
 {
-  if(internal_string == NULL)
+  struct parse_string *string = &context->string;
+
+  if(string->text == NULL)
     return 0;
 
-  return strlen(internal_string);
+  return string->length;
 }
 
 /**
  * Empty, free and nullify the internal string.
+ *
+ * @param context The parser context of the document.
  */
-void parse_string_discard(void)
+void parse_string_discard(struct parse_context *context)
 {
-  if(internal_string != NULL)
-    free(internal_string);
+  struct parse_string *string = &context->string;
+
+  if(string->text != NULL)
+    free(string->text);
 
-  internal_string = NULL;
+  string->text = NULL;
+  string->length = 0;
 }
 
 /**
@@ -383,50 +387,272 @@ unsigned char parse_string_find_character_entity(char *entity)
 /**
  * Convert all character entities in the internal string into
  * ISO-8859-1 characters.
+ *
+ * @param context The parser context of the document.
  */
-void parse_string_convert_character_entities(void)
+void parse_string_convert_character_entities(struct parse_context *context)
 {
-  char *textp, *entityp, *entity;
+  struct parse_string *string = &context->string;
+  char *readp, *writep, *entityp, *endp;
   unsigned char new;
-  int entity_length;
 
-  if(internal_string == NULL)
+  if(string->text == NULL)
     return;
 
-  textp = internal_string;
-
-  while(*textp != '\0') {
-    while(*textp != '\0' && *textp != '&')
-      textp++;
-    if(*textp == '\0')
-      return;
-    
-    entityp = textp;
-    textp++;
-    while(*textp != '\0' && *textp != ';')
-      textp++;
-    if(*textp == '\0')
-      return;
-    
-    entity_length = textp - entityp - 1;
-    entity = (char *)malloc(entity_length + 1);
-    if(entity == NULL)
-      return;
-    strncpy(entity, entityp + 1, entity_length);
-    entity[entity_length] = '\0';
-    
-    textp++;
-    
-    /* Find the correspnding character and replace it in the string. */
-    new = parse_string_find_character_entity(entity);
+  /* The text is moved towards the front as the entities shrink, so that
+   * each character is only moved once. An entity never continues on the
+   * next line of a preformatted text.
+   */
+  readp = writep = string->text;
+  while((entityp = strchr(readp, '&')) != NULL) {
+    endp = strpbrk(entityp + 1, ";\n");
+    if(endp == NULL)
+      break;
+
+    if(*endp == '\n') {
+      memmove(writep, readp, endp + 1 - readp);
+      writep += endp + 1 - readp;
+      readp = endp + 1;
+      continue;
+    }
+
+    memmove(writep, readp, entityp - readp);
+    writep += entityp - readp;
+
+    /* Find the corresponding character and replace it in the string. */
+    *endp = '\0';
+    new = parse_string_find_character_entity(entityp + 1);
+    *endp = ';';
     if(new > 0) {
-      *entityp++ = new;
-      memmove(entityp, textp, strlen(textp) + 1);    
-      textp = entityp;
+      *writep++ = new;
+    } else {
+      memmove(writep, entityp, endp + 1 - entityp);
+      writep += endp + 1 - entityp;
     }
 
-    free(entity);
+    readp = endp + 1;
   }
+
+  string->length = (writep - string->text) + strlen(readp);
+  memmove(writep, readp, strlen(readp) + 1);
+}
+
+/**
+ * Add a copy of a piece of text as a new text part, in the current style.
+ *
+ * @param context The parser context of the document.
+ * @param text The text to add. It does not have to be nul terminated.
+ * @param length The number of characters in the text.
+ *
+ * @return a pointer to the new part, or NULL if an error occurred.
+ */
+static struct layout_part *parse_string_add_text(struct parse_context *context,
+						 char *text, int length)
+{
+  struct layout_part *partp;
+  char *copy;
+
+  copy = layout_alloc_string(context->page, length + 1);
+  if(copy == NULL)
+    return NULL;
+  memcpy(copy, text, length);
+  copy[length] = '\0';
+
+  partp = layout_init_part(context->page, LAYOUT_PART_TEXT);
+  if(partp == NULL) {
+    layout_free_string(context->page, copy);
+    return NULL;
+  }
+
+  layout_set_text(partp, copy);
+  parse_state_get_current(context, &partp->data.text.style, NULL, NULL);
+  parse_state_add_part(context, partp);
+
+  return partp;
+}
+
+/**
+ * Add a permanent paragraph, which is what a newline in preformatted
+ * text is equivalent to.
+ *
+ * @param context The parser context of the document.
+ *
+ * @return a pointer to the new part, or NULL if an error occurred.
+ */
+static struct layout_part *parse_string_add_break(struct parse_context *context)
+{
+  struct layout_part *partp;
+
+  partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
+  if(partp == NULL)
+    return NULL;
+
+  partp->data.paragraph.permanent = 1;
+  parse_state_add_part(context, partp);
+
+  return partp;
+}
+
+/**
+ * Put the currently stored string, which has newline characters in it,
+ * into the list of parts. The first line continues the row it was begun
+ * on, and is added as a text part. So is the last line, if it is not
+ * ended yet, since it may share its row with what comes after. All the
+ * complete lines in between are put in one preformatted block, instead
+ * of one text part and paragraph each. Inside a link, where each line
+ * has to be a link text of its own, that is still the way it is done.
+ * All of it gets the current style.
+ *
+ * @param context The parser context of the document.
+ *
+ * @return a pointer to the last part added, or NULL if an error occurred.
+ */
+static struct layout_part *parse_string_add_lines(struct parse_context *context)
+{
+  struct parse_string *string = &context->string;
+  struct layout_part *partp, *base_part;
+  char *text, *start, *end, *stop, *tail, *tmp;
+  int length, tail_length, index, breaks;
+  size_t *lines;
+  int number_of_lines;
+
+  /* Take the string over, since its buffer is used for the block. */
+  text = string->text;
+  length = string->length;
+  string->text = NULL;
+  string->length = 0;
+
+  /* The last character that is not a newline is the one that would have
+   * been stored last, had each line been stored on its own.
+   */
+  for(index = length - 1 ; index >= 0 && text[index] == '\n' ; index--)
+    ;
+  if(index >= 0) {
+    if(isspace((int)text[index]))
+      string->last_was_space = 1;
+    else
+      string->last_was_space = 0;
+  }
+
+  /* Split the text into the first line, the complete lines in between
+   * and the unfinished last line, not counting the newlines around the
+   * lines in between.
+   */
+  start = memchr(text, '\n', length);
+  tail = text + length;
+  while(tail[-1] != '\n')
+    tail--;
+  tail_length = text + length - tail;
+  length = tail - start - 1;
+
+  partp = NULL;
+  if(start > text)
+    partp = parse_string_add_text(context, text, start - text);
+  if(start == text || partp != NULL)
+    partp = parse_string_add_break(context);
+  start++;
+
+  base_part = NULL;
+  parse_state_get_current(context, NULL, NULL, &base_part);
+
+  /* Empty lines at the end are left as paragraphs, since a paragraph
+   * right after them is merged into them by the layouter.
+   */
+  breaks = 0;
+  if(length > 0) {
+    do {
+      length--;
+      breaks++;
+    } while(length > 0 && start[length - 1] == '\n');
+  }
+
+  if(partp != NULL && breaks > 0) {
+    if(base_part != NULL && base_part->type == LAYOUT_PART_LINK) {
+      /* The lines in between are added one by one. */
+      stop = start + length;
+      while(partp != NULL && start <= stop) {
+	end = memchr(start, '\n', stop - start);
+	if(end == NULL)
+	  end = stop;
+	if(end > start)
+	  partp = parse_string_add_text(context, start, end - start);
+	if(partp != NULL && end < stop)
+	  partp = parse_string_add_break(context);
+	start = end + 1;
+      }
+    } else if(memchr(start, '\n', length) == NULL) {
+      if(length > 0)
+	partp = parse_string_add_text(context, start, length);
+    } else {
+      /* The lines in between are moved to the front of the buffer, which
+       * is then used for the block. The rest is copied before that.
+       */
+      if(tail_length > 0) {
+	tmp = malloc(tail_length);
+	if(tmp == NULL) {
+	  free(text);
+	  return NULL;
+	}
+	memcpy(tmp, tail, tail_length);
+	tail = tmp;
+      }
+
+      memmove(text, start, length);
+      text[length] = '\0';
+      tmp = realloc(text, length + 1);
+      if(tmp != NULL)
+	text = tmp;
+
+      number_of_lines = 1;
+      for(index = 0 ; index < length ; index++)
+	if(text[index] == '\n')
+	  number_of_lines++;
+
+      lines = (size_t *)malloc(number_of_lines * sizeof(size_t));
+      partp = layout_init_part(context->page, LAYOUT_PART_PREFORMATTED);
+      if(lines == NULL || partp == NULL) {
+	if(lines != NULL)
+	  free(lines);
+	if(partp != NULL)
+	  layout_free_part(partp);
+	if(tail_length > 0)
+	  free(tail);
+	free(text);
+	return NULL;
+      }
+
+      /* End each line where its newline was. */
+      lines[0] = 0;
+      start = text;
+      for(index = 1 ; index < number_of_lines ; index++) {
+	start = memchr(start, '\n', text + length - start);
+	*start++ = '\0';
+	lines[index] = start - text;
+      }
+
+      partp->data.preformatted.text = text;
+      partp->data.preformatted.length = length;
+      partp->data.preformatted.lines = lines;
+      partp->data.preformatted.number_of_lines = number_of_lines;
+      parse_state_get_current(context, &partp->data.preformatted.style,
+			      NULL, NULL);
+      parse_state_add_part(context, partp);
+      text = NULL;
+    }
+
+    while(partp != NULL && breaks-- > 0)
+      partp = parse_string_add_break(context);
+  }
+
+  if(partp != NULL && tail_length > 0)
+    partp = parse_string_add_text(context, tail, tail_length);
+
+  if(text == NULL && tail_length > 0)
+    free(tail);
+  if(text != NULL)
+    free(text);
+
+  return partp;
 }
 
 /**
@@ -434,60 +660,68 @@ void parse_string_convert_character_entities(void)
  * This reads the current text style from the style state stack, and
  * uses the right style for the right text.
  *
+ * @param context The parser context of the document.
+ *
  * @return a pointer to the layout part that was just added to the list
  * @return or NULL if there was no string stored.
  */
-struct layout_part *parse_string_store_current(void)
+struct layout_part *parse_string_store_current(struct parse_context *context)
 {
+  struct parse_string *string = &context->string;
   char *text;
   int string_length;
   struct layout_part *partp;
   struct layout_text_styles current_style;
-  static int last_was_space = 1;
   
   /* Get the current styles of the text to be stored. */
-  parse_state_get_current(&current_style, NULL, NULL);
+  parse_state_get_current(context, &current_style, NULL, NULL);
 
   /* If the page says that this particular piece of text is to be rendered
    * preformatted, then so be it, and we must not modify it by cutting off
    * excess whitespaces.
    */
   if(!current_style.preformatted) {
-    parse_string_trim(last_was_space);
+    parse_string_trim(context, string->last_was_space);
   }
 
-  string_length = parse_string_get_length();
+  string_length = parse_string_get_length(context);
   if(string_length > 0) {
-    text = malloc(string_length + 1);
-    if(text == NULL)
-      return NULL;
-
     /* Convert HTML coded characters into ISO-8859-1. 
      * Only do this, if the text is not marked as direct quote.
      */
     if(!current_style.directquote)
-      parse_string_convert_character_entities();
+      parse_string_convert_character_entities(context);
+
+    /* Preformatted text may have several lines. */
+    if(memchr(string->text, '\n', string->length) != NULL)
+      return parse_string_add_lines(context);
+
+    text = layout_alloc_string(context->page, string_length + 1);
+    if(text == NULL)
+      return NULL;
 
-    parse_string_get_stored(text, string_length + 1);
-    partp = layout_init_part(LAYOUT_PART_TEXT);
+    parse_string_get_stored(context, text, string_length + 1);
+    partp = layout_init_part(context->page, LAYOUT_PART_TEXT);
     if(partp == NULL) {
-      free(text);
+      layout_free_string(context->page, text);
       return NULL;
     }
 
-    partp->data.text.text = text;
+    layout_set_text(partp, text);
     partp->data.text.style = current_style;
-    layout_add_part(partp);
 
-    if(isspace((int)text[strlen(text) - 1]))
-      last_was_space = 1;
+    /* The text may be merged with the one before it, when it is added. */
+    if(isspace((int)text[partp->data.text.length - 1]))
+      string->last_was_space = 1;
     else
-      last_was_space = 0;
+      string->last_was_space = 0;
+
+    parse_state_add_part(context, partp);
   } else {
     /* If the string was trimmed away completely, we still need to discard
      * what might be left of it. 
      */
-    parse_string_discard();
+    parse_string_discard(context);
     return NULL;
   }
 
@@ -499,38 +733,38 @@ struct layout_part *parse_string_store_current(void)
  * What is special about this is that it is always placed first in the
  * linked list or parts. 
  *
+ * @param context The parser context of the document.
+ *
  * @return non-zero value if an error occurred.
  */
-int parse_string_store_title(void)
+int parse_string_store_title(struct parse_context *context)
 {
   char *text;
   int string_length;
   struct layout_part *partp;
   
-  parse_string_trim(0);
-  string_length = parse_string_get_length();
+  partp = context->page;
+
+  if(partp == NULL) {
+    partp = layout_init_part(NULL, LAYOUT_PART_PAGE_INFORMATION);
+    if(partp == NULL)
+      return 1;
+    parse_state_add_part(context, partp);
+  }
+
+  /* The title is kept together with the other strings of the page. */
+  parse_string_trim(context, 0);
+  string_length = parse_string_get_length(context);
   if(string_length > 0) {
-    text = malloc(string_length + 1);
+    text = layout_alloc_string(partp, string_length + 1);
     if(text == NULL)
       return 1;
-    parse_string_get_stored(text, string_length + 1);
+    parse_string_get_stored(context, text, string_length + 1);
   } else {
     /* If the string was trimmed away, save NULL in the title text. */
-    parse_string_discard();
+    parse_string_discard(context);
     text = NULL;
   }
-
-  partp = layout_get_page_information(NULL);
-
-  if(partp == NULL) {
-    partp = layout_init_part(LAYOUT_PART_PAGE_INFORMATION);
-    if(partp == NULL) {
-      if(text)
-	free(text);
-      return 1;
-    }
-    layout_add_part(partp);
-  }
   
   /* At this point, we will change the real part by changing what is in
    * the pointer partp.
@@ -543,11 +777,15 @@ int parse_string_store_title(void)
 
 /**
  * Prints the currently stored string.
+ *
+ * @param context The parser context of the document.
  */
-void debug_dump_string(void)
+void debug_dump_string(struct parse_context *context)
 {
-  if(internal_string)
-    fprintf(stderr, "String: '%s'\n", internal_string);
+  struct parse_string *string = &context->string;
+
+  if(string->text)
+    fprintf(stderr, "String: '%s'\n", string->text);
   else 
     fprintf(stderr, "String: (null)\n");
 }
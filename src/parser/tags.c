@@ -33,6 +33,8 @@
 #include "helpers.h"
 #include "tags.h"
 #include "states.h"
+#include "parse.h"
+#include "context.h"
 #include "layout.h"
 #include "ui.h"
 
@@ -53,58 +55,50 @@
  * alink - The colour of active links, whatever that is.
  * vlink - The colour of visited links.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_body(struct parse_tag *tagp)
+int parse_tag_function_body(struct parse_context *context,
+			    struct parse_tag *tagp)
 {
   struct layout_part *partp;
   struct layout_aligns align;
 
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
-      partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+      partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
       if(partp == NULL) {
 	return 1;
       }
-      parse_state_get_current(NULL, &align, NULL);
+      parse_state_get_current(context, NULL, &align, NULL);
       align.horizontal = LAYOUT_PART_ALIGN_LEFT;
-      parse_state_push(tagp->name, NULL, &align, NULL);
-      layout_add_part(partp);
+      parse_state_push(context, tagp->name, NULL, &align, NULL);
+      parse_state_add_part(context, partp);
 
       /* Get the page information part, and fill it up with values. */
-      partp = layout_get_page_information(NULL);
+      partp = context->page;
       if(partp != NULL) {
-	char *param_value;
-	
-	param_value = parse_get_param_value(tagp->first, "bgcolor");
-	if(param_value)
-	  partp->data.page_information.background_colour = 
-	    parse_convert_colour(param_value);
-
-	param_value = parse_get_param_value(tagp->first, "text");
-	if(param_value)
-	  partp->data.page_information.text_colour = 
-	    parse_convert_colour(param_value);
-
-	param_value = parse_get_param_value(tagp->first, "link");
-	if(param_value)
-	  partp->data.page_information.link_colour = 
-	    parse_convert_colour(param_value);
-	  
-	param_value = parse_get_param_value(tagp->first, "alink");
-	if(param_value)
-	  partp->data.page_information.active_link_colour = 
-	    parse_convert_colour(param_value);
-	  
-	param_value = parse_get_param_value(tagp->first, "vlink");
-	if(param_value)
-	  partp->data.page_information.visited_link_colour = 
-	    parse_convert_colour(param_value);
+	static char *names[] = { "bgcolor", "text", "link", "alink", "vlink",
+				 NULL };
+	uint32_t *colours[5];
+	char *values[5];
+	int i;
+
+	colours[0] = &partp->data.page_information.background_colour;
+	colours[1] = &partp->data.page_information.text_colour;
+	colours[2] = &partp->data.page_information.link_colour;
+	colours[3] = &partp->data.page_information.active_link_colour;
+	colours[4] = &partp->data.page_information.visited_link_colour;
+
+	parse_get_param_values(tagp->first, names, values);
+	for(i = 0 ; i < 5 ; i++)
+	  if(values[i])
+	    *colours[i] = parse_convert_colour(values[i]);
       }
 
       break;
@@ -130,16 +124,18 @@ int parse_tag_function_body(struct parse_tag *tagp)
  *
  * This tag has no parameters.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_title(struct parse_tag *tagp)
+int parse_tag_function_title(struct parse_context *context,
+			     struct parse_tag *tagp)
 {
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
-      parse_string_store_current();
+      parse_string_store_current(context);
       break;
     }
   
@@ -148,7 +144,7 @@ int parse_tag_function_title(struct parse_tag *tagp)
       /* Put the page title first in the internal list. This is done by
        * the function we are about to call. 
        */
-      parse_string_store_title();
+      parse_string_store_title(context);
       break;
     }
 
@@ -166,23 +162,25 @@ int parse_tag_function_title(struct parse_tag *tagp)
  *
  * Currently supported parameters:
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_script(struct parse_tag *tagp)
+int parse_tag_function_script(struct parse_context *context,
+			      struct parse_tag *tagp)
 {
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
-      parse_string_store_current();
+      parse_string_store_current(context);
       break;
     }
   
   case PARSE_TAG_END:
     {
       /* Just throw away anything that is within a script container. */
-      parse_string_discard();
+      parse_string_discard(context);
       break;
     }
 
@@ -201,23 +199,25 @@ int parse_tag_function_script(struct parse_tag *tagp)
  * Currently supported parameters:
  * href - The hyperlink reference for the new base URL.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_base(struct parse_tag *tagp)
+int parse_tag_function_base(struct parse_context *context,
+			    struct parse_tag *tagp)
 {
   struct layout_part *partp;
 
   /* Get the page information part, and fill it up with values. */
-  partp = layout_get_page_information(NULL);
+  partp = context->page;
   if(partp != NULL) {
     char *param_value, *href;
 	
     param_value = parse_get_param_value(tagp->first, "href");
     if(param_value != NULL) {
       if(strlen(param_value) > 0) {
-	href = malloc(strlen(param_value) + 1);
+	href = layout_alloc_string(partp, strlen(param_value) + 1);
 	if(href == NULL) {
 	  return 1;
 	}
@@ -240,26 +240,28 @@ int parse_tag_function_base(struct parse_tag *tagp)
  * Currently supported parameters:
  * align - (p only) Alignment of this paragraph.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_paragraph(struct parse_tag *tagp)
+int parse_tag_function_paragraph(struct parse_context *context,
+				 struct parse_tag *tagp)
 {
   struct layout_part *partp;
   struct layout_aligns align;
 
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
-      partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+      partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
       if(partp == NULL) {
 	return 1;
       }
 
-      parse_state_get_current(NULL, &align, NULL);
+      parse_state_get_current(context, NULL, &align, NULL);
       
       if(!strcmp(tagp->name, "p")) {
 	char *align_text;
@@ -291,17 +293,17 @@ int parse_tag_function_paragraph(struct parse_tag *tagp)
 	 * current state before this, if it was another <p>-tag.
 	 */
 	if(valid_align) {
-	  if(!strcmp(parse_state_peek(), tagp->name))
-	    parse_state_pop(tagp->name, 0);
-	  parse_state_push(tagp->name, NULL, &align, NULL);
+	  if(!strcmp(parse_state_peek(context), tagp->name))
+	    parse_state_pop(context, tagp->name, 0);
+	  parse_state_push(context, tagp->name, NULL, &align, NULL);
 	}
       } else if(!strcmp(tagp->name, "center")) {
 	align.horizontal = LAYOUT_PART_ALIGN_FORCED_CENTER;
 	partp->data.paragraph.paragraph = 1;
-	parse_state_push(tagp->name, NULL, &align, NULL);
+	parse_state_push(context, tagp->name, NULL, &align, NULL);
       }
 
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
       break;
     }
 
@@ -316,21 +318,21 @@ int parse_tag_function_paragraph(struct parse_tag *tagp)
       /* If we are inside a forced center, and this is an ending p-tag, 
        * we should not pop the state here.
        */
-      parse_state_get_current(NULL, &align, NULL);
+      parse_state_get_current(context, NULL, &align, NULL);
       if(align.horizontal == LAYOUT_PART_ALIGN_FORCED_CENTER &&
 	 !strcmp(tagp->name, "center"))
-	parse_state_pop(tagp->name, 0);
+	parse_state_pop(context, tagp->name, 0);
       else if(align.horizontal != LAYOUT_PART_ALIGN_FORCED_CENTER)
-	parse_state_pop(tagp->name, 0);
+	parse_state_pop(context, tagp->name, 0);
 
-      partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+      partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
       if(partp == NULL) {
 	return 1;
       }
       if(!strcmp(tagp->name, "center")) {
 	partp->data.paragraph.paragraph = 1;
       }
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
       break;
     }
 
@@ -349,22 +351,24 @@ int parse_tag_function_paragraph(struct parse_tag *tagp)
  * Currently supported parameters:
  * align - Alignment of parts.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_division(struct parse_tag *tagp)
+int parse_tag_function_division(struct parse_context *context,
+				struct parse_tag *tagp)
 {
   struct layout_aligns align;
 
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
       char *align_text;
 
-      parse_state_get_current(NULL, &align, NULL);
+      parse_state_get_current(context, NULL, &align, NULL);
       
       align_text = parse_get_param_value(tagp->first, "align");
       if(align_text) {
@@ -379,13 +383,13 @@ int parse_tag_function_division(struct parse_tag *tagp)
       } else if(align.horizontal != LAYOUT_PART_ALIGN_FORCED_CENTER) {
 	align.horizontal = LAYOUT_PART_ALIGN_LEFT;
       }
-      parse_state_push(tagp->name, NULL, &align, NULL);
+      parse_state_push(context, tagp->name, NULL, &align, NULL);
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 1);
+      parse_state_pop(context, tagp->name, 1);
       break;
     }
 
@@ -410,13 +414,15 @@ int parse_tag_function_division(struct parse_tag *tagp)
  * bgcolor - The background colour to use in table cells.
  * align - The alignment of the whole table.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_table(struct parse_tag *tagp)
+int parse_tag_function_table(struct parse_context *context,
+			     struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
@@ -429,7 +435,7 @@ int parse_tag_function_table(struct parse_tag *tagp)
        */
       if(user_interface.ui_support.table) {
 	/* Initialize the part to be placed in the main part list. */
-	partp = layout_init_part(LAYOUT_PART_TABLE);
+	partp = layout_init_part(context->page, LAYOUT_PART_TABLE);
 	if(partp == NULL) {
 	  return 1;
 	}
@@ -477,10 +483,10 @@ int parse_tag_function_table(struct parse_tag *tagp)
 	    partp->data.table.height_type = LAYOUT_SIZE_ABSOLUTE;
 	}
 
-	layout_add_part(partp);
+	parse_state_add_part(context, partp);
 
 	/* The alignment must be set after it has been added, since the
-	 * layout_add_part() function will set it first.
+	 * parse_state_add_part() function will set it first.
 	 */
 	param_value = parse_get_param_value(tagp->first, "align");
 	if(param_value) {
@@ -497,14 +503,14 @@ int parse_tag_function_table(struct parse_tag *tagp)
 	/* The whole table goes into a subsection, so everything within
 	 * the table will end up as child parts of this part.
 	 */
-	parse_state_push(tagp->name, NULL, NULL, &partp);
+	parse_state_push(context, tagp->name, NULL, NULL, &partp);
       } else {
-	partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+	partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
 	if(partp == NULL) {
 	  return 1;
 	}
 	partp->data.paragraph.paragraph = 1;
-	layout_add_part(partp);
+	parse_state_add_part(context, partp);
       }
       break;
     }
@@ -521,20 +527,20 @@ int parse_tag_function_table(struct parse_tag *tagp)
 	 * But all this, only if we are inside a table row, table cell, or
 	 * the table itself.
 	 */
-	parse_state_get_current(NULL, NULL, &partp);
+	parse_state_get_current(context, NULL, NULL, &partp);
 	if(partp && 
 	   (partp->type == LAYOUT_PART_TABLE_CELL ||
 	    partp->type == LAYOUT_PART_TABLE_ROW ||
 	    partp->type == LAYOUT_PART_TABLE))
-	  parse_state_pop(tagp->name, 1);
+	  parse_state_pop(context, tagp->name, 1);
       } else {
 	/* Always begin on a new line after a table. */
-	partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+	partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
 	if(partp == NULL) {
 	  return 1;
 	}
 	partp->data.paragraph.paragraph = 1;
-	layout_add_part(partp);
+	parse_state_add_part(context, partp);
       }
 
       break;
@@ -555,13 +561,15 @@ int parse_tag_function_table(struct parse_tag *tagp)
  * Currently supported parameters:
  * bgcolor - The background colour to use in table cells.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_table_row(struct parse_tag *tagp)
+int parse_tag_function_table_row(struct parse_context *context,
+				 struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
@@ -578,17 +586,17 @@ int parse_tag_function_table_row(struct parse_tag *tagp)
 	 * therefore end it here, and go on as usual with the next row.
 	 * If we are inside a table cell, we need to leave that first.
 	 */
-	parse_state_get_current(NULL, NULL, &partp);
+	parse_state_get_current(context, NULL, NULL, &partp);
 	if(partp && partp->type == LAYOUT_PART_TABLE_CELL) {
-	  parse_state_pop("td", 1);
-	  parse_state_get_current(NULL, NULL, &partp);
+	  parse_state_pop(context, "td", 1);
+	  parse_state_get_current(context, NULL, NULL, &partp);
 	}
 	if(partp && partp->type == LAYOUT_PART_TABLE_ROW) {
-	  parse_state_pop("tr", 1);
+	  parse_state_pop(context, "tr", 1);
 	}
 
 	/* Initialize the part to be placed in the main part list. */
-	partp = layout_init_part(LAYOUT_PART_TABLE_ROW);
+	partp = layout_init_part(context->page, LAYOUT_PART_TABLE_ROW);
 	if(partp == NULL) {
 	  return 1;
 	}
@@ -601,24 +609,24 @@ int parse_tag_function_table_row(struct parse_tag *tagp)
 	  partp->data.table_row.background_colour =
 	    parse_convert_colour(param_value);
 	} else {
-	  parse_state_get_current(NULL, NULL, &table);
+	  parse_state_get_current(context, NULL, NULL, &table);
 	  if(table && table->type == LAYOUT_PART_TABLE)
 	    partp->data.table_row.background_colour = 
 	      table->data.table.background_colour;
 	}
 	
-	layout_add_part(partp);
+	parse_state_add_part(context, partp);
 
 	/* Everything within this particular table row will be child parts
 	 * of this part.
 	 */
-	parse_state_push(tagp->name, NULL, NULL, &partp);
+	parse_state_push(context, tagp->name, NULL, NULL, &partp);
       } else {
-	partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+	partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
 	if(partp == NULL) {
 	  return 1;
 	}
-	layout_add_part(partp);
+	parse_state_add_part(context, partp);
       }
       break;
     }
@@ -632,9 +640,9 @@ int parse_tag_function_table_row(struct parse_tag *tagp)
 	/* If the current base is not a table row, we should not end
 	 * the current.
 	 */
-	parse_state_get_current(NULL, NULL, &partp);
+	parse_state_get_current(context, NULL, NULL, &partp);
 	if(partp && partp->type == LAYOUT_PART_TABLE_ROW)
-	  parse_state_pop(tagp->name, 1);
+	  parse_state_pop(context, tagp->name, 1);
       }
       break;
     }
@@ -661,13 +669,15 @@ int parse_tag_function_table_row(struct parse_tag *tagp)
  * valign - The vertical alignment of the content of the table cell.
  * bgcolor - The background colour to use in this table cell.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_table_cell(struct parse_tag *tagp)
+int parse_tag_function_table_cell(struct parse_context *context,
+				  struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
@@ -675,7 +685,7 @@ int parse_tag_function_table_cell(struct parse_tag *tagp)
       struct layout_part *partp, *table_row;
       struct layout_aligns align;
       struct layout_text_styles style;
-      char *param_value;
+      char *param_value, *text;
 
       /* If the user interface know how to handle tables, we make it,
        * otherwise, we simple make a new paragraph here.
@@ -685,13 +695,13 @@ int parse_tag_function_table_cell(struct parse_tag *tagp)
 	 * the HTML page does not use the ending table cell tags. We
 	 * therefore end it here, and go on as usual with the next cell.
 	 */
-	parse_state_get_current(NULL, NULL, &partp);
+	parse_state_get_current(context, NULL, NULL, &partp);
 	if(partp && partp->type == LAYOUT_PART_TABLE_CELL) {
-	  parse_state_pop("td", 1);
+	  parse_state_pop(context, "td", 1);
 	}
 
 	/* Initialize the part to be placed in the main part list. */
-	partp = layout_init_part(LAYOUT_PART_TABLE_CELL);
+	partp = layout_init_part(context->page, LAYOUT_PART_TABLE_CELL);
 	if(partp == NULL) {
 	  return 1;
 	}
@@ -712,7 +722,7 @@ int parse_tag_function_table_cell(struct parse_tag *tagp)
 	  partp->data.table_cell.background_colour =
 	    parse_convert_colour(param_value);
 	} else {
-	  parse_state_get_current(NULL, NULL, &table_row);
+	  parse_state_get_current(context, NULL, NULL, &table_row);
 	  if(table_row && table_row->type == LAYOUT_PART_TABLE_ROW)
 	    partp->data.table_cell.background_colour = 
 	      table_row->data.table_row.background_colour;
@@ -748,24 +758,26 @@ int parse_tag_function_table_cell(struct parse_tag *tagp)
 	 * cell will be the actual text, images, or something else.
 	 */
 
-	layout_add_part(partp);
+	parse_state_add_part(context, partp);
 
       } else {
 	/* This is for user interface which do not support tables. */
 
-	partp = layout_init_part(LAYOUT_PART_TEXT);
+	partp = layout_init_part(context->page, LAYOUT_PART_TEXT);
 	if(partp == NULL) {
 	  return 1;
 	}
-	partp->data.text.text = (char *)malloc(2);
-	if(partp->data.text.text == NULL) {
+	text = layout_alloc_string(partp, 2);
+	if(text == NULL) {
+	  layout_free_part(partp);
 	  return 1;
 	}
-	strcpy(partp->data.text.text, " ");
-	parse_state_get_current(&style, NULL, NULL);
+	strcpy(text, " ");
+	layout_set_text(partp, text);
+	parse_state_get_current(context, &style, NULL, NULL);
 	partp->data.text.style = style;
 
-	layout_add_part(partp);
+	parse_state_add_part(context, partp);
       }
 
       /* Use default states within the table. */
@@ -807,9 +819,9 @@ int parse_tag_function_table_cell(struct parse_tag *tagp)
        * sure to pop it again in the <tr> tag, if necessary.
        */
       if(user_interface.ui_support.table) {
-	parse_state_push("td", &style, &align, &partp);
+	parse_state_push(context, "td", &style, &align, &partp);
       } else {
-	parse_state_push("td", &style, &align, NULL);
+	parse_state_push(context, "td", &style, &align, NULL);
       }
 
       break;
@@ -824,11 +836,11 @@ int parse_tag_function_table_cell(struct parse_tag *tagp)
 	/* If the current base is not a table cell, we should not end
 	 * the current.
 	 */
-	parse_state_get_current(NULL, NULL, &partp);
+	parse_state_get_current(context, NULL, NULL, &partp);
 	if(partp && partp->type == LAYOUT_PART_TABLE_CELL)
-	  parse_state_pop("td", 1);
+	  parse_state_pop(context, "td", 1);
       } else {
-	parse_state_pop("td", 1);
+	parse_state_pop(context, "td", 1);
       }
 
       break;
@@ -849,17 +861,19 @@ int parse_tag_function_table_cell(struct parse_tag *tagp)
  *
  * Currently supported parameters:
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_list(struct parse_tag *tagp)
+int parse_tag_function_list(struct parse_context *context,
+			    struct parse_tag *tagp)
 {
   struct layout_part *partp;
   struct layout_aligns align;
   int old_indent_offset;
 
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
@@ -871,34 +885,34 @@ int parse_tag_function_list(struct parse_tag *tagp)
        * In any case, we must do this before creating the paragraph
        * layout part, because the layouter expects it to be the so.
        */
-      parse_state_get_current(NULL, &align, NULL);
+      parse_state_get_current(context, NULL, &align, NULL);
       old_indent_offset = align.indent_offset;
       align.indent_offset += 40;
-      parse_state_push(tagp->name, NULL, &align, NULL);
+      parse_state_push(context, tagp->name, NULL, &align, NULL);
 
-      partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+      partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
       if(partp == NULL) {
 	return 1;
       }
       if(old_indent_offset == 0)
 	partp->data.paragraph.paragraph = 1;
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
 
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 0);
-      parse_state_get_current(NULL, &align, NULL);
+      parse_state_pop(context, tagp->name, 0);
+      parse_state_get_current(context, NULL, &align, NULL);
 
-      partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+      partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
       if(partp == NULL) {
 	return 1;
       }
       if(align.indent_offset == 0)
 	partp->data.paragraph.paragraph = 1;
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
 
       break;
     }
@@ -917,22 +931,24 @@ int parse_tag_function_list(struct parse_tag *tagp)
  *
  * Currently supported parameters:
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_list_item(struct parse_tag *tagp)
+int parse_tag_function_list_item(struct parse_context *context,
+				 struct parse_tag *tagp)
 {
   struct layout_part *partp;
 
   if(tagp->type == PARSE_TAG_START) {
-    parse_string_store_current();
+    parse_string_store_current(context);
     
-    partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+    partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
     if(partp == NULL) {
       return 1;
     }
-    layout_add_part(partp);
+    parse_state_add_part(context, partp);
   }  
 
   return 0;
@@ -951,15 +967,17 @@ int parse_tag_function_list_item(struct parse_tag *tagp)
  * Currently supported parameters:
  * align - The horizontal alignment of the header.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_header(struct parse_tag *tagp)
+int parse_tag_function_header(struct parse_context *context,
+			      struct parse_tag *tagp)
 {
   struct layout_part *partp;
 
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
@@ -968,14 +986,14 @@ int parse_tag_function_header(struct parse_tag *tagp)
       struct layout_text_styles style;
       char *align_text;
 
-      parse_state_get_current(&style, &align, NULL);
+      parse_state_get_current(context, &style, &align, NULL);
 
-      partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+      partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
       if(partp == NULL) {
 	return 1;
       }
       partp->data.paragraph.paragraph = 1;
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
 
       align_text = parse_get_param_value(tagp->first, "align");
       if(align_text) {
@@ -1012,18 +1030,18 @@ int parse_tag_function_header(struct parse_tag *tagp)
       }
       style.bold = 1;
 
-      parse_state_push(tagp->name, &style, &align, NULL);
+      parse_state_push(context, tagp->name, &style, &align, NULL);
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 0);
-      partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+      parse_state_pop(context, tagp->name, 0);
+      partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
       if(partp == NULL) {
 	return 1;
       }
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
       break;
     }
 
@@ -1041,28 +1059,30 @@ int parse_tag_function_header(struct parse_tag *tagp)
  *
  * This tag has no parameters.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_underline(struct parse_tag *tagp)
+int parse_tag_function_underline(struct parse_context *context,
+				 struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
       struct layout_text_styles style;
 
-      parse_state_get_current(&style, NULL, NULL);
+      parse_state_get_current(context, &style, NULL, NULL);
       style.underlined = 1;
-      parse_state_push(tagp->name, &style, NULL, NULL);
+      parse_state_push(context, tagp->name, &style, NULL, NULL);
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 0);
+      parse_state_pop(context, tagp->name, 0);
       break;
     }
 
@@ -1082,28 +1102,30 @@ int parse_tag_function_underline(struct parse_tag *tagp)
  *
  * This tag has no parameters.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_italic(struct parse_tag *tagp)
+int parse_tag_function_italic(struct parse_context *context,
+			      struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
       struct layout_text_styles style;
 
-      parse_state_get_current(&style, NULL, NULL);
+      parse_state_get_current(context, &style, NULL, NULL);
       style.italic = 1;
-      parse_state_push(tagp->name, &style, NULL, NULL);
+      parse_state_push(context, tagp->name, &style, NULL, NULL);
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 0);
+      parse_state_pop(context, tagp->name, 0);
       break;
     }
 
@@ -1122,28 +1144,30 @@ int parse_tag_function_italic(struct parse_tag *tagp)
  *
  * This tag has no parameters.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_bold(struct parse_tag *tagp)
+int parse_tag_function_bold(struct parse_context *context,
+			    struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
       struct layout_text_styles style;
 
-      parse_state_get_current(&style, NULL, NULL);
+      parse_state_get_current(context, &style, NULL, NULL);
       style.bold = 1;
-      parse_state_push(tagp->name, &style, NULL, NULL);
+      parse_state_push(context, tagp->name, &style, NULL, NULL);
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 0);
+      parse_state_pop(context, tagp->name, 0);
       break;
     }
 
@@ -1161,28 +1185,30 @@ int parse_tag_function_bold(struct parse_tag *tagp)
  *
  * This tag has no parameters.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_big(struct parse_tag *tagp)
+int parse_tag_function_big(struct parse_context *context,
+			   struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
       struct layout_text_styles style;
 
-      parse_state_get_current(&style, NULL, NULL);
+      parse_state_get_current(context, &style, NULL, NULL);
       style.size += 2;
-      parse_state_push(tagp->name, &style, NULL, NULL);
+      parse_state_push(context, tagp->name, &style, NULL, NULL);
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 0);
+      parse_state_pop(context, tagp->name, 0);
       break;
     }
 
@@ -1200,28 +1226,30 @@ int parse_tag_function_big(struct parse_tag *tagp)
  *
  * This tag has no parameters.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_small(struct parse_tag *tagp)
+int parse_tag_function_small(struct parse_context *context,
+			     struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
     {
       struct layout_text_styles style;
 
-      parse_state_get_current(&style, NULL, NULL);
+      parse_state_get_current(context, &style, NULL, NULL);
       style.size -= 2;
-      parse_state_push(tagp->name, &style, NULL, NULL);
+      parse_state_push(context, tagp->name, &style, NULL, NULL);
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 0);
+      parse_state_pop(context, tagp->name, 0);
       break;
     }
 
@@ -1242,13 +1270,15 @@ int parse_tag_function_small(struct parse_tag *tagp)
  * size - The size of the font, absolute or relative.
  * color - The american colour of the font.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_font(struct parse_tag *tagp)
+int parse_tag_function_font(struct parse_context *context,
+			    struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
@@ -1256,7 +1286,7 @@ int parse_tag_function_font(struct parse_tag *tagp)
       char *param_value;
       struct layout_text_styles style;
 
-      parse_state_get_current(&style, NULL, NULL);
+      parse_state_get_current(context, &style, NULL, NULL);
 
       /* Take care of the size parameter, if it is given. */
       param_value = parse_get_param_value(tagp->first, "size");
@@ -1280,13 +1310,13 @@ int parse_tag_function_font(struct parse_tag *tagp)
 	style.colour = parse_convert_colour(param_value);
       }
 
-      parse_state_push(tagp->name, &style, NULL, NULL);
+      parse_state_push(context, tagp->name, &style, NULL, NULL);
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 0);
+      parse_state_pop(context, tagp->name, 0);
       break;
     }
 
@@ -1304,15 +1334,17 @@ int parse_tag_function_font(struct parse_tag *tagp)
  *
  * This tag has no parameters.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_preformat(struct parse_tag *tagp)
+int parse_tag_function_preformat(struct parse_context *context,
+				 struct parse_tag *tagp)
 {
   struct layout_part *partp;
 
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
@@ -1320,31 +1352,31 @@ int parse_tag_function_preformat(struct parse_tag *tagp)
       struct layout_text_styles style;
 
       /* A text within a pre tag should begin at a new paragraph. */
-      partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+      partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
       if(partp == NULL) {
 	return 1;
       }
       partp->data.paragraph.paragraph = 1;
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
 
-      parse_state_get_current(&style, NULL, NULL);
+      parse_state_get_current(context, &style, NULL, NULL);
       style.preformatted = 1;
       style.monospaced = 1;
-      parse_state_push(tagp->name, &style, NULL, NULL);
+      parse_state_push(context, tagp->name, &style, NULL, NULL);
       break;
     }
 
   case PARSE_TAG_END:
     {
-      parse_state_pop(tagp->name, 0);
+      parse_state_pop(context, tagp->name, 0);
 
       /* The text right after a pre tag should begin at a new paragraph. */
-      partp = layout_init_part(LAYOUT_PART_PARAGRAPH);
+      partp = layout_init_part(context->page, LAYOUT_PART_PARAGRAPH);
       if(partp == NULL) {
 	return 1;
       }
       partp->data.paragraph.paragraph = 1;
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
 
       break;
     }
@@ -1364,13 +1396,15 @@ int parse_tag_function_preformat(struct parse_tag *tagp)
  * Currently supported parameters:
  * href - The URL to link to.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_anchor(struct parse_tag *tagp)
+int parse_tag_function_anchor(struct parse_context *context,
+			      struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
@@ -1382,16 +1416,16 @@ int parse_tag_function_anchor(struct parse_tag *tagp)
       /* If the current base already is a link part, we should end
        * that one right here. Why? Because Netscape says so.
        */
-      parse_state_get_current(NULL, NULL, &partp);
+      parse_state_get_current(context, NULL, NULL, &partp);
       if(partp && partp->type == LAYOUT_PART_LINK)
-	parse_state_pop(tagp->name, 0);
+	parse_state_pop(context, tagp->name, 0);
 
       /* Get the href URL for the link. */
       href = NULL;
       param_value = parse_get_param_value(tagp->first, "href");
       if(param_value != NULL) {
 	if(strlen(param_value) > 0) {
-	  href = malloc(strlen(param_value) + 1);
+	  href = layout_alloc_string(context->page, strlen(param_value) + 1);
 	  if(href == NULL) {
 	    return 1;
 	  }
@@ -1402,17 +1436,17 @@ int parse_tag_function_anchor(struct parse_tag *tagp)
       }
 
       /* Initialize the part to be placed in the main part list. */
-      partp = layout_init_part(LAYOUT_PART_LINK);
+      partp = layout_init_part(context->page, LAYOUT_PART_LINK);
       if(partp == NULL) {
-	free(href);
+	layout_free_string(context->page, href);
 	return 1;
       }
 
       partp->data.link.href = href;
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
 
       /* Set the text style for links. */
-      parse_state_get_current(&style, NULL, NULL);
+      parse_state_get_current(context, &style, NULL, NULL);
       style.underlined = 1;
       style.colour = 0x400000ff;
 
@@ -1420,7 +1454,7 @@ int parse_tag_function_anchor(struct parse_tag *tagp)
        * end up as a child tree to the original anchor part.
        * Push the new text style at the same time.
        */
-      parse_state_push(tagp->name, &style, NULL, &partp);
+      parse_state_push(context, tagp->name, &style, NULL, &partp);
 
       break;
     }
@@ -1432,9 +1466,9 @@ int parse_tag_function_anchor(struct parse_tag *tagp)
       /* If the current base is not a link part, we should not end
        * the current.
        */
-      parse_state_get_current(NULL, NULL, &partp);
+      parse_state_get_current(context, NULL, NULL, &partp);
       if(partp && partp->type == LAYOUT_PART_LINK)
-	parse_state_pop(tagp->name, 0);
+	parse_state_pop(context, tagp->name, 0);
 
       break;
     }
@@ -1455,18 +1489,20 @@ int parse_tag_function_anchor(struct parse_tag *tagp)
  * width - Width of line, absolute or relative.
  * size - The height of the line.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_hr(struct parse_tag *tagp)
+int parse_tag_function_hr(struct parse_context *context,
+			  struct parse_tag *tagp)
 {
   char *param_value;
   struct layout_part *partp;
 
-  parse_string_store_current();
+  parse_string_store_current(context);
 
-  partp = layout_init_part(LAYOUT_PART_LINE);
+  partp = layout_init_part(context->page, LAYOUT_PART_LINE);
   if(partp == NULL) {
     return 1;
   }
@@ -1483,11 +1519,12 @@ int parse_tag_function_hr(struct parse_tag *tagp)
     partp->data.line.size = atoi(param_value);
   }
 
-  layout_add_part(partp);
+  parse_state_add_part(context, partp);
 
   /* Horizontal lines are always centered, as far as I know. 
-   * We need to set this after we have added the part, since layout_add_part()
-   * will set the alignment according to the current state.
+   * We need to set this after we have added the part, since 
+   * parse_state_add_part() will set the alignment according to the 
+   * current state.
    */
   partp->align.horizontal = LAYOUT_PART_ALIGN_CENTER;
 
@@ -1506,11 +1543,13 @@ int parse_tag_function_hr(struct parse_tag *tagp)
  * alt - Alternative text for the image.
  * align - Vertical alignment of the image relative to the surrounding text.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_image(struct parse_tag *tagp)
+int parse_tag_function_image(struct parse_context *context,
+			     struct parse_tag *tagp)
 {
   char *alt_text, *src_text, *param_value;
   struct layout_part *partp;
@@ -1524,28 +1563,28 @@ int parse_tag_function_image(struct parse_tag *tagp)
 
     param_value = parse_get_param_value(tagp->first, "alt");
     if(param_value == NULL || strlen(param_value) == 0) {
-      parse_string_store_character('[');
-      parse_string_store_character('I');
-      parse_string_store_character('M');
-      parse_string_store_character('A');
-      parse_string_store_character('G');
-      parse_string_store_character('E');
-      parse_string_store_character(']');
+      parse_string_store_character(context, '[');
+      parse_string_store_character(context, 'I');
+      parse_string_store_character(context, 'M');
+      parse_string_store_character(context, 'A');
+      parse_string_store_character(context, 'G');
+      parse_string_store_character(context, 'E');
+      parse_string_store_character(context, ']');
     } else {
       for(i = 0 ; i < strlen(param_value) ; i++)
-	parse_string_store_character(param_value[i]);
+	parse_string_store_character(context, param_value[i]);
     }
     return 0;
   }
 
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   /* Get the alternative text from the image tag, if any. */
   alt_text = NULL;
   param_value = parse_get_param_value(tagp->first, "alt");
   if(param_value != NULL) {
     if(strlen(param_value) > 0) {
-      alt_text = malloc(strlen(param_value) + 1);
+      alt_text = layout_alloc_string(context->page, strlen(param_value) + 1);
       if(alt_text == NULL)
 	return 1;
       strcpy(alt_text, param_value);
@@ -1557,10 +1596,10 @@ int parse_tag_function_image(struct parse_tag *tagp)
   param_value = parse_get_param_value(tagp->first, "src");
   if(param_value != NULL) {
     if(strlen(param_value) > 0) {
-      src_text = malloc(strlen(param_value) + 1);
+      src_text = layout_alloc_string(context->page, strlen(param_value) + 1);
       if(src_text == NULL) {
 	if(alt_text)
-	  free(alt_text);
+	  layout_free_string(context->page, alt_text);
 	return 1;
       }
       strcpy(src_text, param_value);
@@ -1588,12 +1627,12 @@ int parse_tag_function_image(struct parse_tag *tagp)
   else
     border = 0;
 
-  partp = layout_init_part(LAYOUT_PART_GRAPHICS);
+  partp = layout_init_part(context->page, LAYOUT_PART_GRAPHICS);
   if(partp == NULL) {
     if(alt_text)
-      free(alt_text);
+      layout_free_string(context->page, alt_text);
     if(src_text)
-      free(src_text);
+      layout_free_string(context->page, src_text);
     return 1;
   }
 
@@ -1606,7 +1645,7 @@ int parse_tag_function_image(struct parse_tag *tagp)
   partp->data.graphics.border = border;
   partp->geometry.width = width;
   partp->geometry.height = height;
-  layout_add_part(partp);
+  parse_state_add_part(context, partp);
 
   /* Set the vertical alignment, if it is specified. */
   param_value = parse_get_param_value(tagp->first, "align");
@@ -1633,13 +1672,15 @@ int parse_tag_function_image(struct parse_tag *tagp)
  * method - The request method to use for this form.
  * action - The URL to call on submit.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_form(struct parse_tag *tagp)
+int parse_tag_function_form(struct parse_context *context,
+			    struct parse_tag *tagp)
 {
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   switch(tagp->type) {
   case PARSE_TAG_START:
@@ -1651,7 +1692,8 @@ int parse_tag_function_form(struct parse_tag *tagp)
       param_value = parse_get_param_value(tagp->first, "action");
       if(param_value != NULL) {
 	if(strlen(param_value) > 0) {
-	  action_text = malloc(strlen(param_value) + 1);
+	  action_text = layout_alloc_string(context->page,
+					    strlen(param_value) + 1);
 	  if(action_text == NULL) {
 	    return 1;
 	  }
@@ -1660,10 +1702,10 @@ int parse_tag_function_form(struct parse_tag *tagp)
       }
 
       /* Initialize the part to be placed in the main part list. */
-      partp = layout_init_part(LAYOUT_PART_FORM);
+      partp = layout_init_part(context->page, LAYOUT_PART_FORM);
       if(partp == NULL) {
 	if(action_text)
-	  free(action_text);
+	  layout_free_string(context->page, action_text);
 	return 1;
       }
       
@@ -1677,12 +1719,12 @@ int parse_tag_function_form(struct parse_tag *tagp)
 	  partp->data.form.method = LAYOUT_PART_FORM_POST;
       }      
       
-      layout_add_part(partp);
+      parse_state_add_part(context, partp);
       
       /* Arrange so that every part which is within the form tag will
        * end up as a child tree to this part.
        */
-      parse_state_push(tagp->name, NULL, NULL, &partp);
+      parse_state_push(context, tagp->name, NULL, NULL, &partp);
 
       break;
     }
@@ -1694,9 +1736,9 @@ int parse_tag_function_form(struct parse_tag *tagp)
       /* If the current base is not a form part, we should not end
        * the current.
        */
-      parse_state_get_current(NULL, NULL, &partp);
+      parse_state_get_current(context, NULL, NULL, &partp);
       if(partp && partp->type == LAYOUT_PART_FORM)
-	parse_state_pop(tagp->name, 0);
+	parse_state_pop(context, tagp->name, 0);
       else
 	fprintf(stderr, "Warning! Form end tag at wrong place.\n");
 
@@ -1720,16 +1762,18 @@ int parse_tag_function_form(struct parse_tag *tagp)
  * name - The name of the input thingie.
  * value - The default value of the input gizmo.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_tag_function_form_input(struct parse_tag *tagp)
+int parse_tag_function_form_input(struct parse_context *context,
+				  struct parse_tag *tagp)
 {
   struct layout_part *partp;
   char *param_value, *input_type, *name, *value;
 
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   input_type = parse_get_param_value(tagp->first, "type");
   if(input_type == NULL) {
@@ -1740,7 +1784,7 @@ int parse_tag_function_form_input(struct parse_tag *tagp)
   param_value = parse_get_param_value(tagp->first, "name");
   if(param_value != NULL) {
     if(strlen(param_value) > 0) {
-      name = malloc(strlen(param_value) + 1);
+      name = layout_alloc_string(context->page, strlen(param_value) + 1);
       if(name == NULL) {
 	return 1;
       }
@@ -1751,10 +1795,10 @@ int parse_tag_function_form_input(struct parse_tag *tagp)
   value = NULL;
   param_value = parse_get_param_value(tagp->first, "value");
   if(param_value != NULL) {
-    value = malloc(strlen(param_value) + 1);
+    value = layout_alloc_string(context->page, strlen(param_value) + 1);
     if(value == NULL) {
       if(name)
-	free(name);
+	layout_free_string(context->page, name);
       return 1;
     }
     strcpy(value, param_value);
@@ -1770,24 +1814,24 @@ int parse_tag_function_form_input(struct parse_tag *tagp)
    */
   if(!strcasecmp(input_type, "submit") ||
      !strcasecmp(input_type, "button")) {
-    partp = layout_init_part(LAYOUT_PART_FORM_SUBMIT);
+    partp = layout_init_part(context->page, LAYOUT_PART_FORM_SUBMIT);
     if(partp == NULL) {
       if(value)
-	free(value);
+	layout_free_string(context->page, value);
       if(name)
-	free(name);
+	layout_free_string(context->page, name);
       return 1;
     }
 
     partp->data.form_submit.name = name;
     partp->data.form_submit.value = value;
   } else if(!strcasecmp(input_type, "checkbox")) {
-    partp = layout_init_part(LAYOUT_PART_FORM_CHECKBOX);
+    partp = layout_init_part(context->page, LAYOUT_PART_FORM_CHECKBOX);
     if(partp == NULL) {
       if(value)
-	free(value);
+	layout_free_string(context->page, value);
       if(name)
-	free(name);
+	layout_free_string(context->page, name);
       return 1;
     }
 
@@ -1799,12 +1843,12 @@ int parse_tag_function_form_input(struct parse_tag *tagp)
     if(param_value != NULL)
       partp->data.form_checkbox.checked = 1;
   } else if(!strcasecmp(input_type, "radio")) {
-    partp = layout_init_part(LAYOUT_PART_FORM_RADIO);
+    partp = layout_init_part(context->page, LAYOUT_PART_FORM_RADIO);
     if(partp == NULL) {
       if(value)
-	free(value);
+	layout_free_string(context->page, value);
       if(name)
-	free(name);
+	layout_free_string(context->page, name);
       return 1;
     }
 
@@ -1816,12 +1860,12 @@ int parse_tag_function_form_input(struct parse_tag *tagp)
     if(param_value != NULL)
       partp->data.form_radio.checked = 1;
   } else if(!strcasecmp(input_type, "hidden")) {
-    partp = layout_init_part(LAYOUT_PART_FORM_HIDDEN);
+    partp = layout_init_part(context->page, LAYOUT_PART_FORM_HIDDEN);
     if(partp == NULL) {
       if(value)
-	free(value);
+	layout_free_string(context->page, value);
       if(name)
-	free(name);
+	layout_free_string(context->page, name);
       return 1;
     }
 
@@ -1831,12 +1875,12 @@ int parse_tag_function_form_input(struct parse_tag *tagp)
     /* We do this like Netscape, if the type is unknown to us, 
      * we just set it to be a text field. 
      */
-    partp = layout_init_part(LAYOUT_PART_FORM_TEXT);
+    partp = layout_init_part(context->page, LAYOUT_PART_FORM_TEXT);
     if(partp == NULL) {
       if(value)
-	free(value);
+	layout_free_string(context->page, value);
       if(name)
-	free(name);
+	layout_free_string(context->page, name);
       return 1;
     }
 
@@ -1853,7 +1897,7 @@ int parse_tag_function_form_input(struct parse_tag *tagp)
   }
 
   if(partp != NULL)
-    layout_add_part(partp);
+    parse_state_add_part(context, partp);
 
   return 0;
 }
@@ -1916,21 +1960,82 @@ struct parse_tag_binding parse_tag_bindings[] = {
   { NULL, NULL }
 };
 
+/**
+ * Build the page from a tag found by parse_html(), by calling the
+ * function bound to it. The name of an anchor, and the id of any tag,
+ * is then remembered as a named place on the page.
+ *
+ * @param tagp The tag and its parameters.
+ * @param data The parser context of the document.
+ *
+ * @return zero, since the whole document is always parsed.
+ */
+static int parse_tag_event(struct parse_tag *tagp, void *data)
+{
+  struct parse_context *context = (struct parse_context *)data;
+  char *name;
+
+  parse_call_tag_binding(context, tagp);
+
+  if(tagp->type == PARSE_TAG_START) {
+    if(!strcmp(tagp->name, "a")) {
+      name = parse_get_param_value(tagp->first, "name");
+      if(name != NULL)
+	parse_state_add_anchor(context, name);
+    }
+    name = parse_get_param_value(tagp->first, "id");
+    if(name != NULL)
+      parse_state_add_anchor(context, name);
+  }
+
+  return 0;
+}
+
+/**
+ * Build the page from the text found by parse_html(), by storing it
+ * until the next tag.
+ *
+ * @param text The text, as written in the document.
+ * @param length The number of characters in the text.
+ * @param data The parser context of the document.
+ *
+ * @return zero, since the whole document is always parsed.
+ */
+static int parse_tag_text_event(char *text, int length, void *data)
+{
+  parse_string_store_text((struct parse_context *)data, text, length);
+
+  return 0;
+}
+
+/**
+ * The events which build the layout parts of the page. Comments are
+ * not kept at all.
+ */
+struct parse_events parse_tag_events = {
+  parse_tag_event,
+  parse_tag_event,
+  parse_tag_text_event,
+  NULL
+};
+
 /**
  * Call the appropriate function bound to the tag.
  *
+ * @param context The parser context of the document.
  * @param tagp The current tag and its parameters.
  *
  * @return the return value of the tag function, if it was found.
  * @return Otherwise a non-zero value.
  */
-int parse_call_tag_binding(struct parse_tag *tagp)
+int parse_call_tag_binding(struct parse_context *context,
+			   struct parse_tag *tagp)
 {
   int index;
 
   for(index = 0 ; parse_tag_bindings[index].name ; index++) {
     if(!strcmp(parse_tag_bindings[index].name, tagp->name)) {
-      return parse_tag_bindings[index].function(tagp);
+      return parse_tag_bindings[index].function(context, tagp);
     }
   }
 
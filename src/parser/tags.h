@@ -27,11 +27,13 @@
 
 /**
  * The different types a tag can be.
- * There are only two relevant types, start and end.
+ * There are only two relevant types, start and end. Comments are only
+ * read as tags when someone wants to see them.
  */
 enum parse_tag_type {
   PARSE_TAG_START,
-  PARSE_TAG_END
+  PARSE_TAG_END,
+  PARSE_TAG_COMMENT
 };
 
 /**
@@ -50,7 +52,7 @@ struct parse_param {
  * Contains the name of the tag and its a linked list of its
  * parameters.
  *
- * @member name The name of the tag.
+ * @member name The name of the tag, or the text of a comment.
  * @member type Tells if the tag is a start or an end tag. 
  * @member first A pointer to the first parameter in the list.
  */
@@ -60,10 +62,12 @@ struct parse_tag {
   struct parse_param *first;
 };
 
+struct parse_context;
+
 /**
  * Type definition for tag binding functions.
  */
-typedef int parse_tag_function(struct parse_tag *);
+typedef int parse_tag_function(struct parse_context *, struct parse_tag *);
 
 /**
  * Contains function bindings to each tag. The functions are
@@ -79,7 +83,11 @@ struct parse_tag_binding {
   parse_tag_function *function;
 };
 
+/* The events that build the layout parts of the page. */
+extern struct parse_events parse_tag_events;
+
 /* Function prototype */
-extern int parse_call_tag_binding(struct parse_tag *tagp);
+extern int parse_call_tag_binding(struct parse_context *context,
+				  struct parse_tag *tagp);
 
 #endif /* _PARSER_TAGS_H_ */
@@ -32,9 +32,16 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
 
 #include "states.h"
+#include "context.h"
 #include "helpers.h"
 #include "layout.h"
 
@@ -43,46 +50,179 @@
 #include <dmalloc.h>
 #endif /* HAVE_DMALLOC_H */
 
+#ifdef HAVE_MMAP
+/**
+ * Show a plain text file without reading it through the parser, by
+ * mapping it into memory and placing all of it in one preformatted
+ * block. The file is looked through once, to count the lines, find the
+ * longest one, and remember where every LAYOUT_PREFORMATTED_INDEX_STEP:th
+ * line starts. The rest is left to layout_get_line(), when the user
+ * interface asks for a line. This only works for files in ISO-8859-1,
+ * since nothing of it is converted, and not for documents which are
+ * read from memory.
+ *
+ * @param context The parser context of the document.
+ * @param fd File descriptor of input stream.
+ *
+ * @return zero if the file was mapped, a positive value if it cannot be
+ * @return mapped and has to be read instead, or a negative value if an
+ * @return error occurred.
+ */
+static int parse_text_map(struct parse_context *context, int fd)
+{
+  struct stat file_status;
+  struct layout_part *partp;
+  struct layout_part_preformatted_data *block;
+  char *text, *start, *end;
+  size_t *lines, length;
+  int number_of_lines, longest_line, longest, entries;
+
+  if(context->charset.kind != PARSE_CHARSET_LATIN1 ||
+     context->input.memory != NULL ||
+     fstat(fd, &file_status) != 0 || !S_ISREG(file_status.st_mode) ||
+     file_status.st_size <= 0)
+    return 1;
+
+  length = file_status.st_size;
+  text = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  if(text == MAP_FAILED)
+    return 1;
+
+  /* An empty first line is not shown when the text is read either. */
+  for(start = text ; start < text + length ; start++)
+    if(*start != '\r' && *start != '\0')
+      break;
+  if(start < text + length && *start == '\n')
+    start++;
+  else
+    start = text;
+  if(start == text + length) {
+    munmap(text, length);
+    return 1;
+  }
+
+  /* Look through the whole file once. */
+  entries = 64;
+  lines = (size_t *)malloc(entries * sizeof(size_t));
+  if(lines == NULL) {
+    munmap(text, length);
+    return -1;
+  }
+
+  number_of_lines = 0;
+  longest_line = 0;
+  longest = -1;
+  for( ; start < text + length ; start = end + 1) {
+    if(number_of_lines % LAYOUT_PREFORMATTED_INDEX_STEP == 0) {
+      if(number_of_lines / LAYOUT_PREFORMATTED_INDEX_STEP == entries) {
+	size_t *tmp;
+
+	entries *= 2;
+	tmp = (size_t *)realloc(lines, entries * sizeof(size_t));
+	if(tmp == NULL) {
+	  free(lines);
+	  munmap(text, length);
+	  return -1;
+	}
+	lines = tmp;
+      }
+      lines[number_of_lines / LAYOUT_PREFORMATTED_INDEX_STEP] = start - text;
+    }
+
+    end = memchr(start, '\n', text + length - start);
+    if(end == NULL)
+      end = text + length;
+    if(end - start > longest) {
+      longest = end - start;
+      longest_line = number_of_lines;
+    }
+    number_of_lines++;
+  }
+
+  partp = layout_init_part(context->page, LAYOUT_PART_PREFORMATTED);
+  if(partp == NULL) {
+    free(lines);
+    munmap(text, length);
+    return -1;
+  }
+
+  block = &partp->data.preformatted;
+  block->text = text;
+  block->length = length;
+  block->lines = lines;
+  block->line_step = LAYOUT_PREFORMATTED_INDEX_STEP;
+  block->number_of_lines = number_of_lines;
+  block->longest_line = longest_line;
+  block->mapped = 1;
+  parse_state_get_current(context, &block->style, NULL, NULL);
+  parse_state_add_part(context, partp);
+
+  context->input.total = length;
+
+  return 0;
+}
+#endif /* HAVE_MMAP */
+
 /**
  * Treat the incoming stream as plain text.
  * 
+ * @param context The parser context of the document.
  * @param fd File descriptor of input stream.
  *
  * @return non-zero value if an error occurred.
  */
-int parse_text(int fd)
+int parse_text(struct parse_context *context, int fd)
 {
-  char c;
-  int ret, amount_read;
+  char c, *text;
+  int ret, amount_read, length;
   struct layout_text_styles style;
 
   ret = 0;
 
   /* Initialize the state struct used throughout the whole parsing. */
-  parse_state_delete_all();
-  parse_state_init();
+  parse_state_delete_all(context);
+  parse_state_init(context);
 
-  parse_state_get_current(&style, NULL, NULL);
+  parse_state_get_current(context, &style, NULL, NULL);
   style.monospaced = 1;
   style.preformatted = 1;
   style.directquote = 1;
-  parse_state_push("textparser", &style, NULL, NULL);
+  parse_state_push(context, "textparser", &style, NULL, NULL);
+
+#ifdef HAVE_MMAP
+  /* A file can be shown without reading it. */
+  ret = parse_text_map(context, fd);
+  if(ret <= 0) {
+    parse_state_delete_all(context);
+    return ret;
+  }
+  ret = 0;
+#endif /* HAVE_MMAP */
 
   while(1) {
-    amount_read = parse_get_byte(fd, &c);
+    /* Store the rest of the line in one go, as far as it has been read. */
+    length = parse_get_run(context, '\n', &text);
+    if(length > 0)
+      parse_string_store_text(context, text, length);
+
+    amount_read = parse_get_byte(context, fd, &c);
     if(amount_read <= 0) { /* Either error or end of stream. */
       ret = amount_read;
       break;
     }
     
-    parse_string_store_character(c);
+    parse_string_store_character(context, c);
+
+    /* Let the caller see what has been parsed so far, if it is time. */
+    if(c == '\n')
+      parse_context_checkpoint(context);
   }
 
   /* The file is at an end, please place the last read string in the list. */
-  parse_string_store_current();
+  parse_string_store_current(context);
 
   /* Delete the states when we are done with them. */
-  parse_state_delete_all();
+  parse_state_delete_all(context);
 
   return ret;
 }
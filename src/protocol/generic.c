@@ -41,6 +41,7 @@
 #include "streams.h"
 #include "file.h"
 #include "http.h"
+#include "preload.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
 #ifdef HAVE_DMALLOC_H
@@ -57,6 +58,11 @@ static struct protocol_stream *first_stream = NULL;
 char *base_host = NULL;
 char *base_path = NULL;
 
+/* Held while the base URL is used, since streams may be opened by
+ * several threads at the same time.
+ */
+pthread_mutex_t protocol_base_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /**
  * Store a URL as the base for following relative references. This will
  * store the URL in two parts, the host, including protocol type, and
@@ -332,6 +338,72 @@ char *protocol_make_absolute(char *url, char *base_url)
   return new_url;
 }
 
+/**
+ * Like protocol_make_absolute(), but first stores the referring URL as
+ * the base, the same way as protocol_open() does. This is safe to use
+ * while other threads are opening streams, which protocol_make_absolute()
+ * on its own is not. A URL which is only a fragment refers to a place
+ * on the referring page itself.
+ *
+ * @param url The absolute or relative URL to absolutify.
+ * @param referer The URL we got from to get here, or NULL.
+ * @param base_url If not NULL, this is used as the new base URL.
+ *
+ * @return the new, absolutely absolute URL.
+ */
+char *protocol_resolve_url(char *url, char *referer, char *base_url)
+{
+  char *new_url, *tmp;
+
+  if(url && url[0] == '#' && referer) {
+    new_url = (char *)malloc(strlen(referer) + strlen(url) + 1);
+    if(new_url == NULL)
+      return NULL;
+    strcpy(new_url, referer);
+    tmp = strchr(new_url, '#');
+    if(tmp != NULL)
+      *tmp = '\0';
+    strcat(new_url, url);
+
+    return new_url;
+  }
+
+  pthread_mutex_lock(&protocol_base_lock);
+  if(referer)
+    protocol_store_base(referer);
+  new_url = protocol_make_absolute(url, base_url);
+  pthread_mutex_unlock(&protocol_base_lock);
+
+  return new_url;
+}
+
+/**
+ * Allocates an HTTP headers struct, filled in with the default values.
+ *
+ * @return a pointer to the new headers, or NULL if an error occurred.
+ */
+struct protocol_http_headers *protocol_alloc_headers(void)
+{
+  struct protocol_http_headers *headers;
+
+  headers = (struct protocol_http_headers *)
+    malloc(sizeof(struct protocol_http_headers));
+  if(headers == NULL)
+    return NULL;
+
+  headers->return_code = 200;
+  headers->return_message = NULL;
+  headers->content_type_major = NULL;
+  headers->content_type_minor = NULL;
+  headers->charset = NULL;
+  headers->content_length = -1;
+  headers->server = NULL;
+  headers->location = NULL;
+  headers->real_url = NULL;
+
+  return headers;
+}
+
 /**
  * Frees everything that has been allocated for the HTTP headers.
  *
@@ -348,6 +420,8 @@ void protocol_free_headers(struct protocol_http_headers *headers)
     free(headers->content_type_major);
   if(headers->content_type_minor)
     free(headers->content_type_minor);
+  if(headers->charset)
+    free(headers->charset);
   if(headers->server)
     free(headers->server);
   if(headers->location)
@@ -379,6 +453,10 @@ static int protocol_close_specific(int fd, enum protocol_type protocol)
     protocol_file_close(fd);
     break;
 
+  case PROTOCOL_PRELOAD:
+    close(fd);
+    break;
+
   default:
     fprintf(stderr, 
 	    "%s: Unsupported protocol detected. Sorry, cannot close.\n",
@@ -408,33 +486,30 @@ int protocol_open(char *url, char *referer, char *base_url)
   char *new_url;
   enum protocol_type protocol;
   struct protocol_stream *new_stream;
-  struct protocol_http_headers *headers;
+  struct protocol_http_headers *headers, *preloaded_headers;
   struct protocol_url *url_parts;
 
-  headers = (struct protocol_http_headers *)
-    malloc(sizeof(struct protocol_http_headers));
+  headers = protocol_alloc_headers();
   if(headers == NULL) {
     return -1;
   }
 
-  /* Fill in the default values for the HTTP headers struct. */
-  headers->return_code = 200;
-  headers->return_message = NULL;
-  headers->content_type_major = NULL;
-  headers->content_type_minor = NULL;
-  headers->content_length = -1;
-  headers->server = NULL;
-  headers->location = NULL;
-  headers->real_url = NULL;
-
-  if(referer)
-    protocol_store_base(referer);
-
   /* Get the absolute equivalence to the specified URL. */
-  new_url = protocol_make_absolute(url, base_url);
+  new_url = protocol_resolve_url(url, referer, base_url);
 
+  /* It might already have been fetched in the background. */
   protocol = PROTOCOL_UNKNOWN;
+  fd = -1;
   if(new_url) {
+    fd = protocol_preload_claim(new_url, &preloaded_headers);
+    if(fd >= 0) {
+      protocol_free_headers(headers);
+      headers = preloaded_headers;
+      protocol = PROTOCOL_PRELOAD;
+    }
+  }
+
+  if(new_url && fd < 0) {
     url_parts = protocol_split_url(new_url);
     if(url_parts) {
       /* Find the correct protocol to use. */
@@ -451,8 +526,6 @@ int protocol_open(char *url, char *referer, char *base_url)
     } else {
       fd = -1;
     }
-  } else {
-    fd = -1;
   }
 
   /* Unless there was an unexpected error, we put the new file descriptor
@@ -495,8 +568,11 @@ int protocol_open(char *url, char *referer, char *base_url)
    */
   if(headers->content_type_major && headers->content_type_minor &&
      !strcmp(headers->content_type_major, "text") &&
-     !strcmp(headers->content_type_minor, "html"))
+     !strcmp(headers->content_type_minor, "html")) {
+    pthread_mutex_lock(&protocol_base_lock);
     protocol_store_base(headers->real_url);
+    pthread_mutex_unlock(&protocol_base_lock);
+  }
 
   free(new_url);
 
@@ -560,6 +636,10 @@ int protocol_close(int fd)
     protocol_file_close(fd);
     break;
 
+  case PROTOCOL_PRELOAD:
+    close(fd);
+    break;
+
   default:
     fprintf(stderr, 
 	    "%s: Unsupported protocol detected. Sorry, cannot close.\n",
@@ -626,11 +706,19 @@ struct protocol_url *protocol_split_url(char *orgurl)
   surl->host = NULL;
   surl->port = 0;
   surl->file = NULL;
+  surl->fragment = NULL;
 
   url = strdup(orgurl);
   if(url == NULL)
     return NULL;
 
+  /* The fragment only means something to us, not to the server. */
+  tmp = strchr(url, '#');
+  if(tmp != NULL) {
+    *tmp++ = '\0';
+    surl->fragment = strdup(tmp);
+  }
+
   urlp = url;
   tmp = strstr(urlp, "://");
   if(tmp != NULL) {
@@ -715,7 +803,8 @@ int protocol_default_port(char *protocol)
  * Takes a disassembled protocol_url struct, and puts it
  * into a URL string. This function is rather HTTP-centric,
  * and might need some care to work correctly with other
- * protocols.
+ * protocols. The fragment is left out, since it is not a part of
+ * what is fetched.
  *
  * @param url The URL struct
  *
@@ -774,6 +863,8 @@ void protocol_free_url(struct protocol_url *url)
       free(url->host);
     if(url->file)
       free(url->file);
+    if(url->fragment)
+      free(url->fragment);
 
     free(url);
   }
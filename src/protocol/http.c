@@ -53,6 +53,22 @@
 #include <dmalloc.h>
 #endif /* HAVE_DMALLOC_H */
 
+/* Held while looking up a host name, since the result is kept in static
+ * memory, and resources may be fetched by several threads at once.
+ */
+static pthread_mutex_t protocol_http_host_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Unlock the host name lock. Used as a cleanup handler, in case the
+ * thread is cancelled while looking up a host name.
+ *
+ * @param argument Not used.
+ */
+static void protocol_http_unlock_host(void *argument)
+{
+  pthread_mutex_unlock(&protocol_http_host_lock);
+}
+
 /**
  * Open a TCP connection to the other host, on a specific port number. 
  *
@@ -90,12 +106,17 @@ static int protocol_http_open_connection(struct protocol_url *url)
     return -1;
   }
 
+  pthread_mutex_lock(&protocol_http_host_lock);
+  pthread_cleanup_push(protocol_http_unlock_host, NULL);
   hent = gethostbyname(url->host);
+  if(hent != NULL)
+    memcpy(&saddr.sin_addr, hent->h_addr_list[0], sizeof(struct in_addr));
+  pthread_cleanup_pop(1);
+
   if(hent == NULL) {
     close(sock);
     return -1;
   }
-  memcpy(&saddr.sin_addr, hent->h_addr_list[0], sizeof(struct in_addr));
   saddr.sin_family = AF_INET;
   saddr.sin_port = htons(url->port);
   
@@ -107,6 +128,42 @@ static int protocol_http_open_connection(struct protocol_url *url)
   return sock;
 }
 
+/**
+ * Find the charset among the options given after the content type, as in
+ * "text/html; charset=ISO-8859-1". Quotes around the value are removed.
+ *
+ * @param options The options following the first ';' of the content type.
+ *
+ * @return an allocated copy of the charset name, or NULL if there was none
+ * @return or an error occurred.
+ */
+static char *protocol_http_get_charset(char *options)
+{
+  char *start, *charset;
+  size_t length;
+
+  for(start = options ; *start ; start++)
+    if(!strncasecmp(start, "charset=", 8))
+      break;
+  if(*start == '\0')
+    return NULL;
+
+  start += 8;
+  if(*start == '"' || *start == '\'')
+    start++;
+  length = strcspn(start, "\"'; \t\r\n");
+  if(length == 0)
+    return NULL;
+
+  charset = (char *)malloc(length + 1);
+  if(charset == NULL)
+    return NULL;
+  strncpy(charset, start, length);
+  charset[length] = '\0';
+
+  return charset;
+}
+
 /**
  * Make an HTTP request to a webserver on an open stream. This reads
  * the important headers from the response and fills in the struct
@@ -330,27 +387,14 @@ static int protocol_http_make_request(int fd, struct protocol_url *url,
 	headers->content_type_minor = tmp;
 
 	/* Look for other options for the content type. This is most
-	 * likely the charset. Currently, we do not use the charset
-	 * value for anything, but always assume ISO-8859-1 throughout
-	 * the whole program. Think what you like about that. 
-	 *
-	 * Note that I have done this simple, and it is not the charset
-	 * which is placed in headers->charset, but the whole option
-	 * string. This will change, when there is a need to use the
-	 * charset value, or when I have nothing better to do, whichever
-	 * comes first.
+	 * likely the charset, which the parser uses to convert the page
+	 * into ISO-8859-1, the character set used throughout the program.
 	 */
 	divider = strchr(tmp, ';');
 	if(divider == NULL)
 	  continue;
 	divider[0] = '\0';
-	tmp = (char *)malloc(strlen(&divider[1]) + 1);
-	if(tmp == NULL) {
-	  error = 1;
-	  continue;
-	}
-	strcpy(tmp, &divider[1]);
-	headers->charset = tmp;
+	headers->charset = protocol_http_get_charset(&divider[1]);
       } else if(!strcasecmp(field, "server")) {
 	tmp = (char *)malloc(strlen(value) + 1);
 	if(tmp == NULL) {
@@ -511,7 +555,7 @@ int protocol_http_open(struct protocol_url *url, char *referer,
      * it is relative to the URL that returned 30x.
      */
     tmp = protocol_unsplit_url(url);
-    absolute_relocation = protocol_make_absolute(headers->location, tmp);
+    absolute_relocation = protocol_resolve_url(headers->location, NULL, tmp);
     relocation_url = protocol_split_url(absolute_relocation);
     free(absolute_relocation);
     free(tmp);
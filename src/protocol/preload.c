@@ -0,0 +1,371 @@
+/**
+ * Preloading of resources. While a page is still being read and parsed,
+ * the images it refers to are fetched in the background, so that they
+ * are already here when the layouter asks for them with protocol_open().
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* If threads are used, we might need redefined read and write functions. */
+#include "threads.h"
+
+#include "protocol.h"
+#include "streams.h"
+#include "http.h"
+#include "preload.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/* Protects everything below. */
+static pthread_mutex_t preload_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Signalled every time a resource has been fetched. */
+static pthread_cond_t preload_finished = PTHREAD_COND_INITIALIZER;
+
+/* The resources preloaded for the current page. */
+static struct protocol_preload *first_preload = NULL;
+
+/* The number of resources asked for since the list was last cleared. */
+static int preload_count = 0;
+
+/* The number of those that were actually used. */
+static int preload_used = 0;
+
+/* The number of threads currently fetching resources. */
+static int preload_workers = 0;
+
+/**
+ * Free a preloaded resource and everything it holds.
+ *
+ * @param preload The resource to free.
+ */
+static void protocol_preload_free(struct protocol_preload *preload)
+{
+  free(preload->url);
+  if(preload->referer)
+    free(preload->referer);
+  protocol_free_headers(preload->headers);
+  if(preload->file)
+    fclose(preload->file);
+  free(preload);
+}
+
+/**
+ * Fetch one resource into a temporary file.
+ *
+ * @param preload The resource to fetch.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int protocol_preload_fetch(struct protocol_preload *preload)
+{
+  struct protocol_url *url_parts;
+  char buffer[PROTOCOL_PRELOAD_BUFFER_SIZE];
+  FILE *file;
+  int fd, amount_read;
+
+  url_parts = protocol_split_url(preload->url);
+  if(url_parts == NULL)
+    return 1;
+
+  fd = protocol_http_open(url_parts, preload->referer, preload->headers);
+  protocol_free_url(url_parts);
+
+  if(fd < 0)
+    return 1;
+  if(preload->headers->return_code != 200) {
+    protocol_http_close(fd);
+    return 1;
+  }
+
+  file = tmpfile();
+  if(file == NULL) {
+    protocol_http_close(fd);
+    return 1;
+  }
+
+  while((amount_read = read(fd, buffer, PROTOCOL_PRELOAD_BUFFER_SIZE)) > 0) {
+    if(fwrite(buffer, 1, amount_read, file) != (size_t)amount_read) {
+      amount_read = -1;
+      break;
+    }
+  }
+  protocol_http_close(fd);
+
+  if(amount_read < 0 || fflush(file) != 0) {
+    fclose(file);
+    return 1;
+  }
+
+  preload->file = file;
+
+  return 0;
+}
+
+/**
+ * The thread function of the preloading threads. Each thread fetches
+ * waiting resources until there are none left.
+ *
+ * @param argument Not used.
+ *
+ * @return nothing.
+ */
+static void *protocol_preload_worker(void *argument)
+{
+  struct protocol_preload *preload;
+  int error;
+
+  pthread_mutex_lock(&preload_lock);
+  while(1) {
+    preload = first_preload;
+    while(preload && preload->state != PROTOCOL_PRELOAD_WAITING)
+      preload = preload->next;
+    if(preload == NULL)
+      break;
+
+    preload->state = PROTOCOL_PRELOAD_RUNNING;
+    pthread_mutex_unlock(&preload_lock);
+
+    error = protocol_preload_fetch(preload);
+
+    pthread_mutex_lock(&preload_lock);
+    if(preload->abandoned) {
+      /* Not on the list any more, so nobody else knows about it. */
+      protocol_preload_free(preload);
+    } else {
+      if(error)
+	preload->state = PROTOCOL_PRELOAD_FAILED;
+      else
+	preload->state = PROTOCOL_PRELOAD_DONE;
+    }
+    pthread_cond_broadcast(&preload_finished);
+  }
+  preload_workers--;
+  pthread_mutex_unlock(&preload_lock);
+
+  return NULL;
+}
+
+/**
+ * Start fetching a resource in the background, if it is not already
+ * being fetched. Local files are not preloaded, since they are read
+ * quickly enough when they are needed.
+ *
+ * @param url The absolute or relative URL of the resource.
+ * @param referer The URL of the page referring to the resource, or NULL.
+ * @param base_url The base URL to be used to create an absolute URL from
+ * @param base_url the given URL, or NULL to use the locally stored base.
+ *
+ * @return non-zero value if the resource will not be preloaded.
+ */
+int protocol_preload(char *url, char *referer, char *base_url)
+{
+  struct protocol_preload *preload, *last_preload;
+  pthread_attr_t attributes;
+  pthread_t thread;
+  char *new_url;
+
+  new_url = protocol_resolve_url(url, referer, base_url);
+  if(new_url == NULL)
+    return 1;
+  if(strncmp(new_url, "http://", 7)) {
+    free(new_url);
+    return 1;
+  }
+
+  pthread_mutex_lock(&preload_lock);
+
+  /* Only ask for each resource once. */
+  last_preload = NULL;
+  for(preload = first_preload ; preload ; preload = preload->next) {
+    if(!strcmp(preload->url, new_url)) {
+      pthread_mutex_unlock(&preload_lock);
+      free(new_url);
+      return 0;
+    }
+    last_preload = preload;
+  }
+
+  if(preload_count >= PROTOCOL_PRELOAD_MAX) {
+    pthread_mutex_unlock(&preload_lock);
+    free(new_url);
+    return 1;
+  }
+
+  preload = (struct protocol_preload *)malloc(sizeof(struct protocol_preload));
+  if(preload == NULL) {
+    pthread_mutex_unlock(&preload_lock);
+    free(new_url);
+    return 1;
+  }
+  preload->url = new_url;
+  preload->referer = NULL;
+  if(referer) {
+    preload->referer = (char *)malloc(strlen(referer) + 1);
+    if(preload->referer)
+      strcpy(preload->referer, referer);
+  }
+  preload->state = PROTOCOL_PRELOAD_WAITING;
+  preload->headers = protocol_alloc_headers();
+  preload->file = NULL;
+  preload->abandoned = 0;
+  preload->next = NULL;
+  if(preload->headers == NULL) {
+    protocol_preload_free(preload);
+    pthread_mutex_unlock(&preload_lock);
+    return 1;
+  }
+
+  /* Resources are fetched in the order they were found. */
+  if(last_preload)
+    last_preload->next = preload;
+  else
+    first_preload = preload;
+  preload_count++;
+
+  /* If no thread is free to take it, a new one is started. If that is
+   * not possible, it is simply fetched the normal way when needed.
+   */
+  if(preload_workers < PROTOCOL_PRELOAD_WORKERS) {
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    if(pthread_create(&thread, &attributes, protocol_preload_worker,
+		      NULL) == 0)
+      preload_workers++;
+    pthread_attr_destroy(&attributes);
+  }
+
+  pthread_mutex_unlock(&preload_lock);
+
+  return 0;
+}
+
+/**
+ * Unlock the preload list. Used as a cleanup handler, in case the
+ * thread is cancelled while waiting for a resource.
+ *
+ * @param argument Not used.
+ */
+static void protocol_preload_unlock(void *argument)
+{
+  pthread_mutex_unlock(&preload_lock);
+}
+
+/**
+ * Take a resource from the preloaded ones. If it is still being fetched,
+ * this waits until it is done. A resource can only be claimed once.
+ *
+ * @param url The absolute URL of the resource.
+ * @param headers A pointer to where the HTTP headers of the resource are
+ * @param headers placed. The caller is responsible for freeing them.
+ *
+ * @return a file descriptor to read the resource from, or a negative value
+ * @return if it has not been preloaded, in which case it should be opened
+ * @return the normal way.
+ */
+int protocol_preload_claim(char *url, struct protocol_http_headers **headers)
+{
+  struct protocol_preload *preload, *previous_preload;
+  int fd;
+
+  fd = -1;
+
+  pthread_mutex_lock(&preload_lock);
+  pthread_cleanup_push(protocol_preload_unlock, NULL);
+
+  while(1) {
+    previous_preload = NULL;
+    preload = first_preload;
+    while(preload && strcmp(preload->url, url)) {
+      previous_preload = preload;
+      preload = preload->next;
+    }
+    if(preload == NULL || preload->state != PROTOCOL_PRELOAD_RUNNING)
+      break;
+    pthread_cond_wait(&preload_finished, &preload_lock);
+  }
+
+  /* A resource not yet started is just as well opened the normal way. */
+  if(preload) {
+    if(previous_preload)
+      previous_preload->next = preload->next;
+    else
+      first_preload = preload->next;
+
+    if(preload->state == PROTOCOL_PRELOAD_DONE) {
+      fd = dup(fileno(preload->file));
+      if(fd >= 0) {
+	lseek(fd, 0, SEEK_SET);
+	*headers = preload->headers;
+	preload->headers = NULL;
+	preload_used++;
+      }
+    }
+    protocol_preload_free(preload);
+  }
+
+  pthread_cleanup_pop(1);
+
+  return fd;
+}
+
+/**
+ * Throw away all preloaded resources, for example when a new page is
+ * loaded. Resources still being fetched are freed by their threads
+ * when they are done.
+ */
+void protocol_preload_clear(void)
+{
+  struct protocol_preload *preload;
+
+  pthread_mutex_lock(&preload_lock);
+
+#ifdef DEBUG
+  if(preload_count > 0)
+    fprintf(stderr, "%s: %d of %d preloaded resources were used.\n",
+	    __FUNCTION__, preload_used, preload_count);
+#endif /* DEBUG */
+
+  while(first_preload) {
+    preload = first_preload;
+    first_preload = preload->next;
+    if(preload->state == PROTOCOL_PRELOAD_RUNNING)
+      preload->abandoned = 1;
+    else
+      protocol_preload_free(preload);
+  }
+  preload_count = 0;
+  preload_used = 0;
+
+  pthread_mutex_unlock(&preload_lock);
+}
@@ -0,0 +1,77 @@
+/**
+ * Structs and prototypes for preloading resources in the background.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+#ifndef _PROTOCOL_PRELOAD_H_
+#define _PROTOCOL_PRELOAD_H_
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stdio.h>
+
+#include "protocol.h"
+
+/* The largest number of resources preloaded for one page. */
+#define PROTOCOL_PRELOAD_MAX  64
+
+/* The number of resources that are fetched at the same time. */
+#define PROTOCOL_PRELOAD_WORKERS  4
+
+/* The number of bytes read from the stream at a time. */
+#define PROTOCOL_PRELOAD_BUFFER_SIZE  8192
+
+/**
+ * How far a preloaded resource has come.
+ */
+enum protocol_preload_state {
+  PROTOCOL_PRELOAD_WAITING,
+  PROTOCOL_PRELOAD_RUNNING,
+  PROTOCOL_PRELOAD_DONE,
+  PROTOCOL_PRELOAD_FAILED
+};
+
+/**
+ * Linked list of the resources that are preloaded for the current page.
+ *
+ * @member url The absolute URL of the resource.
+ * @member referer The URL of the page referring to the resource, or NULL.
+ * @member state How far the resource has come.
+ * @member headers The HTTP headers of the resource.
+ * @member file A temporary file holding the resource once it is done.
+ * @member abandoned Non-zero value if the resource was thrown away while
+ * @member abandoned it was being fetched. The fetching thread then frees it.
+ * @member next The next resource in the linked list.
+ */
+struct protocol_preload {
+  char *url;
+  char *referer;
+  enum protocol_preload_state state;
+  struct protocol_http_headers *headers;
+  FILE *file;
+  int abandoned;
+  struct protocol_preload *next;
+};
+
+/* Internal function prototype. */
+extern int protocol_preload_claim(char *url,
+				  struct protocol_http_headers **headers);
+
+#endif /* _PROTOCOL_PRELOAD_H_ */
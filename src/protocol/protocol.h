@@ -41,6 +41,9 @@
  * @member port on the protocol type, if not given in the URL.
  * @member file The directory and filename, without the leading slash,
  * @member file or NULL if not given.
+ * @member fragment The name of the place on the page, which was given
+ * @member fragment after a hash mark, or NULL if not given. This is never
+ * @member fragment sent to the server.
  */
 struct protocol_url {
   char *type;
@@ -49,6 +52,7 @@ struct protocol_url {
   char *host;
   unsigned int port;
   char *file;
+  char *fragment;
 };
 
 /**
@@ -61,8 +65,8 @@ struct protocol_url {
  * @member content_type_major provided for this stream. NULL otherwise.
  * @member content_type_minor The minor content type string, if one was 
  * @member content_type_minor provided for this stream. NULL otherwise.
- * @member charset The charset to be used for this page. It is currently
- * @member charset not used, but ISO-8859-1 is always assumed. 
+ * @member charset The name of the charset the page is written in, if one
+ * @member charset was given. NULL otherwise, and ISO-8859-1 is assumed.
  * @member content_length The length of the data in the stream, or a negative
  * @member content_length if it was not given in the headers.
  * @member server A string identifying the server we are currently talking to.
@@ -88,11 +92,15 @@ struct protocol_http_headers {
 extern int protocol_open(char *url, char *referer, char *base_url);
 extern int protocol_close(int fd);
 extern struct protocol_http_headers *protocol_get_headers(int fd);
+extern struct protocol_http_headers *protocol_alloc_headers(void);
 extern void protocol_free_headers(struct protocol_http_headers *headers);
 extern struct protocol_url *protocol_split_url(char *url);
 extern void protocol_free_url(struct protocol_url *url);
 extern int protocol_default_port(char *protocol);
 extern char *protocol_unsplit_url(struct protocol_url *url);
 extern char *protocol_make_absolute(char *url, char *base_url);
+extern char *protocol_resolve_url(char *url, char *referer, char *base_url);
+extern int protocol_preload(char *url, char *referer, char *base_url);
+extern void protocol_preload_clear(void);
 
 #endif /* _PROTOCOL_PROTOCOL_H_ */
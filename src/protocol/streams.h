@@ -26,6 +26,7 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include "threads.h"
 #include "http.h"
 
 /**
@@ -35,7 +36,8 @@ enum protocol_type {
   PROTOCOL_UNKNOWN,
   PROTOCOL_FILE,
   PROTOCOL_HTTP,
-  PROTOCOL_FTP
+  PROTOCOL_FTP,
+  PROTOCOL_PRELOAD
 };
 
 /**
@@ -57,4 +59,7 @@ struct protocol_stream {
   struct protocol_stream *next;
 };
 
+/* Held while the stored base URL is used. */
+extern pthread_mutex_t protocol_base_lock;
+
 #endif /* _PROTOCOL_STREAMS_H_ */
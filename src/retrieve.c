@@ -29,10 +29,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "protocol.h"
 #include "parse.h"
 #include "layout.h"
+#include "retrieve.h"
 #include "ui.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
@@ -40,6 +42,97 @@
 #include <dmalloc.h>
 #endif /* HAVE_DMALLOC_H */
 
+/* The number of screens layouted while a page is loaded, if the user
+ * interface layouts the rest of it as it is scrolled down.
+ */
+#define RETRIEVE_FIRST_SCREENS  2
+
+/**
+ * Keeps track of a page while it is being retrieved.
+ *
+ * @member layout The layout progress of the page.
+ * @member publish The function to give the partly loaded page to, or
+ * @member publish NULL if the page is only wanted when it is complete.
+ * @member start The time when the retrieval started.
+ * @member first_screen The number of milliseconds until something of
+ * @member first_screen the page was first published, or -1.
+ * @member height The height down to which the page is layouted while it
+ * @member height is loaded, or zero to layout all of it.
+ */
+struct retrieve_progress {
+  struct layout_progress layout;
+  retrieve_publish_function *publish;
+  struct timeval start;
+  long first_screen;
+  int height;
+};
+
+/**
+ * Get the number of milliseconds since a given time.
+ *
+ * @param start The time to measure from.
+ *
+ * @return the number of milliseconds elapsed.
+ */
+static long retrieve_elapsed(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+
+  return (now.tv_sec - start->tv_sec) * 1000 + 
+    (now.tv_usec - start->tv_usec) / 1000;
+}
+
+/**
+ * Called by the parser at its checkpoints. Layout what can be layouted
+ * of the page so far, and let the user interface have it. Once the page
+ * reaches the height it should have while it is loaded, the rest of it
+ * is only parsed.
+ *
+ * @param open_part The first pending part that is not yet finished.
+ * @param data A pointer to the retrieve progress of the page.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int retrieve_checkpoint(struct layout_part *open_part, void *data)
+{
+  struct retrieve_progress *progress = (struct retrieve_progress *)data;
+
+  if(progress->height > 0 &&
+     progress->layout.page->geometry.height >= progress->height)
+    return 0;
+
+  /* Nothing new to show. */
+  if(layout_do_partial(&progress->layout, open_part) != 0)
+    return 0;
+
+  if(progress->first_screen < 0)
+    progress->first_screen = retrieve_elapsed(&progress->start);
+
+  return progress->publish(progress->layout.page);
+}
+
+/**
+ * Called by the preload scanner for every image found in the page. The
+ * image is fetched in the background, so that it is already here when
+ * the layouter wants it.
+ *
+ * @param url The URL of the image, as written in the page.
+ * @param base_url The base URL given in the page, or NULL.
+ * @param data A pointer to the page being retrieved.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int retrieve_preload(char *url, char *base_url, void *data)
+{
+  struct layout_part *page = (struct layout_part *)data;
+
+  protocol_preload(url, page->data.page_information.url, base_url);
+
+  return 0;
+}
+
 /**
  * This function will take a URL from the the user interface, get the
  * page, parse it, layout it and send it back to the user interface.
@@ -53,11 +146,47 @@
  * @return NULL if an error occurred.
  */
 struct layout_part *retrieve_page(char *url, char *referer)
+{
+  return retrieve_page_progressive(url, referer, NULL);
+}
+
+/**
+ * Retrieve a page just like retrieve_page(), but also layout the page
+ * bit by bit while it is parsed, and give it to the user interface
+ * every time it has grown. The parts already given away are never
+ * changed, and new parts are only added after them. If the user
+ * interface layouts the rest of a page itself, only the first screens
+ * of the page are layouted, and the rest is left to relayout_more.
+ *
+ * @param url The URL to the object to retreive.
+ * @param referer The URL we were at when moving to the new URL.
+ * @param publish The function which is given the page while it is 
+ * @param publish loaded, or NULL if the page is only wanted when complete.
+ *
+ * @return a pointer to the layouted parts from what is found on URL, or
+ * @return NULL if an error occurred.
+ */
+struct layout_part *retrieve_page_progressive(char *url, char *referer,
+					      retrieve_publish_function 
+					      *publish)
 {
   struct protocol_http_headers *headers;
   struct layout_part *base_part;
+  struct parse_context *context;
+  struct retrieve_progress progress;
   int fd, ret;
-  char *status;
+  char *status, *fragment;
+
+  gettimeofday(&progress.start, NULL);
+  progress.first_screen = -1;
+  progress.publish = publish;
+  progress.height = 0;
+  if(publish != NULL && user_interface.ui_support.partial_layout &&
+     user_interface.ui_display.height > 0)
+    progress.height = RETRIEVE_FIRST_SCREENS * user_interface.ui_display.height;
+
+  /* Images preloaded for the last page are not wanted any more. */
+  protocol_preload_clear();
 
   /* Open a stream to the specified URL. */
   fd = protocol_open(url, referer, NULL);
@@ -79,17 +208,58 @@ struct layout_part *retrieve_page(char *url, char *referer)
      */
 
     base_part = layout_init_page(headers->real_url, referer);
+    if(base_part == NULL) {
+      protocol_close(fd);
+      return NULL;
+    }
+
+    /* Remember which place on the page was asked for, if any. */
+    fragment = strchr(url, '#');
+    if(fragment != NULL && fragment[1] != '\0') {
+      base_part->data.page_information.fragment =
+	layout_alloc_string(base_part, strlen(fragment));
+      if(base_part->data.page_information.fragment != NULL)
+	strcpy(base_part->data.page_information.fragment, fragment + 1);
+    }
+
+    /* Everything the parser needs to remember about this page is kept 
+     * in its own context.
+     */
+    context = parse_context_new(base_part);
+    if(context == NULL) {
+      layout_delete_all_parts(base_part);
+      protocol_close(fd);
+      return NULL;
+    }
+
+    /* The parser puts the parts where the layouter can pick them up, a
+     * few at a time if someone wants to see the page before it is done.
+     */
+    if(layout_init_progress(&progress.layout, base_part) != 0) {
+      parse_context_free(context);
+      layout_delete_all_parts(base_part);
+      protocol_close(fd);
+      return NULL;
+    }
+    parse_context_set_checkpoint(context, progress.layout.pending,
+				 publish ? retrieve_checkpoint : NULL, 
+				 &progress);
 
     if(headers->content_type_major == NULL || 
        !strcmp(headers->content_type_major, "text")) {
+      if(headers->charset)
+	parse_context_set_charset(context, headers->charset);
       if(headers->content_type_minor == NULL ||
 	 !strcmp(headers->content_type_minor, "html")) {
-	ret = parse_html(fd);
+	/* There is no point in fetching images that cannot be shown. */
+	if(user_interface.ui_support.image)
+	  parse_context_set_preload(context, retrieve_preload, base_part);
+	ret = parse_html(context, fd);
       } else if(!strcmp(headers->content_type_minor, "plain")) {
-	ret = parse_text(fd);
+	ret = parse_text(context, fd);
       }
     } else if(!strcmp(headers->content_type_major, "image")) {
-      ret = parse_image(fd);
+      ret = parse_image(context, fd);
     } else {
       status = malloc(strlen(headers->content_type_major) + 
 		      strlen(headers->content_type_minor) + 64);
@@ -106,22 +276,50 @@ struct layout_part *retrieve_page(char *url, char *referer)
 	free(status);
       }
 
+      /* Nothing of the page has been given away yet. */
+      layout_do_finish(&progress.layout);
+      parse_context_free(context);
+      layout_delete_all_parts(base_part);
+      protocol_close(fd);
       return NULL;
     }
+
+    parse_context_free(context);
   }
 
   /* Check if the page does not contain any data. */
-  if(base_part->child == NULL) {
+  if(base_part->child == NULL && progress.layout.pending->child == NULL) {
     ui_functions_set_status("Page contains no data.");
     ret = 1;
   }
 
-  /* Check if the parsing went smooth. */
-  if(ret == 0) {
-    /* Do the layouting on the page we got from layout_init_page(). */
-    layout_do(base_part, 0, 0, NULL);
+  /* Check if the parsing went smooth. If not, what was never layouted
+   * is thrown away.
+   */
+  if(ret != 0 && progress.layout.pending->child != NULL) {
+    layout_free_anchors(base_part);
+    layout_delete_all_parts(progress.layout.pending->child);
+    progress.layout.pending->child = NULL;
+    progress.layout.pending->last_child = NULL;
   }
 
+  /* Do the layouting on what is left of the page, or on as much of it
+   * as is shown at first.
+   */
+  layout_do_later(&progress.layout, progress.height);
+
+  /* The layouter has taken the images it wanted, unless some of the
+   * page is left for later. They are then kept until the next page.
+   */
+  if(base_part->data.page_information.relayout == NULL)
+    protocol_preload_clear();
+
+#ifdef DEBUG
+  fprintf(stderr, "%s: first screen after %ld ms, whole page after %ld ms.\n",
+	  __FUNCTION__, progress.first_screen, 
+	  retrieve_elapsed(&progress.start));
+#endif /* DEBUG */
+
   /* Close the stream in the proper way. */
   protocol_close(fd);
 
@@ -27,7 +27,20 @@
 
 #include "layout.h"
 
-/* Function prototype. */
+/**
+ * A function which is given a page while it is still being loaded,
+ * each time more of it has been layouted. 
+ *
+ * @param page A pointer to the page information part of the page.
+ *
+ * @return non-zero value if an error occurred.
+ */
+typedef int retrieve_publish_function(struct layout_part *page);
+
+/* Function prototypes. */
 extern struct layout_part *retrieve_page(char *url, char *referer);
+extern struct layout_part *retrieve_page_progressive(char *url, char *referer,
+						     retrieve_publish_function
+						     *publish);
 
 #endif /* _RETRIEVE_H_ */
@@ -47,6 +47,7 @@
 #endif /* HAVE_GETOPT_H */
 
 #include "settings.h"
+#include "threads.h"
 
 /**
  * The global structure that contains all possible settings, read
@@ -194,11 +195,18 @@ static void set_defaults(void)
 {
   settings_set("dump_source", (void *)0, SETTING_BOOLEAN);
   settings_set("dump_config", (void *)0, SETTING_BOOLEAN);
+  settings_set("benchmark", (void *)0, SETTING_NUMBER);
+  settings_set("stress", (void *)0, SETTING_NUMBER);
   settings_set("interface", (void *)"dump", SETTING_STRING);
   settings_set("default_page", (void *)"http://www.nocrew.org/software/zen/",
 	       SETTING_STRING);
   settings_set("screen_gamma", (void *)"2.42", SETTING_STRING);
   settings_set("png_gamma", (void *)"0.45455", SETTING_STRING);
+  settings_set("yield_work", (void *)THREAD_BUDGET_WORK, SETTING_NUMBER);
+  settings_set("yield_interval", (void *)THREAD_BUDGET_INTERVAL, 
+	       SETTING_NUMBER);
+  settings_set("layout_threads", (void *)THREAD_LAYOUT_THREADS, 
+	       SETTING_NUMBER);
 }
 
 /**
@@ -214,8 +222,11 @@ static int interpret_options(int argc, char *argv[])
   int arg;
   int setting_dump_source = 0;
   int setting_dump_config = 0;
+  int setting_benchmark = 0;
+  int setting_stress = 0;
   char *setting_interface = "";
   int set_dump_source=0, set_dump_config=0, set_interface=0;
+  int set_benchmark=0, set_stress=0;
   char *real_program_name;
 
 #ifdef HAVE_GETOPT_LONG
@@ -224,12 +235,14 @@ static int interpret_options(int argc, char *argv[])
     { "source", no_argument, NULL, 's' },
     { "config", required_argument, NULL, 'c' },
     { "dump-config", no_argument, NULL, 'd' },
+    { "benchmark", required_argument, NULL, 'b' },
+    { "stress", required_argument, NULL, 'S' },
     { "help", no_argument, NULL, 'h' },
     { "version", no_argument, NULL, 'V' },
     { NULL, 0, NULL, 0 } };
 #endif /* HAVE_GETOPT_LONG */
 
-  char *short_options = "i:sc:dhV";
+  char *short_options = "i:sc:db:S:hV";
 
   /* First check if we have started Zen as another name than "zen". This
    * can happen, since we create symbolic links for some interfaces when
@@ -291,6 +304,16 @@ static int interpret_options(int argc, char *argv[])
       set_dump_config = 1;
       break;
 
+    case 'b': /* --benchmark */
+      setting_benchmark = atoi(optarg);
+      set_benchmark = 1;
+      break;
+
+    case 'S': /* --stress */
+      setting_stress = atoi(optarg);
+      set_stress = 1;
+      break;
+
     case 'h': /* --help */
       print_usage();
       exit(0);
@@ -322,6 +345,10 @@ static int interpret_options(int argc, char *argv[])
     settings_set("dump_source", (void *)setting_dump_source, SETTING_BOOLEAN);
   if(set_dump_config)
     settings_set("dump_config", (void *)setting_dump_config, SETTING_BOOLEAN);
+  if(set_benchmark)
+    settings_set("benchmark", (void *)setting_benchmark, SETTING_NUMBER);
+  if(set_stress)
+    settings_set("stress", (void *)setting_stress, SETTING_NUMBER);
   if(set_interface)
     settings_set("interface", (void *)setting_interface, SETTING_STRING);
 
@@ -379,6 +406,12 @@ static void print_usage(void)
 	  "    --config=file\n"
 	  "-d             Do not load the page, but dump the current \n"
 	  " --dump-config configuration on stdout\n"
+	  "-b rounds      Parse the page a number of times, print how fast\n"
+	  "    --benchmark=rounds\n"
+	  "               it went, and dump the parts on stdout\n"
+	  "-S threads     Parse and layout the page on several threads at\n"
+	  "    --stress=threads\n"
+	  "               once, and check that each does it as when alone\n"
 	  "-h  --help     Print this text and exit\n"
 	  "-V  --version  Print version and exit\n"
 #else /* !HAVE_GETOPT_LONG */
@@ -387,6 +420,10 @@ static void print_usage(void)
 	  "-c file        Extra configuration file read after all other\n"
 	  "-d             Do not load the page, but dump the current \n"
 	  "               configuration on stdout\n"
+	  "-b rounds      Parse the page a number of times, print how fast\n"
+	  "               it went, and dump the parts on stdout\n"
+	  "-S threads     Parse and layout the page on several threads at\n"
+	  "               once, and check that each does it as when alone\n"
 	  "-h             Print this text and exit\n"
 	  "-V             Print version and exit\n"
 #endif /* !HAVE_GETOPT_LONG */
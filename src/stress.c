@@ -0,0 +1,478 @@
+/**
+ * A stress test of the parser and the layouter. The page is read into
+ * memory and parsed a number of times, first one time after the other
+ * and then on several threads at once. Every parse has a context of its
+ * own, so all of them must make exactly the same parts out of the page.
+ * Anything that is still shared between the threads shows up as parts
+ * that differ from those made when the page was parsed alone. The same
+ * is then done for layouting the parsed page at a few widths, where the
+ * positions and sizes of the parts must be the same as when alone.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "parse.h"
+#include "layout.h"
+#include "benchmark.h"
+#include "stress.h"
+
+/* This is used when compiling with the libdmalloc debug library. */
+#ifdef HAVE_DMALLOC_H
+#include <dmalloc.h>
+#endif /* HAVE_DMALLOC_H */
+
+/**
+ * What one thread of the stress test works with.
+ *
+ * @member url The URL of the page.
+ * @member data The whole page, which all threads share.
+ * @member length The number of bytes in the page.
+ * @member charset The charset of the page, or NULL for ISO-8859-1.
+ * @member index The number of the thread, which decides the order in
+ * @member index which it layouts the page at the different widths.
+ * @member expected The sum of the parts made when the page was parsed
+ * @member expected alone.
+ * @member layouts The sums of the geometry of the parts when the page
+ * @member layouts was layouted alone at each width.
+ * @member failures The number of times the parts differed from those,
+ * @member failures or the page could not be parsed or layouted at all.
+ */
+struct stress_work {
+  char *url;
+  char *data;
+  size_t length;
+  char *charset;
+  int index;
+  unsigned long expected;
+  unsigned long layouts[STRESS_WIDTHS];
+  int failures;
+};
+
+/**
+ * Add a number to a sum.
+ *
+ * @param sum The sum so far.
+ * @param value The number to add.
+ *
+ * @return the new sum.
+ */
+static unsigned long stress_add(unsigned long sum, unsigned long value)
+{
+  return ((sum ^ value) * 16777619UL) & 0xffffffffUL;
+}
+
+/**
+ * Add a string to a sum.
+ *
+ * @param sum The sum so far.
+ * @param string The string to add, or NULL.
+ *
+ * @return the new sum.
+ */
+static unsigned long stress_add_string(unsigned long sum, char *string)
+{
+  if(string == NULL)
+    return stress_add(sum, 0);
+
+  for( ; *string ; string++)
+    sum = stress_add(sum, (unsigned char)*string);
+
+  return stress_add(sum, 1);
+}
+
+/**
+ * Sum up what the parser has put into a linked list of parts, and
+ * everything under them.
+ *
+ * @param parts A pointer to the first part in the list.
+ * @param sum The sum so far.
+ *
+ * @return the new sum.
+ */
+static unsigned long stress_sum_parts(struct layout_part *parts,
+				      unsigned long sum)
+{
+  struct layout_part *partp;
+  struct layout_text_styles *style;
+
+  for(partp = parts ; partp ; partp = partp->next) {
+    sum = stress_add(sum, partp->type);
+    if(partp->type != LAYOUT_PART_PAGE_INFORMATION) {
+      sum = stress_add(sum, partp->align.horizontal);
+      sum = stress_add(sum, partp->align.vertical);
+      sum = stress_add(sum, partp->align.indent_offset);
+    }
+
+    switch(partp->type) {
+    case LAYOUT_PART_PAGE_INFORMATION:
+      sum = stress_add_string(sum, partp->data.page_information.title);
+      break;
+
+    case LAYOUT_PART_TEXT:
+      style = &partp->data.text.style;
+      sum = stress_add(sum, style->size);
+      sum = stress_add(sum, style->colour);
+      sum = stress_add(sum, (style->monospaced << 0) |
+		       (style->italic << 1) | (style->bold << 2) |
+		       (style->underlined << 3) | (style->overlined << 4) |
+		       (style->subscript << 5) | (style->superscript << 6) |
+		       (style->preformatted << 7));
+      sum = stress_add_string(sum, partp->data.text.text);
+      break;
+
+    case LAYOUT_PART_PREFORMATTED:
+      sum = stress_add(sum, partp->data.preformatted.number_of_lines);
+      sum = stress_add(sum, partp->data.preformatted.length);
+      break;
+
+    case LAYOUT_PART_LINK:
+      sum = stress_add_string(sum, partp->data.link.href);
+      break;
+
+    case LAYOUT_PART_GRAPHICS:
+      sum = stress_add_string(sum, partp->data.graphics.src);
+      sum = stress_add_string(sum, partp->data.graphics.alt_text);
+      break;
+
+    case LAYOUT_PART_TABLE_CELL:
+      sum = stress_add(sum, partp->data.table_cell.rowspan);
+      sum = stress_add(sum, partp->data.table_cell.colspan);
+      break;
+
+    default:
+      break;
+    }
+
+    if(partp->child != NULL)
+      sum = stress_sum_parts(partp->child, sum);
+  }
+
+  return sum;
+}
+
+/**
+ * Sum up the positions and sizes of a linked list of parts, and of
+ * everything under them, as the layouter has set them.
+ *
+ * @param parts A pointer to the first part in the list.
+ * @param sum The sum so far.
+ *
+ * @return the new sum.
+ */
+static unsigned long stress_sum_geometry(struct layout_part *parts,
+					 unsigned long sum)
+{
+  struct layout_part *partp;
+
+  for(partp = parts ; partp ; partp = partp->next) {
+    sum = stress_add(sum, partp->type);
+    if(partp->type == LAYOUT_PART_DELETED)
+      continue;
+
+    sum = stress_add(sum, partp->geometry.x_position);
+    sum = stress_add(sum, partp->geometry.y_position);
+    sum = stress_add(sum, partp->geometry.width);
+    sum = stress_add(sum, partp->geometry.height);
+    if(partp->type == LAYOUT_PART_TEXT)
+      sum = stress_add(sum, partp->data.text.length);
+
+    if(partp->child != NULL)
+      sum = stress_sum_geometry(partp->child, sum);
+  }
+
+  return sum;
+}
+
+/**
+ * Parse the page once, and sum up the parts made from it.
+ *
+ * @param work What to parse.
+ * @param sum A pointer to where the sum of the parts is placed.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int stress_parse(struct stress_work *work, unsigned long *sum)
+{
+  struct parse_statistics stats;
+  struct layout_part *page;
+  long time;
+
+  page = benchmark_parse(work->url, work->data, work->length,
+			 work->charset, &time, &stats);
+  if(page == NULL)
+    return 1;
+
+  *sum = stress_sum_parts(page, 2166136261UL);
+  layout_delete_all_parts(page);
+
+  return 0;
+}
+
+/**
+ * Layout a parsed page at one of the widths, and sum up the geometry of
+ * its parts.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param width The number of the width to layout the page at.
+ * @param sum A pointer to where the sum of the geometry is placed.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int stress_layout(struct layout_part *page, int width,
+			 unsigned long *sum)
+{
+  if(layout_relayout(page, STRESS_WIDTH(width)) != 0)
+    return 1;
+
+  *sum = stress_sum_geometry(page, 2166136261UL);
+
+  return 0;
+}
+
+/**
+ * The function each thread of the parse stress test runs. It parses the
+ * page a number of times, and counts how many times the parts differed
+ * from those made when the page was parsed alone.
+ *
+ * @param arg A pointer to the work of the thread.
+ *
+ * @return NULL.
+ */
+static void *stress_parse_thread(void *arg)
+{
+  struct stress_work *work;
+  unsigned long sum;
+  int i;
+
+  work = (struct stress_work *)arg;
+  for(i = 0 ; i < STRESS_ROUNDS ; i++)
+    if(stress_parse(work, &sum) != 0 || sum != work->expected)
+      work->failures++;
+
+  return NULL;
+}
+
+/**
+ * The function each thread of the layout stress test runs. It parses
+ * the page once, and then layouts it a number of times, at each width
+ * in turn. Every thread starts at a width of its own, so the threads
+ * layout the page at different widths at the same time. It counts how
+ * many times the geometry differed from that of the page layouted alone
+ * at the same width.
+ *
+ * @param arg A pointer to the work of the thread.
+ *
+ * @return NULL.
+ */
+static void *stress_layout_thread(void *arg)
+{
+  struct stress_work *work;
+  struct parse_statistics stats;
+  struct layout_part *page;
+  unsigned long sum;
+  long time;
+  int i, width;
+
+  work = (struct stress_work *)arg;
+  page = benchmark_parse(work->url, work->data, work->length,
+			 work->charset, &time, &stats);
+  if(page == NULL) {
+    work->failures += STRESS_ROUNDS;
+    return NULL;
+  }
+
+  for(i = 0 ; i < STRESS_ROUNDS ; i++) {
+    width = (work->index + i) % STRESS_WIDTHS;
+    if(stress_layout(page, width, &sum) != 0 || sum != work->layouts[width])
+      work->failures++;
+  }
+
+  layout_delete_all_parts(page);
+
+  return NULL;
+}
+
+/**
+ * Run a function on several threads at once, each with a work of its
+ * own, and wait for all of them to finish.
+ *
+ * @param works An array with the work of each thread.
+ * @param threads The number of threads to run.
+ * @param function The function each thread runs.
+ * @param failures A pointer to where the sum of the failures of all the
+ * @param failures threads is placed.
+ *
+ * @return the number of threads that could be started.
+ */
+static int stress_run(struct stress_work *works, int threads,
+		      void *(*function)(void *), int *failures)
+{
+  pthread_t *thread_ids;
+  int i, started;
+
+  *failures = 0;
+  thread_ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+  if(thread_ids == NULL)
+    return 0;
+
+  for(i = 0 ; i < threads ; i++)
+    works[i].failures = 0;
+
+  started = 0;
+  for(i = 0 ; i < threads ; i++) {
+    if(pthread_create(&thread_ids[i], NULL, function, &works[i]) != 0)
+      break;
+    started++;
+  }
+
+  for(i = 0 ; i < started ; i++) {
+    pthread_join(thread_ids[i], NULL);
+    *failures += works[i].failures;
+  }
+
+  free(thread_ids);
+
+  return started;
+}
+
+/**
+ * Parse and layout a page alone a number of times, and then on several
+ * threads at once, and check that every parse makes the same parts and
+ * that every layout at the same width puts them at the same places. The
+ * result is printed on stderr.
+ *
+ * @param url The URL of the page to parse.
+ * @param threads The number of threads to parse the page on at once.
+ *
+ * @return non-zero value if anything differed, or an error occurred.
+ */
+int stress_parser(char *url, int threads)
+{
+  struct stress_work *works;
+  struct parse_statistics stats;
+  struct layout_part *page;
+  char *data, *charset;
+  size_t length;
+  unsigned long sum, expected, layouts[STRESS_WIDTHS];
+  long time;
+  int i, width, recorded, started, layout_started;
+  int serial_failures, failures, layout_serial_failures, layout_failures;
+
+  data = benchmark_read_page(url, &length, &charset);
+  if(data == NULL)
+    return 1;
+
+  works = (struct stress_work *)malloc(threads * sizeof(struct stress_work));
+  if(works == NULL) {
+    free(data);
+    if(charset != NULL)
+      free(charset);
+    return 1;
+  }
+
+  for(i = 0 ; i < threads ; i++) {
+    works[i].url = url;
+    works[i].data = data;
+    works[i].length = length;
+    works[i].charset = charset;
+    works[i].index = i;
+  }
+
+  /* Each parse alone must make the same parts as the first one. */
+  expected = 0;
+  serial_failures = 0;
+  for(i = 0 ; i < STRESS_ROUNDS ; i++) {
+    if(stress_parse(&works[0], &sum) != 0)
+      serial_failures++;
+    else if(i == 0)
+      expected = sum;
+    else if(sum != expected)
+      serial_failures++;
+  }
+
+  for(i = 0 ; i < threads ; i++)
+    works[i].expected = expected;
+  started = stress_run(works, threads, stress_parse_thread, &failures);
+
+  /* Each layout alone must give the same geometry as the first one at
+   * the same width, even after the page has been layouted at the other
+   * widths in between.
+   */
+  memset(layouts, 0, sizeof(layouts));
+  recorded = 0;
+  layout_serial_failures = 0;
+  page = benchmark_parse(url, data, length, charset, &time, &stats);
+  if(page == NULL) {
+    layout_serial_failures = STRESS_ROUNDS + STRESS_WIDTHS;
+  } else {
+    for(i = 0 ; i < STRESS_WIDTHS + STRESS_ROUNDS ; i++) {
+      width = i % STRESS_WIDTHS;
+      if(stress_layout(page, width, &sum) != 0)
+	layout_serial_failures++;
+      else if(i < STRESS_WIDTHS) {
+	layouts[width] = sum;
+	recorded++;
+      } else if(sum != layouts[width])
+	layout_serial_failures++;
+    }
+    layout_delete_all_parts(page);
+  }
+
+  /* The threads are only checked if there is a layout alone to compare
+   * with at every width.
+   */
+  layout_started = 0;
+  layout_failures = 0;
+  if(recorded == STRESS_WIDTHS) {
+    for(i = 0 ; i < threads ; i++)
+      memcpy(works[i].layouts, layouts, sizeof(layouts));
+    layout_started = stress_run(works, threads, stress_layout_thread,
+				&layout_failures);
+  }
+
+  fprintf(stderr,
+	  "Parsed %lu bytes %d times alone, %d of them differed.\n"
+	  "Parsed it %d times on %d threads at once, %d of them differed.\n"
+	  "Layouted it %d times alone at %d widths, %d of them differed.\n"
+	  "Layouted it %d times on %d threads at once, %d of them differed.\n",
+	  (unsigned long)length, STRESS_ROUNDS, serial_failures,
+	  started * STRESS_ROUNDS, started, failures,
+	  STRESS_WIDTHS + STRESS_ROUNDS, STRESS_WIDTHS, layout_serial_failures,
+	  layout_started * STRESS_ROUNDS, layout_started, layout_failures);
+
+  free(works);
+  free(data);
+  if(charset != NULL)
+    free(charset);
+
+  return (serial_failures != 0 || failures != 0 || started < threads ||
+	  layout_serial_failures != 0 || layout_failures != 0 ||
+	  layout_started < threads);
+}
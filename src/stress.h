@@ -0,0 +1,40 @@
+/** 
+ * Prototypes for the stress test of the parser and the layouter.
+ *
+ * @author Tomas Berndtsson <tomas@nocrew.org>
+ */
+
+#ifndef _STRESS_H_
+#define _STRESS_H_
+
+/*
+ * Copyright (C) 1999, Tomas Berndtsson <tomas@nocrew.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* The number of times the page is parsed alone, and on each thread. It
+ * is also layouted as many times, after once at each width.
+ */
+#define STRESS_ROUNDS  8
+
+/* The number of widths the page is layouted at, and the widths. */
+#define STRESS_WIDTHS  4
+#define STRESS_WIDTH(number)  (200 + 150 * (number))
+
+/* Function prototypes. */
+extern int stress_parser(char *url, int threads);
+
+#endif /* _STRESS_H_ */
@@ -36,6 +36,7 @@
 #endif /* HAVE_PTHREAD_H */
 
 #include "threads.h"
+#include "settings.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
 #ifdef HAVE_DMALLOC_H
@@ -271,3 +272,66 @@ int thread_give_response(enum thread_response response, void *argument)
   return 0;
 }
 
+/**
+ * Start a new budget for a long running loop. How much work and time
+ * the loop may spend before other threads are let to run is taken from
+ * the settings "yield_work" and "yield_interval".
+ *
+ * @param budget The budget to start.
+ */
+void thread_budget_init(struct thread_budget *budget)
+{
+  void *value;
+
+  budget->quantum = THREAD_BUDGET_WORK;
+  if(settings_get("yield_work", &value) == SETTING_NUMBER && 
+     (long)value > 0)
+    budget->quantum = (long)value;
+
+  budget->interval = THREAD_BUDGET_INTERVAL;
+  if(settings_get("yield_interval", &value) == SETTING_NUMBER && 
+     (long)value > 0)
+    budget->interval = (long)value;
+
+  budget->work = 0;
+  budget->next_check = THREAD_BUDGET_CHECK;
+  if(budget->next_check > budget->quantum)
+    budget->next_check = budget->quantum;
+  budget->yields = 0;
+  gettimeofday(&budget->time, NULL);
+}
+
+/**
+ * Let other threads run, if the loop has done enough work, or has been
+ * running long enough, since they last were. This is called by
+ * thread_budget_spend() now and then, instead of for all work done,
+ * since looking at the clock takes some time as well.
+ *
+ * @param budget The budget of the loop.
+ */
+void thread_budget_check(struct thread_budget *budget)
+{
+  struct timeval now;
+  long elapsed;
+
+  gettimeofday(&now, NULL);
+  elapsed = (now.tv_sec - budget->time.tv_sec) * 1000 +
+    (now.tv_usec - budget->time.tv_usec) / 1000;
+
+  if(budget->work < budget->quantum && elapsed < budget->interval) {
+    budget->next_check = budget->work + THREAD_BUDGET_CHECK;
+    if(budget->next_check > budget->quantum)
+      budget->next_check = budget->quantum;
+    return;
+  }
+
+  thread_yield();
+  budget->yields++;
+
+  /* The time spent by the other threads is not counted. */
+  budget->work = 0;
+  budget->next_check = THREAD_BUDGET_CHECK;
+  if(budget->next_check > budget->quantum)
+    budget->next_check = budget->quantum;
+  gettimeofday(&budget->time, NULL);
+}
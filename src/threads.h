@@ -26,6 +26,7 @@
  */
 
 #include <pthread.h>
+#include <sys/time.h>
 
 #ifdef HAVE_GNU_PTH
 #include <pth.h>
@@ -36,6 +37,26 @@
 #define connect pth_connect
 #endif /* HAVE_GNU_PTH */
 
+/* The default number of work units, such as tags or layout parts, done
+ * between each time other threads are let to run, and the default number
+ * of milliseconds after which they are let to run anyway.
+ */
+#define THREAD_BUDGET_WORK  64
+#define THREAD_BUDGET_INTERVAL  20
+
+/* The most work units done between each look at the clock. */
+#define THREAD_BUDGET_CHECK  8
+
+/* The default number of threads which may layout the cells of a large
+ * table at the same time, where zero means one for each processor. With
+ * GNU pth, they would only take turns.
+ */
+#ifdef HAVE_GNU_PTH
+#define THREAD_LAYOUT_THREADS  1
+#else
+#define THREAD_LAYOUT_THREADS  0
+#endif /* HAVE_GNU_PTH */
+
 typedef void *thread_function(void *);
 
 enum thread_command {
@@ -45,7 +66,8 @@ enum thread_command {
 
 enum thread_response {
   THREAD_RESPONSE_UNKNOWN,
-  THREAD_RESPONSE_NEW_PAGE
+  THREAD_RESPONSE_NEW_PAGE,
+  THREAD_RESPONSE_PARTIAL_PAGE
 };
 
 enum thread_type {
@@ -71,6 +93,31 @@ struct thread_info {
   struct thread_info *next;
 };
 
+/**
+ * Keeps track of how much a long running loop has done since it last
+ * let other threads run. The loop tells how much work it does, and other
+ * threads are only let to run when enough work has been done, or enough
+ * time has passed.
+ *
+ * @member work The work done since other threads were last let to run.
+ * @member next_check The amount of work at which to look at the clock.
+ * @member quantum The amount of work after which other threads are let
+ * @member quantum to run, as given by the setting "yield_work".
+ * @member interval The number of milliseconds after which other threads
+ * @member interval are let to run, as given by the setting
+ * @member interval "yield_interval".
+ * @member time The time other threads were last let to run.
+ * @member yields The number of times other threads have been let to run.
+ */
+struct thread_budget {
+  int work;
+  int next_check;
+  int quantum;
+  int interval;
+  struct timeval time;
+  unsigned long yields;
+};
+
 extern int thread_start(enum thread_type type, thread_function *start_function, 
 			void *arg);
 extern int thread_kill_all(void);
@@ -82,6 +129,8 @@ extern enum thread_response thread_wait_response(void **argument);
 extern int thread_check_response(enum thread_response expected_response, 
 				 void **argument);
 extern int thread_give_response(enum thread_response response, void *argument);
+extern void thread_budget_init(struct thread_budget *budget);
+extern void thread_budget_check(struct thread_budget *budget);
 
 /**
  * This function is called to yield execution to other threads. That is
@@ -96,4 +145,23 @@ pth_yield(NULL);
 
 }
 
+/**
+ * This function is called by long running loops to tell how much work
+ * they have done, and lets other threads run when the budget is spent.
+ * Just like thread_yield(), this does nothing unless GNU pth is used.
+ *
+ * @param budget The budget of the loop.
+ * @param work The amount of work done since the last call.
+ */
+static inline void thread_budget_spend(struct thread_budget *budget,
+				       int work) {
+
+#ifdef HAVE_GNU_PTH
+  budget->work += work;
+  if(budget->work >= budget->next_check)
+    thread_budget_check(budget);
+#endif /* HAVE_GNU_PTH */
+
+}
+
 #endif /* _THREADS_H_ */
@@ -147,6 +147,7 @@ int ui_init(int argc, char *argv[])
   user_interface.ui_support.freemove = 0;
   user_interface.ui_support.scrollable_x = 0;
   user_interface.ui_support.scrollable_y = 0;
+  user_interface.ui_support.partial_layout = 0;
   user_interface.ui_settings.min_fontsize = 8;
   user_interface.ui_settings.max_fontsize = 8;
   user_interface.ui_settings.default_fontsize = 8;
@@ -44,7 +44,7 @@ int curses_set_size(struct layout_part *partp)
 {
   switch(partp->type) {
   case LAYOUT_PART_TEXT:
-    partp->geometry.width = curses_pixels(strlen(partp->data.text.text));
+    partp->geometry.width = curses_pixels(partp->data.text.length);
     partp->geometry.height = curses_pixels(1);
     break;
 
@@ -59,3 +59,26 @@ int curses_set_size(struct layout_part *partp)
 
   return 0;
 }
+
+/**
+ * Get the metrics of the font used for a style of text. Every character
+ * takes up one cell of the terminal, whatever the style.
+ *
+ * @param style The style of the text.
+ * @param metrics A pointer to where the metrics are stored.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int curses_get_font_metrics(struct layout_text_styles *style,
+			    struct zen_ui_font_metrics *metrics)
+{
+  int i;
+
+  for(i = 0 ; i < 256 ; i++)
+    metrics->width[i] = curses_pixels(1);
+  metrics->scale = 1;
+  metrics->ascent = curses_pixels(1);
+  metrics->descent = 0;
+
+  return 0;
+}
@@ -27,7 +27,8 @@ int init(int argc, char *argv[], struct zen_ui *ui)
     curses_open,
     curses_close,
     curses_set_size,
-    NULL
+    NULL,
+    curses_get_font_metrics
   };
    
   ui->ui_type = ZEN_UI_GRAPHICAL;
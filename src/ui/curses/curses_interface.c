@@ -94,6 +94,20 @@ static int previouslink(struct curses_interface *this)
  */
 static int followlink(struct curses_interface *this)
 {
+   struct curses_page *page = this->activepage;
+   int y_position;
+   
+   /* A place on the page itself is only scrolled to. */
+   y_position = this->functions->find_anchor(page->parts,
+     page->activelink->data.link.href);
+   if (y_position >= 0) {
+      if (curses_page_scroll(page, 0, y_position - page->scroll.y_position))
+        return 1;
+      if (interface_update(this)) return 1;
+      
+      return 0;
+   }
+   
    page_id = this->functions->request_page(
      this->activepage->activelink->data.link.href, NULL);
    
@@ -252,7 +266,7 @@ int curses_interface_init(struct curses_interface *this,
  */
 int curses_interface_open(struct curses_interface *this, char *url)
 {
-   int key, error;
+   int key, error, y_position;
    struct layout_part *tmp_part = NULL;
    
    if (curses_lib_init()) {
@@ -314,6 +328,11 @@ int curses_interface_open(struct curses_interface *this, char *url)
 	this->activepage =
 	   curses_page_linkin(this->pages, curses_page_new(tmp_part));
 	curses_window_text(this->statusbar, NULL);
+	
+	/* Show the place on the page that was asked for. */
+	y_position = this->functions->find_anchor(tmp_part, NULL);
+	if (y_position > 0)
+	  curses_page_scroll(this->activepage, 0, y_position);
         interface_update(this);
       }
       
@@ -155,6 +155,8 @@ extern int curses_close(void);
 extern int curses_percent(int total, int percent);
 extern int curses_pixels(int chars);
 extern int curses_set_size(struct layout_part *partp);
+extern int curses_get_font_metrics(struct layout_text_styles *style,
+				   struct zen_ui_font_metrics *metrics);
 extern int curses_interface_init(struct curses_interface *this,
 			         struct zen_ui_functions *functions,
 			         struct zen_ui_display *display,
@@ -30,6 +30,7 @@
 #include <string.h>
 
 #include "layout.h"
+#include "zen_ui.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
 #ifdef HAVE_DMALLOC_H
@@ -50,7 +51,7 @@ int dump_set_size(struct layout_part *partp)
   switch(partp->type) {
   case LAYOUT_PART_TEXT:
     /* We define the character size to be 8x8 pixels. */
-    partp->geometry.width = 8 * strlen(partp->data.text.text);
+    partp->geometry.width = 8 * partp->data.text.length;
     partp->geometry.height = 8;
     break;
 
@@ -60,3 +61,26 @@ int dump_set_size(struct layout_part *partp)
 
   return 0;
 }
+
+/**
+ * Get the metrics of the font used for a style of text. Every character
+ * is 8x8 pixels, just as dump_set_size() measures them.
+ *
+ * @param style The style of the text.
+ * @param metrics A pointer to where the metrics are stored.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int dump_get_font_metrics(struct layout_text_styles *style,
+			  struct zen_ui_font_metrics *metrics)
+{
+  int i;
+
+  for(i = 0 ; i < 256 ; i++)
+    metrics->width[i] = 8;
+  metrics->scale = 1;
+  metrics->ascent = 8;
+  metrics->descent = 0;
+
+  return 0;
+}
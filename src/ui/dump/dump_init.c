@@ -62,7 +62,8 @@ int init(int argc, char *argv[], struct zen_ui *ui)
     dump_open,
     dump_close,
     dump_set_size,
-    NULL /* set_palette */
+    NULL, /* set_palette */
+    dump_get_font_metrics
   };
 
   ui->ui_type = ZEN_UI_TEXTUAL;
@@ -80,6 +81,7 @@ int init(int argc, char *argv[], struct zen_ui *ui)
   ui->ui_support.freemove = 0;
   ui->ui_support.scrollable_x = 0;
   ui->ui_support.scrollable_y = 1;
+  ui->ui_support.partial_layout = 0;
 
   ui->ui_settings.min_fontsize = 8;
   ui->ui_settings.max_fontsize = 8;
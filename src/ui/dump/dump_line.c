@@ -45,7 +45,7 @@ int dump_draw_line(struct layout_part *partp)
 {
   int i, width;
   
-  width = partp->data.line.width / 8;
+  width = partp->geometry.width / 8;
   
   printf("\n");
   for(i = 0 ; i < partp->geometry.x_position / 8 ; i++) {
@@ -63,6 +63,10 @@ int dump_render(struct layout_part *parts)
       dump_draw_text(partp);
       break;
 
+    case LAYOUT_PART_PREFORMATTED:
+      dump_draw_preformatted(partp);
+      break;
+
     case LAYOUT_PART_LINK:
       printf("[%s]", partp->data.link.href);
       break;
@@ -27,8 +27,10 @@
 #endif /* HAVE_CONFIG_H */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "layout.h"
+#include "info.h"
 
 /* This is used when compiling with the libdmalloc debug library. */
 #ifdef HAVE_DMALLOC_H
@@ -62,9 +64,47 @@ int dump_draw_text(struct layout_part *partp)
 	i++) {
       printf(" ");
     }
-    printf("%s", partp->data.text.text);
+    printf("%.*s", partp->data.text.length, partp->data.text.text);
     previous_x_position += i * 8 + partp->geometry.width;
   }
 
   return 0;
 }
+
+/**
+ * Print out a block of preformatted text, one line at a time, just as
+ * if each line were a text part of its own. Empty lines are left to the
+ * lines after them, just like the paragraphs they used to be.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int dump_draw_preformatted(struct layout_part *partp)
+{
+  struct layout_part_preformatted_data *block;
+  struct layout_part line;
+  int i;
+
+  block = &partp->data.preformatted;
+
+  memset(&line, 0, sizeof(struct layout_part));
+  line.type = LAYOUT_PART_TEXT;
+  line.parent = partp->parent;
+  line.data.text.style = block->style;
+  line.geometry.x_position = partp->geometry.x_position;
+
+  for(i = 0 ; i < block->number_of_lines ; i++) {
+    line.data.text.text = dump_ui->ui_functions->get_line(partp, i);
+    if(line.data.text.text == NULL)
+      break;
+    line.data.text.length = strlen(line.data.text.text);
+    if(line.data.text.length == 0)
+      continue;
+
+    line.geometry.y_position = (partp->geometry.y_position + 
+				i * block->line_height);
+    dump_set_size(&line);
+    dump_draw_text(&line);
+  }
+
+  return 0;
+}
@@ -32,8 +32,11 @@ extern int dump_open(char *url);
 extern int dump_close(void);
 extern int dump_render(struct layout_part *partp);
 extern int dump_set_size(struct layout_part *partp);
+extern int dump_get_font_metrics(struct layout_text_styles *style,
+				 struct zen_ui_font_metrics *metrics);
 extern int dump_set_title(char *title_text);
 extern int dump_draw_text(struct layout_part *partp);
+extern int dump_draw_preformatted(struct layout_part *partp);
 extern int dump_draw_image(struct layout_part *partp);
 extern int dump_draw_line(struct layout_part *partp);
 
@@ -40,8 +40,25 @@
 #include <dmalloc.h>
 #endif /* HAVE_DMALLOC_H */
 
-/* Temporary space for status line. This will move and use mutex locks. */
+/* Temporary space for status line. It is set by every thread that loads
+ * a page, and read by the interface, so it is locked while used.
+ */
 static char ui_status_text[1024] = "";
+static pthread_mutex_t ui_status_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Used to hand a page over to the interface, while the page is still
+ * being loaded. If the interface has not yet picked up the page from 
+ * last time, it will simply get the newer version of it.
+ *
+ * @param page A pointer to the page information part of the page.
+ *
+ * @return non-zero value if an error occurred.
+ */
+static int ui_functions_publish_page(struct layout_part *page)
+{
+  return thread_give_response(THREAD_RESPONSE_PARTIAL_PAGE, (void *)page);
+}
 
 /**
  * Used as thread function to retrieve a new page.
@@ -58,7 +75,8 @@ static void *threaded_request_page(void *arguments)
   url = ((char **)arguments)[0];
   referer = ((char **)arguments)[1];
 
-  new_page = retrieve_page(url, referer);
+  new_page = retrieve_page_progressive(url, referer, 
+				       ui_functions_publish_page);
   thread_give_response(THREAD_RESPONSE_NEW_PAGE, (void *)new_page);
 
   return NULL;
@@ -107,6 +125,10 @@ static int ui_functions_request_page(char *url, char *referer)
  * @return page, or zero either if there was no new page yet, in which
  * @return case pagep is set to NULL, or if there was a new page, in
  * @return which case pagep is set to point to the page information.
+ * @return A positive value means that pagep points to a page which is
+ * @return still being loaded. The parts already on it will not change,
+ * @return but more parts are added after them, and the same page is
+ * @return returned again as it grows, and with zero when it is complete.
  */
 static int ui_functions_poll_page(int page_id, struct layout_part **pagep)
 {
@@ -119,6 +141,10 @@ static int ui_functions_poll_page(int page_id, struct layout_part **pagep)
       return -1;
 
     *pagep = new_page;
+  } else if(thread_check_response(THREAD_RESPONSE_PARTIAL_PAGE, 
+				  (void **)&new_page)) {
+    *pagep = new_page;
+    return 1;
   } else {
     *pagep = NULL;
   }
@@ -140,9 +166,11 @@ static int ui_functions_get_status(int page_id, char *status, int max_length)
 {
   page_id = page_id;
 
+  pthread_mutex_lock(&ui_status_lock);
   strncpy(status, ui_status_text, max_length);
   status[max_length] = '\0';
   ui_status_text[0] = '\0';
+  pthread_mutex_unlock(&ui_status_lock);
 
   return strlen(status);
 }
@@ -158,10 +186,15 @@ static int ui_functions_get_status(int page_id, char *status, int max_length)
  */
 int ui_functions_set_status(char *status)
 {
+  int length;
+
+  pthread_mutex_lock(&ui_status_lock);
   strncpy(ui_status_text, status, 1023);
   ui_status_text[1023] = '\0';
+  length = strlen(ui_status_text);
+  pthread_mutex_unlock(&ui_status_lock);
 
-  return strlen(ui_status_text);
+  return length;
 }
 
 /**
@@ -216,6 +249,12 @@ struct zen_ui_functions *ui_functions_init(void)
   functions.get_status = ui_functions_get_status;
   functions.get_setting = ui_functions_get_setting;
   functions.set_setting = ui_functions_set_setting;
+  functions.get_line = layout_get_line;
+  functions.find_anchor = layout_find_anchor;
+  functions.relayout_page = layout_relayout;
+  functions.relayout_start = layout_relayout_start;
+  functions.relayout_more = layout_relayout_more;
+  functions.set_interface_data = layout_set_interface_data;
 
   return &functions;
 }
@@ -78,6 +78,7 @@ void gtkui_free_interface_data(struct layout_part *partp)
     break;
 
   case LAYOUT_PART_TEXT:
+  case LAYOUT_PART_PREFORMATTED:
     gdk_font_unref(((struct gtkui_text_information *)
 		    partp->interface_data)->font);
     gdk_gc_unref(((struct gtkui_text_information *)
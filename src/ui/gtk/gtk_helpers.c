@@ -28,6 +28,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <gtk/gtk.h>
 
@@ -64,7 +65,8 @@ int gtkui_set_size(struct layout_part *partp)
 
       font = gtkui_get_font(partp);
 /*        font = gdk_font_ref(font); */
-      partp->geometry.width = gdk_string_width(font, partp->data.text.text);
+      partp->geometry.width = gdk_text_width(font, partp->data.text.text,
+					     partp->data.text.length);
       partp->geometry.height = font->ascent + font->descent + 1;
 /*        gdk_font_unref(font); */
     }
@@ -184,6 +186,69 @@ int gtkui_set_size(struct layout_part *partp)
   return 0;
 }
 
+/**
+ * Get the metrics of the font used for a style of text. The widths and
+ * heights are those that gtkui_set_size() would measure, including the
+ * extra pixel below each row of text.
+ *
+ * @param style The style of the text.
+ * @param metrics A pointer to where the metrics are stored.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int gtkui_get_font_metrics(struct layout_text_styles *style,
+			   struct zen_ui_font_metrics *metrics)
+{
+  struct layout_part text;
+  GdkFont *font;
+  int i;
+
+  memset(&text, 0, sizeof(struct layout_part));
+  text.type = LAYOUT_PART_TEXT;
+  text.data.text.style = *style;
+
+  gdk_threads_enter();
+
+  font = gtkui_get_font(&text);
+  if(font == NULL) {
+    gdk_threads_leave();
+    return 1;
+  }
+
+  for(i = 0 ; i < 256 ; i++)
+    metrics->width[i] = gdk_char_width(font, (gchar)i);
+  metrics->scale = 1;
+  metrics->ascent = font->ascent;
+  metrics->descent = font->descent + 1;
+
+  gdk_threads_leave();
+
+  return 0;
+}
+
+/**
+ * Let go of the GDK lock before the layouter is called from the GTK+
+ * main loop, which holds the lock in timeouts and signal handlers. The
+ * layouter measures text through gtkui_set_size() and
+ * gtkui_get_font_metrics(), which take the lock themselves, and they
+ * are also called from the threads that layout table cells while this
+ * thread waits for them. Nothing may be drawn until gtkui_layout_done()
+ * has been called.
+ */
+void gtkui_layout_begin(void)
+{
+  gdk_threads_leave();
+}
+
+/**
+ * Take the GDK lock again once the layouter, called after
+ * gtkui_layout_begin(), is done.
+ */
+void gtkui_layout_done(void)
+{
+  gdk_threads_enter();
+}
+
 /**
  * Converts a 32-bit colour value into a GdkColor struct, and match it to
  * the colourmap belonging to the given widget. 
@@ -265,3 +330,40 @@ int gtkui_set_status_text(char *text)
   return 0;
 }
 
+/**
+ * Scroll the current page to the place a URL points at, if it points
+ * at a place on the page itself. A page which is still being loaded is
+ * never scrolled, since the place might not have been layouted yet.
+ *
+ * @param url The URL to scroll to, or NULL to scroll to the place the
+ * @param url page was asked for with.
+ *
+ * @return non-zero value if the page was scrolled, and zero if the URL
+ * @return has to be requested as a new page.
+ */
+int gtkui_scroll_to_anchor(char *url)
+{
+  struct gtkui_information *info = 
+    (struct gtkui_information *)gtkui_ui->ui_specific;
+  int y_position;
+
+  if(info->current_page == NULL || info->rendered_part != NULL)
+    return 0;
+
+  /* Finding the place may layout more of the page, which measures text. */
+  gtkui_layout_begin();
+  y_position = gtkui_ui->ui_functions->find_anchor(info->current_page, url);
+  gtkui_layout_done();
+  if(y_position < 0)
+    return 0;
+
+  /* A page which is being layouted again may have been layouted further
+   * to find the place.
+   */
+  gtkui_render_relayout(y_position + gtkui_ui->ui_display.height);
+
+  gtk_adjustment_set_value(gtk_layout_get_vadjustment(info->display), 
+			   y_position);
+
+  return 1;
+}
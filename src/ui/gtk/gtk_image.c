@@ -185,6 +185,10 @@ static gboolean select_image_link(GtkWidget *widget, GdkEventButton *event,
     button_pressed = 1;
   } else if(button_pressed) {
     button_pressed = 0;
+
+    /* A place on the page itself is only scrolled to. */
+    if(gtkui_scroll_to_anchor(partp->parent->data.link.href))
+      return TRUE;
     
     /* Request the URL that the user clicked upon. */
     status_text = (unsigned char *)
@@ -305,8 +309,8 @@ int gtkui_draw_image(struct layout_part *partp,
   image_information->image_gc = gc;
   image_information->border_gc = border_gc;
   image_information->background_gc = bg_gc;
-  partp->interface_data = (void *)image_information;
-  partp->free_interface_data = gtkui_free_interface_data;
+  gtkui_ui->ui_functions->set_interface_data(partp, (void *)image_information,
+					     gtkui_free_interface_data);
 
   return 0;
 }
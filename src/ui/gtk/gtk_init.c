@@ -62,7 +62,8 @@ int init(int argc, char *argv[], struct zen_ui *ui)
     gtkui_open,
     gtkui_close,
     gtkui_set_size,
-    NULL /* set_palette */
+    NULL, /* set_palette */
+    gtkui_get_font_metrics
   };
   static struct gtkui_information gtkui_specific;
 
@@ -81,6 +82,7 @@ int init(int argc, char *argv[], struct zen_ui *ui)
   ui->ui_support.freemove = 1;
   ui->ui_support.scrollable_x = 1;
   ui->ui_support.scrollable_y = 1;
+  ui->ui_support.partial_layout = 1;
 
   ui->ui_settings.min_fontsize = 8;
   ui->ui_settings.max_fontsize = 72;
@@ -143,8 +143,8 @@ int gtkui_draw_line(struct layout_part *partp, GtkLayout *display)
   line_information->light_gc = light_gc;
   line_information->dark_gc = dark_gc;
   line_information->background_gc = bg_gc;
-  partp->interface_data = (void *)line_information;
-  partp->free_interface_data = gtkui_free_interface_data;
+  gtkui_ui->ui_functions->set_interface_data(partp, (void *)line_information,
+					     gtkui_free_interface_data);
 
   gtk_signal_connect(GTK_OBJECT(display), "expose_event",
 		     (GtkSignalFunc)render_line_event, (gpointer)partp);
@@ -28,6 +28,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/time.h>
 #include <gtk/gtk.h>
 
 /* For thread_yield function */
@@ -44,6 +45,90 @@
 #define min(a,b) ((a)<(b)?(a):(b))
 #define max(a,b) ((a)>(b)?(a):(b))
 
+/* The number of milliseconds spent on layouting more of a page which is
+ * layouted again, each time the interval check is called.
+ */
+#define RELAYOUT_INTERVAL  20
+
+/**
+ * Get the number of milliseconds since a given time.
+ *
+ * @param start The time to measure from.
+ *
+ * @return the number of milliseconds elapsed.
+ */
+static long elapsed_time(struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+
+  return (now.tv_sec - start->tv_sec) * 1000 + 
+    (now.tv_usec - start->tv_usec) / 1000;
+}
+
+/**
+ * Check if the display has changed its width since the current page was
+ * layouted, and if so, layout the page again and render it. Only what
+ * is shown, and one screen below it, is layouted at once. The rest is
+ * layouted a little at a time by interval_check(). The page is scrolled
+ * to about the same place as before. Nothing is done while a page is
+ * being loaded, since the layouter is then busy with that page.
+ */
+static void check_display_size(void)
+{
+  struct gtkui_information *info = 
+    (struct gtkui_information *)gtkui_ui->ui_specific;
+  struct gtkui_page_information *page_information;
+  GtkAdjustment *adjustment;
+  struct timeval start;
+  gfloat vscroll;
+  int ret;
+
+  if(info->page_id != -1)
+    return;
+
+  gtkui_ui->ui_display.width = GTK_WIDGET(info->display)->allocation.width;
+  gtkui_ui->ui_display.height = GTK_WIDGET(info->display)->allocation.height;
+
+  if(info->current_page == NULL || info->current_page->interface_data == NULL)
+    return;
+
+  page_information = 
+    (struct gtkui_page_information *)info->current_page->interface_data;
+  if(page_information->width == gtkui_ui->ui_display.width ||
+     gtkui_ui->ui_display.width <= 0)
+    return;
+
+  /* The height of the rows of text grows about as much as the display
+   * gets narrower, which tells how far down the same place ends up.
+   */
+  adjustment = gtk_layout_get_vadjustment(info->display);
+  vscroll = adjustment->value * page_information->width / 
+    gtkui_ui->ui_display.width;
+
+  gettimeofday(&start, NULL);
+  gtkui_layout_begin();
+  ret = gtkui_ui->ui_functions->
+    relayout_start(info->current_page, 0,
+		   (int)vscroll + 2 * gtkui_ui->ui_display.height);
+  gtkui_layout_done();
+  if(ret != 0)
+    return;
+#ifdef DEBUG
+  fprintf(stderr, "%s: first screen after %ld ms.\n",
+	  __FUNCTION__, elapsed_time(&start));
+#endif /* DEBUG */
+
+  page_information->width = gtkui_ui->ui_display.width;
+  page_information->vscroll = vscroll;
+  page_information->hscroll = 
+    gtk_layout_get_hadjustment(info->display)->value;
+
+  info->relayouted_part = NULL;
+  gtkui_render(info->current_page, NULL);
+}
+
 /**
  * This function is called with regular intervals from the GTK+ main
  * event loop. It will check for new status messages from the main
@@ -63,6 +148,7 @@ static gint interval_check(gpointer data)
   struct layout_part *partp;
   struct gtkui_page_information *page_information;
   char status_text[2048];
+  struct timeval start;
   int last_progress_image_pointer;
   GdkEventExpose event_expose;
   gboolean *return_code;
@@ -81,12 +167,19 @@ static gint interval_check(gpointer data)
      * We then want to stop the progress logo animation. 
      */
     info->page_id = -1;
+  } else if(partp != NULL && partp == info->current_page && 
+	    info->rendered_part != NULL) {
+    /* More of the page being loaded is ready. Only the new parts are
+     * rendered, since the old ones have not changed.
+     */
+    gtkui_render_more(partp, info->rendered_part->next);
   } else if(partp != NULL) {
     /* Save the adjustment settings from the current page, before
      * rendering the new one. Then, when someone presses the Back
      * button, it will be restored.
      */
-    if(info->current_page != NULL) {
+    if(info->current_page != NULL && 
+       info->current_page->interface_data != NULL) {
       page_information = 
 	(struct gtkui_page_information *)info->current_page->interface_data;
       page_information->hscroll = 
@@ -96,16 +189,51 @@ static gint interval_check(gpointer data)
     }
 
     info->current_page = partp;
+    info->relayouted_part = NULL;
     gtkui_render(partp, NULL);
+
+    if(info->current_page->interface_data == NULL) {
+      page_information = (struct gtkui_page_information *)
+	malloc(sizeof(struct gtkui_page_information));
+      if(page_information == NULL)
+	return FALSE;
+      page_information->hscroll = 0;
+      page_information->vscroll = 0;
+      page_information->width = gtkui_ui->ui_display.width;
+      gtkui_ui->ui_functions->set_interface_data(info->current_page,
+						 (void *)page_information,
+						 gtkui_free_interface_data);
+    }
+  }
+
+  /* If the page is still being loaded, remember how much of it has been
+   * rendered, so that we know where to continue. 
+   */
+  if(error > 0 && partp != NULL) {
+    info->rendered_part = partp->child;
+    while(info->rendered_part && info->rendered_part->next)
+      info->rendered_part = info->rendered_part->next;
+  } else if(error == 0 && partp != NULL) {
+    info->rendered_part = NULL;
     gtkui_set_status_text(NULL);
     info->page_id = -1;
 
-    page_information = (struct gtkui_page_information *)
-      malloc(sizeof(struct gtkui_page_information));
-    if(page_information == NULL)
-      return FALSE;
-    info->current_page->interface_data = (void *)page_information;
-    info->current_page->free_interface_data = gtkui_free_interface_data;
+    /* Show the place on the page that was asked for. */
+    gtkui_scroll_to_anchor(NULL);
+  }
+
+  /* Layout the page again, if the window has been resized. */
+  check_display_size();
+
+  /* Layout more of a page which is being layouted again, a screen at a
+   * time, until it is done or it is time to let the user do something.
+   */
+  if(info->current_page != NULL) {
+    gettimeofday(&start, NULL);
+    while(gtkui_render_relayout(info->current_page->geometry.height + 
+				 gtkui_ui->ui_display.height) &&
+	  elapsed_time(&start) < RELAYOUT_INTERVAL)
+      ;
   }
 
   /* We only want to deal with the progress logo things, if there 
@@ -74,6 +74,21 @@ static void exit_window_event(GtkWidget *widget, gpointer data)
   gtk_main_quit();
 }
 
+/**
+ * This event is called by GTK+ when the display has been scrolled. If
+ * the current page is layouted a piece at a time, and the display now
+ * shows more than has been layouted, only the missing piece is layouted
+ * at once, down to one screen below what is shown.
+ *
+ * @param adjustment
+ * @param data
+ */
+static void scroll_event(GtkAdjustment *adjustment, gpointer data)
+{
+  gtkui_render_relayout((int)(adjustment->value + adjustment->page_size) +
+			gtkui_ui->ui_display.height);
+}
+
 /**
  * This event is called by GTK+ if the back button was clicked.
  * It renders the previous page in the history list. 
@@ -102,6 +117,8 @@ static void back_button_event(GtkButton *button, gpointer data)
     }
 
     info->current_page = info->current_page->previous;
+    info->rendered_part = NULL;
+    info->relayouted_part = NULL;
     gtkui_render(info->current_page, NULL);
     gtkui_set_status_text(NULL);
   }
@@ -135,6 +152,8 @@ static void forward_button_event(GtkButton *button, gpointer data)
     }
 
     info->current_page = info->current_page->next;
+    info->rendered_part = NULL;
+    info->relayouted_part = NULL;
     gtkui_render(info->current_page, NULL);
     gtkui_set_status_text(NULL);
   }
@@ -422,6 +441,8 @@ GtkWidget *gtkui_create_window(int width, int height)
 
   vadjustment = gtk_layout_get_vadjustment(GTK_LAYOUT(layout));
   vadjustment->step_increment = 8;
+  gtk_signal_connect(GTK_OBJECT(vadjustment), "value_changed",
+		     GTK_SIGNAL_FUNC(scroll_event), NULL);
   hadjustment = gtk_layout_get_hadjustment(GTK_LAYOUT(layout));
   hadjustment->step_increment = 8;
 
@@ -447,6 +468,8 @@ GtkWidget *gtkui_create_window(int width, int height)
   }
 
   info->current_page = NULL;
+  info->rendered_part = NULL;
+  info->relayouted_part = NULL;
   info->page_id = -1;
   info->progress_image_pointer = 0;
 
@@ -330,6 +330,10 @@ int gtkui_render(struct layout_part *parts, GtkLayout *display)
       gtkui_draw_text(partp, display);
       break;
 
+    case LAYOUT_PART_PREFORMATTED:
+      gtkui_draw_preformatted(partp, display);
+      break;
+
     case LAYOUT_PART_GRAPHICS:
       gtkui_draw_image(partp, display);
       break;
@@ -391,3 +395,107 @@ int gtkui_render(struct layout_part *parts, GtkLayout *display)
   return 0;
 }
 
+/**
+ * Render parts which have been added to the end of a page that is 
+ * already rendered. This is used while the page is still being loaded,
+ * to show more of it as it arrives.
+ *
+ * @param page A pointer to the page information part of the page.
+ * @param parts A pointer to the first new part on the page.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int gtkui_render_more(struct layout_part *page, struct layout_part *parts)
+{
+  struct gtkui_information *info = 
+    (struct gtkui_information *)gtkui_ui->ui_specific;
+  struct layout_rectangle area;
+  GtkLayout *display;
+  int old_width, old_height;
+
+  display = info->display;
+  old_width = display->width;
+  old_height = display->height;
+
+  gtk_layout_set_size(display, page->geometry.width, page->geometry.height);
+  gtk_layout_freeze(display);
+
+  /* Fill the background of what the page has grown with. */
+  if(page->geometry.height > old_height) {
+    area.x_position = 0;
+    area.y_position = old_height;
+    area.width = page->geometry.width;
+    area.height = page->geometry.height - old_height;
+    gtkui_fill_area(area, display, info->default_background_colour);
+  }
+  if(page->geometry.width > old_width) {
+    area.x_position = old_width;
+    area.y_position = 0;
+    area.width = page->geometry.width - old_width;
+    area.height = old_height;
+    gtkui_fill_area(area, display, info->default_background_colour);
+  }
+
+  gtkui_render(parts, display);
+
+  gtk_layout_thaw(display);
+  gtk_widget_show_all(GTK_WIDGET(display));
+
+  return 0;
+}
+
+/**
+ * Layout more of the current page, if it is being layouted a piece at a
+ * time, until it reaches a given height, and render what has been
+ * added to it. A page which was left before it was finished is
+ * continued when it is shown again.
+ *
+ * @param height The height that the page should reach.
+ *
+ * @return non-zero value if there is more of the page left.
+ */
+int gtkui_render_relayout(int height)
+{
+  struct gtkui_information *info = 
+    (struct gtkui_information *)gtkui_ui->ui_specific;
+  struct layout_part *page, *partp;
+  int ret;
+
+  /* A page which is still being loaded is layouted by the loader. */
+  page = info->current_page;
+  if(page == NULL || info->rendered_part != NULL ||
+     page->data.page_information.relayout == NULL)
+    return 0;
+
+  /* Everything on the page was rendered when it was shown. */
+  if(info->relayouted_part == NULL) {
+    info->relayouted_part = page->child;
+    while(info->relayouted_part && info->relayouted_part->next)
+      info->relayouted_part = info->relayouted_part->next;
+  }
+
+  /* Called from the main loop, so the layouter must not measure text
+   * while this holds the GDK lock.
+   */
+  gtkui_layout_begin();
+  ret = gtkui_ui->ui_functions->relayout_more(page, height);
+  gtkui_layout_done();
+
+  if(info->relayouted_part == NULL)
+    partp = page->child;
+  else
+    partp = info->relayouted_part->next;
+  if(partp != NULL) {
+    gtkui_render_more(page, partp);
+    info->relayouted_part = partp;
+    while(info->relayouted_part->next)
+      info->relayouted_part = info->relayouted_part->next;
+  }
+
+  if(ret <= 0) {
+    info->relayouted_part = NULL;
+    return 0;
+  }
+
+  return 1;
+}
@@ -110,8 +110,8 @@ static gint render_text_event(GtkWidget *widget, GdkEventExpose *event,
 		       partrect.width, partrect.height);
 
 #ifdef DEBUG
-    fprintf(stderr, "%s(%d): '%s' %dx%d+%d+%d\n", __FUNCTION__, __LINE__, 
-	    partp->data.text.text,
+    fprintf(stderr, "%s(%d): '%.*s' %dx%d+%d+%d\n", __FUNCTION__, __LINE__, 
+	    partp->data.text.length, partp->data.text.text,
 	    clipping.width, clipping.height,
 	    clipping.x, clipping.y);
 #endif /* DEBUG */
@@ -119,9 +119,9 @@ static gint render_text_event(GtkWidget *widget, GdkEventExpose *event,
     window = display->bin_window;
   }
 
-  gdk_draw_string(window, font, gc,
-		  partrect.x, partrect.y + font->ascent,
-		  partp->data.text.text);
+  gdk_draw_text(window, font, gc,
+		partrect.x, partrect.y + font->ascent,
+		partp->data.text.text, partp->data.text.length);
 
   /* If the text should be underlined, so it shall be. */
   if(partp->data.text.style.underlined) {
@@ -133,8 +133,8 @@ static gint render_text_event(GtkWidget *widget, GdkEventExpose *event,
   }
 
 #ifdef DEBUG
-  fprintf(stderr, "%s(%d): '%s' %d,%d\n", __FUNCTION__, __LINE__, 
-	  partp->data.text.text,
+  fprintf(stderr, "%s(%d): '%.*s' %d,%d\n", __FUNCTION__, __LINE__, 
+	  partp->data.text.length, partp->data.text.text,
 	  partrect.x, partrect.y);
 #endif
 
@@ -214,6 +214,10 @@ static gboolean select_text_link(GtkWidget *widget, GdkEventButton *event,
     button_pressed = 1;
   } else if(button_pressed) {
     button_pressed = 0;
+
+    /* A place on the page itself is only scrolled to. */
+    if(gtkui_scroll_to_anchor(partp->parent->data.link.href))
+      return TRUE;
     
     /* Request the URL that the user clicked upon. */
     status_text = (unsigned char *)
@@ -256,7 +260,7 @@ int gtkui_draw_text(struct layout_part *partp, GtkLayout *display)
   int is_link;
 
   /* An empty string is pointless to draw. */
-  if(partp->data.text.text[0] == '\0')
+  if(partp->data.text.length == 0)
     return 0;
 
   if(partp->parent && partp->parent->type == LAYOUT_PART_LINK)
@@ -345,9 +349,144 @@ int gtkui_draw_text(struct layout_part *partp, GtkLayout *display)
   text_information->font = font;
   text_information->text_gc = gc;
   text_information->background_gc = bg_gc;
-  partp->interface_data = (void *)text_information;
-  partp->free_interface_data = gtkui_free_interface_data;
+  gtkui_ui->ui_functions->set_interface_data(partp, (void *)text_information,
+					     gtkui_free_interface_data);
 
   return 0;
 }
 
+
+/**
+ * This draws the lines of a preformatted block, which are within the
+ * area that needs redrawing. Lines outside of it are not even looked at,
+ * so a long block is just as quick to redraw as a short one.
+ *
+ * @param widget The widget which needs redrawing.
+ * @param event The event data for the redrawing.
+ * @param data A pointer to the layout part of the block.
+ *
+ * @return
+ */
+static gint render_preformatted_event(GtkWidget *widget, 
+				      GdkEventExpose *event, gpointer data)
+{
+  struct layout_part *partp;
+  struct layout_part_preformatted_data *block;
+  struct gtkui_text_information *text_information;
+  GtkLayout *display;
+  GdkFont *font;
+  GdkGC *gc;
+  GdkRectangle partrect, clipping;
+  char *text;
+  int first, last, i, y_position;
+
+  partp = (struct layout_part *)data;
+  block = &partp->data.preformatted;
+  display = GTK_LAYOUT(widget);    
+
+  partrect.x = partp->geometry.x_position - display->xoffset;
+  partrect.y = partp->geometry.y_position - display->yoffset;
+  partrect.width = partp->geometry.width;
+  partrect.height = partp->geometry.height;
+  if(block->line_height <= 0 ||
+     !gdk_rectangle_intersect(&event->area, &partrect, &clipping))
+    return FALSE;
+
+  text_information = (struct gtkui_text_information *)partp->interface_data;
+  font = text_information->font;
+  gc = text_information->text_gc;
+
+  gdk_gc_set_clip_rectangle(gc, &clipping);
+
+  /* Find the lines that are within the clipping area. */
+  first = (clipping.y - partrect.y) / block->line_height;
+  last = (clipping.y + clipping.height - 1 - partrect.y) / block->line_height;
+  if(last >= block->number_of_lines)
+    last = block->number_of_lines - 1;
+
+  for(i = first ; i <= last ; i++) {
+    text = gtkui_ui->ui_functions->get_line(partp, i);
+    if(text == NULL)
+      break;
+    y_position = partrect.y + i * block->line_height + font->ascent;
+
+    gdk_draw_string(display->bin_window, font, gc,
+		    partrect.x, y_position, text);
+
+    /* If the text should be underlined, so it shall be. */
+    if(block->style.underlined && text[0] != '\0') {
+      gdk_draw_line(display->bin_window, gc,
+		    partrect.x, y_position + 1,
+		    partrect.x + gdk_string_width(font, text) - 1, 
+		    y_position + 1);
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+ * Render a block of preformatted text on the display. The whole block
+ * shares one font and colour, and is redrawn by one event handler.
+ * Blocks are never made inside links, so there is no link to care about.
+ *
+ * @param partp A pointer to the layout part representing the block.
+ * @param display A pointer to the GtkLayout widget to draw on.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int gtkui_draw_preformatted(struct layout_part *partp, GtkLayout *display)
+{
+  struct gtkui_information *info = 
+    (struct gtkui_information *)gtkui_ui->ui_specific;
+  struct gtkui_text_information *text_information;
+  struct layout_part_preformatted_data *block;
+  struct layout_part line;
+  GdkFont *font;
+  GdkGC *gc, *bg_gc;
+  GdkColor colour;
+  uint32_t *bg_colourp;
+
+  block = &partp->data.preformatted;
+
+  text_information = (struct gtkui_text_information *)
+    malloc(sizeof(struct gtkui_text_information));
+  if(text_information == NULL)
+    return 1;
+
+  gtk_signal_connect(GTK_OBJECT(display), "expose_event",
+		     (GtkSignalFunc)render_preformatted_event, (gpointer)partp);
+  gtk_widget_add_events(GTK_WIDGET(display), GDK_EXPOSURE_MASK);
+
+  gc = gdk_gc_new(display->bin_window);
+  bg_gc = gdk_gc_new(display->bin_window);
+
+  /* The font is found just like for a text in the same style. */
+  memset(&line, 0, sizeof(struct layout_part));
+  line.type = LAYOUT_PART_TEXT;
+  line.data.text.style = block->style;
+  font = gtkui_get_font(&line);
+
+  if(block->style.colour & 0x80000000)
+    block->style.colour = info->default_text_colour;
+  else if(block->style.colour & 0x40000000)
+    block->style.colour = info->default_link_colour;
+
+  gtkui_colourvalue_to_gdkcolor(GTK_WIDGET(display), block->style.colour, 
+				&colour);
+  gdk_gc_set_foreground(gc, &colour);
+
+  /* Attract the current background colour value from the current display. */
+  bg_colourp = gtk_object_get_data(GTK_OBJECT(display), "background_colour");
+  gtkui_colourvalue_to_gdkcolor(GTK_WIDGET(display), *bg_colourp, &colour);
+  gdk_gc_set_background(gc, &colour);
+  gdk_gc_set_foreground(bg_gc, &colour);
+
+  text_information->font = font;
+  text_information->text_gc = gc;
+  text_information->background_gc = bg_gc;
+  gtkui_ui->ui_functions->set_interface_data(partp, (void *)text_information,
+					     gtkui_free_interface_data);
+
+  return 0;
+}
@@ -51,6 +51,11 @@
  * @member default_active_link_colour The active link colour for the page.
  * @member default_visited_link_colour The visited link colour for the page.
  * @member current_page A pointer to the currently displayed page.
+ * @member rendered_part The last part rendered of the current page, if
+ * @member rendered_part the page is still being loaded, or else NULL.
+ * @member relayouted_part The last part rendered of the current page, if
+ * @member relayouted_part the page is being layouted a piece at a time,
+ * @member relayouted_part or else NULL.
  * @member page_id The identifier of the currently requested page. 
  */
 struct gtkui_information {
@@ -71,6 +76,8 @@ struct gtkui_information {
   uint32_t default_active_link_colour;
   uint32_t default_visited_link_colour;
   struct layout_part *current_page;
+  struct layout_part *rendered_part;
+  struct layout_part *relayouted_part;
   int page_id;
 };
 
@@ -97,10 +104,12 @@ struct gtkui_link {
  *
  * @member hscroll The horizontal scroll position of the page.
  * @member vscroll The vertical scroll position of the page.
+ * @member width The width of the display the page was layouted for.
  */
 struct gtkui_page_information {
   gfloat hscroll;
   gfloat vscroll;
+  int width;
 };
 
 /**
@@ -177,10 +186,18 @@ extern struct zen_ui *gtkui_ui;
 extern int gtkui_open(char *url);
 extern int gtkui_close(void);
 extern int gtkui_render(struct layout_part *partp, GtkLayout *display);
+extern int gtkui_render_more(struct layout_part *page, 
+			     struct layout_part *parts);
+extern int gtkui_render_relayout(int height);
 extern int gtkui_set_title(char *title_text);
 extern int gtkui_set_url(char *url);
 extern int gtkui_set_status_text(char *text);
+extern int gtkui_scroll_to_anchor(char *url);
+extern void gtkui_layout_begin(void);
+extern void gtkui_layout_done(void);
 extern int gtkui_draw_text(struct layout_part *partp, GtkLayout *display);
+extern int gtkui_draw_preformatted(struct layout_part *partp, 
+				   GtkLayout *display);
 extern int gtkui_draw_image(struct layout_part *partp, GtkLayout *display);
 extern int gtkui_draw_line(struct layout_part *partp, GtkLayout *display);
 extern int gtkui_draw_table(struct layout_part *partp, GtkLayout *display);
@@ -193,6 +210,8 @@ extern int gtkui_draw_form_radio(struct layout_part *partp,
 extern int gtkui_draw_form_text(struct layout_part *partp, 
 				GtkLayout *display);
 extern int gtkui_set_size(struct layout_part *partp);
+extern int gtkui_get_font_metrics(struct layout_text_styles *style,
+				  struct zen_ui_font_metrics *metrics);
 extern void gtkui_free_interface_data(struct layout_part *partp);
 
 extern GdkFont *gtkui_get_font(struct layout_part *textp);
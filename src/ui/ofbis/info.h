@@ -90,6 +90,9 @@ extern int ofbis_set_status_text(char *text);
 extern int ofbis_draw_text(struct layout_part *partp,
 			   struct layout_rectangle geometry,
 			   struct layout_rectangle scroll);
+extern int ofbis_draw_preformatted(struct layout_part *partp,
+				   struct layout_rectangle geometry,
+				   struct layout_rectangle scroll);
 extern int ofbis_draw_image(struct layout_part *partp,
 			    struct layout_rectangle geometry,
 			    struct layout_rectangle scroll);
@@ -101,6 +104,8 @@ extern int ofbis_draw_table(struct layout_part *partp,
 			    struct layout_rectangle scroll);
 extern int ofbis_set_palette(int *red, int *green, int *blue);
 extern int ofbis_set_size(struct layout_part *partp);
+extern int ofbis_get_font_metrics(struct layout_text_styles *style,
+				  struct zen_ui_font_metrics *metrics);
 
 extern int ofbis_set_colour(int index, uint32_t colour);
 extern int ofbis_fill_area(struct layout_rectangle geometry, 
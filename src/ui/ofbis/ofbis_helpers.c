@@ -142,7 +142,7 @@ int ofbis_set_size(struct layout_part *partp)
   switch(partp->type) {
   case LAYOUT_PART_TEXT:
     /* All current fonts in oFBis are always 8 pixels wide. */
-    partp->geometry.width = 8 * strlen(partp->data.text.text);
+    partp->geometry.width = 8 * partp->data.text.length;
     partp->geometry.height = partp->data.text.style.size;
     break;
 
@@ -162,6 +162,29 @@ int ofbis_set_size(struct layout_part *partp)
   return 0;
 }
 
+/**
+ * Get the metrics of the font used for a style of text. All current
+ * fonts in oFBis are 8 pixels wide, and as high as the size of the text.
+ *
+ * @param style The style of the text.
+ * @param metrics A pointer to where the metrics are stored.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int ofbis_get_font_metrics(struct layout_text_styles *style,
+			   struct zen_ui_font_metrics *metrics)
+{
+  int i;
+
+  for(i = 0 ; i < 256 ; i++)
+    metrics->width[i] = 8;
+  metrics->scale = 1;
+  metrics->ascent = style->size;
+  metrics->descent = 0;
+
+  return 0;
+}
+
 /**
  * Fills an area of the screen with a specific colour.
  *
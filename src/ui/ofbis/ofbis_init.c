@@ -62,7 +62,8 @@ int init(int argc, char *argv[], struct zen_ui *ui)
     ofbis_open,
     ofbis_close,
     ofbis_set_size,
-    ofbis_set_palette
+    ofbis_set_palette,
+    ofbis_get_font_metrics
   };
   static struct ofbis_information ofbis_specific;
 
@@ -81,6 +82,7 @@ int init(int argc, char *argv[], struct zen_ui *ui)
   ui->ui_support.freemove = 1;
   ui->ui_support.scrollable_x = 1;
   ui->ui_support.scrollable_y = 1;
+  ui->ui_support.partial_layout = 0;
 
   ui->ui_settings.min_fontsize = 8;
   ui->ui_settings.max_fontsize = 16;
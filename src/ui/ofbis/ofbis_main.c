@@ -388,7 +388,7 @@ int ofbis_main(char *url)
   struct layout_rectangle control_geometry;
 #endif
   char status_text[2048], *new_url;
-  int page_id, error;
+  int page_id, error, y_position;
 
   fb = info->ofbis_fb;
 
@@ -433,6 +433,11 @@ int ofbis_main(char *url)
       ofbis_render(parts, geometry, scroll);
       active_link = NULL;
       ofbis_set_status_text(NULL);
+
+      /* Show the place on the page that was asked for. */
+      y_position = ofbis_ui->ui_functions->find_anchor(parts, NULL);
+      if(y_position > 0)
+	ofbis_scroll_page(parts, 0, y_position);
     }
 
     switch(event.type) {
@@ -547,6 +552,14 @@ int ofbis_main(char *url)
 
       case '\n':
 	if(active_link) {
+	  /* A place on the page itself is only scrolled to. */
+	  y_position = ofbis_ui->ui_functions->
+	    find_anchor(parts, active_link->part->data.link.href);
+	  if(y_position >= 0) {
+	    ofbis_scroll_page(parts, 0, y_position - scroll.y_position);
+	    break;
+	  }
+
 	  page_id = ofbis_ui->ui_functions->
 	    request_page(active_link->part->data.link.href,
 			 parts->data.page_information.url);
@@ -569,6 +582,13 @@ int ofbis_main(char *url)
 	if(link == NULL)
 	  continue;
 
+	y_position = ofbis_ui->ui_functions->
+	  find_anchor(parts, link->part->data.link.href);
+	if(y_position >= 0) {
+	  ofbis_scroll_page(parts, 0, y_position - scroll.y_position);
+	  continue;
+	}
+
 	page_id = ofbis_ui->ui_functions->
 	  request_page(link->part->data.link.href,
 		       parts->data.page_information.url);
@@ -216,8 +216,10 @@ int ofbis_render(struct layout_part *parts, struct layout_rectangle geometry,
 
     /*     fprintf(stderr, "Passed one test.\n"); */
 
+    /* A block of preformatted text is checked line by line instead. */
     if(partp->child == NULL &&
        partp->type != LAYOUT_PART_GRAPHICS &&
+       partp->type != LAYOUT_PART_PREFORMATTED &&
        (partp->geometry.x_position - scroll.x_position < 
 	geometry.x_position ||
 	partp->geometry.y_position - scroll.y_position < 
@@ -276,6 +278,10 @@ int ofbis_render(struct layout_part *parts, struct layout_rectangle geometry,
       ofbis_draw_text(partp, geometry, scroll);
       break;
 
+    case LAYOUT_PART_PREFORMATTED:
+      ofbis_draw_preformatted(partp, geometry, scroll);
+      break;
+
     case LAYOUT_PART_GRAPHICS:
       ofbis_draw_image(partp, geometry, scroll);
       break;
@@ -65,7 +65,7 @@ int ofbis_draw_text(struct layout_part *partp,
   fb = info->ofbis_fb;
 
   /* An empty string is pointless to draw. */
-  if(partp->data.text.text[0] == '\0')
+  if(partp->data.text.length == 0)
     return 0;
 
   /* Check if we are to use the default colour for this text. */
@@ -96,7 +96,7 @@ int ofbis_draw_text(struct layout_part *partp,
     info->x_position;
   y_position = partp->geometry.y_position - scroll.y_position +
     info->y_position;
-  for(i = 0 ; i < strlen(partp->data.text.text) ; i++) {
+  for(i = 0 ; i < partp->data.text.length ; i++) {
     FBputchar(fb, x_position, y_position, 
 	      colour, 0x80000000, 
 	      partp->data.text.text[i]);
@@ -124,3 +124,66 @@ int ofbis_draw_text(struct layout_part *partp,
   return 0;
 }
 
+
+/**
+ * Render the lines of a block of preformatted text, which fit within
+ * the display. Just like for text parts, lines that do not fit
+ * completely are left out. Only the lines that may fit are looked at.
+ *
+ * @param partp A pointer to the layout part representing the block.
+ * @param geometry The current geometry of the display, describing what
+ * @param geometry and where to render the block.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int ofbis_draw_preformatted(struct layout_part *partp,
+			    struct layout_rectangle geometry,
+			    struct layout_rectangle scroll)
+{
+  struct layout_part_preformatted_data *block;
+  struct layout_part line;
+  int i, first, top;
+
+  block = &partp->data.preformatted;
+  if(block->line_height <= 0)
+    return 0;
+
+  memset(&line, 0, sizeof(struct layout_part));
+  line.type = LAYOUT_PART_TEXT;
+  line.parent = partp->parent;
+  line.data.text.style = block->style;
+  line.geometry.x_position = partp->geometry.x_position;
+
+  if(line.geometry.x_position - scroll.x_position < geometry.x_position)
+    return 0;
+
+  /* Skip the lines above the display. */
+  top = partp->geometry.y_position - scroll.y_position;
+  first = 0;
+  if(top < geometry.y_position)
+    first = ((geometry.y_position - top + block->line_height - 1) / 
+	     block->line_height);
+
+  for(i = first ; i < block->number_of_lines ; i++) {
+    line.geometry.y_position = partp->geometry.y_position + 
+      i * block->line_height;
+    line.data.text.text = ofbis_ui->ui_functions->get_line(partp, i);
+    if(line.data.text.text == NULL)
+      break;
+    line.data.text.length = strlen(line.data.text.text);
+    ofbis_set_size(&line);
+
+    /* The rest of the lines are below the display. */
+    if(line.geometry.y_position - scroll.y_position + 
+       line.geometry.height - 1 > geometry.y_position + geometry.height - 1)
+      break;
+
+    if(line.geometry.x_position - scroll.x_position + 
+       line.geometry.width - 1 > geometry.x_position + geometry.width - 1)
+      continue;
+
+    ofbis_draw_text(&line, geometry, scroll);
+  }
+
+  return 0;
+}
@@ -94,6 +94,7 @@ extern int psdump_set_url(char *url);
 extern int psdump_set_status_text(char *text);
 #endif
 extern int psdump_draw_text(struct layout_part *partp);
+extern int psdump_draw_preformatted(struct layout_part *partp);
 extern int psdump_draw_image(struct layout_part *partp);
 extern int psdump_draw_line(struct layout_part *partp);
 extern int psdump_draw_table(struct layout_part *partp);
@@ -109,7 +110,10 @@ extern void psdump_new_page(int next_y);
 extern int psdump_choose_font(struct layout_part *partp,
 			       char *fontnamebuffer);
 /*extern int psdump_get_character_width(char *font, char c);*/
-extern double psdump_get_string_width(char *string, char *fontname, int fontsize);
+extern double psdump_get_string_width(char *string, int length,
+				      char *fontname, int fontsize);
+extern int psdump_get_font_metrics(struct layout_text_styles *style,
+				   struct zen_ui_font_metrics *metrics);
 
 #if 0
 extern int psdump_set_colour(int index, uint32_t colour);
@@ -170,12 +170,14 @@ static FontInfo *get_fontinfo(char *fontname) {
  * a given font size.
  *
  * @param string the string to be measured
+ * @param length number of characters in the string
  * @param fontname name of the font, like "Times-Roman"
  * @param fontsize font size in points
  *
  * @return width in points, or negative value on error
  */
-double psdump_get_string_width(char *string, char *fontname, int fontsize) {
+double psdump_get_string_width(char *string, int length, char *fontname,
+			       int fontsize) {
   FontInfo *fontinfo;
   double sum = 0.0, ratio;
   int i, c;
@@ -186,7 +188,7 @@ double psdump_get_string_width(char *string, char *fontname, int fontsize) {
 
   /* What is the real algorithm? It seems I will have to RTFM. */
   ratio = (double)fontsize / /*(double)fontinfo->gfi->xHeight*/ 1000.0;
-  for (i = 0; i < strlen(string); i++) {
+  for (i = 0; i < length; i++) {
     c = (int)(unsigned char)string[i];
     if (c < 256)
       sum += fontinfo->cwi[c] * ratio;
@@ -195,6 +197,45 @@ double psdump_get_string_width(char *string, char *fontname, int fontsize) {
   return sum;
 }
 
+/**
+ * Return the metrics of the font used for a given style of text. The
+ * character widths of the AFM file are in thousandths of the font
+ * size, so the widths given are scaled by 1000.
+ *
+ * @param style the style of the text
+ * @param metrics where to store the metrics
+ *
+ * @return zero
+ */
+int psdump_get_font_metrics(struct layout_text_styles *style,
+			    struct zen_ui_font_metrics *metrics) {
+  struct layout_part text;
+  FontInfo *fontinfo;
+  char font[30];
+  int i;
+
+  memset(&text, 0, sizeof(struct layout_part));
+  text.type = LAYOUT_PART_TEXT;
+  text.data.text.style = *style;
+  psdump_choose_font(&text, font);
+
+  /* Without an AFM file, psdump_set_size() guesses half the font size
+   * for each character, and so does this.
+   */
+  fontinfo = get_fontinfo(font);
+  for (i = 0; i < 256; i++) {
+    if (fontinfo == NULL)
+      metrics->width[i] = style->size / 2;
+    else
+      metrics->width[i] = fontinfo->cwi[i] * style->size;
+  }
+  metrics->scale = (fontinfo == NULL ? 1 : 1000);
+  metrics->ascent = style->size;
+  metrics->descent = 0;
+
+  return 0;
+}
+
 /**
  * Choose a font according to information in layout_part, and
  * return in supplied buffer.
@@ -168,9 +168,12 @@ int psdump_set_size(struct layout_part *partp)
       double width;
 
       psdump_choose_font(partp, font);
-      width = psdump_get_string_width(partp->data.text.text, font, partp->data.text.style.size);
+      width = psdump_get_string_width(partp->data.text.text,
+				      partp->data.text.length,
+				      font, partp->data.text.style.size);
       if (width < 0)
-	partp->geometry.width = (partp->data.text.style.size/2) * strlen(partp->data.text.text);
+	partp->geometry.width = ((partp->data.text.style.size/2) *
+				 partp->data.text.length);
       else
 	partp->geometry.width = psdump_untranslate_width(width);
       partp->geometry.height = partp->data.text.style.size;
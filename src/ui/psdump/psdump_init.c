@@ -62,7 +62,8 @@ int init(int argc, char *argv[], struct zen_ui *ui)
     psdump_open,
     psdump_close,
     psdump_set_size,
-    NULL
+    NULL,
+    psdump_get_font_metrics
   };
   static struct psdump_information psdump_specific;
 
@@ -83,6 +84,7 @@ int init(int argc, char *argv[], struct zen_ui *ui)
   ui->ui_support.freemove = 0;
   ui->ui_support.scrollable_x = 0;
   ui->ui_support.scrollable_y = 0;
+  ui->ui_support.partial_layout = 0;
 
   ui->ui_settings.min_fontsize = 8;
   ui->ui_settings.max_fontsize = 36;
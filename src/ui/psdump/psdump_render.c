@@ -203,7 +203,10 @@ int psdump_render(struct layout_part *parts)
     */
 
     if (psdump_translate_y(partp->geometry.y_position + partp->geometry.height) < info->bottom_margin) {
-      if (partp->type != LAYOUT_PART_TABLE && partp->type != LAYOUT_PART_PAGE_INFORMATION) {
+      /* A block of preformatted text is split over the pages by line. */
+      if (partp->type != LAYOUT_PART_TABLE &&
+	  partp->type != LAYOUT_PART_PAGE_INFORMATION &&
+	  partp->type != LAYOUT_PART_PREFORMATTED) {
 	psdump_new_page(partp->geometry.y_position);
       }
     }
@@ -312,6 +315,10 @@ int psdump_render(struct layout_part *parts)
       psdump_draw_text(partp);
       break;
 
+    case LAYOUT_PART_PREFORMATTED:
+      psdump_draw_preformatted(partp);
+      break;
+
     case LAYOUT_PART_GRAPHICS:
       psdump_draw_image(partp);
       break;
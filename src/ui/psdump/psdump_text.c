@@ -56,7 +56,7 @@ int psdump_draw_text(struct layout_part *partp /* , */
   char font[30];
 
   /* An empty string is pointless to draw. */
-  if(partp->data.text.text[0] == '\0')
+  if(partp->data.text.length == 0)
     return 0;
 
   /* Check if we are to use the default colour for this text. */
@@ -98,7 +98,7 @@ int psdump_draw_text(struct layout_part *partp /* , */
   /* Parantheses and backslashes are to be escaped with a
    * backslash.
    */
-  for (i = 0; i < strlen(partp->data.text.text); i++) {
+  for (i = 0; i < partp->data.text.length; i++) {
     switch (partp->data.text.text[i]) {
     case '(':
     case ')':
@@ -129,3 +129,47 @@ int psdump_draw_text(struct layout_part *partp /* , */
 }
 
   
+
+/**
+ * Render a block of preformatted text, one line at a time, just as if
+ * each line were a text part of its own. A new page is started before
+ * any line that does not fit on the current one.
+ *
+ * @param partp A pointer to the layout part representing the block.
+ *
+ * @return non-zero value if an error occurred.
+ */
+int psdump_draw_preformatted(struct layout_part *partp)
+{
+  struct psdump_information *info = 
+    (struct psdump_information *)psdump_ui->ui_specific;
+  struct layout_part_preformatted_data *block;
+  struct layout_part line;
+  int i;
+
+  block = &partp->data.preformatted;
+
+  memset(&line, 0, sizeof(struct layout_part));
+  line.type = LAYOUT_PART_TEXT;
+  line.parent = partp->parent;
+  line.data.text.style = block->style;
+  line.geometry.x_position = partp->geometry.x_position;
+
+  for(i = 0 ; i < block->number_of_lines ; i++) {
+    line.data.text.text = psdump_ui->ui_functions->get_line(partp, i);
+    if(line.data.text.text == NULL)
+      break;
+    line.data.text.length = strlen(line.data.text.text);
+    line.geometry.y_position = (partp->geometry.y_position + 
+				i * block->line_height);
+    psdump_set_size(&line);
+
+    if(psdump_translate_y(line.geometry.y_position + line.geometry.height) <
+       info->bottom_margin)
+      psdump_new_page(line.geometry.y_position);
+
+    psdump_draw_text(&line);
+  }
+
+  return 0;
+}
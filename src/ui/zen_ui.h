@@ -44,6 +44,23 @@ enum zen_ui_types {
   ZEN_UI_GRAPHICAL
 };
 
+/**
+ * The metrics of the font used for one style of text. The width of a
+ * string is the sum of the widths of its characters, divided by scale
+ * and rounded down, and its height is the ascent and descent together.
+ *
+ * @member width The advance width of each character, in parts of a pixel.
+ * @member scale The number of parts of a pixel the widths are given in.
+ * @member ascent The height of the font above the baseline, in pixels.
+ * @member descent The height of the font below the baseline, in pixels.
+ */
+struct zen_ui_font_metrics {
+  int width[256];
+  int scale;
+  int ascent;
+  int descent;
+};
+
 /**
  * Contains the operations used by the generic user interface to setup
  * the specific user interfaces. Each interface will set the functions
@@ -65,12 +82,23 @@ enum zen_ui_types {
  * @member set_size size of the part. This operation is required.
  * @member set_palette Operation to set the palette of the interface. This 
  * @member set_palette is an optional operation. It might disappear.
+ * @member get_font_metrics Operation to get the metrics of the font used
+ * @member get_font_metrics for a style of text, which lets the layouter
+ * @member get_font_metrics measure text without calling set_size for each
+ * @member get_font_metrics string. The metrics may only depend on the size
+ * @member get_font_metrics of the text, and if it is bold, italic or
+ * @member get_font_metrics monospaced, since they are kept for each such
+ * @member get_font_metrics combination. A non-zero return value means that
+ * @member get_font_metrics the text has to be measured by set_size. This
+ * @member get_font_metrics is an optional operation.
  */
 struct zen_ui_operations {
   int (*open)(char *url);
   int (*close)(void);
   int (*set_size)(struct layout_part *partp);
   int (*set_palette)(int *red, int *green, int *blue);
+  int (*get_font_metrics)(struct layout_text_styles *style,
+			  struct zen_ui_font_metrics *metrics);
 };
 
 /**
@@ -92,11 +120,44 @@ struct zen_ui_operations {
  * @member poll_page This is used by the interface to poll the main program
  * @member poll_page for a new page, after calling request_page.
  * @member poll_page This is NULL for non-interactive interfaces.
+ * @member poll_page A positive return value means that the page is still
+ * @member poll_page being loaded. It may be shown, and the same page will
+ * @member poll_page be returned again with more parts added at its end.
  * @member get_status Get a text string containing information about the
  * @member get_status current status of the main program. This is used for
  * @member get_status progress meters and other information.
  * @member get_setting Get a configuration setting.
  * @member set_setting Set a configuration setting.
+ * @member get_line Get one line of a block of preformatted text. The line
+ * @member get_line is only valid until the next line of the same block is
+ * @member get_line taken, and NULL is returned if there is no such line.
+ * @member find_anchor Find the Y position on a completely loaded page
+ * @member find_anchor that a URL points at, so that following a link to
+ * @member find_anchor a place on the same page only means scrolling it.
+ * @member find_anchor A negative value means that the URL is for another
+ * @member find_anchor page, which has to be requested. With a NULL URL,
+ * @member find_anchor the place the page was asked for with is found.
+ * @member relayout_page Layout a completely loaded page again, within a
+ * @member relayout_page new width, or within the width of the display if
+ * @member relayout_page the width is zero. This is used when the display
+ * @member relayout_page has changed its size, and does not load or parse
+ * @member relayout_page the page again. The page must then be rendered
+ * @member relayout_page again from the beginning.
+ * @member relayout_start Start to layout a completely loaded page again,
+ * @member relayout_start like relayout_page, but only down to a given
+ * @member relayout_start height, such as the bottom of what is shown.
+ * @member relayout_start The page can then be rendered from the beginning
+ * @member relayout_start at once, while the rest is layouted later.
+ * @member relayout_more Layout more of a page started on by relayout_start,
+ * @member relayout_more until it reaches a given height, or all of it if
+ * @member relayout_more the height is zero. The parts already on the page
+ * @member relayout_more do not change, and new ones are added after them.
+ * @member relayout_more A positive value means that there is more left.
+ * @member set_interface_data Give a part data of the interface, together
+ * @member set_interface_data with the function which frees it, or NULL
+ * @member set_interface_data to have it freed as it is. The data must be
+ * @member set_interface_data set with this, and not directly in the part,
+ * @member set_interface_data for it to be freed when the page is.
  */
 struct zen_ui_functions {
   struct layout_part *(*get_page)(char *url, char *referer);
@@ -105,6 +166,13 @@ struct zen_ui_functions {
   int (*get_status)(int page_id, char *status, int max_length);
   enum zen_settings_type (*get_setting)(char *setting, void **value);
   int (*set_setting)(char *setting, void *value, enum zen_settings_type type);
+  char *(*get_line)(struct layout_part *partp, int index);
+  int (*find_anchor)(struct layout_part *page, char *url);
+  int (*relayout_page)(struct layout_part *page, int width);
+  int (*relayout_start)(struct layout_part *page, int width, int height);
+  int (*relayout_more)(struct layout_part *page, int height);
+  void (*set_interface_data)(struct layout_part *partp, void *data,
+			     void (*free_data)(struct layout_part *partp));
 };
 
 /**
@@ -131,6 +199,10 @@ struct zen_ui_functions {
  * @member scrollable_x scroll in the X direction.
  * @member scrollable_y non-zero value means the interface is able to
  * @member scrollable_y scroll in the Y direction.
+ * @member partial_layout Non-zero value means the interface layouts the
+ * @member partial_layout rest of a loaded page itself with relayout_more,
+ * @member partial_layout as it is scrolled down, so only the first screens
+ * @member partial_layout of a page are layouted while it is loaded.
  */
 struct zen_ui_support {
   int table;
@@ -142,6 +214,7 @@ struct zen_ui_support {
   int freemove;
   int scrollable_x;
   int scrollable_y;
+  int partial_layout;
 };
 
 /**